@@ -20,6 +20,7 @@ struct GlobalDeviceConfigurationStruct SB_GlobalDeviceConfiguration = {
 	.BLECheckInterval = 10,
 	.CheckReadDelayMS = 0,
 	.MaxTransmitStateTimeS = 10,
+	.TemperatureResolution = 3, // MCP9808_RESOLUTION_0P0625
 };
 
 /*
@@ -37,7 +38,9 @@ PIN_Config BoardGpioInitTable[] = {
 	// Analog Pins
 	Board_BANDAGE_A_0    | PIN_GPIO_OUTPUT_EN | PIN_GPIO_LOW | PIN_PUSHPULL | PIN_DRVSTR_MAX,
 	Board_CONN_STATE_RD  | PIN_GPIO_OUTPUT_EN | PIN_GPIO_LOW | PIN_PUSHPULL | PIN_DRVSTR_MAX,
+#ifndef SENSORTAG_HW
 	Board_VSENSE_0       | PIN_GPIO_OUTPUT_EN | PIN_GPIO_LOW | PIN_PUSHPULL | PIN_DRVSTR_MAX,
+#endif
 	Board_VSENSE_1		 | PIN_GPIO_OUTPUT_EN | PIN_GPIO_LOW | PIN_PUSHPULL | PIN_DRVSTR_MAX,
 	Board_1V3			 | PIN_GPIO_OUTPUT_EN | PIN_GPIO_LOW | PIN_PUSHPULL | PIN_DRVSTR_MAX,
 
@@ -93,3 +96,102 @@ const I2C_Config I2C_config[] = {
 /*
  *  ========================== I2C end =========================================
 */
+
+#ifdef SB_TRACE_UART
+/*
+ *  ============================= UART begin ===================================
+*/
+/* Place into subsections to allow the TI linker to remove items properly */
+#if defined(__TI_COMPILER_VERSION__)
+#pragma DATA_SECTION(UART_config, ".const:UART_config")
+#pragma DATA_SECTION(uartCC26XXHWAttrs, ".const:uartCC26XXHWAttrs")
+#endif
+
+/* Include drivers */
+#include <ti/drivers/UART.h>
+#include <ti/drivers/uart/UARTCC26XX.h>
+
+/* UART objects */
+UARTCC26XX_Object uartCC26XXObjects[CC2650_UARTCOUNT];
+
+/* UART hardware parameter structure, also used to assign UART pins. Only TX is used, by trace.c */
+const UARTCC26XX_HWAttrs uartCC26XXHWAttrs[CC2650_UARTCOUNT] = {
+    {
+        .baseAddr = UART0_BASE,
+        .intNum = INT_UART0,
+        .powerMngrId = PERIPH_UART0,
+        .txPin = Board_UART_TX,
+        .rxPin = PIN_UNASSIGNED,
+        .ctsPin = PIN_UNASSIGNED,
+        .rtsPin = PIN_UNASSIGNED
+    }
+};
+
+/* UART configuration structure */
+const UART_Config UART_config[] = {
+    {&UARTCC26XX_fxnTable, &uartCC26XXObjects[0], &uartCC26XXHWAttrs[0]},
+    {NULL, NULL, NULL}
+};
+/*
+ *  ============================= UART end =====================================
+*/
+#endif
+
+#ifdef SENSORTAG_HW
+/*
+ *  ============================= SPI begin ====================================
+*/
+/* Place into subsections to allow the TI linker to remove items properly */
+#if defined(__TI_COMPILER_VERSION__)
+#pragma DATA_SECTION(UDMACC26XX_config, ".const:UDMACC26XX_config")
+#pragma DATA_SECTION(udmaHWAttrs, ".const:udmaHWAttrs")
+#pragma DATA_SECTION(SPI_config, ".const:SPI_config")
+#pragma DATA_SECTION(spiCC26XXDMAHWAttrs, ".const:spiCC26XXDMAHWAttrs")
+#endif
+
+/* Include drivers */
+#include <ti/drivers/dma/UDMACC26XX.h>
+#include <ti/drivers/spi/SPICC26XXDMA.h>
+
+/* UDMA objects, used by the SPI driver */
+UDMACC26XX_Object UdmaObjects[CC2650_UDMACOUNT];
+
+const UDMACC26XX_HWAttrs udmaHWAttrs[CC2650_UDMACOUNT] = {
+    {
+        .baseAddr = UDMA0_BASE,
+        .powerMngrId = PERIPH_UDMA,
+    }
+};
+
+const UDMACC26XX_Config UDMACC26XX_config[] = {
+    {&UdmaObjects[0], &udmaHWAttrs[0]},
+    {NULL, NULL}
+};
+
+/* SPI objects */
+SPICC26XX_Object spiCC26XXDMAObjects[CC2650_SPICOUNT];
+
+/* SPI configuration structure, describing which pins are to be used. Used for the external flash. */
+const SPICC26XX_HWAttrs spiCC26XXDMAHWAttrs[CC2650_SPICOUNT] = {
+    {
+        .baseAddr = SSI0_BASE,
+        .intNum = INT_SSI0,
+        .powerMngrId = PERIPH_SSI0,
+        .defaultTxBufValue = 0,
+        .rxChannelBitMask = 1<<UDMA_CHAN_SSI0_RX,
+        .txChannelBitMask = 1<<UDMA_CHAN_SSI0_TX,
+        .mosiPin = Board_SPI0_MOSI,
+        .misoPin = Board_SPI0_MISO,
+        .clkPin = Board_SPI0_CLK,
+        .csnPin = Board_SPI0_CSN
+    }
+};
+
+const SPI_Config SPI_config[] = {
+    {&SPICC26XXDMA_fxnTable, &spiCC26XXDMAObjects[0], &spiCC26XXDMAHWAttrs[0]},
+    {NULL, NULL, NULL}
+};
+/*
+ *  ============================= SPI end ======================================
+*/
+#endif
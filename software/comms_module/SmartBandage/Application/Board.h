@@ -96,14 +96,40 @@ extern uint8_t Mcp9808Addresses[];
 /*****************************************************************
  * Time parameters
  ****************************************************************/
-#define SB_TIMESTAMP_T uint32
-#define SB_TIMEDIFF_T  uint16
+#define SB_TIMESTAMP_T uint32		// Seconds
+#define SB_TIMEDIFF_T  uint32		// Milliseconds since the reference timestamp
+
+// The drift of the clock is measured between times set by the phone at least this far apart
+#define SB_CLOCK_DRIFT_MIN_SPAN_S	(6*60*60)
+
+// Measured drifts larger than this are taken to be changes to the phone's time instead
+#define SB_CLOCK_MAX_DRIFT_PPM		500
 
 /*****************************************************************
  * Flash parameters
  ****************************************************************/
 #define SB_REINIT_FLASH_ON_START true
 
+// Archive readings to the external SPI flash when internal flash fills up. Needs Board/Devices/ext_flash.c,
+// Board/Interfaces/bsp_spi.c and the Board_SPI0/Board_SPI_FLASH_CS pins of a board with the flash fitted.
+// Only FlashOnly_ST_OAD_ExtFlash builds Board/; the other configurations exclude it. It is built for the
+// SensorTag hardware, whose flash is described under SPI Configuration. The bandage board has none.
+#ifdef SENSORTAG_HW
+#define SB_FLASH_ARCHIVE
+#endif
+
+/*****************************************************************
+ * Trace parameters
+ ****************************************************************/
+// Log loop, BLE and flash events to a RAM ring instead of printing them. See trace.h.
+#define SB_TRACE
+#define SB_TRACE_BUFFER_WORDS	256		// 1 KB. Must be a power of two.
+
+// Send the trace ring out of the UART instead of leaving it to be read over BLE. Only TX is used,
+// on a DIO that is free on this board but has to be brought out to a header or test point.
+//#define SB_TRACE_UART
+#define SB_TRACE_UART_BAUD		115200
+
 /*****************************************************************
  * External MUX configurations
  ****************************************************************/
@@ -196,6 +222,45 @@ typedef enum CC2650_I2CName {
     CC2650_I2CCOUNT
 } CC2650_I2CName;
 
+#ifdef SB_TRACE_UART
+/*****************************************************************
+ * UART Configuration
+ ****************************************************************/
+#define Board_UART_TX               IOID_15
+#define Board_UART                  CC2650_UART0
+
+typedef enum CC2650_UARTName {
+    CC2650_UART0 = 0,
+    CC2650_UARTCOUNT
+} CC2650_UARTName;
+#endif
+
+#ifdef SENSORTAG_HW
+/*****************************************************************
+ * SPI Configuration
+ ****************************************************************/
+// The SensorTag's external flash. Its chip select is the bandage board's Board_VSENSE_0, which is
+// left out of the pin tables on this hardware.
+#define Board_SPI0_MISO             IOID_18
+#define Board_SPI0_MOSI             IOID_19
+#define Board_SPI0_CLK              IOID_17
+#define Board_SPI0_CSN              PIN_UNASSIGNED
+#define Board_SPI_FLASH_CS          IOID_14
+#define Board_FLASH_CS_ON           0
+#define Board_FLASH_CS_OFF          1
+#define Board_SPI0                  CC2650_SPI0
+
+typedef enum CC2650_SPIName {
+    CC2650_SPI0 = 0,
+    CC2650_SPICOUNT
+} CC2650_SPIName;
+
+typedef enum CC2650_UdmaName {
+    CC2650_UDMA0 = 0,
+    CC2650_UDMACOUNT
+} CC2650_UdmaName;
+#endif
+
 /*****************************************************************
  * GPIO Configuration
  ****************************************************************/
@@ -239,6 +304,15 @@ typedef enum {
 #define SB_TRANSMIT_MIN_CONN_PERIOD NTICKS_PER_SECOND    // One second
 #define SB_TRANSMIT_MAX_STATE_TIME  NTICKS_PER_SECOND*10 // 10 seconds
 
+// Each connection event while in S_TRANSMIT keeps the state alive at least this much longer
+#define SB_TRANSMIT_CONN_EXTEND_PERIOD    (NTICKS_PER_SECOND*5) // 5 seconds
+
+// Maximum time to wait for the central to drop the link after we terminate it
+#define SB_TRANSMIT_DISCONNECT_TIMEOUT_MS 5000
+
+// Blink period of the BLE status LED while in S_TRANSMIT
+#define SB_TRANSMIT_LED_PERIOD_MS         500
+
 /*****************************************************************
  * Helpers
  ****************************************************************/
@@ -253,6 +327,7 @@ struct GlobalDeviceConfigurationStruct {
 	uint16_t BLECheckInterval;
 	uint16_t CheckReadDelayMS;
 	uint16_t MaxTransmitStateTimeS;
+	uint16_t TemperatureResolution;		// MCP9808_RESOLUTION_* used for each temperature sample
 };
 
 extern struct GlobalDeviceConfigurationStruct SB_GlobalDeviceConfiguration;
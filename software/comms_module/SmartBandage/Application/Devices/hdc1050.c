@@ -70,3 +70,26 @@ SB_Error hdc1050_readTempHumidity(HDC1050_DEVICE *device, Semaphore_Handle *sema
 
 	return transaction.completionResult;
 }
+
+uint16_t hdc1050_conversionTimeUs(uint16_t configuration) {
+	uint16_t temperatureUs, humidityUs;
+
+	switch ((configuration >> HDC1050_REG_CONFIGURATION_HRES) & 0x3) {
+	case HDC1050_REG_CONFIGURATION_HRES_14BIT: humidityUs = (uint16_t)(HDC1050_CONV_TIME_HRES_14BIT * 1000); break;
+	case HDC1050_REG_CONFIGURATION_HRES_11BIT: humidityUs = (uint16_t)(HDC1050_CONV_TIME_HRES_11BIT * 1000); break;
+	default:                                   humidityUs = (uint16_t)(HDC1050_CONV_TIME_HRES_8BIT  * 1000); break;
+	}
+
+	if (HDC1050_REG_CONFIGURATION_TRES_11BIT == ((configuration >> HDC1050_REG_CONFIGURATION_TRES) & 0x1)) {
+		temperatureUs = (uint16_t)(HDC1050_CONV_TIME_TRES_11BIT * 1000);
+	} else {
+		temperatureUs = (uint16_t)(HDC1050_CONV_TIME_TRES_14BIT * 1000);
+	}
+
+	// A sequential conversion does both, one after the other. Otherwise only the temperature is converted.
+	if (HDC1050_REG_CONFIGURATION_MODE_SEQUENTIAL == ((configuration >> HDC1050_REG_CONFIGURATION_MODE) & 0x1)) {
+		return temperatureUs + humidityUs;
+	}
+
+	return temperatureUs;
+}
@@ -28,6 +28,11 @@
 #define HDC1050_REG_CONFIGURATION_TRES 10
 #define HDC1050_REG_CONFIGURATION_HRES  8
 
+// Configuration bits that read back as written. Reset reads as 0 and battery status is status.
+#define HDC1050_REG_CONFIGURATION_WRITTEN_MASK \
+	(1 << HDC1050_REG_CONFIGURATION_HEAT | 1 << HDC1050_REG_CONFIGURATION_MODE \
+	| 1 << HDC1050_REG_CONFIGURATION_TRES | 3 << HDC1050_REG_CONFIGURATION_HRES)
+
 #define HDC1050_REG_CONFIGURATION_HEAT_EN   1
 #define HDC1050_REG_CONFIGURATION_HEAT_DSBL 0
 
@@ -60,10 +65,16 @@ typedef struct {
 	uint16_t humidity;
 	uint16_t configuration;
 	uint8_t  address;
-	uint32_t readReadyTime;
 } HDC1050_DEVICE;
 
 SB_Error hdc1050_startTempHumidityConversion(HDC1050_DEVICE *device, Semaphore_Handle *semaphore);
 SB_Error hdc1050_readTempHumidity(HDC1050_DEVICE *device, Semaphore_Handle *semaphore);
 
+/*
+ * The HDC1050 sleeps on its own once a triggered conversion is done, so it draws nothing
+ * between hdc1050_startTempHumidityConversion calls. Returns how long the conversion the
+ * configuration selects takes.
+ */
+uint16_t hdc1050_conversionTimeUs(uint16_t configuration);
+
 #endif /* APPLICATION_DEVICES_HDC1050_H_ */
@@ -6,6 +6,8 @@
  */
 
 #include "mcp9808.h"
+#include "../i2c.h"
+#include <ti/sysbios/BIOS.h>
 
 int16_t mcp9808_convert_raw_temp_data(uint8_t upperByte, uint8_t lowerByte) {
 	if (upperByte & 0x10) {
@@ -15,3 +17,82 @@ int16_t mcp9808_convert_raw_temp_data(uint8_t upperByte, uint8_t lowerByte) {
 		return (upperByte & 0x0F) << 8 | lowerByte;
 	}
 }
+
+static SB_Error mcp9808_transfer(MCP9808_DEVICE *device, Semaphore_Handle *semaphore, uint8_t *txBuf, uint8_t txLen, uint8_t *rxBuf, uint8_t rxLen) {
+	SB_i2cTransaction transaction;
+	I2C_Transaction baseTransaction;
+	SB_Error result;
+
+	baseTransaction.writeCount   = txLen;
+	baseTransaction.writeBuf     = txBuf;
+	baseTransaction.readCount    = rxLen;
+	baseTransaction.readBuf      = rxBuf;
+	baseTransaction.slaveAddress = device->Address;
+
+	transaction.baseTransaction = &baseTransaction;
+	transaction.completionSemaphore = semaphore;
+
+	result = SB_i2cQueueTransaction(&transaction, BIOS_WAIT_FOREVER);
+	if (NoError != result) {
+		return result;
+	}
+
+	Semaphore_pend(*semaphore, BIOS_WAIT_FOREVER);
+
+	return transaction.completionResult;
+}
+
+SB_Error mcp9808_setShutdown(MCP9808_DEVICE *device, Semaphore_Handle *semaphore, MCP9808_SHUTDOWN_STATE state) {
+	uint16_t configuration = (device->Configuration & ~(1 << MCP9808_CONFIG_SHDN)) | state << MCP9808_CONFIG_SHDN;
+	uint8_t txBuf[3];
+	SB_Error result;
+
+	txBuf[0] = MCP9808_REG_CONFIG;
+	txBuf[1] = 0xFF & (configuration >> 8);
+	txBuf[2] = 0xFF & (configuration >> 0);
+
+	if (NoError == (result = mcp9808_transfer(device, semaphore, txBuf, 3, NULL, 0))) {
+		device->Configuration = configuration;
+	}
+
+	return result;
+}
+
+SB_Error mcp9808_setResolution(MCP9808_DEVICE *device, Semaphore_Handle *semaphore, uint8_t resolution) {
+	uint8_t txBuf[2];
+	SB_Error result;
+
+	txBuf[0] = MCP9808_REG_RESOLUTION;
+	txBuf[1] = resolution;
+
+	if (NoError == (result = mcp9808_transfer(device, semaphore, txBuf, 2, NULL, 0))) {
+		device->Resolution = resolution;
+	}
+
+	return result;
+}
+
+SB_Error mcp9808_readTemperature(MCP9808_DEVICE *device, Semaphore_Handle *semaphore) {
+	uint8_t txBuf[1];
+	uint8_t rxBuf[2];
+	SB_Error result;
+
+	txBuf[0] = MCP9808_REG_TA;
+
+	if (NoError == (result = mcp9808_transfer(device, semaphore, txBuf, 1, rxBuf, 2))) {
+		// The temperature sensor is big endian and this device is little endian
+		// Also need to apply the mask for the data from the sensor: 0x0FFF
+		device->Temperature = 0x0FFF & ((rxBuf[0] << 8) | (rxBuf[1]));
+	}
+
+	return result;
+}
+
+uint16_t mcp9808_conversionTimeMs(uint8_t resolution) {
+	switch (resolution) {
+	case MCP9808_RESOLUTION_0P5:    return MCP9808_RES_TCONV_MS_0P5;
+	case MCP9808_RESOLUTION_0P25:   return MCP9808_RES_TCONV_MS_0P25;
+	case MCP9808_RESOLUTION_0P125:  return MCP9808_RES_TCONV_MS_0P125;
+	default:                        return MCP9808_RES_TCONV_MS_0P0625;
+	}
+}
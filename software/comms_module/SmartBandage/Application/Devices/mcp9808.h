@@ -10,6 +10,8 @@
 #define APPLICATION_DEVICES_MCP9808_H_
 
 #include "hci_tl.h"
+#include "../Board.h"
+#include <ti/sysbios/knl/Semaphore.h>
 
 #define MCP9808_REG_CONFIG          0x01
 #define MCP9808_REG_TUPPER          0x02
@@ -32,6 +34,10 @@
 #define MCP9808_CONF_REG_MASK_UPPER (MCP9808_CONF_REG_MASK & 0xFF00)
 #define MCP9808_CONF_REG_MASK_LOWER (MCP9808_CONF_REG_MASK & 0x00FF)
 
+// Configuration bits that read back as written. The rest are status.
+#define MCP9808_CONF_REG_MASK_WRITTEN \
+	(MCP9808_CONF_REG_MASK & ~(1 << MCP9808_CONFIG_ALERT_STATUS | 1 << MCP9808_CONFIG_INT_CLR))
+
 #define MCP9808_MANUFACTURER_ID     0x0054
 #define MCP9808_MIN_DEVICE_ID       0x0400
 
@@ -96,4 +102,13 @@ typedef struct {
 
 extern int16_t mcp9808_convert_raw_temp_data(uint8_t upperByte, uint8_t lowerByte);
 
+/*
+ * The MCP9808 has no one shot mode. A single conversion is made by leaving shutdown, waiting
+ * mcp9808_conversionTimeMs for the resolution, reading, then shutting down again.
+ */
+SB_Error mcp9808_setShutdown(MCP9808_DEVICE *device, Semaphore_Handle *semaphore, MCP9808_SHUTDOWN_STATE state);
+SB_Error mcp9808_setResolution(MCP9808_DEVICE *device, Semaphore_Handle *semaphore, uint8_t resolution);
+SB_Error mcp9808_readTemperature(MCP9808_DEVICE *device, Semaphore_Handle *semaphore);
+uint16_t mcp9808_conversionTimeMs(uint8_t resolution);
+
 #endif /* APPLICATION_DEVICES_MCP9808_H_ */
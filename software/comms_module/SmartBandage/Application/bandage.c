@@ -33,6 +33,7 @@
 
 
 #include "bandage.h"
+#include "energy.h"
 #include "peripheralManager.h"
 
 #define READINGS_AVAIL_WAIT_TIME_MS 10
@@ -128,6 +129,7 @@ SB_Error SB_beginReadBandageImpedances(uint32_t timeout, uint16_t (*readingsBuf)
 	// Configure and enable the ADC using the fixed internal reference, manual triggers, and
 	// the default sample time for the SmartBandage
 	AUXADCEnableSync(AUXADC_REF_FIXED, SB_ADC_SAMPLE_TIME, AUXADC_TRIGGER_MANUAL);
+	SB_energySetLoad(SB_LOAD_ADC, true);
 
 	// Disallow STANDBY mode while using the ADC.
 	Power_setConstraint(Power_SB_DISALLOW);
@@ -151,6 +153,7 @@ SB_Error _readingComplete() {
 
 	// Disable clocks
 	AUXWUCClockDisable(AUX_WUC_ADC_CLOCK | AUX_WUC_ADI_CLOCK);
+	SB_energySetLoad(SB_LOAD_ADC, false);
 
 	// Allow STANDBY mode again
 	Power_releaseConstraint(Power_SB_DISALLOW);
@@ -6,6 +6,7 @@
  */
 #include <string.h>
 
+#include <ti/sysbios/hal/Hwi.h>
 #include <ti/sysbios/knl/Task.h>
 #include <ti/sysbios/knl/Clock.h>
 #include <ti/sysbios/knl/Semaphore.h>
@@ -16,6 +17,7 @@
 #include "gatt.h"
 #include "gapgattserver.h"
 #include "gattservapp.h"
+#include "linkdb.h"
 //#include "devinfoservice.h"
 #include "../PROFILES/smartBandageProfile.h"
 
@@ -28,10 +30,16 @@
 #include "util.h"
 #include "ble.h"
 #include "clock.h"
+#include "energy.h"
+#include "trace.h"
 #include "flash.h"
 
 #include "readingsManager.h"
 
+#if defined(FEATURE_OAD)
+#include "../PROFILES/oad.h"
+#endif //FEATURE_OAD
+
 /*********************************************************************
  * TYPEDEFS
  */
@@ -40,8 +48,28 @@
 typedef struct
 {
   appEvtHdr_t hdr;  // event header.
+  uint8_t seq; // order the event was raised in, across both rings
+  uint16_t connHandle; // connection the event came from, if any
+  uint8_t peerAddr[B_ADDR_LEN]; // address of the central on that connection when the event was raised
 } sbpEvt_t;
 
+// Capacity of each app event ring. A power of two, at most 128.
+#define SB_EVENT_RING_SIZE		16
+
+// Fixed capacity ring of app events with one producer task and the app task as consumer.
+// Only the producer writes head and only the consumer writes tail, so neither side needs a
+// critical section. Every shared field is volatile to keep the event writes ahead of the
+// head update that publishes them. Events carry a sequence number shared by all rings so
+// that the consumer handles them in the order they were raised.
+typedef struct
+{
+	volatile uint8_t head;		// Next slot to fill, free running
+	volatile uint8_t tail;		// Next slot to take, free running
+	volatile uint8_t dropped;	// Events lost to a full ring, written by the producer only
+	uint8_t reported;			// Drops already reported, consumer only
+	volatile sbpEvt_t events[SB_EVENT_RING_SIZE];
+} SB_EventRing;
+
 
 /*********************************************************************
  * LOCAL VARIABLES
@@ -57,12 +85,20 @@ static ICall_EntityID selfEntity;
 // Semaphore globally used to post events to the application thread
 static ICall_Semaphore sem;
 
-// Queue object used for app messages
-static Queue_Struct appMsg;
-static Queue_Handle appMsgQueue;
+// App events from the GAPRole task (state changes) and from the stack task (characteristic
+// writes). One ring per producer keeps each single producer.
+static SB_EventRing stateEvents;
+static SB_EventRing charEvents;
+
+// Sequence number of the next event raised, and of the next event to handle
+static uint8_t raisedEvents = 0;
+static uint8_t handledEvents = 0;
 
 static volatile bool bleConnected = false;
 
+// App events lost to full rings since boot, totalled by the app task
+static uint32_t droppedEvents = 0;
+
 #if defined(FEATURE_OAD)
 // Event data from OAD profile.
 static Queue_Struct oadQ;
@@ -146,16 +182,18 @@ static uint8_t SimpleBLEPeripheral_processStackMsg(ICall_Hdr *pMsg);
 static uint8_t SimpleBLEPeripheral_processGATTMsg(gattMsgEvent_t *pMsg);
 static void SimpleBLEPeripheral_processAppMsg(sbpEvt_t *pMsg);
 static void SimpleBLEPeripheral_processStateChangeEvt(gaprole_States_t newState);
-static void SimpleBLEPeripheral_processCharValueChangeEvt(uint8_t paramID);
+static void SimpleBLEPeripheral_processCharValueChangeEvt(uint16_t connHandle, const uint8_t *peerAddr, uint8_t paramID);
 
 static void SimpleBLEPeripheral_sendAttRsp(void);
 static void SimpleBLEPeripheral_freeAttRsp(uint8_t status);
 
 static void SimpleBLEPeripheral_stateChangeCB(gaprole_States_t newState);
 #ifndef FEATURE_OAD
-static void SimpleBLEPeripheral_charValueChangeCB(uint8_t paramID);
+static void SimpleBLEPeripheral_charValueChangeCB(uint16_t connHandle, uint8_t paramID);
 #endif //!FEATURE_OAD
-static void SimpleBLEPeripheral_enqueueMsg(uint8_t event, uint8_t state);
+static void SimpleBLEPeripheral_enqueueMsg(SB_EventRing *ring, uint8_t event, uint8_t state, uint16_t connHandle, const uint8_t *peerAddr);
+static uint8_t SimpleBLEPeripheral_processAppEvents(void);
+static void SimpleBLEPeripheral_countDropped(SB_EventRing *ring);
 
 /*********************************************************************
  * PROFILE CALLBACKS
@@ -219,9 +257,6 @@ void SimpleBLEPeripheral_init(void)
 	// Set device's Sleep Clock Accuracy
 	//HCI_EXT_SetSCACmd(40);
 
-	// Create an RTOS queue for message from profile to be sent to app.
-	appMsgQueue = Util_constructQueue(&appMsg);
-
 	// Setup the GAP
 	GAP_SetParamValue(TGAP_CONN_PAUSE_PERIPHERAL, DEFAULT_CONN_PAUSE_PERIPHERAL);
 
@@ -327,8 +362,25 @@ SB_Error SB_disableBLE() {
 	return status == SUCCESS ? NoError : UnknownError;
 }
 
-void SB_processBLEMessages() {
+/*********************************************************************
+ * @fn      SB_bleWakeApp
+ *
+ * @brief   Wakes the application task from ICall_wait() without a stack message.
+ * 			Safe to call from Swi (clock) context.
+ */
+void SB_bleWakeApp() {
+	Semaphore_post(sem);
+}
 
+/*********************************************************************
+ * @fn      SB_processBLEMessages
+ *
+ * @brief   Processes any pending stack and application messages
+ *
+ * @return  The number of messages processed
+ */
+uint8_t SB_processBLEMessages() {
+    uint8_t processed = 0;
     ICall_EntityID dest;
     ICall_ServiceEnum src;
     ICall_HciExtEvt *pMsg = NULL;
@@ -362,21 +414,14 @@ void SB_processBLEMessages() {
       {
         ICall_freeMsg(pMsg);
       }
+
+      ++processed;
     }
 
-    // If RTOS queue is not empty, process app message.
-    while (!Queue_empty(appMsgQueue))
-    {
-      sbpEvt_t *pMsg = (sbpEvt_t *)Util_dequeueMsg(appMsgQueue);
-      if (pMsg)
-      {
-        // Process message.
-        SimpleBLEPeripheral_processAppMsg(pMsg);
+    // Process app events, in the order they were raised
+    processed += SimpleBLEPeripheral_processAppEvents();
 
-        // Free the space from the message.
-        ICall_free(pMsg);
-      }
-    }
+    return processed;
 }
 
 /*********************************************************************
@@ -456,23 +501,23 @@ static uint8_t SimpleBLEPeripheral_processGATTMsg(gattMsgEvent_t *pMsg)
     // The app is informed in case it wants to drop the connection.
 
     // Display the opcode of the message that caused the violation.
-	  System_printf("FC Violated:%d\n", pMsg->msg.flowCtrlEvt.opcode);
+	  SB_TRACE1(SB_TRACE_BLE_FLOW_CONTROL, pMsg->msg.flowCtrlEvt.opcode);
   }
   else if (pMsg->method == ATT_MTU_UPDATED_EVENT)
   {
     // MTU size updated
-    System_printf("MTU Size:%d\n", pMsg->msg.mtuEvt.MTU);
+    SB_TRACE2(SB_TRACE_BLE_MTU, pMsg->msg.mtuEvt.MTU, pMsg->connHandle);
   } else if (pMsg->method == ATT_HANDLE_VALUE_NOTI) {
-	  System_printf("GATT handle value notification\n");
+	  SB_TRACE0(SB_TRACE_BLE_NOTIFICATION);
   } else if (pMsg->method == ATT_HANDLE_VALUE_IND) {
-	  System_printf("GATT handle value indication\n");
+	  SB_TRACE0(SB_TRACE_BLE_INDICATION);
   } else if (pMsg->method == ATT_HANDLE_VALUE_CFM) {
 	  SB_Error error;
-	  if (NoError != (error = SB_currentReadingsRead())) {
-		  System_printf("Error handling GATT value confirmation: %d\n", error);
+	  if (NoError != (error = SB_currentReadingsRead(pMsg->connHandle, NULL))) {
+		  SB_TRACE1(SB_TRACE_BLE_CONFIRM_FAILED, error);
 	  }
   } else {
-	  System_printf("Unknown GATT MSG: %d\n", pMsg->method);
+	  SB_TRACE1(SB_TRACE_BLE_UNKNOWN_GATT_MSG, pMsg->method);
   }
 
   // Free message payload. Needed only for ATT Protocol messages
@@ -515,7 +560,7 @@ static void SimpleBLEPeripheral_sendAttRsp(void)
     else
     {
       // Continue retrying
-    	System_printf("Rsp send retry: %d\n", rspTxRetry);
+    	SB_TRACE1(SB_TRACE_BLE_RSP_RETRY, rspTxRetry);
     }
   }
 }
@@ -537,14 +582,14 @@ static void SimpleBLEPeripheral_freeAttRsp(uint8_t status)
     // See if the response was sent out successfully
     if (status == SUCCESS)
     {
-    	System_printf("Rsp sent, retry:%d\n", rspTxRetry);
+    	SB_TRACE1(SB_TRACE_BLE_RSP_SENT, rspTxRetry);
     }
     else
     {
       // Free response payload
       GATT_bm_free(&pAttRsp->msg, pAttRsp->method);
 
-      System_printf("Rsp retry failed:%d\n", rspTxRetry);
+      SB_TRACE1(SB_TRACE_BLE_RSP_FAILED, rspTxRetry);
     }
 
     // Free response message
@@ -574,7 +619,7 @@ static void SimpleBLEPeripheral_processAppMsg(sbpEvt_t *pMsg)
       break;
 
     case SBP_CHAR_CHANGE_EVT:
-      SimpleBLEPeripheral_processCharValueChangeEvt(pMsg->hdr.state);
+      SimpleBLEPeripheral_processCharValueChangeEvt(pMsg->connHandle, pMsg->peerAddr, pMsg->hdr.state);
       break;
 
     default:
@@ -594,7 +639,7 @@ static void SimpleBLEPeripheral_processAppMsg(sbpEvt_t *pMsg)
  */
 static void SimpleBLEPeripheral_stateChangeCB(gaprole_States_t newState)
 {
-  SimpleBLEPeripheral_enqueueMsg(SBP_STATE_CHANGE_EVT, newState);
+  SimpleBLEPeripheral_enqueueMsg(&stateEvents, SBP_STATE_CHANGE_EVT, newState, INVALID_CONNHANDLE, NULL);
 }
 
 /*********************************************************************
@@ -609,6 +654,11 @@ static void SimpleBLEPeripheral_stateChangeCB(gaprole_States_t newState)
 static void SimpleBLEPeripheral_processStateChangeEvt(gaprole_States_t newState)
 {
 	uint8_t error;
+
+	// The radio is in use while advertising or connected
+	SB_energySetLoad(SB_LOAD_RADIO, GAPROLE_ADVERTISING == newState
+			|| GAPROLE_CONNECTED == newState || GAPROLE_CONNECTED_ADV == newState);
+
   switch ( newState )
   {
     case GAPROLE_STARTED:
@@ -623,50 +673,73 @@ static void SimpleBLEPeripheral_processStateChangeEvt(gaprole_States_t newState)
       break;
 
     case GAPROLE_ADVERTISING:
-    	System_printf("BLE Advertising\n");
+    	SB_TRACE0(SB_TRACE_BLE_ADVERTISING);
       break;
 
     case GAPROLE_CONNECTED:
       {
     	  bleConnected = true;
-        uint8_t peerAddress[B_ADDR_LEN];
+        uint16_t connHandle;
+        uint8_t peerAddrType;
+        uint8_t peerAddr[B_ADDR_LEN];
+        uint8_t identity[B_ADDR_LEN];
+
+        GAPRole_GetParameter(GAPROLE_CONNHANDLE, &connHandle);
+        GAPRole_GetParameter(GAPROLE_CONN_BD_ADDR, peerAddr);
+        GAPRole_GetParameter(GAPROLE_BD_ADDR_TYPE, &peerAddrType);
 
-        GAPRole_GetParameter(GAPROLE_CONN_BD_ADDR, peerAddress);
+        SB_TRACE1(SB_TRACE_BLE_CONNECTED, connHandle);
 
-        System_printf("BLE Connected %s\n", Util_convertBdAddr2Str(peerAddress));
+        // A bonded central is known by its identity address, whichever private address it uses
+        if (GAPBondMgr_ResolveAddr(peerAddrType, peerAddr, identity) >= GAP_BONDINGS_MAX) {
+        	memcpy(identity, peerAddr, B_ADDR_LEN);
+        }
+
+        // Every central keeps its own position in the readings log, across connections
+        if (NoError != (error = SB_readingsConsumerConnected(connHandle, peerAddr, identity))) {
+        	SB_TRACE1(SB_TRACE_BLE_CONSUMER_FAILED, error);
+        }
       }
       break;
 
     case GAPROLE_CONNECTED_ADV:
-    	System_printf("BLE Connected Advertising\n");
+    	SB_TRACE0(SB_TRACE_BLE_CONNECTED_ADV);
       break;
 
     case GAPROLE_WAITING:
     	bleConnected = false;
     	if (0 != (error = SB_Profile_ClearNotificationState())) {
-			System_printf("Clearing gatt notification state failed! %d\n", error);
+			SB_TRACE1(SB_TRACE_BLE_CLEAR_NOTIFY_FAILED, error);
 		}
+    	SB_readingsConsumersDisconnected();
       SimpleBLEPeripheral_freeAttRsp(bleNotConnected);
+#if defined(FEATURE_OAD)
+      OAD_linkTerminated(INVALID_CONNHANDLE);
+#endif //FEATURE_OAD
 
-      System_printf("BLE Disconnected\n");
+      SB_TRACE0(SB_TRACE_BLE_DISCONNECTED);
       break;
 
     case GAPROLE_WAITING_AFTER_TIMEOUT:
     	bleConnected = false;
     	if (0 != (error = SB_Profile_ClearNotificationState())) {
-			System_printf("Clearing gatt notification state failed! %d\n", error);
+			SB_TRACE1(SB_TRACE_BLE_CLEAR_NOTIFY_FAILED, error);
 		}
+    	SB_readingsConsumersDisconnected();
       SimpleBLEPeripheral_freeAttRsp(bleNotConnected);
+#if defined(FEATURE_OAD)
+      OAD_linkTerminated(INVALID_CONNHANDLE);
+#endif //FEATURE_OAD
 
-      System_printf("BLE Timed Out\n");
+      SB_TRACE0(SB_TRACE_BLE_TIMED_OUT);
       break;
 
     case GAPROLE_ERROR:
-    	System_printf("BLE Error\n");
+    	SB_TRACE0(SB_TRACE_BLE_ERROR);
       break;
 
     default:
-    	System_printf("\n");
+    	SB_TRACE1(SB_TRACE_BLE_UNKNOWN_STATE, newState);
       break;
   }
 }
@@ -675,19 +748,30 @@ bool SB_bleConnected() {
 	return bleConnected;
 }
 
+uint32_t SB_bleEventsDropped() {
+	return droppedEvents;
+}
+
 /*********************************************************************
  * @fn      SimpleBLEPeripheral_charValueChangeCB
  *
  * @brief   Callback from Simple Profile indicating a characteristic
  *          value change.
  *
+ * @param   connHandle - connection that changed the value.
  * @param   paramID - parameter ID of the value that was changed.
  *
  * @return  None.
  */
-static void SimpleBLEPeripheral_charValueChangeCB(uint8_t paramID)
+static void SimpleBLEPeripheral_charValueChangeCB(uint16_t connHandle, uint8_t paramID)
 {
-  SimpleBLEPeripheral_enqueueMsg(SBP_CHAR_CHANGE_EVT, paramID);
+  uint8_t peerAddr[B_ADDR_LEN];
+
+  // The write came in on the link that is up now. By the time the app task handles it that link
+  // may have gone and another central may have the handle, so the event names the central.
+  GAPRole_GetParameter(GAPROLE_CONN_BD_ADDR, peerAddr);
+
+  SimpleBLEPeripheral_enqueueMsg(&charEvents, SBP_CHAR_CHANGE_EVT, paramID, connHandle, peerAddr);
 }
 
 /*********************************************************************
@@ -696,11 +780,13 @@ static void SimpleBLEPeripheral_charValueChangeCB(uint8_t paramID)
  * @brief   Process a pending Simple Profile characteristic value change
  *          event.
  *
+ * @param   connHandle - connection that changed the value.
+ * @param   peerAddr - address of the central that changed the value.
  * @param   paramID - parameter ID of the value that was changed.
  *
  * @return  None.
  */
-static void SimpleBLEPeripheral_processCharValueChangeEvt(uint8_t paramID)
+static void SimpleBLEPeripheral_processCharValueChangeEvt(uint16_t connHandle, const uint8_t *peerAddr, uint8_t paramID)
 {
 	uint8_t newValue[4];
 
@@ -710,9 +796,7 @@ static void SimpleBLEPeripheral_processCharValueChangeEvt(uint8_t paramID)
 			// TODO: Integrate this with the rest of the system, and the storage mechanism
 			SB_Profile_GetParameter(SB_CHARACTERISTIC_SYSTEMTIME, &newValue, 4);
 
-#ifdef SB_DEBUG
-			System_printf("System time set: %u\n", *(uint32_t*)newValue);
-#endif
+			SB_TRACE1(SB_TRACE_BLE_TIME_SET, *(uint32_t*)newValue);
 
 			SB_clockSetTime(*(uint32_t*)newValue);
 			SB_flashTimeSet();
@@ -722,21 +806,24 @@ static void SimpleBLEPeripheral_processCharValueChangeEvt(uint8_t paramID)
 		case SB_CHARACTERISTIC_READINGCOUNT:
 			SB_Profile_GetParameter(SB_CHARACTERISTIC_SYSTEMTIME, &newValue, 2);
 
-#ifdef SB_DEBUG
-			System_printf("Readings read.\n Reading count set: %d\n", *(uint16_t*)newValue);
-#endif
+			SB_TRACE1(SB_TRACE_BLE_READING_COUNT, *(uint16_t*)newValue);
 
-			SB_currentReadingsRead();
+			SB_currentReadingsRead(connHandle, peerAddr);
 			break;
 
 		case SB_CHARACTERISTIC_READINGS:
 			// Notification state of the readings parameter was changed
-#ifdef SB_DEBUG
-			System_printf("Android notification subscription status changed\n");
-#endif
+			SB_TRACE0(SB_TRACE_BLE_SUBSCRIPTION);
 
 			if (SB_bleConnected() && SB_Profile_ReadingsNotificationsEnabled()) {
-				SB_sendNotificationIfSubscriptionChanged(true);
+				SB_readingsSubscriptionChanged(connHandle, peerAddr);
+			}
+			break;
+
+		case SB_CHARACTERISTIC_SNAPSHOT:
+			// Push the current frame straight away so the central doesn't wait a full cycle
+			if (SB_bleConnected() && SB_Profile_NotificationsEnabled(SB_CHARACTERISTIC_SNAPSHOT)) {
+				SB_Profile_MarkParameterUpdated(SB_CHARACTERISTIC_SNAPSHOT);
 			}
 			break;
 
@@ -749,26 +836,125 @@ static void SimpleBLEPeripheral_processCharValueChangeEvt(uint8_t paramID)
 /*********************************************************************
  * @fn      SimpleBLEPeripheral_enqueueMsg
  *
- * @brief   Creates a message and puts the message in RTOS queue.
+ * @brief   Puts an event in an app event ring and wakes the app task. May only be called
+ * 			from the ring's producer task.
  *
+ * @param   ring - the producer's event ring.
  * @param   event - message event.
  * @param   state - message state.
+ * @param   connHandle - connection the message came from.
+ * @param   peerAddr - address of the central on that connection, NULL if none.
  *
  * @return  None.
  */
-static void SimpleBLEPeripheral_enqueueMsg(uint8_t event, uint8_t state)
+static void SimpleBLEPeripheral_enqueueMsg(SB_EventRing *ring, uint8_t event, uint8_t state, uint16_t connHandle, const uint8_t *peerAddr)
 {
-  sbpEvt_t *pMsg;
+	uint8_t head = ring->head;
+	volatile sbpEvt_t *slot;
+	uint8_t i;
+	UInt key;
+
+	// Only this task fills the ring, so a free slot stays free. A dropped event takes no
+	// sequence number, and the consumer never waits for one that will not come.
+	if ((uint8_t)(head - ring->tail) >= SB_EVENT_RING_SIZE) {
+		++ring->dropped;
+		return;
+	}
 
-  // Create dynamic pointer to message.
-  if ((pMsg = ICall_malloc(sizeof(sbpEvt_t))))
-  {
-    pMsg->hdr.event = event;
-    pMsg->hdr.state = state;
+	slot = &ring->events[head & (SB_EVENT_RING_SIZE - 1)];
+	slot->hdr.event = event;
+	slot->hdr.state = state;
+	slot->connHandle = connHandle;
+	for (i = 0; i < B_ADDR_LEN; ++i) {
+		slot->peerAddr[i] = NULL == peerAddr ? 0 : peerAddr[i];
+	}
 
-    // Enqueue the message.
-    Util_enqueueMsg(appMsgQueue, sem, (uint8*)pMsg);
-  }
+	// Both producers number their events from the one counter
+	key = Hwi_disable();
+	slot->seq = raisedEvents++;
+	Hwi_restore(key);
+
+	// Publish the event once it is complete
+	ring->head = head + 1;
+
+	Semaphore_post(sem);
+}
+
+/*********************************************************************
+ * @fn      SimpleBLEPeripheral_processAppEvents
+ *
+ * @brief   Takes the events waiting in the app event rings, merged back into the order they
+ * 			were raised, and processes them. The slots are handed back before processing
+ * 			starts. An event numbered before one already published but not itself published
+ * 			yet holds up the rest until its producer posts the semaphore.
+ *
+ * @return  The number of events processed
+ */
+static uint8_t SimpleBLEPeripheral_processAppEvents(void)
+{
+	SB_EventRing *rings[] = { &stateEvents, &charEvents };
+	sbpEvt_t events[2 * SB_EVENT_RING_SIZE];
+	uint8_t count = 0;
+	uint8_t i, r;
+
+	for (;;) {
+		volatile sbpEvt_t *slot = NULL;
+		SB_EventRing *ring;
+
+		for (r = 0; r < sizeof(rings)/sizeof(rings[0]); ++r) {
+			ring = rings[r];
+			if (ring->tail != ring->head
+					&& ring->events[ring->tail & (SB_EVENT_RING_SIZE - 1)].seq == handledEvents) {
+				slot = &ring->events[ring->tail & (SB_EVENT_RING_SIZE - 1)];
+				break;
+			}
+		}
+
+		if (NULL == slot) {
+			break;
+		}
+
+		events[count].hdr.event = slot->hdr.event;
+		events[count].hdr.state = slot->hdr.state;
+		events[count].connHandle = slot->connHandle;
+		for (i = 0; i < B_ADDR_LEN; ++i) {
+			events[count].peerAddr[i] = slot->peerAddr[i];
+		}
+
+		ring->tail = ring->tail + 1;
+		++handledEvents;
+		++count;
+	}
+
+	for (r = 0; r < sizeof(rings)/sizeof(rings[0]); ++r) {
+		SimpleBLEPeripheral_countDropped(rings[r]);
+	}
+
+	for (i = 0; i < count; ++i) {
+		SimpleBLEPeripheral_processAppMsg(&events[i]);
+	}
+
+	return count;
+}
+
+/*********************************************************************
+ * @fn      SimpleBLEPeripheral_countDropped
+ *
+ * @brief   Adds the events a full ring has lost since the last call to the total
+ *
+ * @param   ring - the event ring to check.
+ *
+ * @return  None.
+ */
+static void SimpleBLEPeripheral_countDropped(SB_EventRing *ring)
+{
+	if (ring->dropped != ring->reported) {
+		uint8_t dropped = ring->dropped - ring->reported;
+
+		droppedEvents += dropped;
+		ring->reported += dropped;
+		SB_TRACE1(SB_TRACE_BLE_EVENTS_DROPPED, dropped);
+	}
 }
 
 /*********************************************************************
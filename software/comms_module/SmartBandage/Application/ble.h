@@ -83,10 +83,12 @@
 
 
 //extern void SB_bleInit();
-extern void SB_processBLEMessages();
+extern uint8_t SB_processBLEMessages();
+extern void SB_bleWakeApp();
 extern void SimpleBLEPeripheral_init(void);
 extern SB_Error SB_enableBLE();
 extern SB_Error SB_disableBLE();
 extern bool SB_bleConnected();
+extern uint32_t SB_bleEventsDropped();
 
 #endif /* APPLICATION_BLE_H_ */
@@ -3,18 +3,88 @@
  *
  *  Created on: Mar 21, 2016
  *      Author: michaelblouin
+ *
+ * Time is kept as the time the phone last sent and the tick count at that moment, so that the
+ * fractions of a second between calls are never dropped. The 32 bit RTOS tick count wraps
+ * after about 12 hours; it is extended to 64 bits on every call, which the sensing cycle makes
+ * far more often than that.
+ *
+ * The crystal's rate error is learned from the times the phone sends, measured over the
+ * longest span available, and taken out of every elapsed time.
  */
 
+#include <string.h>
+
+#include <ti/sysbios/hal/Hwi.h>
 #include <ti/sysbios/knl/Clock.h>
+#include <xdc/runtime/System.h>
 
 #include "Board.h"
+#include "clock.h"
+
+#define NTICKS_PER_MS (NTICKS_PER_SECOND/1000)
 
 struct {
-	uint32_t lastTimestamp;
-	uint32_t lastReferenceTicks;
+	uint64_t ticks;				// Ticks since boot
+	uint32_t lastRawTicks;
+
+	uint64_t initTicks;
+	uint64_t referenceTicks;	// Tick count at which the time was referenceMs
+	uint64_t referenceMs;
+
+	// First time the phone sent, the start of the span the drift is measured over
+	uint64_t anchorTicks;
+	uint32_t anchorTimestamp;
+
+	int32_t driftPpb;			// Rate error of the ticks, positive if they run fast
 	bool isSet : 1;
+	bool hasAnchor : 1;
 } clock;
 
+/*
+ * Converts a number of ticks to milliseconds, taking out the drift
+ */
+static uint64_t SB_clockTicksToMs(uint64_t ticks) {
+	int64_t correction = ((int64_t)ticks * clock.driftPpb) / (1000000000LL + clock.driftPpb);
+
+	return (ticks - correction) / NTICKS_PER_MS;
+}
+
+/*
+ * Updates the drift estimate from a time sent by the phone
+ */
+static void SB_clockLearnDrift(uint32_t timestamp, uint64_t ticks) {
+	int64_t trueMs, localMs, driftPpb;
+
+	if (!clock.hasAnchor || timestamp < clock.anchorTimestamp) {
+		clock.anchorTimestamp = timestamp;
+		clock.anchorTicks = ticks;
+		clock.hasAnchor = true;
+		return;
+	}
+
+	// The phone only sends whole seconds, so the span has to be long for the estimate to mean anything
+	if (timestamp - clock.anchorTimestamp < SB_CLOCK_DRIFT_MIN_SPAN_S) {
+		return;
+	}
+
+	trueMs = (int64_t)(timestamp - clock.anchorTimestamp) * 1000;
+	localMs = (ticks - clock.anchorTicks) / NTICKS_PER_MS;
+	driftPpb = (localMs - trueMs) * 1000000000LL / trueMs;
+
+	if (driftPpb > SB_CLOCK_MAX_DRIFT_PPM * 1000LL || driftPpb < -SB_CLOCK_MAX_DRIFT_PPM * 1000LL) {
+		// No crystal is that far off: the phone's time was changed. Start measuring again from here.
+		clock.anchorTimestamp = timestamp;
+		clock.anchorTicks = ticks;
+#ifdef SB_DEBUG
+		System_printf("Clock: time moved by %d ms, drift not updated\n", (int32_t)(localMs - trueMs));
+#endif
+		return;
+	}
+
+	clock.driftPpb = driftPpb;
+}
+
 /*********************************************************************
  * @fn      SB_clockIsSet
  *
@@ -34,9 +104,33 @@ inline bool SB_clockIsSet() {
  * @return  NoError if properly initialized, otherwise the error that occured
  */
 void SB_clockInit() {
-	clock.isSet = false;
-	clock.lastTimestamp = 0;
-	clock.lastReferenceTicks = Clock_getTicks();
+	memset(&clock, 0, sizeof(clock));
+
+	clock.lastRawTicks = Clock_getTicks();
+	clock.ticks = clock.lastRawTicks;
+	clock.initTicks = clock.ticks;
+	clock.referenceTicks = clock.ticks;
+}
+
+/*********************************************************************
+ * @fn      SB_clockGetTicks
+ *
+ * @brief   Gets the number of ticks since boot. Unlike Clock_getTicks this doesn't wrap.
+ *
+ * @return  The tick count
+ */
+uint64_t SB_clockGetTicks() {
+	UInt key = Hwi_disable();
+	uint32_t raw = Clock_getTicks();
+	uint64_t ticks;
+
+	clock.ticks += raw - clock.lastRawTicks;
+	clock.lastRawTicks = raw;
+	ticks = clock.ticks;
+
+	Hwi_restore(key);
+
+	return ticks;
 }
 
 /*********************************************************************
@@ -45,11 +139,27 @@ void SB_clockInit() {
  * @brief   Sets the current time
  */
 void SB_clockSetTime(uint32_t timestamp) {
-	clock.lastTimestamp = timestamp;
-	clock.lastReferenceTicks = Clock_getTicks();
+	uint64_t ticks = SB_clockGetTicks();
+
+	SB_clockLearnDrift(timestamp, ticks);
+
+	clock.referenceMs = (uint64_t)timestamp * 1000;
+	clock.referenceTicks = ticks;
 	clock.isSet = true;
 }
 
+/*********************************************************************
+ * @fn      SB_clockGetTimeMs
+ *
+ * @brief   Gets the current time in milliseconds. Until the clock is set, this is the time since
+ * 			the clock was initialized.
+ *
+ * @return  The current time
+ */
+uint64_t SB_clockGetTimeMs() {
+	return clock.referenceMs + SB_clockTicksToMs(SB_clockGetTicks() - clock.referenceTicks);
+}
+
 /*********************************************************************
  * @fn      SB_clockGetTime
  *
@@ -58,8 +168,27 @@ void SB_clockSetTime(uint32_t timestamp) {
  * @return  The current time
  */
 uint32_t SB_clockGetTime() {
-	uint32_t referenceTicks = Clock_getTicks();
-	clock.lastTimestamp += (referenceTicks - clock.lastReferenceTicks)/NTICKS_PER_SECOND;
-	clock.lastReferenceTicks = referenceTicks;
-	return clock.lastTimestamp;
+	return SB_clockGetTimeMs() / 1000;
+}
+
+/*********************************************************************
+ * @fn      SB_clockGetUptimeMs
+ *
+ * @brief   Gets the time since the clock was initialized, in milliseconds
+ *
+ * @return  The uptime
+ */
+uint64_t SB_clockGetUptimeMs() {
+	return SB_clockTicksToMs(SB_clockGetTicks() - clock.initTicks);
+}
+
+/*********************************************************************
+ * @fn      SB_clockGetDriftPpb
+ *
+ * @brief   Gets the rate error of the ticks learned so far
+ *
+ * @return  The drift in parts per billion, positive if the ticks run fast
+ */
+int32_t SB_clockGetDriftPpb() {
+	return clock.driftPpb;
 }
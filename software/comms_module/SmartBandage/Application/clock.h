@@ -28,6 +28,15 @@ void SB_clockInit();
  */
 bool SB_clockIsSet();
 
+/*********************************************************************
+ * @fn      SB_clockGetTicks
+ *
+ * @brief   Gets the number of ticks since boot. Unlike Clock_getTicks this doesn't wrap.
+ *
+ * @return  The tick count
+ */
+uint64_t SB_clockGetTicks();
+
 /*********************************************************************
  * @fn      SB_clockSetTime
  *
@@ -44,4 +53,32 @@ void SB_clockSetTime(uint32_t);
  */
 uint32_t SB_clockGetTime();
 
+/*********************************************************************
+ * @fn      SB_clockGetTimeMs
+ *
+ * @brief   Gets the current time in milliseconds. Until the clock is set, this is the time since
+ * 			the clock was initialized.
+ *
+ * @return  The current time
+ */
+uint64_t SB_clockGetTimeMs();
+
+/*********************************************************************
+ * @fn      SB_clockGetUptimeMs
+ *
+ * @brief   Gets the time since the clock was initialized, in milliseconds
+ *
+ * @return  The uptime
+ */
+uint64_t SB_clockGetUptimeMs();
+
+/*********************************************************************
+ * @fn      SB_clockGetDriftPpb
+ *
+ * @brief   Gets the rate error of the ticks learned so far
+ *
+ * @return  The drift in parts per billion, positive if the ticks run fast
+ */
+int32_t SB_clockGetDriftPpb();
+
 #endif /* APPLICATION_CLOCK_H_ */
@@ -0,0 +1,255 @@
+/*
+ * energy.c
+ *
+ * Time is charged to the current state and to every powered load whenever any of them changes,
+ * in ticks, and split where an hour ends. Completed hours are converted to milliseconds and
+ * moved to a ring.
+ *
+ * The gauge's state of charge is read once per sensing cycle. The charge of an hour is the drop
+ * from the last reading before it to the last reading in it.
+ */
+
+#include <string.h>
+
+#include <ti/sysbios/hal/Hwi.h>
+
+#include "Board.h"
+#include "clock.h"
+#include "energy.h"
+
+#define SB_ENERGY_HOUR_TICKS	(3600ULL * NTICKS_PER_SECOND)
+
+// The state of charge register counts 1/512 % of the configured capacity
+#define SB_ENERGY_SOC_TO_UAH(soc) \
+	((int32_t)(soc) * (GASGAUGE_BATT_CAPACITY * 1000L) / (100L * 512L))
+
+#define SB_ENERGY_SATURATE(counter) \
+	do { if ((uint16_t)((counter) + 1) != 0) { (counter)++; } } while (0)
+
+static struct {
+	uint64_t accountedTicks;		// Time charged up to
+	uint64_t hourEndTicks;
+	uint8_t state;
+	uint8_t loads;					// Loads powered, a bit per SB_EnergyLoad
+
+	// The hour being filled in
+	SB_EnergyHour current;
+	uint32_t stateTicks[SB_NUM_STATES];
+	uint32_t loadTicks[SB_NUM_LOADS];
+	uint16_t hourSoc;				// State of charge at the start of the hour
+	uint16_t lastSoc;
+	bool hasSoc;
+
+	// Completed hours. Entry n % (SB_ENERGY_NUM_HOURS - 1) holds hour n.
+	SB_EnergyHour history[SB_ENERGY_NUM_HOURS - 1];
+} ENERGY;
+
+static void SB_energyStateCallback(SB_State_Transition transition, SB_State state);
+
+/*
+ * Copies the hour being filled in, with its times in milliseconds
+ */
+static void SB_energyGetCurrent(SB_EnergyHour *hour) {
+	uint8_t i;
+
+	*hour = ENERGY.current;
+
+	for (i = 0; i < SB_NUM_STATES; ++i) {
+		hour->stateMs[i] = ENERGY.stateTicks[i] / (NTICKS_PER_MILLSECOND);
+	}
+
+	for (i = 0; i < SB_NUM_LOADS; ++i) {
+		hour->loadMs[i] = ENERGY.loadTicks[i] / (NTICKS_PER_MILLSECOND);
+	}
+
+	hour->gaugeUAh = SB_ENERGY_SOC_TO_UAH((int32_t)ENERGY.hourSoc - ENERGY.lastSoc);
+}
+
+/*
+ * Moves the hour being filled in to the history and starts the next
+ */
+static void SB_energyEndHour() {
+	uint32_t hour = ENERGY.current.hour;
+
+	SB_energyGetCurrent(&ENERGY.history[hour % (SB_ENERGY_NUM_HOURS - 1)]);
+
+	memset(&ENERGY.current, 0, sizeof(ENERGY.current));
+	memset(ENERGY.stateTicks, 0, sizeof(ENERGY.stateTicks));
+	memset(ENERGY.loadTicks, 0, sizeof(ENERGY.loadTicks));
+
+	ENERGY.current.hour = hour + 1;
+	ENERGY.current.voltage = ENERGY.history[hour % (SB_ENERGY_NUM_HOURS - 1)].voltage;
+	ENERGY.hourSoc = ENERGY.lastSoc;
+	ENERGY.hourEndTicks += SB_ENERGY_HOUR_TICKS;
+}
+
+/*
+ * Charges the time since the last call to the current state and the powered loads. Call with
+ * Hwis disabled.
+ */
+static void SB_energyAccount() {
+	uint64_t now = SB_clockGetTicks(), end;
+	uint32_t elapsed;
+	uint8_t i;
+
+	// Nothing is charged before SB_energyInit
+	if (0 == ENERGY.hourEndTicks) {
+		return;
+	}
+
+	while (ENERGY.accountedTicks < now) {
+		end = now < ENERGY.hourEndTicks ? now : ENERGY.hourEndTicks;
+		elapsed = end - ENERGY.accountedTicks;
+
+		ENERGY.stateTicks[ENERGY.state] += elapsed;
+		for (i = 0; i < SB_NUM_LOADS; ++i) {
+			if (ENERGY.loads & _BV(i)) {
+				ENERGY.loadTicks[i] += elapsed;
+			}
+		}
+
+		ENERGY.accountedTicks = end;
+
+		if (end == ENERGY.hourEndTicks) {
+			SB_energyEndHour();
+		}
+	}
+}
+
+/*********************************************************************
+ * @fn      SB_energyInit
+ *
+ * @brief   Clears the accounting and starts the first hour now, in the current state
+ *
+ * @return  NoError if initialized, otherwise the error registering with the state machine
+ */
+SB_Error SB_energyInit() {
+	SB_Error result;
+	UInt key;
+	uint8_t s, loads;
+
+	// Loads switched on before now stay on
+	key = Hwi_disable();
+	loads = ENERGY.loads;
+	memset(&ENERGY, 0, sizeof(ENERGY));
+	ENERGY.loads = loads;
+	ENERGY.accountedTicks = SB_clockGetTicks();
+	ENERGY.hourEndTicks = ENERGY.accountedTicks + SB_ENERGY_HOUR_TICKS;
+	ENERGY.state = SB_currentState();
+	Hwi_restore(key);
+
+	for (s = 0; s < SB_NUM_STATES; ++s) {
+		if (NoError != (result = SB_registerStateTransitionCallback(SB_energyStateCallback, T_STATE_ENTER, (SB_State)s))) {
+			return result;
+		}
+	}
+
+	return NoError;
+}
+
+/*********************************************************************
+ * @fn      SB_energySetLoad
+ *
+ * @brief   Records a load being switched on or off. Repeating the current state is harmless.
+ */
+void SB_energySetLoad(SB_EnergyLoad load, bool on) {
+	UInt key;
+
+	if (load >= SB_NUM_LOADS) {
+		return;
+	}
+
+	key = Hwi_disable();
+	SB_energyAccount();
+
+	if (on) {
+		ENERGY.loads |= _BV(load);
+	} else {
+		ENERGY.loads &= ~_BV(load);
+	}
+
+	Hwi_restore(key);
+}
+
+/*********************************************************************
+ * @fn      SB_energyCountFlashOp
+ *
+ * @brief   Counts a flash program or erase
+ */
+void SB_energyCountFlashOp(SB_EnergyFlashOp op) {
+	UInt key;
+
+	if (op >= SB_NUM_FLASH_OPS) {
+		return;
+	}
+
+	key = Hwi_disable();
+	SB_energyAccount();
+	SB_ENERGY_SATURATE(ENERGY.current.flashOps[op]);
+	Hwi_restore(key);
+}
+
+/*********************************************************************
+ * @fn      SB_energyGaugeSample
+ *
+ * @brief   Records a gas gauge reading
+ *
+ * @param   soc - The raw state of charge register, 1/512 %
+ * @param   voltage - The battery voltage, 16x mV
+ */
+void SB_energyGaugeSample(uint16_t soc, uint16_t voltage) {
+	UInt key = Hwi_disable();
+
+	SB_energyAccount();
+
+	// The first reading starts the count
+	if (!ENERGY.hasSoc) {
+		ENERGY.hourSoc = soc;
+		ENERGY.hasSoc = true;
+	}
+
+	ENERGY.lastSoc = soc;
+	ENERGY.current.voltage = voltage;
+	SB_ENERGY_SATURATE(ENERGY.current.gaugeSamples);
+
+	Hwi_restore(key);
+}
+
+/*********************************************************************
+ * @fn      SB_energyGetHours
+ *
+ * @brief   Copies out the hours kept, newest first. The first is the hour being filled in.
+ *
+ * @return  The number of hours copied
+ */
+uint8_t SB_energyGetHours(SB_EnergyHour *hours, uint8_t maxHours) {
+	UInt key;
+	uint32_t hour;
+	uint8_t n = 0;
+
+	if (0 == maxHours) {
+		return 0;
+	}
+
+	key = Hwi_disable();
+	SB_energyAccount();
+
+	SB_energyGetCurrent(&hours[n++]);
+
+	for (hour = ENERGY.current.hour; hour > 0 && n < maxHours && n < SB_ENERGY_NUM_HOURS; ++n) {
+		hours[n] = ENERGY.history[--hour % (SB_ENERGY_NUM_HOURS - 1)];
+	}
+
+	Hwi_restore(key);
+
+	return n;
+}
+
+static void SB_energyStateCallback(SB_State_Transition transition, SB_State state) {
+	UInt key = Hwi_disable();
+
+	SB_energyAccount();
+	ENERGY.state = state;
+
+	Hwi_restore(key);
+}
@@ -0,0 +1,94 @@
+/*
+ * energy.h
+ *
+ * Energy accounting. Keeps, for every hour since start up, the time spent in each state of the
+ * state machine, the time each switchable load was powered, the flash program and erase counts
+ * and the charge the gas gauge saw leave the battery over the same hour. The last few hours are
+ * kept in RAM and read over BLE; host/energyReplay decodes them and splits the measured charge
+ * between states and loads.
+ *
+ * Loads and flash operations can be reported from any context, including Hwis.
+ */
+
+#ifndef APPLICATION_ENERGY_H_
+#define APPLICATION_ENERGY_H_
+
+#include "Board.h"
+#include "fsm.h"
+
+// Hours kept, the one being filled in included
+#define SB_ENERGY_NUM_HOURS		4
+
+// Loads switched by the application
+typedef enum {
+	SB_LOAD_PERIPHERALS,	// Peripheral power rail
+	SB_LOAD_PWRMUX,			// Power mux output
+	SB_LOAD_ADC,			// ADC and its clocks, which keep the device out of standby
+	SB_LOAD_RADIO,			// Advertising or connected
+
+	SB_NUM_LOADS
+} SB_EnergyLoad;
+
+typedef enum {
+	SB_FLASH_OP_PROGRAM,		// Internal flash
+	SB_FLASH_OP_ERASE,
+	SB_FLASH_OP_EXT_PROGRAM,	// External archive flash
+	SB_FLASH_OP_EXT_ERASE,
+
+	SB_NUM_FLASH_OPS
+} SB_EnergyFlashOp;
+
+// One hour of accounting. Laid out so that no padding is required.
+typedef struct {
+	uint32_t hour;							// Hours since start up. The newest hour is still being filled in.
+	uint32_t stateMs[SB_NUM_STATES];		// Time spent in each SB_State
+	uint32_t loadMs[SB_NUM_LOADS];			// Time each load was powered
+	int32_t gaugeUAh;						// Charge drawn from the battery according to the gauge. Negative while charging.
+	uint16_t flashOps[SB_NUM_FLASH_OPS];	// Flash operations of each kind. Saturates.
+	uint16_t gaugeSamples;					// Gauge readings taken
+	uint16_t voltage;						// Battery voltage at the last gauge reading, 16x mV
+} SB_EnergyHour;
+
+/*********************************************************************
+ * @fn      SB_energyInit
+ *
+ * @brief   Clears the accounting and starts the first hour now, in the current state
+ *
+ * @return  NoError if initialized, otherwise the error registering with the state machine
+ */
+SB_Error SB_energyInit();
+
+/*********************************************************************
+ * @fn      SB_energySetLoad
+ *
+ * @brief   Records a load being switched on or off. Repeating the current state is harmless.
+ */
+void SB_energySetLoad(SB_EnergyLoad load, bool on);
+
+/*********************************************************************
+ * @fn      SB_energyCountFlashOp
+ *
+ * @brief   Counts a flash program or erase
+ */
+void SB_energyCountFlashOp(SB_EnergyFlashOp op);
+
+/*********************************************************************
+ * @fn      SB_energyGaugeSample
+ *
+ * @brief   Records a gas gauge reading
+ *
+ * @param   soc - The raw state of charge register, 1/512 %
+ * @param   voltage - The battery voltage, 16x mV
+ */
+void SB_energyGaugeSample(uint16_t soc, uint16_t voltage);
+
+/*********************************************************************
+ * @fn      SB_energyGetHours
+ *
+ * @brief   Copies out the hours kept, newest first. The first is the hour being filled in.
+ *
+ * @return  The number of hours copied
+ */
+uint8_t SB_energyGetHours(SB_EnergyHour *hours, uint8_t maxHours);
+
+#endif /* APPLICATION_ENERGY_H_ */
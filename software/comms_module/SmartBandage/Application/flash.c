@@ -5,6 +5,9 @@
  *      Author: michaelblouin
  */
 
+#include <stddef.h>
+#include <string.h>
+
 #include "hal_flash.h"
 #include "hal_types.h"
 #include <driverlib/vims.h>
@@ -12,8 +15,11 @@
 #include <xdc/runtime/System.h>
 
 #include "clock.h"
+#include "energy.h"
+#include "trace.h"
 
 #include "flash.h"
+#include "flashArchive.h"
 
 /*********************************************************************
  * CONSTANTS
@@ -44,6 +50,16 @@
 #define SB_FLASH_MARKER					 0x5150
 #define SB_FLASH_MARKER_SIZE			 uint16
 
+// Internal readings are moved to the archive once fewer than this many more would fit
+#define SB_FLASH_MIGRATE_HEADROOM		 4
+
+// Readings stored before SB_TIMEDIFF_T became milliseconds end in a 16-bit time difference in seconds.
+// Everything before it is laid out as it is now. Readings left in this format by an upgrade are kept,
+// and new readings are written after them in the same format until they have all been discarded.
+#define SB_FLASH_LEGACY_TIMEDIFF_T		 uint16
+#define SB_FLASH_LEGACY_READING_SIZE	 (offsetof(SB_FLASH_READING_TYPE, timeDiff) + sizeof(SB_FLASH_LEGACY_TIMEDIFF_T))
+#define SB_FLASH_IS_LEGACY()			 (header.readingSizeBytes != currentReadingSizeBytes)
+
 /*********************************************************************
  * TYPEDEFS
  */
@@ -92,6 +108,12 @@ const uint8 firstFlashByte = 0x51;
 
 SB_FlashHeader header;
 
+// The size of a reading as given to SB_flashInit(). The header gives the size of those stored.
+static uint8 currentReadingSizeBytes;
+
+// Readings in internal flash and in the archive together
+SB_FLASH_COUNT_T readingCount;
+
 /*********************************************************************
  * @fn      loadNextHeader
  *
@@ -108,9 +130,13 @@ SB_Error loadNextHeader(SB_FLASH_PAGE_T pg, SB_FLASH_OFFSET_T offset, SB_FlashHe
 	// Check for an existing header in flash memory
 	SBFlashRead(SB_FLASH_PAGE_FIRST, SB_FLASH_PAGE_HDR_OFFSET, (uint8*)target, sizeof(SB_FlashHeader));
 
+	// Readings stored in the legacy format are drained rather than erased
+	bool legacy = target->readingSizeBytes == SB_FLASH_LEGACY_READING_SIZE && readingSizeBytes == sizeof(SB_FLASH_READING_TYPE)
+			&& target->entryCount > 0;
+
 	// Check for invalid data in the loaded header. If its find reinitialize it and erase the first page
 	uint32 totalSize = target->entryCount * target->readingSizeBytes;
-	if (target->marker != SB_FLASH_MARKER || (target->readingSizeBytes != readingSizeBytes || totalSize >= (uint32)(SB_FLASH_NUM_PAGES * SB_FLASH_PAGE_SIZE))) {
+	if (target->marker != SB_FLASH_MARKER || ((target->readingSizeBytes != readingSizeBytes && !legacy) || totalSize >= (uint32)(SB_FLASH_NUM_PAGES * SB_FLASH_PAGE_SIZE))) {
 		// Initialize new header at start page and offset after the header position
 		target->marker = SB_FLASH_MARKER;
 		target->startPage = SB_FLASH_PAGE_FIRST;
@@ -134,6 +160,37 @@ SB_Error loadNextHeader(SB_FLASH_PAGE_T pg, SB_FLASH_OFFSET_T offset, SB_FlashHe
 	return NoError;
 }
 
+/*********************************************************************
+ * @fn      internalFreeBytes
+ *
+ * @brief   Gets the space left after the last reading in internal flash
+ *
+ * @return  The number of free bytes
+ */
+static uint32 internalFreeBytes() {
+	uint32 used = (header.startPage - SB_FLASH_PAGE_FIRST) * SB_FLASH_PAGE_SIZE + header.startOffset
+			+ header.entryCount * header.readingSizeBytes;
+
+	return (uint32)SB_FLASH_NUM_PAGES * SB_FLASH_PAGE_SIZE - used;
+}
+
+/*********************************************************************
+ * @fn      resetInternal
+ *
+ * @brief   Erases internal flash and starts the readings there over
+ *
+ * @return  NoError if reset, otherwise the error
+ */
+static SB_Error resetInternal() {
+	uint8_t i;
+	for (i = 0; i < SB_FLASH_NUM_PAGES; ++i) {
+		erasePage(i + SB_FLASH_PAGE_FIRST);
+	}
+
+	// After performing page erases this will reset the header to default values, in the current format
+	return loadNextHeader(SB_FLASH_PAGE_FIRST, 0, &header, currentReadingSizeBytes);
+}
+
 /*********************************************************************
  * @fn      SB_flashHasTime
  *
@@ -158,23 +215,11 @@ SB_Error SB_flashTimeSet() {
 		return NoError;
 	}
 
-	header.timestamp = SB_clockGetTime();
-
-	// No further processing if there are no entries
-	if (header.entryCount == 0) {
-		return NoError;
-	}
-
-	// Adjust the timestamp so that reading times are relevant to it.
-	SB_FLASH_READING_TYPE readingBuf;
-	SB_Error result = SB_flashGetLastReading(&readingBuf, NULL);
-	if (NoDataAvailable == result) {
-		return NoError;
-	} else if (NoError != result) {
-		return result;
-	}
+	// Readings taken before the time was set count from the initialization of the clock, so that is
+	// the reference time for them and for those archived, whichever tier they are in.
+	header.timestamp = (SB_clockGetTimeMs() - SB_clockGetUptimeMs()) / 1000;
 
-	header.timestamp -= readingBuf.timeDiff;
+	SB_flashArchiveTimeSet(header.timestamp);
 
 	return NoError;
 }
@@ -207,6 +252,9 @@ inline uint32_t SB_flashGetReferenceTime() {
  */
 SB_Error SB_flashInit(uint8 readingSizeBytes, bool reinit) {
 	SB_Error result;
+
+	currentReadingSizeBytes = readingSizeBytes;
+
 #ifdef SB_DEBUG
 	System_printf("SB Flash NV Storage Config:\n SB Flash Page No: %d\n SB Flash Base Addr: %x\n SB Flash Num Pages: %d\n SB Flash Last Page: %d\n SB Flash Last Addr: %x.\n Sector size: %d\n Reading Size (bytes): %d\n",
 			SB_FLASH_PAGE_FIRST,
@@ -316,6 +364,23 @@ SB_Error SB_flashInit(uint8 readingSizeBytes, bool reinit) {
 # endif
 #endif
 
+#ifdef SB_DEBUG
+	if (SB_FLASH_IS_LEGACY()) {
+		System_printf("SB Flash: draining %d readings of %d bytes before changing format.\n", header.entryCount, header.readingSizeBytes);
+		System_flush();
+	}
+#endif
+
+	// Older readings may be waiting in the archive
+	if (NoError != (result = SB_flashArchiveInit(readingSizeBytes, reinit))) {
+#ifdef SB_DEBUG
+		System_printf("Flash archive unavailable: %d\n", result);
+		System_flush();
+#endif
+	}
+
+	readingCount = SB_flashArchiveCount() + header.entryCount;
+
 	return NoError;
 }
 
@@ -330,12 +395,28 @@ SB_Error SB_flashInit(uint8 readingSizeBytes, bool reinit) {
  * @return  NoError if properly written, otherwise the error
  */
 SB_Error SB_flashWriteReadings(SB_FLASH_READING_TYPE * readings) {
+	SB_FLASH_READING_TYPE legacyReadings;
+	SB_FLASH_LEGACY_TIMEDIFF_T timeDiff;
 	SB_Error result;
 
 	if (NULL == readings) {
 		return InvalidParameter;
 	}
 
+	// Stored after legacy readings, in whole seconds as they are
+	if (SB_FLASH_IS_LEGACY()) {
+		timeDiff = readings->timeDiff / 1000 > UINT16_MAX ? UINT16_MAX : readings->timeDiff / 1000;
+
+		legacyReadings = *readings;
+		memcpy(&legacyReadings.timeDiff, &timeDiff, sizeof(timeDiff));
+		readings = &legacyReadings;
+	}
+
+	// Internal flash is written front to back until it is emptied
+	if (internalFreeBytes() < header.readingSizeBytes) {
+		return OutOfMemory;
+	}
+
 	SB_FLASH_PAGE_T page = header.startPage + (header.entryCount * header.readingSizeBytes + header.startOffset) / SB_FLASH_PAGE_SIZE;
 	SB_FLASH_OFFSET_T offset = (header.entryCount * header.readingSizeBytes + header.startOffset) % SB_FLASH_PAGE_SIZE;
 
@@ -353,6 +434,7 @@ SB_Error SB_flashWriteReadings(SB_FLASH_READING_TYPE * readings) {
 
 	// Increment the entry count
 	++header.entryCount;
+	++readingCount;
 
 	return NoError;
 }
@@ -365,7 +447,7 @@ SB_Error SB_flashWriteReadings(SB_FLASH_READING_TYPE * readings) {
  * @return  The reading count
  */
 SB_FLASH_COUNT_T SB_flashReadingCount() {
-	return header.entryCount;
+	return readingCount;
 }
 
 /*********************************************************************
@@ -376,7 +458,7 @@ SB_FLASH_COUNT_T SB_flashReadingCount() {
  * @return  NoError if properly written, otherwise the error
  */
 const SB_FLASH_COUNT_T* SB_flashReadingCountRef() {
-	return &header.entryCount;
+	return &readingCount;
 }
 
 /*********************************************************************
@@ -388,17 +470,7 @@ const SB_FLASH_COUNT_T* SB_flashReadingCountRef() {
  * @return  NoError if read correctly
  */
 SB_Error SB_flashGetFirstReading(SB_FLASH_READING_TYPE *reading, uint32_t *refTimestamp) {
-	if (header.entryCount == 0) {
-		return NoDataAvailable;
-	}
-
-	SBFlashRead(header.startPage, header.startOffset, (uint8_t*)reading, header.readingSizeBytes);
-
-	if (NULL != refTimestamp) {
-		*refTimestamp = header.timestamp;
-	}
-
-	return NoError;
+	return SB_flashGetReading(0, reading, refTimestamp);
 }
 
 /*********************************************************************
@@ -410,19 +482,48 @@ SB_Error SB_flashGetFirstReading(SB_FLASH_READING_TYPE *reading, uint32_t *refTi
  * @return  NoError if read correctly
  */
 SB_Error SB_flashGetLastReading(SB_FLASH_READING_TYPE *reading, uint32_t *refTimestamp) {
-	if (header.entryCount == 0) {
+	if (readingCount == 0) {
 		return NoDataAvailable;
 	}
 
-	// TODO: This does not traverse the linked list
-	uint32_t diffBytes = (header.entryCount - 1) * header.readingSizeBytes + header.startOffset;
-	SB_FLASH_PAGE_T pg = header.startPage;
-	while (diffBytes >= SB_FLASH_PAGE_SIZE) {
-		++pg;
-		diffBytes -= SB_FLASH_PAGE_SIZE;
+	return SB_flashGetReading(readingCount - 1, reading, refTimestamp);
+}
+
+/*********************************************************************
+ * @fn      SB_flashGetReading
+ *
+ * @brief   Gets a reading from flash storage
+ *
+ * @param   index           - The index of the reading to get, 0 being the oldest. The oldest readings
+ * 							  are in the archive, followed by those still in internal flash.
+ *
+ * @param   readings        - Pointer to the memory location where the reading should be placed
+ * 							  Memory location must be at least readingSizeBytes as specified in SB_flashInit()
+ *
+ * @return  NoError if properly read, otherwise the error. If error `reading` will be NULL.
+ */
+SB_Error SB_flashGetReading(SB_FLASH_COUNT_T index, SB_FLASH_READING_TYPE * reading, uint32_t * refTimestamp) {
+	if (index >= readingCount) {
+		return NoDataAvailable;
+	}
+
+	if (index < SB_flashArchiveCount()) {
+		return SB_flashArchiveGetReading(index, reading, refTimestamp);
 	}
 
-	SBFlashRead(pg, diffBytes, (uint8_t*)reading, header.readingSizeBytes);
+	index -= SB_flashArchiveCount();
+
+	// TODO: This does not traverse the linked list
+	uint32_t diffBytes = index * header.readingSizeBytes + header.startOffset;
+
+	SBFlashRead(header.startPage + diffBytes / SB_FLASH_PAGE_SIZE, diffBytes % SB_FLASH_PAGE_SIZE, (uint8_t*)reading, header.readingSizeBytes);
+
+	if (SB_FLASH_IS_LEGACY()) {
+		SB_FLASH_LEGACY_TIMEDIFF_T timeDiff;
+
+		memcpy(&timeDiff, &reading->timeDiff, sizeof(timeDiff));
+		reading->timeDiff = (SB_TIMEDIFF_T)timeDiff * 1000;
+	}
 
 	if (NULL != refTimestamp) {
 		*refTimestamp = header.timestamp;
@@ -442,26 +543,89 @@ SB_Error SB_flashGetLastReading(SB_FLASH_READING_TYPE *reading, uint32_t *refTim
  * @return  NoError if properly read, otherwise the error. If error `reading` will be NULL.
  */
 SB_Error SB_flashReadNext(SB_FLASH_READING_TYPE * reading, uint32_t * refTimestamp) {
-	SB_flashGetFirstReading(reading, refTimestamp);
+	SB_Error result;
 
-	header.startOffset += header.readingSizeBytes;
-	if (header.startOffset >= SB_FLASH_PAGE_SIZE) {
-		header.startOffset -= header.readingSizeBytes;
-		header.startPage = (header.startPage + 1) % SB_FLASH_NUM_PAGES;
+	if (NoError != (result = SB_flashGetFirstReading(reading, refTimestamp))) {
+		return result;
 	}
 
-	if (--header.entryCount == 0) {
+	return SB_flashDiscard(1);
+}
+
+/*********************************************************************
+ * @fn      SB_flashDiscard
+ *
+ * @brief   Removes the oldest `count` readings from storage
+ *
+ * @param   count           - The number of readings to remove
+ *
+ * @return  NoError if removed, otherwise the error
+ */
+SB_Error SB_flashDiscard(SB_FLASH_COUNT_T count) {
+	SB_FLASH_COUNT_T archived = SB_flashArchiveCount() < count ? SB_flashArchiveCount() : count;
+	SB_Error result;
+
+	if (count > readingCount) {
+		return InvalidParameter;
+	}
+
+	// The oldest readings are archived
+	if (NoError != (result = SB_flashArchiveDiscard(archived))) {
+		return result;
+	}
+
+	readingCount -= count;
+	count -= archived;
+
+	if (count == 0) {
+		return NoError;
+	}
+
+	if (count == header.entryCount) {
 		// There are now no entries stored. Clear flash memory and reset.
-		uint8_t i;
-		for (i = 0; i < SB_FLASH_NUM_PAGES; ++i) {
-			erasePage(i + SB_FLASH_PAGE_FIRST);
+		return resetInternal();
+	}
+
+	// Readings are packed back to back across pages, the same way SB_flashWriteReadings places them
+	uint32_t startBytes = count * header.readingSizeBytes + header.startOffset;
+
+	header.startPage += startBytes / SB_FLASH_PAGE_SIZE;
+	header.startOffset = startBytes % SB_FLASH_PAGE_SIZE;
+	header.entryCount -= count;
+
+	return NoError;
+}
+
+/*********************************************************************
+ * @fn      SB_flashMigrate
+ *
+ * @brief   Moves the readings in internal flash to the archive once internal flash is nearly full.
+ * 			The archive takes them in one sequential write, straight from internal flash.
+ *
+ * @return  NoError if nothing had to move or it was moved, otherwise the error
+ */
+SB_Error SB_flashMigrate() {
+	SB_Error result = NoError;
+
+	// The archive only takes readings in the current format. Legacy ones wait to be drained.
+	if (!SB_FLASH_IS_LEGACY() && header.entryCount > 0 && internalFreeBytes() < SB_FLASH_MIGRATE_HEADROOM * header.readingSizeBytes) {
+		// Readings are packed back to back from the start position, and internal flash is memory mapped
+		const uint8 *readings = (const uint8*)((SB_FLASH_POINTER_T)header.startPage * SB_FLASH_PAGE_SIZE + header.startOffset);
+
+		result = SB_flashArchiveAppend(readings, header.entryCount, header.timestamp);
+
+		if (NoError == result) {
+			// Everything is archived, start internal flash over. The reading count is unchanged.
+			result = resetInternal();
 		}
 
-		// After performing page erases this will reset the header to default values
-		return loadNextHeader(SB_FLASH_PAGE_FIRST, 0, &header, header.readingSizeBytes);
+		SB_TRACE2(SB_TRACE_FLASH_MIGRATED, result, SB_flashArchiveCount());
 	}
 
-	return NoError;
+	// Nothing else uses the external flash until the next migration or sync
+	SB_flashArchiveIdle();
+
+	return result;
 }
 
 /*********************************************************************
@@ -653,6 +817,8 @@ SB_Error SBFlashWrite(uint8 pg, uint16 offset, uint8 *buf, uint16 count) {
 		return InvalidParameter;
 	}
 
+	SB_energyCountFlashOp(SB_FLASH_OP_PROGRAM);
+
 	// Enter Critical Section.
 	HAL_ENTER_CRITICAL_SECTION(cs);
 
@@ -734,6 +900,8 @@ SB_Error erasePage(uint8 pg) {
 	halIntState_t cs;
 	uint32 addr = ((pg % HAL_NV_PAGE_BEG )* HAL_FLASH_PAGE_SIZE);
 
+	SB_energyCountFlashOp(SB_FLASH_OP_ERASE);
+
 	// Enter Critical Section.
 	HAL_ENTER_CRITICAL_SECTION(cs);
 
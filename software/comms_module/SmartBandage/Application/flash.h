@@ -87,6 +87,27 @@ SB_Error SB_flashGetReading(SB_FLASH_COUNT_T index, SB_FLASH_READING_TYPE * read
  */
 SB_Error SB_flashReadNext(SB_FLASH_READING_TYPE * reading, uint32_t * refTimestamp);
 
+/*********************************************************************
+ * @fn      SB_flashDiscard
+ *
+ * @brief   Removes the oldest `count` readings from storage
+ *
+ * @param   count           - The number of readings to remove
+ *
+ * @return  NoError if removed, otherwise the error
+ */
+SB_Error SB_flashDiscard(SB_FLASH_COUNT_T count);
+
+/*********************************************************************
+ * @fn      SB_flashMigrate
+ *
+ * @brief   Moves the readings in internal flash to the external flash archive once internal flash
+ * 			is nearly full. Reading indices and the reading count are unchanged by a migration.
+ *
+ * @return  NoError if nothing had to move or it was moved, otherwise the error
+ */
+SB_Error SB_flashMigrate();
+
 /*********************************************************************
  * @fn      SB_flashPrepShutdown
  *
@@ -0,0 +1,496 @@
+/*
+ * flashArchive.c
+ *
+ * Readings archive in the user region of the external SPI flash.
+ *
+ * Each migration from internal flash becomes one segment: a header followed by the readings packed
+ * back to back, starting on a page boundary so that segments can be found again after a reset by
+ * looking at the start of each page. Segments are placed one after another around the region. The
+ * first page of a segment is erased once all of its readings are discarded, so it is not recovered.
+ * Until then, the readings discarded from it are tallied in its header, so that a reset does not
+ * bring them back.
+ */
+
+#ifdef SB_FLASH_ARCHIVE
+
+#include <string.h>
+#include <stddef.h>
+#include <xdc/runtime/System.h>
+
+#include "ext_flash.h"
+#include "ext_flash_layout.h"
+
+#include "energy.h"
+#include "flashArchive.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define SB_ARCHIVE_BEGIN_ADDR		EFL_ADDR_USER
+#define SB_ARCHIVE_PAGE_SIZE		EFL_PAGE_SIZE
+#define SB_ARCHIVE_NUM_PAGES		(EFL_SIZE_USER / EFL_PAGE_SIZE)
+
+// Segments are at least a page each, so this only limits many small migrations
+#define SB_ARCHIVE_MAX_SEGMENTS		16
+
+#define SB_ARCHIVE_MARKER			0x5142
+#define SB_ARCHIVE_HDR_SIZE			sizeof(SB_ArchiveHeader)
+
+// Each bit of the tally stands for this many readings, so that it covers the whole segment. A
+// segment of at most SB_ARCHIVE_TALLY_BITS readings is tallied exactly.
+#define SB_ARCHIVE_TALLY_BITS		512
+#define SB_ARCHIVE_TALLY_STEP(entryCount)	(((entryCount) + SB_ARCHIVE_TALLY_BITS - 1) / SB_ARCHIVE_TALLY_BITS)
+
+#define SB_ARCHIVE_PAGE_ADDR(page)	(SB_ARCHIVE_BEGIN_ADDR + (size_t)(page) * SB_ARCHIVE_PAGE_SIZE)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+typedef struct {
+	uint16				marker;
+	uint8				readingSizeBytes;
+	uint8				pages;
+	uint32				sequence;
+
+	// Written as all 1's if the time was not set at migration, and programmed once it is
+	SB_TIMESTAMP_T		timestamp;
+	SB_FLASH_COUNT_T	entryCount;
+
+	// Written as all 1's. Bit i, counting from the low bit of the first byte, is programmed to 0
+	// once (i + 1) tally steps of readings have been discarded.
+	uint8				tally[SB_ARCHIVE_TALLY_BITS / 8];
+} SB_ArchiveHeader;
+
+typedef struct {
+	uint8				page;
+	uint8				pages;
+	SB_FLASH_COUNT_T	entryCount;
+	SB_FLASH_COUNT_T	consumed;
+	SB_TIMESTAMP_T		timestamp;
+	uint32				sequence;
+} SB_ArchiveSegment;
+
+/*********************************************************************
+ * Local variables
+ */
+static struct {
+	SB_ArchiveSegment	segments[SB_ARCHIVE_MAX_SEGMENTS];
+	uint8				firstSegment;
+	uint8				numSegments;
+	uint32				nextSequence;
+	SB_FLASH_COUNT_T	entryCount;
+	uint8				readingSizeBytes;
+	bool				isOpen;
+} ARCHIVE;
+
+/*********************************************************************
+ * @fn      archiveSegment
+ *
+ * @brief   Gets the nth oldest segment
+ */
+static SB_ArchiveSegment* archiveSegment(uint8 n) {
+	return &ARCHIVE.segments[(ARCHIVE.firstSegment + n) % SB_ARCHIVE_MAX_SEGMENTS];
+}
+
+/*********************************************************************
+ * @fn      archiveOpen
+ *
+ * @brief   Powers up the external flash if it is not already
+ *
+ * @return  True if the flash is ready
+ */
+static bool archiveOpen() {
+	if (!ARCHIVE.isOpen) {
+		ARCHIVE.isOpen = extFlashOpen();
+	}
+
+	return ARCHIVE.isOpen;
+}
+
+/*********************************************************************
+ * @fn      archiveErase
+ *
+ * @brief   Erases external flash, counting the erase
+ *
+ * @return  True if the erase was started
+ */
+static bool archiveErase(size_t offset, size_t length) {
+	SB_energyCountFlashOp(SB_FLASH_OP_EXT_ERASE);
+
+	return extFlashErase(offset, length);
+}
+
+/*********************************************************************
+ * @fn      archiveWrite
+ *
+ * @brief   Programs external flash, counting the write
+ *
+ * @return  True if written
+ */
+static bool archiveWrite(size_t offset, size_t length, const uint8_t *buf) {
+	SB_energyCountFlashOp(SB_FLASH_OP_EXT_PROGRAM);
+
+	return extFlashWrite(offset, length, buf);
+}
+
+/*********************************************************************
+ * @fn      archiveTallyRead
+ *
+ * @brief   Gets the number of readings tallied as discarded in a segment's header
+ */
+static SB_FLASH_COUNT_T archiveTallyRead(const SB_ArchiveHeader *hdr) {
+	SB_FLASH_COUNT_T steps = 0;
+	uint16 i;
+
+	// Bits are programmed in order, so the tally is a run of 0's followed by 1's
+	for (i = 0; i < sizeof(hdr->tally); ++i) {
+		uint8 bits = hdr->tally[i];
+
+		if (0x00 == bits) {
+			steps += 8;
+			continue;
+		}
+
+		for (; !(bits & 1); bits >>= 1) {
+			++steps;
+		}
+
+		break;
+	}
+
+	steps *= SB_ARCHIVE_TALLY_STEP(hdr->entryCount);
+
+	return steps < hdr->entryCount ? steps : hdr->entryCount;
+}
+
+/*********************************************************************
+ * @fn      archiveTallyWrite
+ *
+ * @brief   Programs the steps a discard completed into the segment's tally. Only 1's are changed to
+ * 			0's, so the header is not erased.
+ *
+ * @param   segment			 - the segment, with its new consumed count
+ *
+ * @param   consumed		 - its consumed count before the discard
+ */
+static void archiveTallyWrite(const SB_ArchiveSegment *segment, SB_FLASH_COUNT_T consumed) {
+	SB_FLASH_COUNT_T step = SB_ARCHIVE_TALLY_STEP(segment->entryCount);
+	uint16 from = consumed / step, to = segment->consumed / step;
+	uint8 bytes[sizeof(((SB_ArchiveHeader*)0)->tally)];
+	uint16 i;
+
+	if (to == from || !archiveOpen()) {
+		return;
+	}
+
+	for (i = from / 8; i <= (to - 1) / 8; ++i) {
+		bytes[i] = to >= (i + 1) * 8 ? 0x00 : (uint8)(0xFF << (to - i * 8));
+	}
+
+	archiveWrite(SB_ARCHIVE_PAGE_ADDR(segment->page) + offsetof(SB_ArchiveHeader, tally) + from / 8,
+			(to - 1) / 8 - from / 8 + 1, &bytes[from / 8]);
+}
+
+/*********************************************************************
+ * @fn      archiveOverlaps
+ *
+ * @brief   Checks whether a range of pages holds any live segment
+ */
+static bool archiveOverlaps(uint8 page, uint8 pages) {
+	uint8 i;
+
+	for (i = 0; i < ARCHIVE.numSegments; ++i) {
+		SB_ArchiveSegment *segment = archiveSegment(i);
+
+		if (page < segment->page + segment->pages && segment->page < page + pages) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*********************************************************************
+ * @fn      SB_flashArchiveInit
+ *
+ * @brief   Initialize the archive, recovering segments left in external flash
+ *
+ * @param   readingSizeBytes - the size of a block of readings in bytes
+ *
+ * @param   reinit			 - true to drop everything archived
+ *
+ * @return  NoError if initialized, otherwise the error
+ */
+SB_Error SB_flashArchiveInit(uint8 readingSizeBytes, bool reinit) {
+	SB_ArchiveHeader hdr;
+	SB_FLASH_COUNT_T consumed;
+	uint8 page, i;
+
+	memset(&ARCHIVE, 0, sizeof(ARCHIVE));
+	ARCHIVE.readingSizeBytes = readingSizeBytes;
+
+	if (!archiveOpen()) {
+		return UnknownError;
+	}
+
+	for (page = 0; page < SB_ARCHIVE_NUM_PAGES; ++page) {
+		if (!extFlashRead(SB_ARCHIVE_PAGE_ADDR(page), sizeof(hdr), (uint8_t*)&hdr)) {
+			return UnknownError;
+		}
+
+		if (hdr.marker != SB_ARCHIVE_MARKER || hdr.readingSizeBytes != readingSizeBytes || 0 == hdr.pages
+				|| page + hdr.pages > SB_ARCHIVE_NUM_PAGES
+				|| SB_ARCHIVE_HDR_SIZE + hdr.entryCount * readingSizeBytes > (uint32)hdr.pages * SB_ARCHIVE_PAGE_SIZE) {
+			continue;
+		}
+
+		consumed = archiveTallyRead(&hdr);
+
+		// A segment whose readings were all discarded, but whose erase was cut short by a reset
+		if (reinit || consumed == hdr.entryCount || ARCHIVE.numSegments == SB_ARCHIVE_MAX_SEGMENTS) {
+			archiveErase(SB_ARCHIVE_PAGE_ADDR(page), SB_ARCHIVE_PAGE_SIZE);
+			continue;
+		}
+
+		// Keep the table in sequence order. Segments are few, so insertion will do.
+		for (i = ARCHIVE.numSegments; i > 0 && ARCHIVE.segments[i - 1].sequence > hdr.sequence; --i) {
+			ARCHIVE.segments[i] = ARCHIVE.segments[i - 1];
+		}
+
+		ARCHIVE.segments[i].page = page;
+		ARCHIVE.segments[i].pages = hdr.pages;
+		ARCHIVE.segments[i].entryCount = hdr.entryCount;
+		ARCHIVE.segments[i].consumed = consumed;
+		ARCHIVE.segments[i].timestamp = hdr.timestamp;
+		ARCHIVE.segments[i].sequence = hdr.sequence;
+
+		++ARCHIVE.numSegments;
+		ARCHIVE.entryCount += hdr.entryCount - consumed;
+
+		if (hdr.sequence >= ARCHIVE.nextSequence) {
+			ARCHIVE.nextSequence = hdr.sequence + 1;
+		}
+
+		// The rest of the segment holds readings, not headers
+		page += hdr.pages - 1;
+	}
+
+#ifdef SB_DEBUG
+	System_printf("SB Flash archive: %d segments, %d readings recovered.\n", ARCHIVE.numSegments, ARCHIVE.entryCount);
+#endif
+
+	return NoError;
+}
+
+/*********************************************************************
+ * @fn      SB_flashArchiveCount
+ *
+ * @brief   Get the number of readings held in the archive
+ *
+ * @return  The reading count
+ */
+SB_FLASH_COUNT_T SB_flashArchiveCount() {
+	return ARCHIVE.entryCount;
+}
+
+/*********************************************************************
+ * @fn      SB_flashArchiveAppend
+ *
+ * @brief   Append readings to the archive as a new segment, in one sequential write
+ *
+ * @param   readings		 - the readings, packed back to back. May point into internal flash.
+ *
+ * @param   count			 - the number of readings
+ *
+ * @param   timestamp		 - the reference time the readings' timeDiff is relative to, UINT32_MAX if not set
+ *
+ * @return  NoError if written, OutOfMemory if the archive has no room for them
+ */
+SB_Error SB_flashArchiveAppend(const uint8 *readings, SB_FLASH_COUNT_T count, SB_TIMESTAMP_T timestamp) {
+	uint32 pages = (SB_ARCHIVE_HDR_SIZE + count * ARCHIVE.readingSizeBytes + SB_ARCHIVE_PAGE_SIZE - 1) / SB_ARCHIVE_PAGE_SIZE;
+	uint8 page = 0;
+	SB_ArchiveSegment *segment;
+	SB_ArchiveHeader hdr;
+
+	if (0 == count) {
+		return NoError;
+	}
+
+	if (NULL == readings || 0 == ARCHIVE.readingSizeBytes) {
+		return InvalidParameter;
+	}
+
+	if (pages > SB_ARCHIVE_NUM_PAGES || ARCHIVE.numSegments == SB_ARCHIVE_MAX_SEGMENTS) {
+		return OutOfMemory;
+	}
+
+	// Continue after the newest segment, going back to the start of the region when it doesn't fit
+	if (ARCHIVE.numSegments > 0) {
+		segment = archiveSegment(ARCHIVE.numSegments - 1);
+		page = segment->page + segment->pages;
+
+		if (page + pages > SB_ARCHIVE_NUM_PAGES) {
+			page = 0;
+		}
+	}
+
+	if (archiveOverlaps(page, pages)) {
+		return OutOfMemory;
+	}
+
+	if (!archiveOpen()) {
+		return UnknownError;
+	}
+
+	hdr.marker = SB_ARCHIVE_MARKER;
+	hdr.readingSizeBytes = ARCHIVE.readingSizeBytes;
+	hdr.pages = pages;
+	hdr.sequence = ARCHIVE.nextSequence;
+	hdr.timestamp = timestamp;
+	hdr.entryCount = count;
+	memset(hdr.tally, 0xFF, sizeof(hdr.tally));
+
+	// The readings go first so that a segment cut short by a reset has no header and is ignored. The
+	// caller erases the readings from internal flash next, so wait for the header to be programmed.
+	if (!archiveErase(SB_ARCHIVE_PAGE_ADDR(page), (size_t)pages * SB_ARCHIVE_PAGE_SIZE)
+			|| !archiveWrite(SB_ARCHIVE_PAGE_ADDR(page) + SB_ARCHIVE_HDR_SIZE, count * ARCHIVE.readingSizeBytes, readings)
+			|| !archiveWrite(SB_ARCHIVE_PAGE_ADDR(page), sizeof(hdr), (const uint8_t*)&hdr)
+			|| !extFlashSync()) {
+		return UnknownError;
+	}
+
+	segment = archiveSegment(ARCHIVE.numSegments++);
+	segment->page = page;
+	segment->pages = pages;
+	segment->entryCount = count;
+	segment->consumed = 0;
+	segment->timestamp = timestamp;
+	segment->sequence = ARCHIVE.nextSequence++;
+
+	ARCHIVE.entryCount += count;
+
+	return NoError;
+}
+
+/*********************************************************************
+ * @fn      SB_flashArchiveGetReading
+ *
+ * @brief   Gets an archived reading
+ *
+ * @param   index           - The index of the reading to get, 0 being the oldest
+ *
+ * @return  NoError if read, otherwise the error
+ */
+SB_Error SB_flashArchiveGetReading(SB_FLASH_COUNT_T index, SB_FLASH_READING_TYPE *reading, uint32_t *refTimestamp) {
+	uint8 i;
+
+	if (index >= ARCHIVE.entryCount) {
+		return NoDataAvailable;
+	}
+
+	for (i = 0; i < ARCHIVE.numSegments; ++i) {
+		SB_ArchiveSegment *segment = archiveSegment(i);
+		SB_FLASH_COUNT_T remaining = segment->entryCount - segment->consumed;
+
+		if (index >= remaining) {
+			index -= remaining;
+			continue;
+		}
+
+		if (!archiveOpen() || !extFlashRead(SB_ARCHIVE_PAGE_ADDR(segment->page) + SB_ARCHIVE_HDR_SIZE
+				+ (size_t)(segment->consumed + index) * ARCHIVE.readingSizeBytes,
+				ARCHIVE.readingSizeBytes, (uint8_t*)reading)) {
+			return UnknownError;
+		}
+
+		if (NULL != refTimestamp) {
+			*refTimestamp = segment->timestamp;
+		}
+
+		return NoError;
+	}
+
+	return NoDataAvailable;
+}
+
+/*********************************************************************
+ * @fn      SB_flashArchiveDiscard
+ *
+ * @brief   Removes the oldest `count` archived readings
+ *
+ * @return  NoError if removed, otherwise the error
+ */
+SB_Error SB_flashArchiveDiscard(SB_FLASH_COUNT_T count) {
+	if (count > ARCHIVE.entryCount) {
+		return InvalidParameter;
+	}
+
+	ARCHIVE.entryCount -= count;
+
+	while (count > 0) {
+		SB_ArchiveSegment *segment = archiveSegment(0);
+		SB_FLASH_COUNT_T remaining = segment->entryCount - segment->consumed;
+
+		if (count < remaining) {
+			segment->consumed += count;
+			archiveTallyWrite(segment, segment->consumed - count);
+			break;
+		}
+
+		count -= remaining;
+
+		// Erasing the header page is enough for the segment not to be recovered. The erase is left
+		// running in the flash.
+		if (archiveOpen()) {
+			archiveErase(SB_ARCHIVE_PAGE_ADDR(segment->page), SB_ARCHIVE_PAGE_SIZE);
+		}
+
+		ARCHIVE.firstSegment = (ARCHIVE.firstSegment + 1) % SB_ARCHIVE_MAX_SEGMENTS;
+		--ARCHIVE.numSegments;
+	}
+
+	return NoError;
+}
+
+/*********************************************************************
+ * @fn      SB_flashArchiveTimeSet
+ *
+ * @brief   Gives segments archived before the time was set their reference time
+ *
+ * @param   timestamp		 - the reference time of readings taken before the time was set
+ */
+void SB_flashArchiveTimeSet(SB_TIMESTAMP_T timestamp) {
+	uint8 i;
+
+	for (i = 0; i < ARCHIVE.numSegments; ++i) {
+		SB_ArchiveSegment *segment = archiveSegment(i);
+
+		if (UINT32_MAX != segment->timestamp) {
+			continue;
+		}
+
+		segment->timestamp = timestamp;
+
+		// The stored timestamp is still all 1's, so it can be programmed in place
+		if (archiveOpen()) {
+			archiveWrite(SB_ARCHIVE_PAGE_ADDR(segment->page) + offsetof(SB_ArchiveHeader, timestamp),
+					sizeof(timestamp), (const uint8_t*)&timestamp);
+		}
+	}
+}
+
+/*********************************************************************
+ * @fn      SB_flashArchiveIdle
+ *
+ * @brief   Powers the external flash down until the archive is next used. An erase left running
+ * 			by a discard is not waited for; the flash is powered down by a later call instead.
+ */
+void SB_flashArchiveIdle() {
+	if (ARCHIVE.isOpen && !extFlashBusy()) {
+		extFlashClose();
+		ARCHIVE.isOpen = false;
+	}
+}
+
+#endif /* SB_FLASH_ARCHIVE */
@@ -0,0 +1,103 @@
+/*
+ * flashArchive.h
+ *
+ * Second tier of the readings log in external SPI flash. flash.c moves its
+ * internal readings here in one sequential write when internal flash runs
+ * low, and reads the oldest readings back from here transparently.
+ */
+
+#ifndef APPLICATION_FLASHARCHIVE_H_
+#define APPLICATION_FLASHARCHIVE_H_
+
+#include "flash.h"
+
+#ifdef SB_FLASH_ARCHIVE
+
+/*********************************************************************
+ * @fn      SB_flashArchiveInit
+ *
+ * @brief   Initialize the archive, recovering segments left in external flash
+ *
+ * @param   readingSizeBytes - the size of a block of readings in bytes
+ *
+ * @param   reinit			 - true to drop everything archived
+ *
+ * @return  NoError if initialized, otherwise the error
+ */
+SB_Error SB_flashArchiveInit(uint8 readingSizeBytes, bool reinit);
+
+/*********************************************************************
+ * @fn      SB_flashArchiveCount
+ *
+ * @brief   Get the number of readings held in the archive
+ *
+ * @return  The reading count
+ */
+SB_FLASH_COUNT_T SB_flashArchiveCount();
+
+/*********************************************************************
+ * @fn      SB_flashArchiveAppend
+ *
+ * @brief   Append readings to the archive as a new segment, in one sequential write
+ *
+ * @param   readings		 - the readings, packed back to back. May point into internal flash.
+ *
+ * @param   count			 - the number of readings
+ *
+ * @param   timestamp		 - the reference time the readings' timeDiff is relative to, UINT32_MAX if not set
+ *
+ * @return  NoError if written, OutOfMemory if the archive has no room for them
+ */
+SB_Error SB_flashArchiveAppend(const uint8 *readings, SB_FLASH_COUNT_T count, SB_TIMESTAMP_T timestamp);
+
+/*********************************************************************
+ * @fn      SB_flashArchiveGetReading
+ *
+ * @brief   Gets an archived reading
+ *
+ * @param   index           - The index of the reading to get, 0 being the oldest
+ *
+ * @return  NoError if read, otherwise the error
+ */
+SB_Error SB_flashArchiveGetReading(SB_FLASH_COUNT_T index, SB_FLASH_READING_TYPE *reading, uint32_t *refTimestamp);
+
+/*********************************************************************
+ * @fn      SB_flashArchiveDiscard
+ *
+ * @brief   Removes the oldest `count` archived readings
+ *
+ * @return  NoError if removed, otherwise the error
+ */
+SB_Error SB_flashArchiveDiscard(SB_FLASH_COUNT_T count);
+
+/*********************************************************************
+ * @fn      SB_flashArchiveTimeSet
+ *
+ * @brief   Gives segments archived before the time was set their reference time
+ *
+ * @param   timestamp		 - the reference time of readings taken before the time was set
+ */
+void SB_flashArchiveTimeSet(SB_TIMESTAMP_T timestamp);
+
+/*********************************************************************
+ * @fn      SB_flashArchiveIdle
+ *
+ * @brief   Powers the external flash down until the archive is next used, once it has finished
+ * 			any erase still running
+ */
+void SB_flashArchiveIdle();
+
+#else
+
+// Without an archive everything stays in internal flash
+static inline SB_Error SB_flashArchiveInit(uint8 readingSizeBytes, bool reinit) { return NoError; }
+static inline SB_FLASH_COUNT_T SB_flashArchiveCount() { return 0; }
+static inline SB_Error SB_flashArchiveAppend(const uint8 *readings, SB_FLASH_COUNT_T count, SB_TIMESTAMP_T timestamp) { return OutOfMemory; }
+static inline SB_Error SB_flashArchiveGetReading(SB_FLASH_COUNT_T index, SB_FLASH_READING_TYPE *reading, uint32_t *refTimestamp) { return NoDataAvailable; }
+static inline SB_Error SB_flashArchiveDiscard(SB_FLASH_COUNT_T count) { return 0 == count ? NoError : InvalidParameter; }
+static inline void SB_flashArchiveTimeSet(SB_TIMESTAMP_T timestamp) { }
+static inline void SB_flashArchiveIdle() { }
+
+#endif /* SB_FLASH_ARCHIVE */
+
+#endif /* APPLICATION_FLASHARCHIVE_H_ */
@@ -1,6 +1,6 @@
 // Outline for finite state machine for MCU
 
-/* 
+/*
 states:
     sleep mode
     transmit mode
@@ -8,35 +8,98 @@ states:
     init mode
     temp error
     perm error
-    
+
 events:
     check timer expires
     ble timer expires
     data change (alert)
     no bandage detected
     error occurs
+    cycle complete (return to sleep)
  */
 
- #include "fsm.h"
+#include "fsm.h"
+#include "trace.h"
 #include <ti/sysbios/knl/Task.h>
+#include <ti/sysbios/knl/Clock.h>
+
 //function prototypes
-SB_State SB_checkTimerExpired(void);
-SB_State SB_bleTimerExpired(void);
-SB_State SB_noBandageDetected(void);
-SB_State SB_errorEvent(); //a more permanent error caught
-SB_State SB_dataChanged(void);
-SB_State SB_returnToSleep(void);
-void SB_setError(SB_Error);
-void SB_callCallback(SB_State_Transition transition, SB_State state);
-
-struct {
-	SB_CallbackFunc *callbacks;
+static SB_State SB_transition(SB_State newState, SB_Event event);
+static void SB_callCallbacks(SB_State_Transition transition, SB_State state);
+
+// Next state for every state and event. Built at compile time; every entry is listed so that
+// none silently defaults to S_SLEEP.
+static const uint8_t transitionTable[SB_NUM_STATES][SB_NUM_EVENTS] = {
+	[S_SLEEP] = {
+		[E_CHECK_TIMER_EXPIRED] = S_CHECK,
+		[E_BLE_TIMER_EXPIRED]   = S_TRANSMIT,
+		[E_DATA_CHANGE]         = S_TRANSMIT,
+		[E_NO_BANDAGE_DETECTED] = S_ERROR_TEMP,
+		[E_ERROR]               = S_ERROR_TEMP,
+		[E_CYCLE_COMPLETE]      = S_SLEEP,
+	},
+	[S_CHECK] = {
+		[E_CHECK_TIMER_EXPIRED] = S_CHECK,
+		[E_BLE_TIMER_EXPIRED]   = S_TRANSMIT,
+		[E_DATA_CHANGE]         = S_TRANSMIT,
+		[E_NO_BANDAGE_DETECTED] = S_ERROR_TEMP,
+		[E_ERROR]               = S_ERROR_TEMP,
+		[E_CYCLE_COMPLETE]      = S_SLEEP,
+	},
+	[S_TRANSMIT] = {
+		[E_CHECK_TIMER_EXPIRED] = S_CHECK,
+		[E_BLE_TIMER_EXPIRED]   = S_TRANSMIT,
+		[E_DATA_CHANGE]         = S_TRANSMIT,
+		[E_NO_BANDAGE_DETECTED] = S_ERROR_TEMP,
+		[E_ERROR]               = S_ERROR_TEMP,
+		[E_CYCLE_COMPLETE]      = S_SLEEP,
+	},
+	// A temporary error is retried on the next timer
+	[S_ERROR_TEMP] = {
+		[E_CHECK_TIMER_EXPIRED] = S_CHECK,
+		[E_BLE_TIMER_EXPIRED]   = S_TRANSMIT,
+		[E_DATA_CHANGE]         = S_TRANSMIT,
+		[E_NO_BANDAGE_DETECTED] = S_ERROR_TEMP,
+		[E_ERROR]               = S_ERROR_TEMP,
+		[E_CYCLE_COMPLETE]      = S_SLEEP,
+	},
+	// Nothing leaves a permanent error
+	[S_ERROR_PERM] = {
+		[E_CHECK_TIMER_EXPIRED] = S_ERROR_PERM,
+		[E_BLE_TIMER_EXPIRED]   = S_ERROR_PERM,
+		[E_DATA_CHANGE]         = S_ERROR_PERM,
+		[E_NO_BANDAGE_DETECTED] = S_ERROR_PERM,
+		[E_ERROR]               = S_ERROR_PERM,
+		[E_CYCLE_COMPLETE]      = S_ERROR_PERM,
+	},
+	[S_INIT] = {
+		[E_CHECK_TIMER_EXPIRED] = S_CHECK,
+		[E_BLE_TIMER_EXPIRED]   = S_TRANSMIT,
+		[E_DATA_CHANGE]         = S_TRANSMIT,
+		[E_NO_BANDAGE_DETECTED] = S_ERROR_TEMP,
+		[E_ERROR]               = S_ERROR_TEMP,
+		[E_CYCLE_COMPLETE]      = S_SLEEP,
+	},
+};
+
+// Registered callback functions, and for each transition stage and state a mask of the ones to call
+static struct {
+	SB_StateTransitionCallbackFunc functions[SB_FSM_MAX_CALLBACKS];
+	uint8_t count;
+	uint8_t masks[SB_NUM_TRANSITIONS][SB_NUM_STATES];
 } callbackTable;
 
+// Most recent transitions. Entry n % SB_FSM_TRACE_SIZE holds transition n.
+static struct {
+	SB_FsmTraceEntry entries[SB_FSM_TRACE_SIZE];
+	uint32_t count;
+} trace;
+
 //local variables
 SB_SystemState systemState = {
 	.currentState = S_INIT,
 	.lastState    = S_INIT,
+	.lastEvent	  = SB_NUM_EVENTS,
 	.currentError = NoError,
 	.lastError    = NoError,
 };
@@ -45,80 +108,65 @@ SB_SystemState systemState = {
  *  - the tasks will have been previously created, and in the function SB_switchState we are using the tasks, but not creating any new ones
  */
 SB_State SB_switchState(SB_State newState) {
-	SB_State oldState = systemState.currentState;
-	SB_callCallback(T_STATE_PRE_EXIT, systemState.currentState);
-
-	switch (newState) {
-	case S_INIT:
+	return SB_transition(newState, SB_NUM_EVENTS);
+}
 
-	case S_SLEEP:
+// Handles an event with the transition table
+SB_State SB_handleEvent(SB_Event event) {
+	SB_State next;
 
-	case S_CHECK:
+	if (event >= SB_NUM_EVENTS) {
+		return SB_transition(S_ERROR_PERM, event);
+	}
 
-	case S_TRANSMIT:
-		SB_setError(NoError);
-		// No "break" on purpose
+	next = (SB_State)transitionTable[systemState.currentState][event];
 
-	case S_ERROR_TEMP:
-		SB_callCallback(T_STATE_PRE_ENTER, newState);
-		systemState.currentState = newState;
-		break;
+	// Errors that the device cannot recover from are permanent
+	if (E_ERROR == event && S_ERROR_TEMP == next) {
+		switch (systemState.currentError) {
+		case OSResourceInitializationError:
+		case OutOfMemory:
+			next = S_ERROR_PERM;
+			break;
 
-	default:
-		SB_callCallback(T_STATE_PRE_ENTER, S_ERROR_PERM);
-		systemState.currentState = S_ERROR_PERM;
+		default:
+			break;
+		}
 	}
 
-	SB_callCallback(T_STATE_EXIT, oldState);
-	SB_callCallback(T_STATE_ENTER, systemState.currentState);
-
-	return systemState.currentState;
+	return SB_transition(next, event);
 }
 
-//action procedures here for now, also might want to put into another file later
-SB_State SB_checkTimerExpired(void){
-    //the timer expired, 
-	return SB_switchState(S_CHECK);
-    //check data from periperal sensors and store it into a register
-    
-    //reset the timer
-    
-    //check new data with previous data (if it exists), if it is outside expected range, send an alert, if not, return to sleep
-}
-SB_State SB_bleTimerExpired(void){
-    //the transmit data timer expired
-	return SB_switchState(S_TRANSMIT);
-    //send the data via the bluetooth to the smartphone android application
-    //check if successful - remove previous data(?) and return to sleep
-    //if not, reset timer, and save previous data
-}
-SB_State SB_noBandageDetected(void){
-    //no connection between the communications module and the bandage module detected
-    //set the current state to temp error and wait for check timer to expire to see if initialized (?)
-	return SB_switchState(S_ERROR_TEMP);
-}
-SB_State SB_errorEvent(){
-    //a more permanent error has occurred, do nothing or else relay problem via bluetooth
-
-	//permanent errors
-	switch (systemState.currentError) {
-	case OSResourceInitializationError:
-	case OutOfMemory:
-		return SB_switchState(S_ERROR_PERM);
-
-	// All other errors implied temporary
-	default:
-		return SB_switchState(S_ERROR_TEMP);
+static SB_State SB_transition(SB_State newState, SB_Event event) {
+	SB_State oldState = systemState.currentState;
+	SB_FsmTraceEntry *entry;
+
+	if (newState >= SB_NUM_STATES) {
+		newState = S_ERROR_PERM;
 	}
-}
-SB_State SB_dataChanged(void){
-    //data changed prior to the ble_timer expiring
-	return SB_switchState(S_TRANSMIT);
-}
 
-//not actually an event, just something that happens when there isn't anything else to do
-SB_State SB_returnToSleep(void){
-	return SB_switchState(S_SLEEP);
+	SB_callCallbacks(T_STATE_PRE_EXIT, oldState);
+
+	if (S_ERROR_TEMP != newState && S_ERROR_PERM != newState) {
+		SB_setError(NoError);
+	}
+
+	SB_callCallbacks(T_STATE_PRE_ENTER, newState);
+	systemState.lastState = oldState;
+	systemState.currentState = newState;
+	systemState.lastEvent = event;
+
+	entry = &trace.entries[trace.count++ & (SB_FSM_TRACE_SIZE - 1)];
+	entry->ticks = Clock_getTicks();
+	entry->from = oldState;
+	entry->to = newState;
+	entry->event = event;
+	SB_TRACE3(SB_TRACE_FSM_TRANSITION, oldState, newState, event);
+
+	SB_callCallbacks(T_STATE_EXIT, oldState);
+	SB_callCallbacks(T_STATE_ENTER, newState);
+
+	return newState;
 }
 
 inline void SB_setError(SB_Error error) {
@@ -132,54 +180,62 @@ inline SB_State SB_currentState() {
 
 // Called from within periheral functions to register that the peripheral will need to be revisited when the state changes
 SB_Error SB_registerStateTransitionCallback(SB_StateTransitionCallbackFunc function, SB_State_Transition transition, SB_State state) {
-	SB_CallbackFunc *newCallback, *current;
+	uint8_t i;
 
-	if (NULL == function) {
+	if (NULL == function || transition >= SB_NUM_TRANSITIONS || state >= SB_NUM_STATES) {
 		return InvalidParameter;
 	}
 
-	newCallback = (SB_CallbackFunc*)malloc( sizeof(SB_CallbackFunc));
-	if (NULL == newCallback) {
-		return OutOfMemory;
-	}
+	// A function registered for several transitions keeps the one slot
+	for (i = 0; i < callbackTable.count && callbackTable.functions[i] != function; ++i);
 
-	newCallback->state = state;
-	newCallback->transition = transition;
-	newCallback->function = function;
-	newCallback->next = NULL;
+	if (i == callbackTable.count) {
+		if (SB_FSM_MAX_CALLBACKS == callbackTable.count) {
+			return OutOfMemory;
+		}
 
-	if (NULL == callbackTable.callbacks) {
-		callbackTable.callbacks = newCallback;
-		return NoError;
+		callbackTable.functions[callbackTable.count++] = function;
 	}
 
-	current = callbackTable.callbacks;
+	callbackTable.masks[transition][state] |= 1 << i;
 
-	while (NULL != current->next) {
-		current = current->next;
+	return NoError;
+}
+
+// Copies out the trace, oldest transition first. Returns the number of entries copied.
+uint8_t SB_fsmGetTrace(SB_FsmTraceEntry *entries, uint8_t maxEntries) {
+	uint32_t first = trace.count > SB_FSM_TRACE_SIZE ? trace.count - SB_FSM_TRACE_SIZE : 0;
+	uint8_t n = 0;
+
+	for (; first < trace.count && n < maxEntries; ++first, ++n) {
+		entries[n] = trace.entries[first & (SB_FSM_TRACE_SIZE - 1)];
 	}
 
-	current->next = newCallback;
+	return n;
+}
 
-	return NoError;
+// Total number of transitions since boot
+uint32_t SB_fsmTransitionCount() {
+	return trace.count;
 }
 
-void SB_callCallback(SB_State_Transition transition, SB_State state) {
+static void SB_callCallbacks(SB_State_Transition transition, SB_State state) {
+	uint8_t mask = callbackTable.masks[transition][state];
 	UInt taskKey;
-    SB_CallbackFunc *current = callbackTable.callbacks;
-	if (current == NULL) {
+	uint8_t i;
+
+	if (0 == mask) {
 		return;
 	}
 
 	// disable context switching for other tasks in this section
 	taskKey = Task_disable();
-	do {
-		if (transition == current->transition && state == current->state && NULL != current->function) {
-			current->function(transition, state);
-		}
 
-		current = current->next;
-	} while (current != NULL);
+	for (i = 0; 0 != mask; ++i, mask >>= 1) {
+		if (mask & 1) {
+			callbackTable.functions[i](transition, state);
+		}
+	}
 
 	// restore context switching for other tasks at this point
 	Task_restore(taskKey);
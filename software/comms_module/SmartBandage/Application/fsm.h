@@ -25,6 +25,7 @@ typedef enum {
 	E_DATA_CHANGE,
 	E_NO_BANDAGE_DETECTED,
 	E_ERROR,
+	E_CYCLE_COMPLETE,	// The work of the current state is done, return to sleep
 
 	// This element should be left -- gives self-correcting code for the correct number of states supported
 	SB_NUM_EVENTS
@@ -36,18 +37,26 @@ typedef enum {
 	T_STATE_PRE_ENTER,
 	T_STATE_EXIT,
 	T_STATE_PRE_EXIT,
+
+	SB_NUM_TRANSITIONS
 } SB_State_Transition;
 
 typedef void (*SB_StateTransitionCallbackFunc)(SB_State_Transition, SB_State);
 
-struct SB_CallbackFunc_struct;
-struct SB_CallbackFunc_struct {
-	struct SB_CallbackFunc_struct *next;
-	SB_StateTransitionCallbackFunc function;
-	SB_State_Transition transition : 2;
-	SB_State state : 6;
-};
-typedef struct SB_CallbackFunc_struct SB_CallbackFunc;
+// Most distinct callback functions that can be registered
+#define SB_FSM_MAX_CALLBACKS	8
+
+// Number of transitions kept in the trace, a power of two. Each transition also goes to the
+// binary trace as SB_TRACE_FSM_TRANSITION, which is read out over BLE.
+#define SB_FSM_TRACE_SIZE		16
+
+// A state change recorded in the transition trace
+typedef struct {
+	uint32_t ticks;		// Clock ticks when the new state was entered
+	uint8_t from;		// SB_State left
+	uint8_t to;			// SB_State entered
+	uint8_t event;		// SB_Event that caused it, SB_NUM_EVENTS for a direct switch
+} SB_FsmTraceEntry;
 
 typedef struct {
 	SB_State lastState;
@@ -58,9 +67,11 @@ typedef struct {
 } SB_SystemState;
 
 SB_State SB_switchState(SB_State);
-SB_Event SB_getNewEvent(void);
 SB_State SB_handleEvent(SB_Event);
 SB_State SB_currentState();
+void SB_setError(SB_Error);
 SB_Error SB_registerStateTransitionCallback(SB_StateTransitionCallbackFunc function, SB_State_Transition transition, SB_State state);
+uint8_t SB_fsmGetTrace(SB_FsmTraceEntry *entries, uint8_t maxEntries);
+uint32_t SB_fsmTransitionCount();
 
 #endif
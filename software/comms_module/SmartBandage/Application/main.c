@@ -23,6 +23,7 @@
 #include "Board.h"
 //#include "ble.h"
 #include "flash.h"
+#include "trace.h"
 
 /* Header files required to enable instruction fetch cache */
 #include <inc/hw_memmap.h>
@@ -46,6 +47,16 @@ int main()
 
 	PIN_init(BoardGpioInitTable);
 
+#ifdef SB_TRACE
+	if (NoError != (error = SB_traceInit())) {
+#ifdef SB_DEBUG
+		System_printf("Error No: %d\n", error);
+		System_printf("Trace UART could not be opened. Trace records are left to be read over BLE.\n");
+		System_flush();
+#endif
+	}
+#endif
+
 #ifndef POWER_SAVING
     /* Set constraints for Standby, powerdown and idle mode */
     Power_setConstraint(Power_SB_DISALLOW);
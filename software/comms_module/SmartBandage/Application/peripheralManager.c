@@ -5,6 +5,8 @@
  *      Author: michaelblouin
  */
 
+#include <string.h>
+
 #include <ti/sysbios/BIOS.h>
 #include <ti/sysbios/knl/Task.h>
 #include <xdc/runtime/System.h>
@@ -16,6 +18,9 @@
 #include "ble.h"
 #include "fsm.h"
 #include "clock.h"
+#include "scheduler.h"
+#include "energy.h"
+#include "trace.h"
 #include "bandage.h"
 #include "Devices/mcp9808.h"
 #include "Devices/hdc1050.h"
@@ -31,6 +36,7 @@ SB_Error applyPWRMuxState(MUX_OUTPUT_ENABLE outputEnable, MUX_OUTPUT output);
 SB_Error applyFullMuxState(SB_MUXState *muxState, uint32 timeout);
 SB_Error _applyFullMuxState(SB_MUXState *muxState);
 void     SB_sysdisblClockHandler(UArg arg);
+void     SB_bleLedClockHandler(UArg arg);
 
 void PreEnterSleepCallback(SB_State_Transition transition, SB_State state);
 void ExitSleepCallback(SB_State_Transition transition, SB_State state);
@@ -65,11 +71,72 @@ struct {
 	PIN_State AnalogPins;
 	Semaphore_Handle muxSemaphore;
 	Clock_Struct sysdisblClock;
+	Clock_Struct bleLedClock;
+	volatile bool bleLedToggle;
 
 	Semaphore_Handle stateSem;
 	Semaphore_Handle adcSem;
+
+	// Time spent in the last S_TRANSMIT cycle
+	uint32_t lastTransmitTicks;
+
+	// Counts the times the peripheral rail was switched on. Device configurations written in an
+	// earlier generation were lost with the power.
+	bool peripheralsEnabled;
+	uint16_t powerGeneration;
 } PMGR;
 
+/*
+ * Reads a register of one or two bytes. Two byte registers are big endian on every device here.
+ */
+static SB_Error readRegister(uint8_t address, uint8_t reg, uint8_t len, uint16_t *value) {
+	SB_i2cTransaction transaction;
+	I2C_Transaction baseTransaction;
+	uint8_t txBuf[1];
+	uint8_t rxBuf[2];
+
+	txBuf[0] = reg;
+
+	baseTransaction.writeCount   = 1;
+	baseTransaction.writeBuf     = txBuf;
+	baseTransaction.readCount    = len;
+	baseTransaction.readBuf      = rxBuf;
+	baseTransaction.slaveAddress = address;
+
+	transaction.baseTransaction = &baseTransaction;
+	transaction.completionSemaphore = &PMGR.i2cDeviceSem;
+
+	SB_i2cQueueTransaction(&transaction, BIOS_WAIT_FOREVER);
+	Semaphore_pend(PMGR.i2cDeviceSem, BIOS_WAIT_FOREVER);
+
+	if (NoError != transaction.completionResult) {
+		return transaction.completionResult;
+	}
+
+	*value = 2 == len ? (rxBuf[0] << 8) | rxBuf[1] : rxBuf[0];
+
+	return NoError;
+}
+
+/*
+ * Whether a device still holds the configuration written to it: it was written since the rail was
+ * last powered up, and the configuration register reads back the same.
+ */
+static bool configurationCurrent(SB_PeripheralState *state, uint8_t address, uint8_t reg, uint8_t len, uint16_t configuration, uint16_t mask) {
+	uint16_t value;
+
+	if (0 == state->configGeneration || state->configGeneration != PMGR.powerGeneration) {
+		return false;
+	}
+
+	if (NoError != readRegister(address, reg, len, &value) || (value & mask) != (configuration & mask)) {
+		state->configGeneration = 0;
+		return false;
+	}
+
+	return true;
+}
+
 SB_Error applyTempSensorConfiguration(uint8_t deviceNo) {
 	SB_i2cTransaction configTransaction, resolutionTransaction;
 	I2C_Transaction configBaseTransaction, resolutionBaseTransaction;
@@ -79,9 +146,11 @@ SB_Error applyTempSensorConfiguration(uint8_t deviceNo) {
 		  MCP9808_ALERT_COMPARATOR   << MCP9808_CONFIG_ALERT_MODE
 		| MCP9808_OUTPUT_ACTIVE_HIGH << MCP9808_CONFIG_ALERT_POLARITY
 		| MCP9808_ALERT_ALL_SOURCES  << MCP9808_CONFIG_ALERT_SELECT
+		| MCP9808_SHUTDOWN           << MCP9808_CONFIG_SHDN
 	;
 
-	PMGR.mcp9808Devices[deviceNo].Resolution = MCP9808_RESOLUTION_0P0625;
+	// Shut down until a sample is due. readSensorData wakes it for a single conversion.
+	PMGR.mcp9808Devices[deviceNo].Resolution = SB_GlobalDeviceConfiguration.TemperatureResolution & MCP9808_RESOLUTION_0P0625;
 
 	txBuf[0] = MCP9808_REG_CONFIG;
 	txBuf[1] = 0xFF & (PMGR.mcp9808Devices[deviceNo].Configuration >> 8);
@@ -199,25 +268,33 @@ SB_Error applyIOExpanderConfiguration() {
 /*********************************************************************
  * @fn      initPeripherals
  *
- * @brief   Initializes external peripherals. Called after peripheral power enabled
+ * @brief   Initializes external peripherals. Called after peripheral power enabled. Devices
+ * 			that still hold their configuration, per a read of their configuration register,
+ * 			are left alone unless the rail was switched on since it was written.
  *
  * @return  NoError if properly initialized, otherwise the error that occured
  */
 SB_Error initPeripherals() {
 	int i;
+	uint8_t configured = 0;
 
 #ifdef IOEXPANDER_PRESENT
 	// Initialize IO Expander
 	PMGR.ioexpanderDevice.address = I2C_DBGIOEXP_ADDR;
-	PMGR.ioexpanderDeviceState.lastError = applyIOExpanderConfiguration();
-
-	if (NoError == PMGR.ioexpanderDeviceState.lastError) {
-		PMGR.ioexpanderDeviceState.currentState = PState_OK;
-	} else {
+	if (!configurationCurrent(&PMGR.ioexpanderDeviceState, PMGR.ioexpanderDevice.address,
+			TCA9554A_REG_CONFIG, 1, PMGR.ioexpanderDevice.configuration, 0xFF)) {
+		PMGR.ioexpanderDeviceState.lastError = applyIOExpanderConfiguration();
+		++configured;
+
+		if (NoError == PMGR.ioexpanderDeviceState.lastError) {
+			PMGR.ioexpanderDeviceState.currentState = PState_OK;
+			PMGR.ioexpanderDeviceState.configGeneration = PMGR.powerGeneration;
+		} else {
 # ifdef SB_DEBUG
-		System_printf("IO Expander config failed: %d...\n", PMGR.ioexpanderDeviceState.lastError);
+			System_printf("IO Expander config failed: %d...\n", PMGR.ioexpanderDeviceState.lastError);
 # endif
-		PMGR.ioexpanderDeviceState.currentState = PState_FailedConfig;
+			PMGR.ioexpanderDeviceState.currentState = PState_FailedConfig;
+		}
 	}
 
 #endif
@@ -226,10 +303,17 @@ SB_Error initPeripherals() {
 	for (i = 0; i < SB_NUM_MCP9808_SENSORS; ++i) {
 		if (PMGR.mcp9808DeviceStates[i].currentState != PState_Failed) {
 			PMGR.mcp9808Devices[i].Address = Mcp9808Addresses[i];
+			if (configurationCurrent(&PMGR.mcp9808DeviceStates[i], PMGR.mcp9808Devices[i].Address,
+					MCP9808_REG_CONFIG, 2, PMGR.mcp9808Devices[i].Configuration, MCP9808_CONF_REG_MASK_WRITTEN)) {
+				continue;
+			}
+
 			PMGR.mcp9808DeviceStates[i].lastError = applyTempSensorConfiguration(i);
+			++configured;
 
 			if (NoError == PMGR.mcp9808DeviceStates[i].lastError) {
 				PMGR.mcp9808DeviceStates[i].currentState = PState_OK;
+				PMGR.mcp9808DeviceStates[i].configGeneration = PMGR.powerGeneration;
 			} else {
 				PMGR.mcp9808DeviceStates[i].currentState = PState_Intermittent;
 				if (++PMGR.mcp9808DeviceStates[i].numReadAttempts > PERIPHERAL_MAX_READ_ATTEMPTS) {
@@ -252,35 +336,26 @@ SB_Error initPeripherals() {
 
 	// Initialize Humidity Sensor
 	PMGR.hdc1050Device.address = HDC1050_I2C_ADDRESS;
-	PMGR.hdc1050DeviceState.lastError = applyHumiditySensorConfiguration();
-	if (PMGR.hdc1050DeviceState.lastError == NoError) {
-		PMGR.hdc1050DeviceState.currentState = PState_OK;
-	} else {
+	if (!configurationCurrent(&PMGR.hdc1050DeviceState, PMGR.hdc1050Device.address,
+			HDC1050_REG_CONFIGURATION, 2, PMGR.hdc1050Device.configuration, HDC1050_REG_CONFIGURATION_WRITTEN_MASK)) {
+		PMGR.hdc1050DeviceState.lastError = applyHumiditySensorConfiguration();
+		++configured;
+
+		if (PMGR.hdc1050DeviceState.lastError == NoError) {
+			PMGR.hdc1050DeviceState.currentState = PState_OK;
+			PMGR.hdc1050DeviceState.configGeneration = PMGR.powerGeneration;
+		} else {
 # ifdef SB_DEBUG
-		System_printf("Humidity sensor config failed: %d...\n", PMGR.hdc1050DeviceState.lastError);
-		System_flush();
+			System_printf("Humidity sensor config failed: %d...\n", PMGR.hdc1050DeviceState.lastError);
+			System_flush();
 # endif
-		PMGR.hdc1050DeviceState.currentState = PState_FailedConfig;
-	}
-
-
-	// Start the conversion for the humidity sensor
-	PMGR.hdc1050DeviceState.lastError = hdc1050_startTempHumidityConversion(&PMGR.hdc1050Device, &PMGR.i2cDeviceSem);
-	if (PMGR.hdc1050DeviceState.lastError == NoError) {
-		PMGR.hdc1050Device.readReadyTime = HDC1050_READ_WAIT_TICKS + Clock_getTicks();
-	} else {
-		if (++PMGR.hdc1050DeviceState.numReadAttempts > PERIPHERAL_MAX_READ_ATTEMPTS) {
-			PMGR.hdc1050DeviceState.currentState = PState_Failed;
-#ifdef SB_DEBUG
-		System_printf("PMGR: HDC1050 sensor failed permanently: %d\n", i);
-#endif
-		} else {
-#ifdef SB_DEBUG
-		System_printf("PMGR: HDC1050 read failed.\n");
-#endif
+			PMGR.hdc1050DeviceState.currentState = PState_FailedConfig;
 		}
 	}
 
+	if (configured) {
+		SB_TRACE2(SB_TRACE_PMGR_CONFIGURED, configured, PMGR.powerGeneration);
+	}
 
 	return NoError;
 }
@@ -342,168 +417,186 @@ SB_Error initAlwaysOnPeripherals() {
 	return NoError;
 }
 
+/*
+ * Counts a failed access to a temperature sensor. Its configuration is written again before it
+ * is next used, and it is given up on after PERIPHERAL_MAX_READ_ATTEMPTS.
+ */
+static void temperatureSensorFailed(uint8_t i) {
+	PMGR.mcp9808DeviceStates[i].currentState = PState_Intermittent;
+	PMGR.mcp9808DeviceStates[i].configGeneration = 0;
+	if (++PMGR.mcp9808DeviceStates[i].numReadAttempts > PERIPHERAL_MAX_READ_ATTEMPTS) {
+		PMGR.mcp9808DeviceStates[i].currentState = PState_Failed;
+		SB_TRACE1(SB_TRACE_PMGR_TEMPERATURE_DEAD, i);
+	} else {
+		SB_TRACE2(SB_TRACE_PMGR_TEMPERATURE_FAILED, i, PMGR.mcp9808DeviceStates[i].numReadAttempts);
+	}
+}
+
+/*
+ * Counts a failed access to the humidity sensor, as temperatureSensorFailed
+ */
+static void humiditySensorFailed() {
+	PMGR.hdc1050DeviceState.configGeneration = 0;
+	if (++PMGR.hdc1050DeviceState.numReadAttempts > PERIPHERAL_MAX_READ_ATTEMPTS) {
+		PMGR.hdc1050DeviceState.currentState = PState_Failed;
+		SB_TRACE0(SB_TRACE_PMGR_HUMIDITY_DEAD);
+	} else {
+		SB_TRACE1(SB_TRACE_PMGR_HUMIDITY_FAILED, PMGR.hdc1050DeviceState.numReadAttempts);
+	}
+}
+
+/*
+ * Ticks to wait for a conversion the datasheet says typically takes us. Allows an eighth more.
+ */
+static uint32_t conversionTicks(uint32_t us) {
+	return (us + us / 8) * (NTICKS_PER_MILLSECOND) / 1000 + PERIPHERAL_CONVERSION_MARGIN_TICKS;
+}
+
 /*********************************************************************
  * @fn      readSensorData
  *
  * @brief   Retrieves readings from all external peripherals and moisture lines,
- * 			stores them in a reading, saves to flash, and updates BLE characteristics
+ * 			stores them in a reading, saves to flash, and updates BLE characteristics.
+ * 			The temperature sensors are woken from shutdown and the humidity sensor
+ * 			triggered together, so a single wait covers every conversion; the
+ * 			temperature sensors are shut down again once read.
  */
 SB_Error readSensorData() {
 	SB_PeripheralReadings readings;
-	SB_i2cTransaction taTransaction;
-	I2C_Transaction taBaseTransaction;
-	uint8_t txBuf[1];
-	uint8_t rxBuf[2];
+	uint8_t resolution = SB_GlobalDeviceConfiguration.TemperatureResolution & MCP9808_RESOLUTION_0P0625;
+	uint32_t waitTicks = 0;
+	uint8_t converting = 0;		// Bit i for temperature sensor i, SB_NUM_MCP9808_SENSORS for humidity
 	uint8_t i;
 	SB_Error result;
 
+	memset(&readings, 0, sizeof(readings));
+
 #ifdef BANDAGE_IMPEDANCE_READINGS
 	// Trigger the start of bandage readings
 	if (NoError != (result = SB_beginReadBandageImpedances(BIOS_NO_WAIT, &readings.moistures))) {
-# ifdef SB_DEBUG
-		System_printf("Could not start bandage impedance reading: %d", result);
-		System_flush();
-# endif
+		SB_TRACE1(SB_TRACE_PMGR_IMPEDANCE_FAILED, result);
 	}
 #endif
 
-	// The configuration transaction for the temperature sensors
-	taBaseTransaction.writeCount   = 1;
-	taBaseTransaction.writeBuf     = txBuf;
-	taBaseTransaction.readCount    = 2;
-	taBaseTransaction.readBuf      = rxBuf;
+	// Wake the temperature sensors for a single conversion at the configured resolution
+	for (i = 0; i < SB_NUM_MCP9808_SENSORS; ++i) {
+		// Only talk to good or intermittent sensors
+		if (PMGR.mcp9808DeviceStates[i].currentState != PState_OK && PMGR.mcp9808DeviceStates[i].currentState != PState_Intermittent) {
+			continue;
+		}
 
-	taTransaction.baseTransaction = &taBaseTransaction;
-	taTransaction.completionSemaphore = &PMGR.i2cDeviceSem;
+		result = NoError;
+		if (PMGR.mcp9808Devices[i].Resolution != resolution) {
+			result = mcp9808_setResolution(&PMGR.mcp9808Devices[i], &PMGR.i2cDeviceSem, resolution);
+		}
 
-	// Read temperature sensors
-	{
-		for (i = 0; i < SB_NUM_MCP9808_SENSORS; ++i) {
-			// Only talk to good or intermittent sensors
-			if (PMGR.mcp9808DeviceStates[i].currentState == PState_OK || PMGR.mcp9808DeviceStates[i].currentState == PState_Intermittent) {
-#ifndef LAUNCHPAD
-				if (NoError != tca9554a_setPinStatus(&PMGR.ioexpanderDevice, &PMGR.i2cDeviceSem, IOEXP_I2CSTATUS_PIN_TEMP(i), true)) {
-					System_printf("IOEXP Error");
-					System_flush();
-				}
-#endif
+		if (NoError == result) {
+			result = mcp9808_setShutdown(&PMGR.mcp9808Devices[i], &PMGR.i2cDeviceSem, MCP9808_RUNNING);
+		}
+
+		if (NoError == result) {
+			converting |= 1 << i;
+			waitTicks = conversionTicks(1000UL * mcp9808_conversionTimeMs(resolution));
+		} else {
+			temperatureSensorFailed(i);
+		}
+	}
 
-				txBuf[0] = MCP9808_REG_TA;
-				taBaseTransaction.slaveAddress = PMGR.mcp9808Devices[i].Address;
+	// The humidity sensor converts once per trigger and sleeps afterwards
+	if (PMGR.hdc1050DeviceState.currentState == PState_OK || PMGR.hdc1050DeviceState.currentState == PState_Intermittent) {
+		PMGR.hdc1050DeviceState.lastError = hdc1050_startTempHumidityConversion(&PMGR.hdc1050Device, &PMGR.i2cDeviceSem);
+
+		if (PMGR.hdc1050DeviceState.lastError == NoError) {
+			converting |= 1 << SB_NUM_MCP9808_SENSORS;
+			if (conversionTicks(hdc1050_conversionTimeUs(PMGR.hdc1050Device.configuration)) > waitTicks) {
+				waitTicks = conversionTicks(hdc1050_conversionTimeUs(PMGR.hdc1050Device.configuration));
+			}
+		} else {
+			humiditySensorFailed();
+		}
+	}
 
-				// Queue the configuration and resolution transactions
-				SB_i2cQueueTransaction(&taTransaction, BIOS_WAIT_FOREVER);
+	// Sleep until every conversion is done
+	if (converting) {
+		SB_schedulerSleep(SB_WAKE_SENSOR_READY, waitTicks, waitTicks);
+	}
 
-				// Wait for completion (twice)
-				Semaphore_pend(PMGR.i2cDeviceSem, BIOS_WAIT_FOREVER);
+	// Read temperature sensors
+	for (i = 0; i < SB_NUM_MCP9808_SENSORS; ++i) {
+		if (!(converting & 1 << i)) {
+			continue;
+		}
 
 #ifndef LAUNCHPAD
-				if (NoError != tca9554a_setPinStatus(&PMGR.ioexpanderDevice, &PMGR.i2cDeviceSem, IOEXP_I2CSTATUS_PIN_TEMP(i), false)) {
-					System_printf("IOEXP Error");
-					System_flush();
-				}
+		if (NoError != (result = tca9554a_setPinStatus(&PMGR.ioexpanderDevice, &PMGR.i2cDeviceSem, IOEXP_I2CSTATUS_PIN_TEMP(i), true))) {
+			SB_TRACE2(SB_TRACE_PMGR_IOEXP_FAILED, IOEXP_I2CSTATUS_PIN_TEMP(i), result);
+		}
 #endif
 
-				// Handle success or failure of the I2C operation
-				if (taTransaction.completionResult == NoError) {
-					// The temperature sensor is big endian and this device is little endian
-					// Also need to apply the mask for the data from the sensor: 0x0FFF
-					PMGR.mcp9808Devices[i].Temperature = 0x0FFF & ((rxBuf[0] << 8) | (rxBuf[1]));
-#ifdef SB_DEBUG
-					System_printf("PMGR: Temperature read: %d\n", PMGR.mcp9808Devices[i].Temperature>>4);
-#endif
-					readings.temperatures[i] = PMGR.mcp9808Devices[i].Temperature;
+		PMGR.mcp9808DeviceStates[i].lastError = mcp9808_readTemperature(&PMGR.mcp9808Devices[i], &PMGR.i2cDeviceSem);
 
-					SB_Profile_Set16bParameter( SB_CHARACTERISTIC_TEMPERATURE, PMGR.mcp9808Devices[i].Temperature, i );
-				} else {
-					// The I2C transaction failed. Manage sensor state
-					PMGR.mcp9808DeviceStates[i].currentState = PState_Intermittent;
-					if (++PMGR.mcp9808DeviceStates[i].numReadAttempts > PERIPHERAL_MAX_READ_ATTEMPTS) {
-						PMGR.mcp9808DeviceStates[i].currentState = PState_Failed;
-#ifdef SB_DEBUG
-					System_printf("PMGR: Temperature sensor failed permanently: %d\n", i);
-#endif
-					} else {
-#ifdef SB_DEBUG
-					System_printf("PMGR: Temperature read failed.\n");
+		// Back to shutdown until the next sample, whether or not the read worked. Left running, it is configured again.
+		if (NoError != mcp9808_setShutdown(&PMGR.mcp9808Devices[i], &PMGR.i2cDeviceSem, MCP9808_SHUTDOWN)) {
+			PMGR.mcp9808DeviceStates[i].configGeneration = 0;
+		}
+
+#ifndef LAUNCHPAD
+		if (NoError != (result = tca9554a_setPinStatus(&PMGR.ioexpanderDevice, &PMGR.i2cDeviceSem, IOEXP_I2CSTATUS_PIN_TEMP(i), false))) {
+			SB_TRACE2(SB_TRACE_PMGR_IOEXP_FAILED, IOEXP_I2CSTATUS_PIN_TEMP(i), result);
+		}
 #endif
-					}
-				}
 
+		// Handle success or failure of the I2C operation
+		if (PMGR.mcp9808DeviceStates[i].lastError == NoError) {
+			SB_TRACE2(SB_TRACE_PMGR_TEMPERATURE, i, PMGR.mcp9808Devices[i].Temperature>>4);
+			readings.temperatures[i] = PMGR.mcp9808Devices[i].Temperature;
 
-			}
+			SB_Profile_Set16bParameter( SB_CHARACTERISTIC_TEMPERATURE, PMGR.mcp9808Devices[i].Temperature, i );
+		} else {
+			temperatureSensorFailed(i);
 		}
 	}
 
-	// Humidity Sensor has longest init time
-	{
-		if (PMGR.hdc1050DeviceState.currentState == PState_OK || PMGR.hdc1050DeviceState.currentState == PState_Intermittent) {
-			// Sleep if result not yet ready
-			int currentTime = Clock_getTicks();
-			if (PMGR.hdc1050Device.readReadyTime > currentTime) {
-				Task_sleep(PMGR.hdc1050Device.readReadyTime - currentTime);
-			}
-
+	// Read the humidity sensor
+	if (converting & 1 << SB_NUM_MCP9808_SENSORS) {
 #ifndef LAUNCHPAD
-			if (NoError != tca9554a_setPinStatus(&PMGR.ioexpanderDevice, &PMGR.i2cDeviceSem, IOEXP_I2CSTATUS_PIN_HUMIDITY, true)) {
-				System_printf("IOEXP Error\n");
-				System_flush();
-			}
+		if (NoError != (result = tca9554a_setPinStatus(&PMGR.ioexpanderDevice, &PMGR.i2cDeviceSem, IOEXP_I2CSTATUS_PIN_HUMIDITY, true))) {
+			SB_TRACE2(SB_TRACE_PMGR_IOEXP_FAILED, IOEXP_I2CSTATUS_PIN_HUMIDITY, result);
+		}
 #endif
 
-			// Start the conversion for the humidity sensor
-			PMGR.hdc1050DeviceState.lastError = hdc1050_readTempHumidity(&PMGR.hdc1050Device, &PMGR.i2cDeviceSem);
+		PMGR.hdc1050DeviceState.lastError = hdc1050_readTempHumidity(&PMGR.hdc1050Device, &PMGR.i2cDeviceSem);
 
-			if (PMGR.hdc1050DeviceState.lastError == NoError) {
-#ifdef SB_DEBUG
-				System_printf("PMGR: Humidity read:  %d\n", PMGR.hdc1050Device.humidity/16);
-				System_printf("PMGR: HTemp read:  %d\n", PMGR.hdc1050Device.temperature/16);
-#endif
+		if (PMGR.hdc1050DeviceState.lastError == NoError) {
+			SB_TRACE2(SB_TRACE_PMGR_HUMIDITY, PMGR.hdc1050Device.humidity/16, PMGR.hdc1050Device.temperature/16);
 
-				SB_Profile_Set16bParameter( SB_CHARACTERISTIC_HUMIDITY, PMGR.hdc1050Device.humidity, 0 );
-				SB_Profile_Set16bParameter( SB_CHARACTERISTIC_TEMPERATURE, PMGR.hdc1050Device.temperature, SB_NUM_MCP9808_SENSORS );
-
-				readings.humidities[0] = PMGR.hdc1050Device.humidity;
-				readings.temperatures[SB_NUM_MCP9808_SENSORS] = PMGR.hdc1050Device.temperature;
-			} else {
-				if (++PMGR.hdc1050DeviceState.numReadAttempts > PERIPHERAL_MAX_READ_ATTEMPTS) {
-					PMGR.hdc1050DeviceState.currentState = PState_Failed;
-#ifdef SB_DEBUG
-				System_printf("PMGR: HDC1050 sensor failed permanently: %d\n", i);
-#endif
-				} else {
-#ifdef SB_DEBUG
-				System_printf("PMGR: HDC1050 read failed.\n");
-#endif
-				}
-			}
+			SB_Profile_Set16bParameter( SB_CHARACTERISTIC_HUMIDITY, PMGR.hdc1050Device.humidity, 0 );
+			SB_Profile_Set16bParameter( SB_CHARACTERISTIC_TEMPERATURE, PMGR.hdc1050Device.temperature, SB_NUM_MCP9808_SENSORS );
 
+			readings.humidities[0] = PMGR.hdc1050Device.humidity;
+			readings.temperatures[SB_NUM_MCP9808_SENSORS] = PMGR.hdc1050Device.temperature;
+		} else {
+			humiditySensorFailed();
+		}
 
 #ifndef LAUNCHPAD
-			if (NoError != tca9554a_setPinStatus(&PMGR.ioexpanderDevice, &PMGR.i2cDeviceSem, IOEXP_I2CSTATUS_PIN_HUMIDITY, false)) {
-# ifdef SB_DEBUG
-				System_printf("IOEXP Error\n");
-				System_flush();
-# endif
-			}
-
-#endif
+		if (NoError != (result = tca9554a_setPinStatus(&PMGR.ioexpanderDevice, &PMGR.i2cDeviceSem, IOEXP_I2CSTATUS_PIN_HUMIDITY, false))) {
+			SB_TRACE2(SB_TRACE_PMGR_IOEXP_FAILED, IOEXP_I2CSTATUS_PIN_HUMIDITY, result);
 		}
+#endif
 	}
 
 	// Read gas gauge
-	stc3115_readInfo(PMGR.gasGaugeDevice, &PMGR.i2cDeviceSem);
-#ifdef SB_DEBUG
-	System_printf("PMGR: Battery voltage: %fmV\n", stc3115_convertedVoltage(PMGR.gasGaugeDevice)/16.);
-#endif
+	if (NoError == stc3115_readInfo(PMGR.gasGaugeDevice, &PMGR.i2cDeviceSem)) {
+		SB_energyGaugeSample(stc3115_soc(PMGR.gasGaugeDevice), stc3115_convertedVoltage(PMGR.gasGaugeDevice));
+	}
+	SB_TRACE1(SB_TRACE_PMGR_BATTERY, stc3115_convertedVoltage(PMGR.gasGaugeDevice)/16);
 	SB_Profile_Set16bParameter( SB_CHARACTERISTIC_BATTCHARGE, stc3115_convertedVoltage(PMGR.gasGaugeDevice), 0 );
 
 #ifdef BANDAGE_IMPEDANCE_READINGS
 	// Wait for ADC readings to be available
 	if (NoError != (result = SB_waitForReadingsAvailable())) {
-# ifdef SB_DEBUG
-		System_printf("PMGR: Error waiting for ADC readings to be available: %d\n", result);
-# endif
+		SB_TRACE1(SB_TRACE_PMGR_ADC_WAIT_FAILED, result);
 	}
 
 	// Convert moisture readings to percentages
@@ -515,9 +608,20 @@ SB_Error readSensorData() {
 	// Write the temporary moisture parameter
 	SB_Profile_SetParameter( SB_CHARACTERISTIC_MOISTUREMAP, sizeof(SB_READING_T) * SB_NUM_MOISTURE, readings.moistures );
 
+	// Publish every channel from this cycle as one consistent frame
+	if (NoError != (result = SB_updateLiveSnapshot(&readings, stc3115_soc(PMGR.gasGaugeDevice)))) {
+		SB_TRACE1(SB_TRACE_PMGR_SNAPSHOT_FAILED, result);
+	}
+
 	// Write the data to flash storage
-	readings.timeDiff = SB_clockGetTime() - SB_flashGetReferenceTime();
+	readings.timeDiff = SB_clockGetTimeMs() - 1000ULL * SB_flashGetReferenceTime();
 	result = SB_flashWriteReadings(&readings);
+
+	// Storage is held for centrals that have left; give up on the furthest behind to make room
+	if (OutOfMemory == result && NoError == SB_readingsStorageFull()) {
+		result = SB_flashWriteReadings(&readings);
+	}
+
 	if (NoError != result) {
 		return result;
 	}
@@ -542,6 +646,14 @@ static void SB_peripheralManagerTask(UArg a0, UArg a1) {
 #endif
 
 	SB_clockInit();
+	SB_schedulerInit(NTICKS_PER_MILLSECOND * SB_GlobalDeviceConfiguration.CheckSleepIntervalMS);
+
+	if (NoError != (result = SB_energyInit())) {
+#ifdef SB_DEBUG
+		System_printf("Energy accounting initialization failure: %d.\n", result);
+		System_flush();
+#endif
+	}
 
 	SimpleBLEPeripheral_init();
 
@@ -622,18 +734,20 @@ static void SB_peripheralManagerTask(UArg a0, UArg a1) {
 //	PIN_Handle statusPin = PIN_open(&sbpPins, pinConfigTable);
 #endif
 
-	SB_switchState(S_CHECK);
+	// The first cycle starts after a full period, like every other one
+	SB_handleEvent(E_CYCLE_COMPLETE);
 
 	bool bleLedStatus = false;
+	bool wasConnected;
 	uint8_t nChecks = 0;
-	uint8_t timeouts = 0;
-	uint32_t startTime;
+	uint32_t startTime, deadline, delay;
 	forever {
 		// Wait for a state change to occur
 		Semaphore_pend(PMGR.stateSem, BIOS_WAIT_FOREVER);
-		System_printf("Loop started %d\n", SB_currentState());
-		System_flush();
-		Task_sleep(NTICKS_PER_MILLSECOND * SB_GlobalDeviceConfiguration.CheckSleepIntervalMS);
+		SB_TRACE1(SB_TRACE_PMGR_LOOP, SB_currentState());
+
+		// Send what the last state logged while this one starts
+		SB_traceFlush();
 
 		switch (SB_currentState()) {
 		case S_CHECK:
@@ -645,126 +759,143 @@ static void SB_peripheralManagerTask(UArg a0, UArg a1) {
 			// Initialize them
 			initPeripherals();
 
-			if (SB_GlobalDeviceConfiguration.CheckReadDelayMS > 0) {
-				Task_sleep(NTICKS_PER_MILLSECOND * SB_GlobalDeviceConfiguration.CheckReadDelayMS);
+			// Reading a little late is harmless, so the settle time may end on a wake booked by something else
+			delay = NTICKS_PER_MILLSECOND * SB_GlobalDeviceConfiguration.CheckReadDelayMS;
+			if (delay > 0) {
+				SB_schedulerSleep(SB_WAKE_READ_DELAY, delay, 2 * delay);
 			}
 
 			// Read sensor data
 			result = readSensorData();
 			if (NoError != result) {
-#ifdef SB_DEBUG
-				System_printf("PMGR: Saving readings failed: %d.\n", result);
-#endif
+				SB_TRACE1(SB_TRACE_PMGR_SAVE_FAILED, result);
 			}
 
-#ifdef SB_DEBUG
-			System_flush();
-#endif
-
 #ifdef PERIPHERAL_PWR_MGMT
 			// Disable peripherals
 			SB_setPeripheralsEnable(false);
 #endif
 
 			// Transition out of the check state
-			SB_switchState(S_SLEEP);
+			SB_handleEvent(E_CYCLE_COMPLETE);
 			break; // S_CHECK
 
 		case S_TRANSMIT:
+			startTime = Clock_getTicks();
+
 			result = SB_enableBLE();
 			if (NoError != result) {
-				System_printf("Error enabling BLE for transmission: %d", result);
+				SB_TRACE1(SB_TRACE_PMGR_BLE_ENABLE_FAILED, result);
 			}
 
-			// Turn on the BLE LED
+			// Turn on the BLE LED. The LED clock takes care of blinking it from here on.
 #ifndef LAUNCHPAD
 			bleLedStatus = true;
-			if (NoError != tca9554a_setPinStatus(&PMGR.ioexpanderDevice, &PMGR.i2cDeviceSem, IOEXP_I2CSTATUS_PIN_BLE, bleLedStatus)) {
-				System_printf("IOEXP Error");
-				System_flush();
+			if (NoError != (result = tca9554a_setPinStatus(&PMGR.ioexpanderDevice, &PMGR.i2cDeviceSem, IOEXP_I2CSTATUS_PIN_BLE, bleLedStatus))) {
+				SB_TRACE2(SB_TRACE_PMGR_IOEXP_FAILED, IOEXP_I2CSTATUS_PIN_BLE, result);
 			}
+
+			PMGR.bleLedToggle = false;
+			Util_startClock(&PMGR.bleLedClock);
 #endif
 
 			// Do a single quick reading now
 			result = readSensorData();
 			if (NoError != result) {
-			#ifdef SB_DEBUG
-				System_printf("PMGR: Saving readings failed: %d.\n", result);
-			#endif
+				SB_TRACE1(SB_TRACE_PMGR_SAVE_FAILED, result);
 			}
 
-			// TODO: SB_TRANSMIT_MAX_STATE_TIME should be the min amount of time we spend waiting for a connection.
-			// Once connected, provided that the other device consumes a block of readings at least every SB_TRANSMIT_MIN_CONN_PERIOD
-			// we should stay connected until complete. We can be assured of a return to sleep as memory is finite and we
-			// aren't adding new readings in the transmit state.
-
-			// Spend the next SB_TRANSMIT_MAX_STATE_TIME talking over bluetooth
+			// Advertise for at most MaxTransmitStateTimeS waiting for a connection. Every connection event pushes the
+			// deadline out by SB_TRANSMIT_CONN_EXTEND_PERIOD, so a central that keeps consuming readings stays connected
+			// until the backlog is drained. Memory is finite and we aren't adding readings here, so this terminates.
 			SB_setClearReadingsMode(true);
+			SB_readingsWindowOpened();
 
-			startTime = Clock_getTicks();
-			while ((Clock_getTicks() - startTime) < (NTICKS_PER_SECOND * SB_GlobalDeviceConfiguration.MaxTransmitStateTimeS)) {
-#ifndef LAUNCHPAD
-				bleLedStatus = !bleLedStatus;
-				tca9554a_setPinStatus(&PMGR.ioexpanderDevice, &PMGR.i2cDeviceSem, IOEXP_I2CSTATUS_PIN_BLE, bleLedStatus);
-#endif
+			wasConnected = false;
+			deadline = startTime + NTICKS_PER_SECOND * SB_GlobalDeviceConfiguration.MaxTransmitStateTimeS;
+			forever {
+				uint32_t now = Clock_getTicks();
 
-				// This could end up taking up to SB_TRANSMIT_MIN_CONN_PERIOD more than SB_TRANSMIT_MAX_STATE_TIME. Do we care?
-				ICall_Errno errno = ICall_wait(500);
+				if ((int32_t)(deadline - now) <= 0) {
+					break;
+				}
 
-				if (errno == ICALL_ERRNO_SUCCESS)
-				{
-					SB_processBLEMessages();
-				} else {
-					// Handle the error that a request wasn't received in a SB_TRANSMIT_MIN_CONN_PERIOD
+				// The centrals that came have taken everything and left -- nothing more to do here
+				if (wasConnected && !SB_bleConnected() && SB_readingsBacklogDrained()) {
+					break;
+				}
+
+				ICall_Errno errno = ICall_wait((deadline - now) / (NTICKS_PER_MILLSECOND) + 1);
+
+				if (errno == ICALL_ERRNO_SUCCESS && SB_processBLEMessages() > 0 && SB_bleConnected()) {
+					wasConnected = true;
+
+					now = Clock_getTicks();
+					if ((int32_t)(now + SB_TRANSMIT_CONN_EXTEND_PERIOD - deadline) > 0) {
+						deadline = now + SB_TRANSMIT_CONN_EXTEND_PERIOD;
+					}
+				}
+
+#ifndef LAUNCHPAD
+				if (PMGR.bleLedToggle) {
+					PMGR.bleLedToggle = false;
+					bleLedStatus = !bleLedStatus;
+					tca9554a_setPinStatus(&PMGR.ioexpanderDevice, &PMGR.i2cDeviceSem, IOEXP_I2CSTATUS_PIN_BLE, bleLedStatus);
 				}
+#endif
 			}
 
 			SB_setClearReadingsMode(false);
 
 			result = SB_disableBLE();
 			if (NoError != result) {
-#ifdef SB_DEBUG
-				System_printf("Error disabling BLE for transmission: %d\n", result);
-#endif
+				SB_TRACE1(SB_TRACE_PMGR_BLE_DISABLE_FAILED, result);
 			}
 
-			while (SB_bleConnected()) {
-#ifndef LAUNCHPAD
-				bleLedStatus = !bleLedStatus;
-				tca9554a_setPinStatus(&PMGR.ioexpanderDevice, &PMGR.i2cDeviceSem, IOEXP_I2CSTATUS_PIN_BLE, bleLedStatus);
-#endif
-				// This could end up taking up to SB_TRANSMIT_MIN_CONN_PERIOD more than SB_TRANSMIT_MAX_STATE_TIME. Do we care?
-				ICall_Errno errno = ICall_wait(500);
+			// Wait for the link to actually drop after terminating it
+			deadline = Clock_getTicks() + SB_TRANSMIT_DISCONNECT_TIMEOUT_MS * (NTICKS_PER_MILLSECOND);
+			while (SB_bleConnected() && (int32_t)(deadline - Clock_getTicks()) > 0) {
+				ICall_Errno errno = ICall_wait((deadline - Clock_getTicks()) / (NTICKS_PER_MILLSECOND) + 1);
 
-				if (errno == ICALL_ERRNO_SUCCESS)
-				{
+				if (errno == ICALL_ERRNO_SUCCESS) {
 					SB_processBLEMessages();
-				} else if (++timeouts > 10) {
-					// Handle the error that a request wasn't received in a SB_TRANSMIT_MIN_CONN_PERIOD
-					break;
 				}
 			}
 
-			timeouts = 0;
-
-#ifdef SB_DEBUG
-			System_flush();
-#endif
 #ifndef LAUNCHPAD
+			Util_stopClock(&PMGR.bleLedClock);
 			bleLedStatus = false;
 			tca9554a_setPinStatus(&PMGR.ioexpanderDevice, &PMGR.i2cDeviceSem, IOEXP_I2CSTATUS_PIN_BLE, bleLedStatus);
 #endif
 
+			PMGR.lastTransmitTicks = Clock_getTicks() - startTime;
+			SB_TRACE1(SB_TRACE_PMGR_TRANSMIT_TIME, PMGR.lastTransmitTicks / (NTICKS_PER_MILLSECOND));
+
 			// Transition out of the transmit state
-			SB_switchState(S_SLEEP);
+			SB_handleEvent(E_CYCLE_COMPLETE);
 			break; // S_TRANSMIT
 
 		case S_SLEEP:
+			// Move readings out of internal flash while nothing else needs it
+			result = SB_flashMigrate();
+			if (NoError != result) {
+				SB_TRACE1(SB_TRACE_PMGR_ARCHIVE_FAILED, result);
+			}
+
+			// Sleep until the next cycle. Anything else timed to end around then is woken with it.
+			SB_schedulerWaitCycle(NTICKS_PER_MILLSECOND * SB_GlobalDeviceConfiguration.CheckSleepIntervalMS);
+
 			// Todo this may be best handled in the state manager?
 			if (++nChecks < SB_GlobalDeviceConfiguration.BLECheckInterval) {
-				SB_switchState(S_CHECK);
+				SB_handleEvent(E_CHECK_TIMER_EXPIRED);
 			} else {
-				SB_switchState(S_TRANSMIT);
+#ifdef SB_TRACE
+				SB_WakeStats wakeStats;
+
+				SB_schedulerGetStats(&wakeStats);
+				SB_TRACE3(SB_TRACE_PMGR_WAKE_STATS, wakeStats.wakeups, wakeStats.uptimeS, wakeStats.merged);
+#endif
+				SB_handleEvent(E_BLE_TIMER_EXPIRED);
 				nChecks = 0;
 			}
 			break; // S_SLEEP
@@ -833,7 +964,9 @@ SB_Error SB_peripheralInit() {
 	{
 		Board_BANDAGE_A_0		| PIN_INPUT_DIS | PIN_GPIO_OUTPUT_DIS ,
 		Board_CONN_STATE_RD		| PIN_INPUT_DIS | PIN_GPIO_OUTPUT_DIS ,
+#ifndef SENSORTAG_HW
 		Board_VSENSE_0			| PIN_INPUT_DIS | PIN_GPIO_OUTPUT_DIS ,
+#endif
 		Board_VSENSE_1			| PIN_INPUT_DIS | PIN_GPIO_OUTPUT_DIS ,
 		Board_1V3				| PIN_INPUT_DIS | PIN_GPIO_OUTPUT_DIS ,
 		PIN_TERMINATE
@@ -863,6 +996,22 @@ SB_Error SB_peripheralInit() {
 		return OSResourceInitializationError;
 	}
 
+	// Initialize BLE LED blink clock
+	if (NULL == Util_constructClock(
+			&PMGR.bleLedClock,
+			SB_bleLedClockHandler,
+			SB_TRANSMIT_LED_PERIOD_MS,
+			SB_TRANSMIT_LED_PERIOD_MS,
+			false,
+			NULL)) {
+
+#ifdef SB_DEBUG
+		System_printf("Failed to initialize BLE LED clock...\n");
+		System_flush();
+#endif
+		return OSResourceInitializationError;
+	}
+
 	// Initialize state callback functions
 	if (
 		NoError != (result = SB_registerStateTransitionCallback(PreEnterSleepCallback, 	 T_STATE_PRE_ENTER, S_SLEEP))
@@ -904,13 +1053,18 @@ SB_Error SB_peripheralInit() {
 SB_Error SB_setPeripheralsEnable(bool enable) {
 	PIN_Status result = PIN_setOutputValue(&PMGR.PeripheralPower, Board_PERIPHERAL_PWR, enable == false);
 	if (result == PIN_SUCCESS) {
+		SB_energySetLoad(SB_LOAD_PERIPHERALS, enable);
+
+		// Every device comes up unconfigured. Generation 0 stands for never configured.
+		if (enable && !PMGR.peripheralsEnabled && 0 == ++PMGR.powerGeneration) {
+			++PMGR.powerGeneration;
+		}
+		PMGR.peripheralsEnabled = enable;
+
 		return NoError;
 	}
 
-#ifdef SB_DEBUG
-	System_printf("Received error setting peripheral power: %d\n", result);
-	System_flush();
-#endif
+	SB_TRACE1(SB_TRACE_PMGR_POWER_FAILED, result);
 
 	return UnknownError;
 }
@@ -948,13 +1102,11 @@ SB_Error _applyFullMuxState(SB_MUXState *muxState) {
 				| (muxState->pwrmuxOutputEnable << Board_PWRMUX_ENABLE_N));
 
 	if (result == PIN_SUCCESS) {
+		SB_energySetLoad(SB_LOAD_PWRMUX, MUX_ENABLE == muxState->pwrmuxOutputEnable);
 		return NoError;
 	}
 
-#ifdef SB_DEBUG
-	System_printf("Received error setting IO MUX state: %d\n", result);
-	System_flush();
-#endif
+	SB_TRACE1(SB_TRACE_PMGR_MUX_FAILED, result);
 
 	return UnknownError;
 }
@@ -1035,6 +1187,11 @@ SB_Error SB_sysDisableRefresh(uint32 semaphoreTimeout) {
 		return result;
 	}
 
+	// Hold the output for at least the refresh period. The release can wait for the start of the next
+	// cycle, which wakes the device anyway.
+	Clock_setTimeout(Clock_handle(&PMGR.sysdisblClock), SB_schedulerAlign(SB_WAKE_SYSDSBL,
+			NTICKS_PER_MILLSECOND * SYSDSBL_REFRESH_CLOCK_PERIOD,
+			NTICKS_PER_MILLSECOND * (SYSDSBL_REFRESH_CLOCK_PERIOD + SB_GlobalDeviceConfiguration.CheckSleepIntervalMS)));
 	Util_startClock(&PMGR.sysdisblClock);
 
 	return NoError;
@@ -1044,6 +1201,12 @@ void SB_sysdisblClockHandler(UArg arg) {
 	Semaphore_post(PMGR.muxSemaphore);
 }
 
+void SB_bleLedClockHandler(UArg arg) {
+	// The IO expander is on I2C, so the toggle itself has to happen in the task
+	PMGR.bleLedToggle = true;
+	SB_bleWakeApp();
+}
+
 /*********************************************************************
  * @fn      SB_sysDisableShutdown
  *
@@ -1088,24 +1251,24 @@ SB_Error SB_sysDisableShutdown() {
 }
 
 void PreEnterSleepCallback(SB_State_Transition transition, SB_State state) {
-	System_printf("PreEnterSleepCallback\n");
+	SB_TRACE2(SB_TRACE_PMGR_STATE_CALLBACK, transition, state);
 	Semaphore_post(PMGR.stateSem);
 }
 
 void ExitSleepCallback(SB_State_Transition transition, SB_State state) {
-	System_printf("ExitSleepCallback\n");
+	SB_TRACE2(SB_TRACE_PMGR_STATE_CALLBACK, transition, state);
 }
 
 void PreEnterTransmitCallback(SB_State_Transition transition, SB_State state) {
-	System_printf("PreEnterTransmitCallback\n");
+	SB_TRACE2(SB_TRACE_PMGR_STATE_CALLBACK, transition, state);
 	Semaphore_post(PMGR.stateSem);
 }
 
 void PreExitTransmitCallback(SB_State_Transition transition, SB_State state) {
-	System_printf("PreExitTransmitCallback\n");
+	SB_TRACE2(SB_TRACE_PMGR_STATE_CALLBACK, transition, state);
 }
 
 void PreEnterCheckCallback(SB_State_Transition transition, SB_State state) {
-	System_printf("PreEnterCheckCallback\n");
+	SB_TRACE2(SB_TRACE_PMGR_STATE_CALLBACK, transition, state);
 	Semaphore_post(PMGR.stateSem);
 }
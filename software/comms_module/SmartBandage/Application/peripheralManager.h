@@ -13,7 +13,8 @@
 
 #define PERIPHERAL_MAX_READ_ATTEMPTS 3
 
-#define HDC1050_READ_WAIT_TICKS ((uint16)(HDC1050_CONV_TIME_HRES_14BIT + HDC1050_CONV_TIME_TRES_14BIT)) * NTICKS_PER_MILLSECOND + (1 * NTICKS_PER_MILLSECOND)
+// Added to the conversion times from the datasheets, which are typical
+#define PERIPHERAL_CONVERSION_MARGIN_TICKS (1 * NTICKS_PER_MILLSECOND)
 
 #define IOEXP_I2CSTATUS_PIN_BLE IOPORT4
 #define IOEXP_I2CSTATUS_PIN_TEMP0 IOPORT2
@@ -45,6 +46,7 @@ typedef struct {
 	SB_Error lastError;
 	SB_PeripheralFunctionalState currentState;
 	uint8_t numReadAttempts;
+	uint16_t configGeneration;	// Power generation the configuration was last written in. 0 if it must be written.
 } SB_PeripheralState;
 
 typedef struct {
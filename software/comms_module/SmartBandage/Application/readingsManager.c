@@ -10,17 +10,57 @@
 #include "flash.h"
 #include "readingsManager.h"
 #include "../PROFILES/smartBandageProfile.h"
+#include "linkdb.h"
 #include <xdc/runtime/System.h>
 
 #include "clock.h"
+#include "trace.h"
+
+// Centrals that have left are remembered, and hold their readings, until they come back or
+// their slot is needed for a central that has not been seen before
+#define READINGS_MANAGER_MAX_DEPARTED  2
+
+// The central on the link, and the centrals that have left. The peripheral role takes one link,
+// so centrals take turns and only the connected one has readings in the characteristic.
+#define READINGS_MANAGER_MAX_CONSUMERS (1 + READINGS_MANAGER_MAX_DEPARTED)
+
+/*
+ * A central's view of the readings log, kept across connections. Positions are indices into flash
+ * storage, where 0 is the oldest reading that is still retained. While the central is connected,
+ * readings [acknowledged, next) are in the Readings characteristic.
+ */
+typedef struct {
+	uint8_t          identity[B_ADDR_LEN];	// Identity address of the central
+	uint8_t          address[B_ADDR_LEN];	// Address the central is connected with
+	uint8_t          registered;
+	uint16_t         connHandle;			// INVALID_CONNHANDLE while the central is away
+	uint16_t         lastSeen;				// RM.connections when the central last connected
+	SB_FLASH_COUNT_T acknowledged;
+	SB_FLASH_COUNT_T next;
+} SB_ReadingsConsumer;
 
 // Readings Manager struct
 struct {
-	uint8_t bleReadingsPopulated: 1;
 	uint8_t clearReadingsMode:    1;
-	uint8_t numReadings: 		  6;
+	uint8_t populated:            1;	// The connected central has readings it has not acknowledged
+	uint8_t snapshotSequence;
+	uint16_t connections;
+	uint16_t windowStart;				// RM.connections when the transmit window opened
+	uint8_t *readings;					// Readings characteristic value
+	SB_ReadingsConsumer *connected;
+	SB_ReadingsConsumer consumers[READINGS_MANAGER_MAX_CONSUMERS];
 } RM;
 
+static SB_ReadingsConsumer* findConsumer(uint16_t connHandle);
+static SB_ReadingsConsumer* findCentral(uint16_t connHandle, const uint8_t *address);
+static SB_ReadingsConsumer* findIdentity(const uint8_t *identity);
+static SB_ReadingsConsumer* claimConsumer();
+static void detachConsumer(SB_ReadingsConsumer *consumer);
+static void evictConsumer(SB_ReadingsConsumer *consumer);
+static SB_Error publishCount();
+static SB_Error loadReadings(SB_ReadingsConsumer *consumer);
+static SB_Error reclaimReadings();
+
 /*********************************************************************
  * @fn      SB_readingsManagerInit
  *
@@ -28,8 +68,18 @@ struct {
  */
 SB_Error SB_readingsManagerInit() {
 	SB_PeripheralReadings* basePtr;
-	RM.bleReadingsPopulated = false;
+	uint8_t i;
+
 	RM.clearReadingsMode = false;
+	RM.populated = false;
+	RM.connections = 0;
+	RM.windowStart = 0;
+	RM.connected = NULL;
+
+	for (i = 0; i < READINGS_MANAGER_MAX_CONSUMERS; ++i) {
+		RM.consumers[i].registered = false;
+		RM.consumers[i].connHandle = INVALID_CONNHANDLE;
+	}
 
 	if (SUCCESS != SB_Profile_Set16bParameter( SB_CHARACTERISTIC_READINGSIZE, sizeof(SB_PeripheralReadings), 0 )) {
 		return BLECharacteristicWriteError;
@@ -53,6 +103,7 @@ SB_Error SB_readingsManagerInit() {
 	}
 
 	memset(basePtr, 0, SB_BLE_READINGS_LEN);
+	RM.readings = (uint8_t*)basePtr;
 
 	// Set the offsets for the PTR struct
 	uint8_t dataOffsets[SB_BLE_READINGDATAOFFSETS_LEN] = {
@@ -71,201 +122,521 @@ SB_Error SB_readingsManagerInit() {
 }
 
 /*********************************************************************
- * @fn      SB_sendNotificationIfSubscriptionChanged
+ * @fn      SB_readingsConsumerConnected
  *
- * @brief   Send property changed notification if changed
+ * @brief   Registers the central on the link as the consumer of the readings log, known by its
+ * 			identity address. A central seen before carries on after the last readings it
+ * 			acknowledged; a new one starts at the oldest retained reading. Does nothing if the
+ * 			central is already registered.
  */
-bool SB_sendNotificationIfSubscriptionChanged(bool forceTry) {
-	if (forceTry || SB_Profile_NotificationStateChanged( SB_CHARACTERISTIC_READINGS )) {
-		uint8_t status;
-		if (0 != (status = SB_Profile_MarkParameterUpdated( SB_CHARACTERISTIC_READINGS ))) {
-			System_printf("Failed to mark characteristic updated %d\n", status);
+SB_Error SB_readingsConsumerConnected(uint16_t connHandle, const uint8_t *address, const uint8_t *identity) {
+	SB_ReadingsConsumer *consumer;
 
-			return false;
+	if (INVALID_CONNHANDLE == connHandle || NULL == address || NULL == identity) {
+		return InvalidParameter;
+	}
+
+	if (NULL != RM.connected) {
+		if (RM.connected->connHandle == connHandle && 0 == memcmp(RM.connected->address, address, B_ADDR_LEN)) {
+			return NoError;
 		}
 
-		return true;
+		// The link was up again before the last central's disconnect was handled
+		detachConsumer(RM.connected);
+	}
+
+	if (NULL != (consumer = findIdentity(identity))) {
+		SB_TRACE2(SB_TRACE_RM_CONSUMER_RETURNED, connHandle, SB_flashReadingCount() - consumer->acknowledged);
+	} else if (NULL != (consumer = claimConsumer())) {
+		memcpy(consumer->identity, identity, B_ADDR_LEN);
+		consumer->registered = true;
+		consumer->acknowledged = 0;
+
+		SB_TRACE1(SB_TRACE_RM_CONSUMER_REGISTERED, connHandle);
+	} else {
+		return OutOfMemory;
 	}
 
-	return false;
+	// Readings it was given on its last connection but did not acknowledge are sent again
+	consumer->connHandle = connHandle;
+	memcpy(consumer->address, address, B_ADDR_LEN);
+	consumer->lastSeen = ++RM.connections;
+	consumer->next = consumer->acknowledged;
+	RM.connected = consumer;
+	RM.populated = false;
+
+	return loadReadings(consumer);
 }
 
 /*********************************************************************
- * @fn      SB_newReadingsAvailable
+ * @fn      SB_readingsConsumersDisconnected
  *
- * @brief   Called when new readings are available. May update bluetooth characteristics.
+ * @brief   Detaches the connected consumer if its connection has closed. Its position in the log
+ * 			is kept, and the readings it has not acknowledged stay in storage until it reconnects
+ * 			or is evicted.
  */
-SB_Error SB_newReadingsAvailable() {
-	uint8_t i = 0, j = 0, status;
-	uint32_t *refTimestampPtr;
+SB_Error SB_readingsConsumersDisconnected() {
+	// The link may be up again already, for the next central
+	if (NULL != RM.connected && !linkDB_Up(RM.connected->connHandle)) {
+		detachConsumer(RM.connected);
+	}
+
+	return publishCount();
+}
+
+/*********************************************************************
+ * @fn      SB_readingsStorageFull
+ *
+ * @brief   Makes room in storage by evicting the centrals that have left, furthest behind first,
+ * 			until readings can be removed.
+ *
+ * @return  NoError if readings were removed, otherwise OutOfMemory
+ */
+SB_Error SB_readingsStorageFull() {
+	SB_FLASH_COUNT_T count = SB_flashReadingCount();
+	SB_ReadingsConsumer *furthest;
 	SB_Error result;
-	SB_PeripheralReadings* readingsPtr;
+	uint8_t i;
 
-	// Update the reading count
-	if (SUCCESS != SB_Profile_SetParameter( SB_CHARACTERISTIC_READINGCOUNT, sizeof(uint32_t), SB_flashReadingCountRef())) {
-		return BLECharacteristicWriteError;
+	while (SB_flashReadingCount() == count) {
+		furthest = NULL;
+
+		for (i = 0; i < READINGS_MANAGER_MAX_CONSUMERS; ++i) {
+			if (RM.consumers[i].registered && INVALID_CONNHANDLE == RM.consumers[i].connHandle
+					&& (NULL == furthest || RM.consumers[i].acknowledged < furthest->acknowledged)) {
+				furthest = &RM.consumers[i];
+			}
+		}
+
+		if (NULL == furthest) {
+			return OutOfMemory;
+		}
+
+		evictConsumer(furthest);
+
+		if (NoError != (result = reclaimReadings())) {
+			return result;
+		}
 	}
 
-	// If there are readings currently available don't do anything
-	if (RM.bleReadingsPopulated) {
-		SB_sendNotificationIfSubscriptionChanged(false);
-		return NoError;
+	return NoError;
+}
+
+/*********************************************************************
+ * @fn      SB_readingsSubscriptionChanged
+ *
+ * @brief   Called when a central changes its readings subscription. Sends it the readings it
+ * 			has waiting, if any.
+ */
+SB_Error SB_readingsSubscriptionChanged(uint16_t connHandle, const uint8_t *address) {
+	SB_ReadingsConsumer *consumer;
+	uint8_t status;
+
+	if (NULL == (consumer = findCentral(connHandle, address))) {
+		return ResourceNotInitialized;
 	}
 
-	if (SB_flashReadingCount() < READINGS_MANAGER_THRESHOLD && !RM.clearReadingsMode || SB_flashReadingCount() == 0) {
-		return NoError;
+	if (RM.populated) {
+		if (0 != (status = SB_Profile_MarkParameterUpdated( SB_CHARACTERISTIC_READINGS ))) {
+			SB_TRACE2(SB_TRACE_RM_MARK_UPDATED_FAILED, connHandle, status);
+			return BLECharacteristicWriteError;
+		}
 	}
 
-	refTimestampPtr = (uint32_t*)
-		SB_Profile_GetCharacteristicWritePTR(
-			SB_CHARACTERISTIC_READINGS,
-			SB_BLE_READINGS_LEN,
-			0 );
+	return NoError;
+}
 
-	if (NULL == refTimestampPtr) {
-		return BLECharacteristicWriteError;
+/*********************************************************************
+ * @fn      SB_newReadingsAvailable
+ *
+ * @brief   Called when new readings are available. May update bluetooth characteristics.
+ */
+SB_Error SB_newReadingsAvailable() {
+	if (NULL == RM.connected) {
+		return publishCount();
 	}
 
-	*refTimestampPtr = SB_flashGetReferenceTime();
-	readingsPtr = (SB_PeripheralReadings*)(&refTimestampPtr[1]);
+	return loadReadings(RM.connected);
+}
 
-	RM.numReadings = READINGS_MANAGER_THRESHOLD;
-	if (SB_flashReadingCount() < READINGS_MANAGER_THRESHOLD) {
-		RM.numReadings = SB_flashReadingCount();
-		memset(readingsPtr, 0, SB_BLE_READINGS_LEN - SB_BLE_READINGREFTIMESTAMP_LEN);
+/*********************************************************************
+ * @fn      SB_setClearReadingsMode
+ *
+ * @brief   Allows all readings to be read, even if the last read does not have 3 readings.
+ */
+void SB_setClearReadingsMode(bool clearReadings) {
+	RM.clearReadingsMode = clearReadings & 1;
+}
+
+/*********************************************************************
+ * @fn      SB_updateLiveSnapshot
+ *
+ * @brief   Publishes the readings from the current sensing cycle as a single snapshot and
+ * 			notifies subscribed centrals once.
+ *
+ * @param   soc - The gas gauge's state of charge register, 1/512 %
+ */
+SB_Error SB_updateLiveSnapshot(const SB_PeripheralReadings *readings, uint16_t soc) {
+	SB_PROFILE_SNAPSHOT snapshot;
+	uint8_t i, status;
+
+	if (NULL == readings) {
+		return InvalidParameter;
 	}
 
-	for (i = 0; i < RM.numReadings; ++i) {
-		uint32_t thisRef;
+	memset(&snapshot, 0, sizeof(snapshot));
 
-		// Read from flash
-		if (NoError != (result = SB_flashReadNext(&readingsPtr[i], &thisRef))) {
-			return result;
+	snapshot.timestamp  = SB_clockGetTime();
+	snapshot.sequence   = ++RM.snapshotSequence;
+	snapshot.battCharge = soc / 512;
+
+	for (i = 0; i < SB_NUM_TEMPERATURE && i < sizeof(snapshot.temperatures)/sizeof(snapshot.temperatures[0]); ++i) {
+		snapshot.temperatures[i] = readings->temperatures[i];
+	}
+
+	// Whole percent is enough for a live view; the stored readings keep sixteenths
+	snapshot.humidity = readings->humidities[0] / 16 > UINT8_MAX ? UINT8_MAX : readings->humidities[0] / 16;
+
+	for (i = 0; i < SB_NUM_MOISTURE && i < sizeof(snapshot.moistures)/sizeof(snapshot.moistures[0]); ++i) {
+		snapshot.moistures[i] = readings->moistures[i] / 16 > UINT8_MAX ? UINT8_MAX : readings->moistures[i] / 16;
+	}
+
+	// Write the whole frame at once so that a read never sees a mix of two cycles
+	if (SUCCESS != SB_Profile_SetParameter( SB_CHARACTERISTIC_SNAPSHOT, SB_BLE_SNAPSHOT_LEN, &snapshot )) {
+		return BLECharacteristicWriteError;
+	}
+
+	if (SB_Profile_NotificationsEnabled( SB_CHARACTERISTIC_SNAPSHOT )) {
+		if (0 != (status = SB_Profile_MarkParameterUpdated( SB_CHARACTERISTIC_SNAPSHOT ))) {
+			SB_TRACE1(SB_TRACE_RM_SNAPSHOT_FAILED, status);
 		}
+	}
 
-		if (thisRef == *refTimestampPtr || 0 == i) {
-			// Leave them as is
-		} else if (thisRef < *refTimestampPtr) {
-			uint16_t diff = thisRef - *refTimestampPtr;
-			// Set the refTimestamp to thisRef and adjust the other refs
-			for (j = 0; j <= i; ++j) {
-				if (readingsPtr[j].timeDiff <= diff) {
-					readingsPtr[j].timeDiff = 1;
-				} else {
-					readingsPtr[j].timeDiff -= diff;
-				}
-			}
-		} else {
-			// thisRef > refTimestamp
-			uint16_t diff = *refTimestampPtr - thisRef;
-			for (j = i; j < RM.numReadings; ++j) {
-				readingsPtr[j].timeDiff += diff;
-			}
+	return NoError;
+}
+
+/*********************************************************************
+ * @fn      SB_readingsBacklogDrained
+ *
+ * @brief   Checks if the centrals that connected since the transmit window opened have
+ * 			acknowledged every stored reading. Centrals that left earlier may still have readings
+ * 			held for them; waiting for them would keep the window open to its end.
+ *
+ * @return  True if a central has connected in the window and none of them has readings left
+ */
+bool SB_readingsBacklogDrained() {
+	bool drained = false;
+	uint8_t i;
+
+	for (i = 0; i < READINGS_MANAGER_MAX_CONSUMERS; ++i) {
+		if (!RM.consumers[i].registered || (int16_t)(RM.consumers[i].lastSeen - RM.windowStart) <= 0) {
+			continue;
 		}
 
-		// `0` is an invalid value for a timediff - an error of 1 second is fine.
-		if (readingsPtr[i].timeDiff == 0) {
-			readingsPtr[i].timeDiff = 1;
+		if (RM.consumers[i].acknowledged < SB_flashReadingCount()) {
+			return false;
 		}
 
-		*refTimestampPtr = thisRef;
+		drained = true;
 	}
 
-	// Update the reference time
-	System_printf("Set ref timestamp: %u\n", *refTimestampPtr);
+	return drained;
+}
 
-	// TODO: Send change notification
-	RM.bleReadingsPopulated = true;
-	if (0 != (status = SB_Profile_MarkParameterUpdated( SB_CHARACTERISTIC_READINGS ))) {
-		System_printf("Failed to mark characteristic updated %d\n", status);
+/*********************************************************************
+ * @fn      SB_readingsWindowOpened
+ *
+ * @brief   Marks the start of a transmit window, for SB_readingsBacklogDrained
+ */
+void SB_readingsWindowOpened() {
+	RM.windowStart = RM.connections;
+}
+
+/*********************************************************************
+ * @fn      SB_currentReadingsRead
+ *
+ * @brief   Called when a central has read the readings currently available to it
+ */
+SB_Error SB_currentReadingsRead(uint16_t connHandle, const uint8_t *address) {
+	SB_ReadingsConsumer *consumer;
+	SB_Error result;
+
+	if (NULL == (consumer = findCentral(connHandle, address))) {
+		return ResourceNotInitialized;
+	}
+
+	// A repeated acknowledgement must not skip readings the central has not seen
+	if (RM.populated) {
+		consumer->acknowledged = consumer->next;
+		RM.populated = false;
+
+		if (NoError != (result = reclaimReadings())) {
+			return result;
+		}
+	}
+
+	SB_TRACE2(SB_TRACE_RM_READINGS_READ, consumer->connHandle, SB_flashReadingCount() - consumer->next);
+
+	return loadReadings(consumer);
+}
+
+/*********************************************************************
+ * @fn      SB_updateReadingsRefTimestamp
+ *
+ * @brief   The reference time has been updated. Upudate the value in the characteristic.
+ */
+SB_Error SB_updateReadingsRefTimestamp() {
+	uint32_t *refTimestampPtr = (uint32_t*)RM.readings;
+
+	// Don't do anything if there aren't any readings populated.
+	if (NULL == RM.connected || !RM.populated) {
+		return NoError;
+	}
+
+	// The buffered readings are still in flash, so the flash reference time accounts for them
+	if (0 == *refTimestampPtr || UINT32_MAX == *refTimestampPtr) {
+		*refTimestampPtr = SB_flashGetReferenceTime();
 	}
 
 	return NoError;
 }
 
 /*********************************************************************
- * @fn      SB_setClearReadingsMode
+ * @fn      findConsumer
  *
- * @brief   Allows all readings to be read, even if the last read does not have 3 readings.
+ * @brief   Gets the consumer connected on the link, NULL if there is none.
  */
-void SB_setClearReadingsMode(bool clearReadings) {
-	RM.clearReadingsMode = clearReadings & 1;
+static SB_ReadingsConsumer* findConsumer(uint16_t connHandle) {
+	if (INVALID_CONNHANDLE == connHandle || NULL == RM.connected || RM.connected->connHandle != connHandle) {
+		return NULL;
+	}
+
+	return RM.connected;
 }
 
 /*********************************************************************
- * @fn      SB_currentReadingsRead
+ * @fn      findCentral
  *
- * @brief   Called when the currently available readings have been read
+ * @brief   Gets the consumer connected on the link, if it is the central with the given address.
+ * 			NULL if there is none or another central has the link now.
  */
-SB_Error SB_currentReadingsRead() {
-	SB_PeripheralReadings* basePtr;
+static SB_ReadingsConsumer* findCentral(uint16_t connHandle, const uint8_t *address) {
+	SB_ReadingsConsumer *consumer = findConsumer(connHandle);
+
+	if (NULL != consumer && NULL != address && 0 != memcmp(consumer->address, address, B_ADDR_LEN)) {
+		return NULL;
+	}
 
-	RM.bleReadingsPopulated = false;
+	return consumer;
+}
 
-	System_printf("BLE Readings Read. %d readings remaining.\n", SB_flashReadingCount());
-	System_flush();
+/*********************************************************************
+ * @fn      findIdentity
+ *
+ * @brief   Gets the consumer registered for the central, connected or not. NULL if there is none.
+ */
+static SB_ReadingsConsumer* findIdentity(const uint8_t *identity) {
+	uint8_t i;
 
-	if (SB_flashReadingCount() >= READINGS_MANAGER_THRESHOLD || RM.clearReadingsMode) {
-		// If there are more readings available, place the next once in the characteristic buffer
-		return SB_newReadingsAvailable();
+	for (i = 0; i < READINGS_MANAGER_MAX_CONSUMERS; ++i) {
+		if (RM.consumers[i].registered && 0 == memcmp(RM.consumers[i].identity, identity, B_ADDR_LEN)) {
+			return &RM.consumers[i];
+		}
 	}
 
-	// Update the reading count
-	else if (SUCCESS != SB_Profile_SetParameter( SB_CHARACTERISTIC_READINGCOUNT, sizeof(uint32_t), SB_flashReadingCountRef())) {
-		return BLECharacteristicWriteError;
+	return NULL;
+}
+
+/*********************************************************************
+ * @fn      claimConsumer
+ *
+ * @brief   Gets an unused consumer slot. When every slot is in use, the central that left the
+ * 			longest ago is evicted to make one. NULL if every central is connected.
+ */
+static SB_ReadingsConsumer* claimConsumer() {
+	SB_ReadingsConsumer *oldest = NULL;
+	uint8_t i;
+
+	for (i = 0; i < READINGS_MANAGER_MAX_CONSUMERS; ++i) {
+		if (!RM.consumers[i].registered) {
+			return &RM.consumers[i];
+		}
+
+		if (INVALID_CONNHANDLE == RM.consumers[i].connHandle
+				&& (NULL == oldest || (int16_t)(RM.consumers[i].lastSeen - oldest->lastSeen) < 0)) {
+			oldest = &RM.consumers[i];
+		}
 	}
 
-	// Clear the readings buffer
-	basePtr = (SB_PeripheralReadings*)
-		SB_Profile_GetCharacteristicWritePTR(
-			SB_CHARACTERISTIC_READINGS,
-			SB_BLE_READINGS_LEN,
-			0 );
+	if (NULL != oldest) {
+		evictConsumer(oldest);
+	}
 
-	if (NULL == basePtr) {
-		return BLECharacteristicWriteError;
+	return oldest;
+}
+
+/*********************************************************************
+ * @fn      detachConsumer
+ *
+ * @brief   Marks a central as having left. Its position in the log is kept.
+ */
+static void detachConsumer(SB_ReadingsConsumer *consumer) {
+	SB_TRACE1(SB_TRACE_RM_CONSUMER_DROPPED, consumer->connHandle);
+
+	consumer->connHandle = INVALID_CONNHANDLE;
+	consumer->next = consumer->acknowledged;
+
+	if (RM.connected == consumer) {
+		RM.connected = NULL;
+		RM.populated = false;
+		memset(RM.readings, 0, SB_BLE_READINGS_LEN);
 	}
+}
 
-	// Clear the characteristic
-	memset(basePtr, 0, SB_BLE_READINGS_LEN);
+/*********************************************************************
+ * @fn      evictConsumer
+ *
+ * @brief   Forgets a central that has left. The readings it had not acknowledged are no longer
+ * 			held for it.
+ */
+static void evictConsumer(SB_ReadingsConsumer *consumer) {
+	SB_TRACE1(SB_TRACE_RM_CONSUMER_EVICTED, SB_flashReadingCount() - consumer->acknowledged);
+
+	consumer->registered = false;
+	consumer->connHandle = INVALID_CONNHANDLE;
+}
+
+/*********************************************************************
+ * @fn      publishCount
+ *
+ * @brief   Sets ReadingCount to the readings the connected central has yet to be given, or to
+ * 			every stored reading while no central is connected.
+ */
+static SB_Error publishCount() {
+	uint32_t count = SB_flashReadingCount();
+
+	if (NULL != RM.connected) {
+		count -= RM.connected->next;
+	}
+
+	if (SUCCESS != SB_Profile_SetParameter( SB_CHARACTERISTIC_READINGCOUNT, sizeof(uint32_t), &count )) {
+		return BLECharacteristicWriteError;
+	}
 
 	return NoError;
 }
 
 /*********************************************************************
- * @fn      SB_setClearReadingsMode
+ * @fn      loadReadings
  *
- * @brief   The reference time has been updated. Upudate the value in the characteristic.
+ * @brief   Places the connected consumer's next readings in the characteristic and tells the
+ * 			central, unless it still has readings it hasn't acknowledged.
  */
-SB_Error SB_updateReadingsRefTimestamp() {
-	// Don't do anything if the BLE stack already has data or if there aren't any readings populated.
-	if (!RM.bleReadingsPopulated || 0 == RM.numReadings) {
-		return NoError;
+static SB_Error loadReadings(SB_ReadingsConsumer *consumer) {
+	uint8_t i = 0, j = 0, numReadings, status;
+	uint32_t *refTimestampPtr = (uint32_t*)RM.readings;
+	SB_PeripheralReadings* readingsPtr = (SB_PeripheralReadings*)(&refTimestampPtr[1]);
+	SB_FLASH_COUNT_T available = SB_flashReadingCount() - consumer->next;
+	SB_Error result;
+
+	// If there are readings currently available don't do anything
+	if (RM.populated) {
+		return publishCount();
 	}
 
-	uint32_t *refTimestampPtr;
+	if ((available < READINGS_MANAGER_THRESHOLD && !RM.clearReadingsMode) || available == 0) {
+		// Clear the characteristic
+		memset(RM.readings, 0, SB_BLE_READINGS_LEN);
+		return publishCount();
+	}
 
-	refTimestampPtr = (uint32_t*)
-		SB_Profile_GetCharacteristicWritePTR(
-			SB_CHARACTERISTIC_READINGS,
-			SB_BLE_READINGS_LEN,
-			0 );
+	*refTimestampPtr = SB_flashGetReferenceTime();
 
-	if (NULL == refTimestampPtr) {
-		return BLECharacteristicWriteError;
+	numReadings = READINGS_MANAGER_THRESHOLD;
+	if (available < READINGS_MANAGER_THRESHOLD) {
+		numReadings = available;
+		memset(readingsPtr, 0, SB_BLE_READINGS_LEN - SB_BLE_READINGREFTIMESTAMP_LEN);
 	}
 
-	if (0 == *refTimestampPtr || UINT32_MAX == *refTimestampPtr) {
-		if (0 == SB_flashReadingCount()) {
-			// If there aren't any readings left than the flash reference time does not consider
-			// the timediffs of the readings in the BLE buffer.
-			SB_PeripheralReadings* readingsPtr;
-			readingsPtr = (SB_PeripheralReadings*)(&refTimestampPtr[1]);
-			*refTimestampPtr = SB_clockGetTime() - readingsPtr[RM.numReadings - 1].timeDiff;
-		} else {
-			*refTimestampPtr = SB_flashGetReferenceTime();
+	for (i = 0; i < numReadings; ++i) {
+		uint32_t thisRef;
+
+		// Read from flash
+		if (NoError != (result = SB_flashGetReading(consumer->next + i, &readingsPtr[i], &thisRef))) {
+			return result;
+		}
+
+		// Every reading in the value counts from the earliest reference time among them
+		if (0 == i) {
+			*refTimestampPtr = thisRef;
+		} else if (thisRef > *refTimestampPtr) {
+			readingsPtr[i].timeDiff += 1000 * (thisRef - *refTimestampPtr);
+		} else if (thisRef < *refTimestampPtr) {
+			for (j = 0; j < i; ++j) {
+				readingsPtr[j].timeDiff += 1000 * (*refTimestampPtr - thisRef);
+			}
+
+			*refTimestampPtr = thisRef;
+		}
+
+		// `0` is an invalid value for a timediff - an error of 1 millisecond is fine.
+		if (readingsPtr[i].timeDiff == 0) {
+			readingsPtr[i].timeDiff = 1;
 		}
 	}
 
-	return NoError;
+	// Update the reference time
+	SB_TRACE2(SB_TRACE_RM_REFERENCE_TIME, *refTimestampPtr, consumer->connHandle);
+
+	consumer->next += numReadings;
+	RM.populated = true;
+
+	if (0 != (status = SB_Profile_MarkParameterUpdated( SB_CHARACTERISTIC_READINGS ))) {
+		SB_TRACE2(SB_TRACE_RM_MARK_UPDATED_FAILED, consumer->connHandle, status);
+	}
+
+	return publishCount();
+}
+
+/*********************************************************************
+ * @fn      reclaimReadings
+ *
+ * @brief   Removes the readings that every registered consumer, connected or not, has
+ * 			acknowledged from storage. Nothing is removed while no consumer is registered.
+ */
+static SB_Error reclaimReadings() {
+	SB_FLASH_COUNT_T reclaimable = 0;
+	SB_Error result;
+	bool registered = false;
+	uint8_t i;
+
+	for (i = 0; i < READINGS_MANAGER_MAX_CONSUMERS; ++i) {
+		if (!RM.consumers[i].registered) {
+			continue;
+		}
+
+		if (!registered || RM.consumers[i].acknowledged < reclaimable) {
+			reclaimable = RM.consumers[i].acknowledged;
+		}
+
+		registered = true;
+	}
+
+	if (0 == reclaimable) {
+		return NoError;
+	}
+
+	if (NoError != (result = SB_flashDiscard(reclaimable))) {
+		return result;
+	}
+
+	// Storage indices have shifted down
+	for (i = 0; i < READINGS_MANAGER_MAX_CONSUMERS; ++i) {
+		if (RM.consumers[i].registered) {
+			RM.consumers[i].acknowledged -= reclaimable;
+			RM.consumers[i].next -= reclaimable;
+		}
+	}
+
+	return publishCount();
 }
@@ -36,16 +36,81 @@ SB_Error SB_newReadingsAvailable();
 /*********************************************************************
  * @fn      SB_currentReadingsRead
  *
- * @brief   Called when the currently available readings have been read
+ * @brief   Called when a central has read the readings currently available to it
+ *
+ * @param   address - The address the central connected with, NULL for whichever central is on
+ * 			the link now. An acknowledgement from a central that has since left is ignored.
+ */
+SB_Error SB_currentReadingsRead(uint16_t connHandle, const uint8_t *address);
+
+/*********************************************************************
+ * @fn      SB_readingsConsumerConnected
+ *
+ * @brief   Registers the central on the link as the consumer of the readings log, known by its
+ * 			identity address. A central seen before carries on after the last readings it
+ * 			acknowledged; a new one starts at the oldest retained reading. Does nothing if the
+ * 			central is already registered.
+ *
+ * @param   address - The address the central connected with
+ * @param   identity - The central's identity address, the same as address if it is not bonded
+ */
+SB_Error SB_readingsConsumerConnected(uint16_t connHandle, const uint8_t *address, const uint8_t *identity);
+
+/*********************************************************************
+ * @fn      SB_readingsConsumersDisconnected
+ *
+ * @brief   Detaches the connected consumer if its connection has closed. Its position in the log
+ * 			is kept, and the readings it has not acknowledged stay in storage until it reconnects
+ * 			or is evicted.
+ */
+SB_Error SB_readingsConsumersDisconnected();
+
+/*********************************************************************
+ * @fn      SB_readingsStorageFull
+ *
+ * @brief   Makes room in storage by evicting the centrals that have left, furthest behind first,
+ * 			until readings can be removed.
+ *
+ * @return  NoError if readings were removed, otherwise OutOfMemory
  */
-SB_Error SB_currentReadingsRead();
+SB_Error SB_readingsStorageFull();
 
 /*********************************************************************
- * @fn      SB_sendNotificationIfSubscriptionChanged
+ * @fn      SB_updateLiveSnapshot
+ *
+ * @brief   Publishes the readings from the current sensing cycle as a single snapshot and
+ * 			notifies subscribed centrals once.
  *
- * @brief   Send property changed notification if changed
+ * @param   soc - The gas gauge's state of charge register, 1/512 %
  */
-bool SB_sendNotificationIfSubscriptionChanged(bool forceTry);
+SB_Error SB_updateLiveSnapshot(const SB_PeripheralReadings *readings, uint16_t soc);
+
+/*********************************************************************
+ * @fn      SB_readingsBacklogDrained
+ *
+ * @brief   Checks if the centrals that connected since the transmit window opened have
+ * 			acknowledged every stored reading
+ *
+ * @return  True if a central has connected in the window and none of them has readings left
+ */
+bool SB_readingsBacklogDrained();
+
+/*********************************************************************
+ * @fn      SB_readingsWindowOpened
+ *
+ * @brief   Marks the start of a transmit window, for SB_readingsBacklogDrained
+ */
+void SB_readingsWindowOpened();
+
+/*********************************************************************
+ * @fn      SB_readingsSubscriptionChanged
+ *
+ * @brief   Called when a central changes its readings subscription. Sends it the readings it
+ * 			has waiting, if any.
+ *
+ * @param   address - The address the central connected with, as for SB_currentReadingsRead
+ */
+SB_Error SB_readingsSubscriptionChanged(uint16_t connHandle, const uint8_t *address);
 
 /*********************************************************************
  * @fn      SB_setClearReadingsMode
@@ -55,7 +120,7 @@ bool SB_sendNotificationIfSubscriptionChanged(bool forceTry);
 void SB_setClearReadingsMode(bool clearReadings);
 
 /*********************************************************************
- * @fn      SB_setClearReadingsMode
+ * @fn      SB_updateReadingsRefTimestamp
  *
  * @brief   The reference time has been updated. Upudate the value in the characteristic.
  */
@@ -0,0 +1,223 @@
+/*
+ * scheduler.c
+ *
+ * Keeps the deadlines booked for the peripheral manager until they pass. A deadline counts as
+ * one wakeup however many sources it serves: with the RTC in tickless mode, Task_sleep and
+ * one shot Clock timeouts that end on the same tick are handled by the same compare interrupt.
+ */
+
+#include <string.h>
+
+#include <ti/sysbios/hal/Hwi.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/knl/Task.h>
+
+#include "scheduler.h"
+
+#define SB_SCHEDULER_SATURATE(counter) \
+	do { if ((uint16_t)((counter) + 1) != 0) { (counter)++; } } while (0)
+
+static struct {
+	uint32_t period;
+	uint32_t nextCycle;			// Tick at which the next cycle starts
+	uint32_t lastTicks;
+	uint64_t elapsedTicks;
+
+	// Deadlines booked and not yet reached, with the sources each serves
+	struct {
+		uint32_t ticks;
+		uint8_t sources;
+	} deadlines[SB_NUM_WAKE_SOURCES];
+	uint8_t numDeadlines;
+
+	SB_WakeStats stats;
+} SCHED;
+
+/*
+ * Counts the deadlines that have passed and forgets them
+ */
+static void SB_schedulerRetire(uint32_t now) {
+	UInt key = Hwi_disable();
+	uint8_t i = 0, s, n;
+
+	SCHED.elapsedTicks += now - SCHED.lastTicks;
+	SCHED.lastTicks = now;
+
+	while (i < SCHED.numDeadlines) {
+		if ((int32_t)(SCHED.deadlines[i].ticks - now) > 0) {
+			++i;
+			continue;
+		}
+
+		++SCHED.stats.wakeups;
+		for (s = 0, n = 0; s < SB_NUM_WAKE_SOURCES; ++s) {
+			if (SCHED.deadlines[i].sources & _BV(s)) {
+				SB_SCHEDULER_SATURATE(SCHED.stats.served[s]);
+				++n;
+			}
+		}
+
+		// The first source of the deadline needed the wake anyway
+		SCHED.stats.merged += n - 1;
+
+		SCHED.deadlines[i] = SCHED.deadlines[--SCHED.numDeadlines];
+	}
+
+	Hwi_restore(key);
+}
+
+/*
+ * Adds the source to the deadline, booking it if it is new
+ */
+static void SB_schedulerBook(SB_WakeSource source, uint32_t ticks) {
+	uint8_t i;
+
+	for (i = 0; i < SCHED.numDeadlines && SCHED.deadlines[i].ticks != ticks; ++i);
+
+	if (i == SCHED.numDeadlines) {
+		// Every source waits on one deadline at a time, so the table cannot fill up
+		if (SB_NUM_WAKE_SOURCES == SCHED.numDeadlines) {
+			return;
+		}
+
+		SCHED.deadlines[i].ticks = ticks;
+		SCHED.deadlines[i].sources = 0;
+		++SCHED.numDeadlines;
+	}
+
+	SCHED.deadlines[i].sources |= _BV(source);
+}
+
+/*
+ * Moves the next cycle past now, skipping the cycles that were missed
+ */
+static void SB_schedulerAdvanceCycle(uint32_t now) {
+	while ((int32_t)(SCHED.nextCycle - now) <= 0) {
+		SCHED.nextCycle += SCHED.period;
+	}
+}
+
+/*********************************************************************
+ * @fn      SB_schedulerInit
+ *
+ * @brief   Clears the counters and starts the cycle one period from now
+ */
+void SB_schedulerInit(uint32_t periodTicks) {
+	memset(&SCHED, 0, sizeof(SCHED));
+
+	SCHED.lastTicks = Clock_getTicks();
+	SCHED.period = periodTicks;
+	SCHED.nextCycle = SCHED.lastTicks + periodTicks;
+}
+
+/*********************************************************************
+ * @fn      SB_schedulerAlign
+ *
+ * @brief   Books a wake for the source between minTicks and maxTicks from now. The earliest
+ * 			deadline already booked or of the cycle within the window is reused, otherwise a
+ * 			new one is booked minTicks from now.
+ *
+ * @return  The timeout in ticks to pass to Task_sleep or to a one shot Clock
+ */
+uint32_t SB_schedulerAlign(SB_WakeSource source, uint32_t minTicks, uint32_t maxTicks) {
+	uint32_t now = Clock_getTicks();
+	uint32_t best = minTicks, offset;
+	bool found = false;
+	uint8_t i;
+
+	SB_schedulerRetire(now);
+
+	if (maxTicks < minTicks) {
+		maxTicks = minTicks;
+	}
+
+	for (i = 0; i < SCHED.numDeadlines; ++i) {
+		offset = SCHED.deadlines[i].ticks - now;
+
+		if (offset >= minTicks && offset <= maxTicks && (!found || offset < best)) {
+			best = offset;
+			found = true;
+		}
+	}
+
+	if (0 != SCHED.period) {
+		SB_schedulerAdvanceCycle(now);
+
+		offset = SCHED.nextCycle - now;
+		if (offset < minTicks) {
+			offset += ((minTicks - offset + SCHED.period - 1) / SCHED.period) * SCHED.period;
+		}
+
+		if (offset <= maxTicks && (!found || offset < best)) {
+			best = offset;
+			found = true;
+		}
+	}
+
+	// With nothing to share, the wake is as early as allowed
+	if (0 != best) {
+		SB_schedulerBook(source, now + best);
+	}
+
+	return best;
+}
+
+/*********************************************************************
+ * @fn      SB_schedulerSleep
+ *
+ * @brief   Sleeps the calling task until the deadline SB_schedulerAlign books
+ */
+void SB_schedulerSleep(SB_WakeSource source, uint32_t minTicks, uint32_t maxTicks) {
+	uint32_t ticks = SB_schedulerAlign(source, minTicks, maxTicks);
+
+	if (0 != ticks) {
+		Task_sleep(ticks);
+		SB_schedulerRetire(Clock_getTicks());
+	}
+}
+
+/*********************************************************************
+ * @fn      SB_schedulerWaitCycle
+ *
+ * @brief   Sleeps the calling task until the start of the next sensing cycle. Cycles start a
+ * 			whole number of periods after the first, however long each one took. A new period
+ * 			restarts the cycle one period from now.
+ */
+void SB_schedulerWaitCycle(uint32_t periodTicks) {
+	uint32_t now = Clock_getTicks();
+
+	if (0 == periodTicks) {
+		return;
+	}
+
+	if (periodTicks != SCHED.period) {
+		SCHED.period = periodTicks;
+		SCHED.nextCycle = now + periodTicks;
+	} else {
+		SB_schedulerAdvanceCycle(now);
+	}
+
+	SB_schedulerSleep(SB_WAKE_CYCLE, SCHED.nextCycle - now, SCHED.nextCycle - now);
+}
+
+/*********************************************************************
+ * @fn      SB_schedulerGetStats
+ *
+ * @brief   Takes a snapshot of the wakeup counters
+ */
+void SB_schedulerGetStats(SB_WakeStats *stats) {
+	uint64_t elapsedTicks;
+	uint32_t perHour;
+	UInt key;
+
+	key = Hwi_disable();
+	*stats = SCHED.stats;
+	elapsedTicks = SCHED.elapsedTicks + (Clock_getTicks() - SCHED.lastTicks);
+	stats->periodMS = SCHED.period / (NTICKS_PER_MILLSECOND);
+	Hwi_restore(key);
+
+	stats->uptimeS = elapsedTicks / NTICKS_PER_SECOND;
+
+	perHour = stats->uptimeS ? (uint64_t)stats->wakeups * 3600 / stats->uptimeS : 0;
+	stats->wakeupsPerHour = perHour > 0xFFFF ? 0xFFFF : perHour;
+}
@@ -0,0 +1,78 @@
+/*
+ * scheduler.h
+ *
+ * Wake scheduler for the peripheral manager. Every timed wait of the sensing loop, and the
+ * clocks it starts, takes its deadline from here. Deadlines are aligned to the sensing cycle
+ * and to each other whenever the caller allows some slack, so that the RTC compare that ends
+ * a standby period serves as many of them as possible.
+ *
+ * Deadlines are only booked by the peripheral manager task. The counters can be read from any
+ * task.
+ */
+
+#ifndef APPLICATION_SCHEDULER_H_
+#define APPLICATION_SCHEDULER_H_
+
+#include "Board.h"
+
+typedef enum {
+	SB_WAKE_CYCLE,			// Start of a sensing cycle
+	SB_WAKE_READ_DELAY,		// Peripherals settled after initialization
+	SB_WAKE_SENSOR_READY,	// Temperature and humidity conversions complete
+	SB_WAKE_SYSDSBL,		// End of the sys disable refresh hold
+
+	SB_NUM_WAKE_SOURCES
+} SB_WakeSource;
+
+// Wakeup counters. Laid out so that no padding is required.
+typedef struct {
+	uint32_t uptimeS;							// Time covered by the counters
+	uint32_t wakeups;							// Distinct deadlines reached, i.e. times the CPU was woken
+	uint32_t merged;							// Deadlines that shared their wake with another source
+	uint16_t wakeupsPerHour;					// wakeups over uptimeS, scaled to an hour
+	uint16_t periodMS;							// Current sensing cycle period
+	uint16_t served[SB_NUM_WAKE_SOURCES];		// Deadlines reached, per source. Saturates.
+} SB_WakeStats;
+
+/*********************************************************************
+ * @fn      SB_schedulerInit
+ *
+ * @brief   Clears the counters and starts the cycle one period from now
+ */
+void SB_schedulerInit(uint32_t periodTicks);
+
+/*********************************************************************
+ * @fn      SB_schedulerAlign
+ *
+ * @brief   Books a wake for the source between minTicks and maxTicks from now. The earliest
+ * 			deadline already booked or of the cycle within the window is reused, otherwise a
+ * 			new one is booked minTicks from now.
+ *
+ * @return  The timeout in ticks to pass to Task_sleep or to a one shot Clock
+ */
+uint32_t SB_schedulerAlign(SB_WakeSource source, uint32_t minTicks, uint32_t maxTicks);
+
+/*********************************************************************
+ * @fn      SB_schedulerSleep
+ *
+ * @brief   Sleeps the calling task until the deadline SB_schedulerAlign books
+ */
+void SB_schedulerSleep(SB_WakeSource source, uint32_t minTicks, uint32_t maxTicks);
+
+/*********************************************************************
+ * @fn      SB_schedulerWaitCycle
+ *
+ * @brief   Sleeps the calling task until the start of the next sensing cycle. Cycles start a
+ * 			whole number of periods after the first, however long each one took. A new period
+ * 			restarts the cycle one period from now.
+ */
+void SB_schedulerWaitCycle(uint32_t periodTicks);
+
+/*********************************************************************
+ * @fn      SB_schedulerGetStats
+ *
+ * @brief   Takes a snapshot of the wakeup counters
+ */
+void SB_schedulerGetStats(SB_WakeStats *stats);
+
+#endif /* APPLICATION_SCHEDULER_H_ */
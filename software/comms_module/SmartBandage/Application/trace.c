@@ -0,0 +1,270 @@
+/*
+ * trace.c
+ *
+ * The ring is a power of two words with free running head and tail indexes. Writers take the
+ * head with Hwis disabled; there is a single reader, which only moves the tail, either the BLE
+ * characteristic or the UART. The characteristic reads records in place and only moves the tail
+ * once the central acknowledges them.
+ *
+ * The UART sends straight out of the ring: each write covers the records from the tail to the
+ * head or to the end of the buffer, and the tail is only moved past them once the callback says
+ * they are sent, so writers cannot overwrite them in the meantime.
+ */
+
+#include <ti/sysbios/hal/Hwi.h>
+#include <ti/sysbios/knl/Clock.h>
+
+#ifdef SB_TRACE_UART
+#include <ti/drivers/UART.h>
+#endif
+
+#include "Board.h"
+#include "trace.h"
+
+#define SB_TRACE_MASK		(SB_TRACE_BUFFER_WORDS - 1)
+
+#if SB_TRACE_BUFFER_WORDS & SB_TRACE_MASK || SB_TRACE_BUFFER_WORDS > 0x8000
+#error "SB_TRACE_BUFFER_WORDS must be a power of two no larger than 0x8000"
+#endif
+
+static struct {
+	uint32_t ring[SB_TRACE_BUFFER_WORDS];
+	volatile uint16_t head;			// Next word written
+	volatile uint16_t tail;			// Oldest word not yet read
+	uint16_t dropped;				// Records dropped since the last SB_TRACE_DROPPED. Saturates.
+
+#ifdef SB_TRACE_UART
+	UART_Handle uart;
+	uint16_t sending;				// Words of the UART write in progress
+#endif
+} TRACE;
+
+static inline void SB_tracePut(uint32_t word) {
+	TRACE.ring[TRACE.head++ & SB_TRACE_MASK] = word;
+}
+
+static inline void SB_tracePutHeader(SB_TraceEvent event, uint8_t nargs) {
+	SB_tracePut((uint32_t)SB_TRACE_SYNC << 16 | (uint32_t)nargs << 8 | event);
+	SB_tracePut(Clock_getTicks());
+}
+
+#ifdef SB_TRACE_UART
+/*
+ * Sends the records from the tail to the head, or to the end of the buffer. Call with Hwis
+ * disabled.
+ */
+static void SB_traceSend() {
+	uint16_t start = TRACE.tail & SB_TRACE_MASK;
+	uint16_t words = (uint16_t)(TRACE.head - TRACE.tail);
+
+	if (TRACE.sending || 0 == words) {
+		return;
+	}
+
+	if (words > SB_TRACE_BUFFER_WORDS - start) {
+		words = SB_TRACE_BUFFER_WORDS - start;
+	}
+
+	TRACE.sending = words;
+	UART_write(TRACE.uart, &TRACE.ring[start], words * sizeof(uint32_t));
+}
+
+static void SB_traceSent(UART_Handle handle, void *buf, size_t count) {
+	UInt key = Hwi_disable();
+
+	TRACE.tail += TRACE.sending;
+	TRACE.sending = 0;
+	SB_traceSend();
+
+	Hwi_restore(key);
+}
+#endif
+
+/*********************************************************************
+ * @fn      SB_traceInit
+ *
+ * @brief   Empties the ring. With SB_TRACE_UART, also opens the UART the ring is sent out of.
+ *
+ * @return  NoError if initialized, otherwise the reason the UART could not be opened
+ */
+SB_Error SB_traceInit() {
+#ifdef SB_TRACE_UART
+	UART_Params params;
+#endif
+	UInt key = Hwi_disable();
+
+	TRACE.tail = TRACE.head;
+	TRACE.dropped = 0;
+
+	Hwi_restore(key);
+
+#ifdef SB_TRACE_UART
+	if (NULL != TRACE.uart) {
+		return NoError;
+	}
+
+	UART_init();
+	UART_Params_init(&params);
+	params.writeMode = UART_MODE_CALLBACK;
+	params.writeCallback = SB_traceSent;
+	params.writeDataMode = UART_DATA_BINARY;
+	params.baudRate = SB_TRACE_UART_BAUD;
+
+	if (NULL == (TRACE.uart = UART_open(Board_UART, &params))) {
+		return OSResourceInitializationError;
+	}
+#endif
+
+	return NoError;
+}
+
+/*********************************************************************
+ * @fn      SB_traceWrite
+ *
+ * @brief   Writes a record to the ring. Use the SB_TRACEn macros instead, which compile to
+ * 			nothing when SB_TRACE is not defined. Can be called from any context.
+ */
+void SB_traceWrite(SB_TraceEvent event, uint8_t nargs, uint32_t a0, uint32_t a1, uint32_t a2) {
+	UInt key = Hwi_disable();
+	uint16_t space = SB_TRACE_BUFFER_WORDS - (uint16_t)(TRACE.head - TRACE.tail);
+
+	// The count of dropped records goes in before anything else does
+	if (TRACE.dropped) {
+		if (space < SB_TRACE_RECORD_WORDS(1) + SB_TRACE_RECORD_WORDS(nargs)) {
+			if ((uint16_t)(TRACE.dropped + 1) != 0) {
+				TRACE.dropped++;
+			}
+
+			Hwi_restore(key);
+			return;
+		}
+
+		SB_tracePutHeader(SB_TRACE_DROPPED, 1);
+		SB_tracePut(TRACE.dropped);
+		TRACE.dropped = 0;
+	} else if (space < SB_TRACE_RECORD_WORDS(nargs)) {
+		TRACE.dropped = 1;
+
+		Hwi_restore(key);
+		return;
+	}
+
+	SB_tracePutHeader(event, nargs);
+
+	switch (nargs) {
+	case 3: SB_tracePut(a0); SB_tracePut(a1); SB_tracePut(a2); break;
+	case 2: SB_tracePut(a0); SB_tracePut(a1); break;
+	case 1: SB_tracePut(a0); break;
+	}
+
+	Hwi_restore(key);
+}
+
+/*********************************************************************
+ * @fn      SB_tracePeek
+ *
+ * @brief   Copies bytes [offset, offset + maxLen) of the oldest whole records that fit in limit
+ * 			bytes, leaving them in the ring. Writers only add records after them, so successive
+ * 			calls see the same bytes until they are discarded. Always returns 0 once the UART is
+ * 			open, as the ring then belongs to it.
+ *
+ * @return  The number of bytes copied
+ */
+uint16_t SB_tracePeek(uint8_t *buf, uint16_t offset, uint16_t maxLen, uint16_t limit) {
+	uint16_t tail = TRACE.tail, head = TRACE.head, len = 0, n, bytes;
+
+#ifdef SB_TRACE_UART
+	if (NULL != TRACE.uart) {
+		return 0;
+	}
+#endif
+
+	for (; tail != head; tail += bytes / sizeof(uint32_t)) {
+		bytes = sizeof(uint32_t) * SB_TRACE_RECORD_WORDS((TRACE.ring[tail & SB_TRACE_MASK] >> 8) & 0xFF);
+
+		if (len + bytes > limit) {
+			break;
+		}
+
+		len += bytes;
+	}
+
+	// Records are little endian, whatever the host
+	for (n = 0; offset < len && n < maxLen; ++n, ++offset) {
+		buf[n] = (uint8_t)(TRACE.ring[(TRACE.tail + offset / sizeof(uint32_t)) & SB_TRACE_MASK] >> (8 * (offset % sizeof(uint32_t))));
+	}
+
+	return n;
+}
+
+/*********************************************************************
+ * @fn      SB_traceDiscard
+ *
+ * @brief   Removes the oldest len bytes of records from the ring, once they have been read.
+ *
+ * @return  NoError if removed, InvalidParameter if len does not end on a record boundary, or
+ * 			ResourceBusy once the UART is open
+ */
+SB_Error SB_traceDiscard(uint16_t len) {
+	uint16_t tail = TRACE.tail, head = TRACE.head, bytes;
+
+#ifdef SB_TRACE_UART
+	if (NULL != TRACE.uart) {
+		return ResourceBusy;
+	}
+#endif
+
+	for (; len > 0 && tail != head; tail += bytes / sizeof(uint32_t), len -= bytes) {
+		bytes = sizeof(uint32_t) * SB_TRACE_RECORD_WORDS((TRACE.ring[tail & SB_TRACE_MASK] >> 8) & 0xFF);
+
+		if (len < bytes) {
+			return InvalidParameter;
+		}
+	}
+
+	if (len > 0) {
+		return InvalidParameter;
+	}
+
+	// Writers only look at the tail, so the records are free once it has moved
+	TRACE.tail = tail;
+
+	return NoError;
+}
+
+/*********************************************************************
+ * @fn      SB_traceRead
+ *
+ * @brief   Moves the oldest whole records that fit out of the ring. Always returns 0 once
+ * 			the UART is open, as the ring then belongs to it.
+ *
+ * @return  The number of bytes copied, a multiple of 4
+ */
+uint16_t SB_traceRead(uint8_t *buf, uint16_t maxLen) {
+	uint16_t len = SB_tracePeek(buf, 0, maxLen, maxLen);
+
+	SB_traceDiscard(len);
+
+	return len;
+}
+
+/*********************************************************************
+ * @fn      SB_traceFlush
+ *
+ * @brief   With SB_TRACE_UART, starts sending the ring if the UART is idle. Returns at once;
+ * 			the UART keeps going from its callback until the ring is empty. Does nothing
+ * 			otherwise.
+ */
+void SB_traceFlush() {
+#ifdef SB_TRACE_UART
+	UInt key;
+
+	if (NULL == TRACE.uart) {
+		return;
+	}
+
+	key = Hwi_disable();
+	SB_traceSend();
+	Hwi_restore(key);
+#endif
+}
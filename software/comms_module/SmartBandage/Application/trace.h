@@ -0,0 +1,106 @@
+/*
+ * trace.h
+ *
+ * Binary trace log. An event is written to a RAM ring as its number, the clock ticks and up to
+ * three integer arguments; the message it stands for is only kept in traceEvents.h, and the ring
+ * is read out later, over BLE or the UART, and turned back into text by host/traceDecode. Writing
+ * an event costs a few stores with Hwis disabled, so events can be left in the loop, in Swis and
+ * in Hwis, which System_printf and System_flush cannot.
+ *
+ * A record is SB_TRACE_RECORD_WORDS(nargs) 32 bit words, little endian:
+ *   word 0 - SB_TRACE_SYNC << 16 | nargs << 8 | event
+ *   word 1 - Clock_getTicks() when written
+ *   then nargs arguments
+ *
+ * Records that do not fit in the ring are dropped and counted, and a SB_TRACE_DROPPED record with
+ * the count is written as soon as there is room again.
+ */
+
+#ifndef APPLICATION_TRACE_H_
+#define APPLICATION_TRACE_H_
+
+#include "Board.h"
+
+#define SB_TRACE_SYNC					0x5B7E
+#define SB_TRACE_MAX_ARGS				3
+#define SB_TRACE_RECORD_WORDS(nargs)	(2 + (nargs))
+
+#define SB_TRACE_EVENT(id, format) id,
+typedef enum {
+#include "traceEvents.h"
+
+	SB_NUM_TRACE_EVENTS
+} SB_TraceEvent;
+#undef SB_TRACE_EVENT
+
+#ifdef SB_TRACE
+#define SB_TRACE0(event)				SB_traceWrite(event, 0, 0, 0, 0)
+#define SB_TRACE1(event, a0)			SB_traceWrite(event, 1, (uint32_t)(a0), 0, 0)
+#define SB_TRACE2(event, a0, a1)		SB_traceWrite(event, 2, (uint32_t)(a0), (uint32_t)(a1), 0)
+#define SB_TRACE3(event, a0, a1, a2)	SB_traceWrite(event, 3, (uint32_t)(a0), (uint32_t)(a1), (uint32_t)(a2))
+#else
+#define SB_TRACE0(event)
+#define SB_TRACE1(event, a0)
+#define SB_TRACE2(event, a0, a1)
+#define SB_TRACE3(event, a0, a1, a2)
+#endif
+
+/*********************************************************************
+ * @fn      SB_traceInit
+ *
+ * @brief   Empties the ring. With SB_TRACE_UART, also opens the UART the ring is sent out of.
+ *
+ * @return  NoError if initialized, otherwise the reason the UART could not be opened
+ */
+SB_Error SB_traceInit();
+
+/*********************************************************************
+ * @fn      SB_traceWrite
+ *
+ * @brief   Writes a record to the ring. Use the SB_TRACEn macros instead, which compile to
+ * 			nothing when SB_TRACE is not defined. Can be called from any context.
+ */
+void SB_traceWrite(SB_TraceEvent event, uint8_t nargs, uint32_t a0, uint32_t a1, uint32_t a2);
+
+/*********************************************************************
+ * @fn      SB_tracePeek
+ *
+ * @brief   Copies bytes [offset, offset + maxLen) of the oldest whole records that fit in limit
+ * 			bytes, leaving them in the ring. Writers only add records after them, so successive
+ * 			calls see the same bytes until they are discarded. Always returns 0 once the UART is
+ * 			open, as the ring then belongs to it.
+ *
+ * @return  The number of bytes copied
+ */
+uint16_t SB_tracePeek(uint8_t *buf, uint16_t offset, uint16_t maxLen, uint16_t limit);
+
+/*********************************************************************
+ * @fn      SB_traceDiscard
+ *
+ * @brief   Removes the oldest len bytes of records from the ring, once they have been read.
+ *
+ * @return  NoError if removed, InvalidParameter if len does not end on a record boundary, or
+ * 			ResourceBusy once the UART is open
+ */
+SB_Error SB_traceDiscard(uint16_t len);
+
+/*********************************************************************
+ * @fn      SB_traceRead
+ *
+ * @brief   Moves the oldest whole records that fit out of the ring. Always returns 0 once
+ * 			the UART is open, as the ring then belongs to it.
+ *
+ * @return  The number of bytes copied, a multiple of 4
+ */
+uint16_t SB_traceRead(uint8_t *buf, uint16_t maxLen);
+
+/*********************************************************************
+ * @fn      SB_traceFlush
+ *
+ * @brief   With SB_TRACE_UART, starts sending the ring if the UART is idle. Returns at once;
+ * 			the UART keeps going from its callback until the ring is empty. Does nothing
+ * 			otherwise.
+ */
+void SB_traceFlush();
+
+#endif /* APPLICATION_TRACE_H_ */
@@ -0,0 +1,78 @@
+/*
+ * traceEvents.h
+ *
+ * Every trace event with its message. Included by trace.h to number the events; the firmware
+ * never holds the messages, they are for the decoder (host/traceDecode) only. Messages take up
+ * to three integer arguments, with %d, %u or %x.
+ *
+ * Numbers are given in order, so add events at the end of the list and never reuse one, or
+ * traces taken by older firmware will decode wrongly. The headings only group the events that
+ * were first listed together; later events go at the end whatever their subsystem, which their
+ * prefix names.
+ */
+
+SB_TRACE_EVENT(SB_TRACE_DROPPED,                    "Trace: %u records dropped, ring full")
+
+// Peripheral manager
+SB_TRACE_EVENT(SB_TRACE_PMGR_LOOP,                  "PMGR: loop started in state %u")
+SB_TRACE_EVENT(SB_TRACE_PMGR_STATE_CALLBACK,        "PMGR: state callback, transition %u state %u")
+SB_TRACE_EVENT(SB_TRACE_PMGR_IMPEDANCE_FAILED,      "PMGR: could not start bandage impedance reading: %d")
+SB_TRACE_EVENT(SB_TRACE_PMGR_IOEXP_FAILED,          "PMGR: IO expander error on pin %u: %d")
+SB_TRACE_EVENT(SB_TRACE_PMGR_TEMPERATURE,           "PMGR: temperature sensor %u read: %d C")
+SB_TRACE_EVENT(SB_TRACE_PMGR_TEMPERATURE_FAILED,    "PMGR: temperature sensor %u read failed, attempt %u")
+SB_TRACE_EVENT(SB_TRACE_PMGR_TEMPERATURE_DEAD,      "PMGR: temperature sensor %u failed permanently")
+SB_TRACE_EVENT(SB_TRACE_PMGR_HUMIDITY,              "PMGR: humidity read: %d %%, temperature %d C")
+SB_TRACE_EVENT(SB_TRACE_PMGR_HUMIDITY_FAILED,       "PMGR: HDC1050 read failed, attempt %u")
+SB_TRACE_EVENT(SB_TRACE_PMGR_HUMIDITY_DEAD,         "PMGR: HDC1050 sensor failed permanently")
+SB_TRACE_EVENT(SB_TRACE_PMGR_BATTERY,               "PMGR: battery voltage: %u mV")
+SB_TRACE_EVENT(SB_TRACE_PMGR_ADC_WAIT_FAILED,       "PMGR: error waiting for ADC readings to be available: %d")
+SB_TRACE_EVENT(SB_TRACE_PMGR_SNAPSHOT_FAILED,       "PMGR: updating live snapshot failed: %d")
+SB_TRACE_EVENT(SB_TRACE_PMGR_SAVE_FAILED,           "PMGR: saving readings failed: %d")
+SB_TRACE_EVENT(SB_TRACE_PMGR_BLE_ENABLE_FAILED,     "PMGR: error enabling BLE for transmission: %d")
+SB_TRACE_EVENT(SB_TRACE_PMGR_BLE_DISABLE_FAILED,    "PMGR: error disabling BLE for transmission: %d")
+SB_TRACE_EVENT(SB_TRACE_PMGR_TRANSMIT_TIME,         "PMGR: transmit state took %u ms")
+SB_TRACE_EVENT(SB_TRACE_PMGR_ARCHIVE_FAILED,        "PMGR: archiving readings failed: %d")
+SB_TRACE_EVENT(SB_TRACE_PMGR_WAKE_STATS,            "PMGR: %u wakeups in %u s, %u merged")
+SB_TRACE_EVENT(SB_TRACE_PMGR_POWER_FAILED,          "PMGR: error setting peripheral power: %d")
+SB_TRACE_EVENT(SB_TRACE_PMGR_MUX_FAILED,            "PMGR: error setting IO MUX state: %d")
+
+// Readings manager
+SB_TRACE_EVENT(SB_TRACE_RM_CONSUMER_REGISTERED,     "Readings: consumer %u registered")
+SB_TRACE_EVENT(SB_TRACE_RM_CONSUMER_DROPPED,        "Readings: consumer %u dropped")
+SB_TRACE_EVENT(SB_TRACE_RM_MARK_UPDATED_FAILED,     "Readings: failed to mark characteristic updated for %u: %d")
+SB_TRACE_EVENT(SB_TRACE_RM_SNAPSHOT_FAILED,         "Readings: failed to notify snapshot: %d")
+SB_TRACE_EVENT(SB_TRACE_RM_READINGS_READ,           "Readings: read by %u, %d readings remaining")
+SB_TRACE_EVENT(SB_TRACE_RM_REFERENCE_TIME,          "Readings: set reference timestamp %u for %u")
+
+// BLE
+SB_TRACE_EVENT(SB_TRACE_BLE_FLOW_CONTROL,           "BLE: flow control violated, opcode %u")
+SB_TRACE_EVENT(SB_TRACE_BLE_MTU,                    "BLE: MTU size %u on %u")
+SB_TRACE_EVENT(SB_TRACE_BLE_NOTIFICATION,           "BLE: GATT handle value notification")
+SB_TRACE_EVENT(SB_TRACE_BLE_INDICATION,             "BLE: GATT handle value indication")
+SB_TRACE_EVENT(SB_TRACE_BLE_CONFIRM_FAILED,         "BLE: error handling GATT value confirmation: %d")
+SB_TRACE_EVENT(SB_TRACE_BLE_UNKNOWN_GATT_MSG,       "BLE: unknown GATT message %u")
+SB_TRACE_EVENT(SB_TRACE_BLE_RSP_RETRY,              "BLE: response send retry %u")
+SB_TRACE_EVENT(SB_TRACE_BLE_RSP_SENT,               "BLE: response sent, retry %u")
+SB_TRACE_EVENT(SB_TRACE_BLE_RSP_FAILED,             "BLE: response retry failed: %u")
+SB_TRACE_EVENT(SB_TRACE_BLE_ADVERTISING,            "BLE: advertising")
+SB_TRACE_EVENT(SB_TRACE_BLE_CONNECTED,              "BLE: connected, handle %u")
+SB_TRACE_EVENT(SB_TRACE_BLE_CONSUMER_FAILED,        "BLE: registering readings consumer failed: %d")
+SB_TRACE_EVENT(SB_TRACE_BLE_CONNECTED_ADV,          "BLE: connected advertising")
+SB_TRACE_EVENT(SB_TRACE_BLE_CLEAR_NOTIFY_FAILED,    "BLE: clearing GATT notification state failed: %d")
+SB_TRACE_EVENT(SB_TRACE_BLE_DISCONNECTED,           "BLE: disconnected")
+SB_TRACE_EVENT(SB_TRACE_BLE_TIMED_OUT,              "BLE: timed out")
+SB_TRACE_EVENT(SB_TRACE_BLE_ERROR,                  "BLE: error")
+SB_TRACE_EVENT(SB_TRACE_BLE_UNKNOWN_STATE,          "BLE: GAP role state %u")
+SB_TRACE_EVENT(SB_TRACE_BLE_TIME_SET,               "BLE: system time set: %u")
+SB_TRACE_EVENT(SB_TRACE_BLE_READING_COUNT,          "BLE: readings read, reading count set: %u")
+SB_TRACE_EVENT(SB_TRACE_BLE_SUBSCRIPTION,           "BLE: notification subscription status changed")
+SB_TRACE_EVENT(SB_TRACE_BLE_EVENTS_DROPPED,         "BLE: %u app events dropped, ring full")
+
+// Flash
+SB_TRACE_EVENT(SB_TRACE_FLASH_MIGRATED,             "Flash: migration to archive: %d, %u readings archived")
+
+// Added since, in order
+SB_TRACE_EVENT(SB_TRACE_PMGR_CONFIGURED,            "PMGR: configured %u devices, power generation %u")
+SB_TRACE_EVENT(SB_TRACE_RM_CONSUMER_RETURNED,       "Readings: consumer %u returned, %u readings held for it")
+SB_TRACE_EVENT(SB_TRACE_RM_CONSUMER_EVICTED,        "Readings: departed consumer evicted, %u readings no longer held")
+SB_TRACE_EVENT(SB_TRACE_FSM_TRANSITION,             "FSM: state %u -> %u on event %u")
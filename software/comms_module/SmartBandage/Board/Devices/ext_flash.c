@@ -35,6 +35,9 @@
 *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 *
 *******************************************************************************/
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/knl/Task.h>
+
 #include "Board.h"
 #include "bsp_spi.h"
 #include "ext_flash.h"
@@ -42,12 +45,22 @@
 /*
  * Implementation for WinBond W25X20CL Flash
  *
+ * Transfers go through the DMA-backed SPI driver at full clock, so the CPU
+ * is free for other tasks while data moves. Program and erase instructions
+ * are issued and left running: the next access waits for the part, sleeping
+ * between status reads rather than spinning on the bus.
  */
 
+/* SPI clock; the part takes up to 104MHz so the SSI is the limit */
+#ifndef EXT_FLASH_SPI_BIT_RATE
+#define EXT_FLASH_SPI_BIT_RATE    12000000
+#endif
+
 /* Instruction codes */
 
 #define BLS_CODE_PROGRAM          0x02 /**< Page Program */
 #define BLS_CODE_READ             0x03 /**< Read Data */
+#define BLS_CODE_FAST_READ        0x0B /**< Fast Read, one dummy byte */
 #define BLS_CODE_READ_STATUS      0x05 /**< Read Status Register */
 #define BLS_CODE_WRITE_ENABLE     0x06 /**< Write Enable */
 #define BLS_CODE_SECTOR_ERASE     0x20 /**< Sector Erase */
@@ -73,6 +86,20 @@
 /* Part specific constants */
 #define BLS_PROGRAM_PAGE_SIZE     256
 #define BLS_ERASE_SECTOR_SIZE     4096
+#define BLS_ERASE_BLOCK_SIZE      65536
+
+/* How long to sleep between status reads while the part is busy. A page
+ * program takes about 1ms, a sector erase 30ms and a block erase 150ms. */
+#define EXT_FLASH_PROGRAM_POLL_US 200
+#define EXT_FLASH_ERASE_POLL_US   5000
+
+#define EXT_FLASH_US_TO_TICKS(us) ((us) / Clock_tickPeriod)
+
+/* What the part was last left doing */
+#define EXT_FLASH_IDLE            0
+#define EXT_FLASH_PROGRAMMING     1
+#define EXT_FLASH_ERASING         2
+#define EXT_FLASH_UNKNOWN         3
 
 // Private functions
 static int extFlashWaitReady(void);
@@ -92,6 +119,8 @@ static PIN_Config BoardFlashPinTable[] =
 static PIN_Handle hFlashPin = NULL;
 static PIN_State pinState;
 
+static uint8_t flashState = EXT_FLASH_UNKNOWN;
+
 /*******************************************************************************
  * @fn          extFlashSelect
  *
@@ -200,14 +229,44 @@ static bool extFlashVerifyPart(void)
 }
 
 /**
- * Wait till previous erase/program operation completes.
+ * Read the status register.
  * @return Zero when successful.
  */
-static int extFlashWaitReady(void)
+static int extFlashReadStatus(uint8_t *status)
 {
   const uint8_t wbuf[1] = { BLS_CODE_READ_STATUS };
   int ret;
 
+  extFlashSelect();
+  ret = bspSpiWrite(wbuf, sizeof(wbuf));
+  if (ret == 0)
+  {
+    ret = bspSpiRead(status, 1);
+  }
+  extFlashDeselect();
+
+  return ret;
+}
+
+/**
+ * Wait till previous erase/program operation completes, sleeping while the
+ * part is busy so that other tasks can run.
+ * @return Zero when successful.
+ */
+static int extFlashWaitReady(void)
+{
+  uint32_t sleepTicks;
+
+  if (flashState == EXT_FLASH_IDLE)
+  {
+    /* Nothing was left running */
+    return 0;
+  }
+
+  sleepTicks = EXT_FLASH_US_TO_TICKS(flashState == EXT_FLASH_PROGRAMMING ?
+                                     EXT_FLASH_PROGRAM_POLL_US :
+                                     EXT_FLASH_ERASE_POLL_US);
+
   /* Throw away all garbage */
   extFlashSelect();
   bspSpiFlush();
@@ -217,12 +276,7 @@ static int extFlashWaitReady(void)
   {
     uint8_t buf;
 
-    extFlashSelect();
-    bspSpiWrite(wbuf, sizeof(wbuf));
-    ret = bspSpiRead(&buf,sizeof(buf));
-    extFlashDeselect();
-
-    if (ret)
+    if (extFlashReadStatus(&buf))
     {
       /* Error */
       return -2;
@@ -232,8 +286,12 @@ static int extFlashWaitReady(void)
       /* Now ready */
       break;
     }
+
+    Task_sleep(sleepTicks);
   }
 
+  flashState = EXT_FLASH_IDLE;
+
   return 0;
 }
 
@@ -277,6 +335,62 @@ static int extFlashWriteEnable(void)
   return 0;
 }
 
+/**
+ * Start a program or erase instruction at the given address and leave the
+ * part busy with it.
+ * @return Zero when successful.
+ */
+static int extFlashStart(uint8_t code, size_t offset, const uint8_t *buf,
+                         size_t length, uint8_t state)
+{
+  uint8_t wbuf[4];
+  int ret;
+
+  /* Wait till previous erase/program operation completes */
+  ret = extFlashWaitReady();
+  if (ret)
+  {
+    return ret;
+  }
+
+  ret = extFlashWriteEnable();
+  if (ret)
+  {
+    return ret;
+  }
+
+  wbuf[0] = code;
+  wbuf[1] = (offset >> 16) & 0xff;
+  wbuf[2] = (offset >> 8) & 0xff;
+  wbuf[3] = offset & 0xff;
+
+  /* Up to 100ns CS hold time (which is not clear
+   * whether it's application only in between reads)
+   * is not imposed here since above instructions
+   * should be enough to delay
+   * as much. */
+  extFlashSelect();
+
+  ret = bspSpiWrite(wbuf, sizeof(wbuf));
+  if (ret == 0 && length > 0)
+  {
+    ret = bspSpiWrite(buf, length);
+  }
+
+  extFlashDeselect();
+
+  if (ret)
+  {
+    /* The instruction may or may not have started */
+    flashState = EXT_FLASH_UNKNOWN;
+    return -4;
+  }
+
+  flashState = state;
+
+  return 0;
+}
+
 
 /* See ext_flash.h file for description */
 bool extFlashOpen(void)
@@ -289,7 +403,10 @@ bool extFlashOpen(void)
   }
 
   /* Make sure SPI is available */
-  bspSpiOpen();
+  bspSpiOpen(EXT_FLASH_SPI_BIT_RATE);
+
+  /* The part may be busy with something from before a reset */
+  flashState = EXT_FLASH_UNKNOWN;
 
   /* Put the part is standby mode */
   extFlashPowerStandby();
@@ -302,6 +419,9 @@ void extFlashClose(void)
 {
   if (hFlashPin != NULL)
   {
+    // Let a program or erase finish, the part ignores power down until then
+    extFlashWaitReady();
+
     // Put the part in low power mode
     extFlashPowerDown();
     extFlashWaitPowerDown();
@@ -317,7 +437,7 @@ void extFlashClose(void)
 /* See ext_flash.h file for description */
 bool extFlashRead(size_t offset, size_t length, uint8_t *buf)
 {
-  uint8_t wbuf[4];
+  uint8_t wbuf[5];
 
   /* Wait till previous erase/program operation completes */
   int ret = extFlashWaitReady();
@@ -326,13 +446,13 @@ bool extFlashRead(size_t offset, size_t length, uint8_t *buf)
     return false;
   }
 
-  /* SPI is driven with very low frequency (1MHz < 33MHz fR spec)
-   * in this temporary implementation.
-   * and hence it is not necessary to use fast read. */
-  wbuf[0] = BLS_CODE_READ;
+  /* Fast read takes a dummy byte after the address and is valid at any
+   * clock the SSI can produce. */
+  wbuf[0] = BLS_CODE_FAST_READ;
   wbuf[1] = (offset >> 16) & 0xff;
   wbuf[2] = (offset >> 8) & 0xff;
   wbuf[3] = offset & 0xff;
+  wbuf[4] = 0;
 
   extFlashSelect();
 
@@ -353,23 +473,8 @@ bool extFlashRead(size_t offset, size_t length, uint8_t *buf)
 /* See ext_flash.h file for description */
 bool extFlashWrite(size_t offset, size_t length, const uint8_t *buf)
 {
-  uint8_t wbuf[4];
-
   while (length > 0)
   {
-    /* Wait till previous erase/program operation completes */
-    int ret = extFlashWaitReady();
-    if (ret)
-    {
-      return false;
-    }
-
-    ret = extFlashWriteEnable();
-    if (ret)
-    {
-      return false;
-    }
-
     size_t ilen; /* interim length per instruction */
 
     ilen = BLS_PROGRAM_PAGE_SIZE - (offset % BLS_PROGRAM_PAGE_SIZE);
@@ -378,36 +483,15 @@ bool extFlashWrite(size_t offset, size_t length, const uint8_t *buf)
       ilen = length;
     }
 
-    wbuf[0] = BLS_CODE_PROGRAM;
-    wbuf[1] = (offset >> 16) & 0xff;
-    wbuf[2] = (offset >> 8) & 0xff;
-    wbuf[3] = offset & 0xff;
-
-    offset += ilen;
-    length -= ilen;
-
-    /* Up to 100ns CS hold time (which is not clear
-     * whether it's application only in between reads)
-     * is not imposed here since above instructions
-     * should be enough to delay
-     * as much. */
-    extFlashSelect();
-
-    if (bspSpiWrite(wbuf, sizeof(wbuf)))
+    if (extFlashStart(BLS_CODE_PROGRAM, offset, buf, ilen,
+                      EXT_FLASH_PROGRAMMING))
     {
-      /* failure */
-      extFlashDeselect();
       return false;
     }
 
-    if (bspSpiWrite(buf,ilen))
-    {
-      /* failure */
-      extFlashDeselect();
-      return false;
-    }
+    offset += ilen;
+    length -= ilen;
     buf += ilen;
-    extFlashDeselect();
   }
 
   return true;
@@ -416,56 +500,69 @@ bool extFlashWrite(size_t offset, size_t length, const uint8_t *buf)
 /* See ext_flash.h file for description */
 bool extFlashErase(size_t offset, size_t length)
 {
-  /* Note that Block erase might be more efficient when the floor map
-   * is well planned for OTA but to simplify for the temporary implementation,
-   * sector erase is used blindly. */
-  uint8_t wbuf[4];
-  size_t i, numsectors;
-
-  wbuf[0] = BLS_CODE_SECTOR_ERASE;
+  size_t endoffset;
 
+  if (length == 0)
   {
-    size_t endoffset = offset + length - 1;
-    offset = (offset / BLS_ERASE_SECTOR_SIZE) * BLS_ERASE_SECTOR_SIZE;
-    numsectors = (endoffset - offset + BLS_ERASE_SECTOR_SIZE - 1) /
-      BLS_ERASE_SECTOR_SIZE;
+    return true;
   }
 
-  for (i = 0; i < numsectors; i++)
+  endoffset = offset + length;
+  offset = (offset / BLS_ERASE_SECTOR_SIZE) * BLS_ERASE_SECTOR_SIZE;
+
+  while (offset < endoffset)
   {
-    /* Wait till previous erase/program operation completes */
-    int ret = extFlashWaitReady();
-    if (ret)
+    /* A 64KB block erase takes about as long as five sector erases, so use
+     * it wherever the range covers a whole block. */
+    if ((offset % BLS_ERASE_BLOCK_SIZE) == 0 &&
+        endoffset - offset >= BLS_ERASE_BLOCK_SIZE)
     {
-      return false;
-    }
+      if (extFlashStart(BLS_CODE_ERASE_64K, offset, NULL, 0, EXT_FLASH_ERASING))
+      {
+        return false;
+      }
 
-    ret = extFlashWriteEnable();
-    if (ret)
+      offset += BLS_ERASE_BLOCK_SIZE;
+    }
+    else
     {
-      return false;
+      if (extFlashStart(BLS_CODE_ERASE_4K, offset, NULL, 0, EXT_FLASH_ERASING))
+      {
+        return false;
+      }
+
+      offset += BLS_ERASE_SECTOR_SIZE;
     }
+  }
 
-    wbuf[1] = (offset >> 16) & 0xff;
-    wbuf[2] = (offset >> 8) & 0xff;
-    wbuf[3] = offset & 0xff;
+  return true;
+}
 
-    extFlashSelect();
+/* See ext_flash.h file for description */
+bool extFlashBusy(void)
+{
+  uint8_t status;
 
-    if (bspSpiWrite(wbuf, sizeof(wbuf)))
-    {
-      /* failure */
-      extFlashDeselect();
-      return false;
-    }
-    extFlashDeselect();
+  if (flashState == EXT_FLASH_IDLE)
+  {
+    return false;
+  }
 
-    offset += BLS_ERASE_SECTOR_SIZE;
+  if (extFlashReadStatus(&status) == 0 && !(status & BLS_STATUS_BIT_BUSY))
+  {
+    flashState = EXT_FLASH_IDLE;
+    return false;
   }
 
   return true;
 }
 
+/* See ext_flash.h file for description */
+bool extFlashSync(void)
+{
+  return extFlashWaitReady() == 0;
+}
+
 /* See ext_flash.h file for description */
 bool extFlashTest(void)
 {
@@ -61,26 +61,42 @@ extern bool extFlashOpen(void);
 extern void extFlashClose(void);
 
 /**
-* Read storage content
+* Read storage content. Waits for any program or erase still running.
 *
 * @return True when successful.
 */
 extern bool extFlashRead(size_t offset, size_t length, uint8_t *buf);
 
 /**
-* Erase storage sectors corresponding to the range.
+* Erase storage sectors corresponding to the range. Returns once the last
+* erase has been started; see extFlashBusy() and extFlashSync().
 *
 * @return True when successful.
 */
 extern bool extFlashErase(size_t offset, size_t length);
 
 /**
-* Write to storage sectors.
+* Write to storage sectors. Returns once the last program page has been
+* started; see extFlashBusy() and extFlashSync().
 *
 * @return True when successful.
 */
 extern bool extFlashWrite(size_t offset, size_t length, const uint8_t *buf);
 
+/**
+* Check whether a program or erase is still running, without waiting.
+*
+* @return True while the part is busy.
+*/
+extern bool extFlashBusy(void);
+
+/**
+* Wait for a program or erase still running, sleeping meanwhile.
+*
+* @return True when successful.
+*/
+extern bool extFlashSync(void);
+
 /**
 * Test the flash (power on self-test)
 *
@@ -75,6 +75,53 @@ static PIN_Config BoardSpiInitTable[] = {
 
 static uint8_t nUsers = 0;
 
+// Most bytes the DMA moves in one SPI transaction
+#define BSP_SPI_MAX_TRANSFER  1024
+
+/*******************************************************************************
+ * @fn          bspSpiTransfer
+ *
+ * @brief       Run an SPI transfer, split into transactions the DMA can take
+ *
+ * @param       txBuf - data to write, or NULL
+ * @param       rxBuf - buffer to read into, or NULL
+ * @param       len - number of bytes to transfer
+ *
+ * @return      '0' if success, -1 if failed
+ */
+static int bspSpiTransfer(const uint8_t *txBuf, uint8_t *rxBuf, size_t len)
+{
+  SPI_Transaction masterTransaction;
+
+  while (len > 0)
+  {
+    masterTransaction.count  = len < BSP_SPI_MAX_TRANSFER ? len :
+                               BSP_SPI_MAX_TRANSFER;
+    masterTransaction.txBuf  = (void*)txBuf;
+    masterTransaction.arg    = NULL;
+    masterTransaction.rxBuf  = rxBuf;
+
+    if (!SPI_transfer(spiHandle, &masterTransaction))
+    {
+      return -1;
+    }
+
+    len -= masterTransaction.count;
+
+    if (txBuf != NULL)
+    {
+      txBuf += masterTransaction.count;
+    }
+
+    if (rxBuf != NULL)
+    {
+      rxBuf += masterTransaction.count;
+    }
+  }
+
+  return 0;
+}
+
 /*******************************************************************************
  * @fn          bspSpiWrite
  *
@@ -87,14 +134,7 @@ static uint8_t nUsers = 0;
  */
 int bspSpiWrite(const uint8_t *buf, size_t len)
 {
-  SPI_Transaction masterTransaction;
-
-  masterTransaction.count  = len;
-  masterTransaction.txBuf  = (void*)buf;
-  masterTransaction.arg    = NULL;
-  masterTransaction.rxBuf  = NULL;
-
-  return SPI_transfer(spiHandle, &masterTransaction) ? 0 : -1;
+  return bspSpiTransfer(buf, NULL, len);
 }
 
 
@@ -110,14 +150,7 @@ int bspSpiWrite(const uint8_t *buf, size_t len)
  */
 int bspSpiRead(uint8_t *buf, size_t len)
 {
-  SPI_Transaction masterTransaction;
-
-  masterTransaction.count  = len;
-  masterTransaction.txBuf  = NULL;
-  masterTransaction.arg    = NULL;
-  masterTransaction.rxBuf  = buf;
-
-  return SPI_transfer(spiHandle, &masterTransaction) ? 0 : -1;
+  return bspSpiTransfer(NULL, buf, len);
 }
 
 
@@ -156,11 +189,12 @@ int bspSpiWriteRead(uint8_t *buf, uint8_t wlen, uint8_t rlen)
  *
  * @brief       Open the RTOS SPI driver
  *
- * @param       none
+ * @param       bitRate - SPI clock in Hz. Only used by the first user, later
+ *                        users share the driver as it was opened.
  *
  * @return      none
  */
-void bspSpiOpen(void)
+void bspSpiOpen(uint32_t bitRate)
 {
   if (hSpiPin != NULL)
   {
@@ -172,9 +206,9 @@ void bspSpiOpen(void)
 
   if (spiHandle == NULL)
   {
-    /*  Configure SPI as master, 1 mHz bit rate*/
+    /*  Configure SPI as master */
     SPI_Params_init(&spiParams);
-    spiParams.bitRate = 1000000;
+    spiParams.bitRate = bitRate;
     spiParams.mode         = SPI_MASTER;
     spiParams.transferMode = SPI_MODE_BLOCKING;
 
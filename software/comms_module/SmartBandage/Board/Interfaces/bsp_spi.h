@@ -48,11 +48,11 @@ extern "C"
 #endif
 
   /**
-  * Open SPI interface
+  * Open SPI interface at the given bit rate (Hz)
   *
   * @return none
   */
-  extern void bspSpiOpen(void);
+  extern void bspSpiOpen(uint32_t bitRate);
 
   /**
   * Close SPI interface
@@ -69,7 +69,7 @@ extern "C"
   extern void bspSpiFlush(void);
 
   /**
-  * Read from an SPI device
+  * Read from an SPI device. Reads longer than one DMA transaction are split.
   *
   * @return 0 when successful.
   */
@@ -8,7 +8,9 @@
   This implementation uses heapmgr.h to implement a simple heap with low
   memory overhead but large processing overhead.<br>
   The size of the heap is determined with HEAPMGR_SIZE macro, which can
-  be overridden with a compile option.
+  be overridden with a compile option.<br>
+  Messages and small memory blocks are served from the fixed block pools
+  in ICallPool.c first, and only fall back to the heap when they do not fit.
 
   <!--
   Copyright 2013 - 2015 Texas Instruments Incorporated. All rights reserved.
@@ -53,6 +55,7 @@
 
 #include "ICall.h"
 #include "ICallPlatform.h"
+#include "ICallPool.h"
 
 #ifndef ICALL_FEATURE_SEPARATE_IMGINFO
 #include <ICallAddrs.h>
@@ -217,6 +220,11 @@ typedef struct _icall_task_entry_t
   Task_Handle task;
   Semaphore_Handle sem;
   ICall_MsgQueue queue;
+  /** last message in the queue */
+  void *tail;
+  /** last queued message the running ICall_waitMatch() did not match,
+   *  nor any message before it */
+  void *unmatched;
 } ICall_TaskEntry;
 
 /** @internal data structure about an entity using ICall module */
@@ -342,6 +350,8 @@ static ICall_TaskEntry *ICall_newTask(Task_Handle taskhandle)
       ICall_TaskEntry *taskentry = &ICall_tasks[i];
       taskentry->task = taskhandle;
       taskentry->queue = NULL;
+      taskentry->tail = NULL;
+      taskentry->unmatched = NULL;
       taskentry->sem = Semaphore_create(0, NULL, NULL);
       if (taskentry->sem == NULL)
       {
@@ -465,6 +475,8 @@ void ICall_init(void)
   {
     ICall_tasks[i].task = NULL;
     ICall_tasks[i].queue = NULL;
+    ICall_tasks[i].tail = NULL;
+    ICall_tasks[i].unmatched = NULL;
   }
   for (i = 0; i < ICALL_MAX_NUM_ENTITIES; i++)
   {
@@ -612,7 +624,7 @@ static ICall_Errno ICall_primRegisterApp(ICall_RegisterAppArgs *args)
 static ICall_Errno ICall_primAllocMsg(ICall_AllocArgs *args)
 {
   ICall_MsgHdr *hdr =
-      (ICall_MsgHdr *) ICall_heapMalloc(sizeof(ICall_MsgHdr) + args->size);
+      (ICall_MsgHdr *) ICall_poolMalloc(sizeof(ICall_MsgHdr) + args->size);
 
   if (!hdr)
   {
@@ -633,7 +645,7 @@ static ICall_Errno ICall_primAllocMsg(ICall_AllocArgs *args)
 static ICall_Errno ICall_primFreeMsg(ICall_FreeArgs *args)
 {
   ICall_MsgHdr *hdr = (ICall_MsgHdr *) args->ptr - 1;
-  ICall_heapFree(hdr);
+  ICall_poolFree(hdr);
   return ICALL_ERRNO_SUCCESS;
 }
 
@@ -669,7 +681,7 @@ void ICall_freeImpl(void *ptr)
  */
 static ICall_Errno ICall_primMalloc(ICall_AllocArgs *args)
 {
-  args->ptr = ICall_heapMalloc(args->size);
+  args->ptr = ICall_poolMalloc(args->size);
   if (args->ptr == NULL)
   {
     return ICALL_ERRNO_NO_RESOURCE;
@@ -684,18 +696,17 @@ static ICall_Errno ICall_primMalloc(ICall_AllocArgs *args)
  */
 static ICall_Errno ICall_primFree(ICall_FreeArgs *args)
 {
-  ICall_heapFree(args->ptr);
+  ICall_poolFree(args->ptr);
   return ICALL_ERRNO_SUCCESS;
 }
 
 /**
- * @internal Queues a message to a message queue.
- * @param q_ptr    message queue
- * @param msg_ptr  message pointer
+ * @internal Queues a message to a task's message queue.
+ * @param taskentry  task entry
+ * @param msg_ptr    message pointer
  */
-static void ICall_msgEnqueue( ICall_MsgQueue *q_ptr, void *msg_ptr )
+static void ICall_msgEnqueue( ICall_TaskEntry *taskentry, void *msg_ptr )
 {
-  void *list;
   ICall_CSState key;
 
   // Hold off interrupts
@@ -703,79 +714,76 @@ static void ICall_msgEnqueue( ICall_MsgQueue *q_ptr, void *msg_ptr )
 
   ICALL_MSG_NEXT( msg_ptr ) = NULL;
   // If first message in queue
-  if ( *q_ptr == NULL )
+  if ( taskentry->queue == NULL )
   {
-    *q_ptr = msg_ptr;
+    taskentry->queue = msg_ptr;
   }
   else
   {
-    // Find end of queue
-    for ( list = *q_ptr; ICALL_MSG_NEXT( list ) != NULL;
-          list = ICALL_MSG_NEXT( list ) );
-
     // Add message to end of queue
-    ICALL_MSG_NEXT( list ) = msg_ptr;
+    ICALL_MSG_NEXT( taskentry->tail ) = msg_ptr;
   }
+  taskentry->tail = msg_ptr;
 
   // Re-enable interrupts
   ICall_leaveCSImpl(key);
 }
 
 /**
- * @internal Dequeues a message from a message queue
- * @param q_ptr  message queue pointer
- * @return Dequeued message pointer or NULL if none.
+ * @internal Takes a message out of a task's message queue
+ * @param taskentry  task entry
+ * @param msg_ptr    message pointer
+ * @param prev_ptr   message before it in the queue, or NULL if it is
+ *                   the first
  */
-static void *ICall_msgDequeue( ICall_MsgQueue *q_ptr )
+static void ICall_msgExtract( ICall_TaskEntry *taskentry, void *msg_ptr,
+                              void *prev_ptr )
 {
-  void *msg_ptr = NULL;
   ICall_CSState key;
 
   // Hold off interrupts
   key = ICall_enterCSImpl();
 
-  if ( *q_ptr != NULL )
+  if ( prev_ptr == NULL )
+  {
+    taskentry->queue = ICALL_MSG_NEXT( msg_ptr );
+  }
+  else
+  {
+    ICALL_MSG_NEXT( prev_ptr ) = ICALL_MSG_NEXT( msg_ptr );
+  }
+  if ( taskentry->tail == msg_ptr )
   {
-    // Dequeue message
-    msg_ptr = *q_ptr;
-    *q_ptr = ICALL_MSG_NEXT( msg_ptr );
-    ICALL_MSG_NEXT( msg_ptr ) = NULL;
-    ICALL_MSG_DEST_ID( msg_ptr ) = ICALL_UNDEF_DEST_ID;
+    taskentry->tail = prev_ptr;
   }
+  if ( taskentry->unmatched == msg_ptr )
+  {
+    // All the messages it vouched for are gone
+    taskentry->unmatched = NULL;
+  }
+  ICALL_MSG_NEXT( msg_ptr ) = NULL;
+  ICALL_MSG_DEST_ID( msg_ptr ) = ICALL_UNDEF_DEST_ID;
 
   // Re-enable interrupts
   ICall_leaveCSImpl(key);
-
-  return msg_ptr;
 }
 
 /**
- * @internal Prepends a list of messages to a message queue
- * @param q_ptr  message queue pointer
- * @param head   message list to prepend
+ * @internal Dequeues a message from a task's message queue
+ * @param taskentry  task entry
+ * @return Dequeued message pointer or NULL if none.
  */
-static void ICall_msgPrepend( ICall_MsgQueue *q_ptr, ICall_MsgQueue head )
+static void *ICall_msgDequeue( ICall_TaskEntry *taskentry )
 {
-  void *msg_ptr = NULL;
-  ICall_CSState key;
-
-  // Hold off interrupts
-  key = ICall_enterCSImpl();
+  void *msg_ptr = taskentry->queue;
 
-  if ( head != NULL )
+  // Only the task itself takes messages out of its queue
+  if ( msg_ptr != NULL )
   {
-    /* Find the end of the queue */
-    msg_ptr = head;
-    while (ICALL_MSG_NEXT( msg_ptr ) != NULL)
-    {
-      msg_ptr = ICALL_MSG_NEXT( msg_ptr );
-    }
-    ICALL_MSG_NEXT(msg_ptr) = *q_ptr;
-    *q_ptr = head;
+    ICall_msgExtract( taskentry, msg_ptr, NULL );
   }
 
-  // Re-enable interrupts
-  ICall_leaveCSImpl(key);
+  return msg_ptr;
 }
 
 /**
@@ -813,7 +821,7 @@ static ICall_Errno ICall_primSend(ICall_SendArgs *args)
   hdr->srcentity = args->src;
   hdr->dstentity = args->dest.entityId;
   hdr->format = args->format;
-  ICall_msgEnqueue(&ICall_entities[args->dest.entityId].task->queue, args->msg);
+  ICall_msgEnqueue(ICall_entities[args->dest.entityId].task, args->msg);
   Semaphore_post(ICall_entities[args->dest.entityId].task->sem);
   return ICALL_ERRNO_SUCCESS;
 }
@@ -843,7 +851,7 @@ static ICall_Errno ICall_primFetchMsg(ICall_FetchMsgArgs *args)
     return ICALL_ERRNO_UNKNOWN_THREAD;
   }
   /* Successful */
-  args->msg = ICall_msgDequeue(&taskentry->queue);
+  args->msg = ICall_msgDequeue(taskentry);
   hdr = (ICall_MsgHdr *) args->msg - 1;
   if (args->msg == NULL)
   {
@@ -1331,6 +1339,12 @@ static ICall_Errno ICall_primGetMaxMSecs(ICall_GetUint32Args *args)
  * @internal
  * Waits for a message that matches comparison
  *
+ * Messages that do not match are left where they are in the queue. The
+ * task entry remembers the last of them, so that each message queued while
+ * waiting is checked once rather than the whole queue again. A wait starts
+ * from the head of the queue, because the match functions of ICallBleAPI.c
+ * may depend on what the caller is waiting for, which changes between waits.
+ *
  * @param args  arguments corresponding to those of ICall_waitMatch().
  * @return @ref ICALL_ERRNO_SUCCESS when the semaphore is signaled.<br>
  *         @ref ICALL_ERRNO_TIMEOUT when designated timeout period
@@ -1343,11 +1357,11 @@ static ICall_Errno ICall_primWaitMatch(ICall_WaitMatchArgs *args)
 {
   Task_Handle taskhandle = Task_self();
   ICall_TaskEntry *taskentry = ICall_searchTask(taskhandle);
-  ICall_MsgQueue prependQueue = NULL;
   uint_fast16_t consumedCount = 0;
   UInt timeout;
   uint_fast32_t timeoutStamp;
   ICall_Errno errno;
+  ICall_CSState key;
 
   {
     BIOS_ThreadType threadtype = BIOS_getThreadType();
@@ -1387,31 +1401,42 @@ static ICall_Errno ICall_primWaitMatch(ICall_WaitMatchArgs *args)
     }
   }
 
+  /* Nothing is known to not match this wait yet */
+  taskentry->unmatched = NULL;
+
   errno = ICALL_ERRNO_TIMEOUT;
   timeoutStamp = Clock_getTicks() + timeout;
   while (Semaphore_pend(taskentry->sem, timeout))
   {
-    ICall_FetchMsgArgs fetchArgs;
     ICall_ServiceEnum servId;
-    errno = ICall_primFetchMsg(&fetchArgs);
-    if (errno == ICALL_ERRNO_SUCCESS)
+    ICall_MsgHdr *hdr;
+    void *prev, *msg;
+
+    /* First message not checked yet, if any. The semaphore is also
+     * counted for those already checked. */
+    key = ICall_enterCSImpl();
+    prev = taskentry->unmatched;
+    msg = (prev == NULL) ? taskentry->queue : ICALL_MSG_NEXT(prev);
+    ICall_leaveCSImpl(key);
+
+    if (msg != NULL)
     {
-      if (ICall_primEntityId2ServiceId(fetchArgs.src.entityId, &servId) ==
-            ICALL_ERRNO_SUCCESS)
+      hdr = (ICall_MsgHdr *) msg - 1;
+      if (ICall_primEntityId2ServiceId(hdr->srcentity, &servId) ==
+            ICALL_ERRNO_SUCCESS &&
+          args->matchFn(servId, hdr->dstentity, msg))
       {
-        if (args->matchFn(servId, fetchArgs.dest, fetchArgs.msg))
-        {
-          /* Matching message found*/
-          args->servId = servId;
-          args->dest = fetchArgs.dest;
-          args->msg = fetchArgs.msg;
-          errno = ICALL_ERRNO_SUCCESS;
-          break;
-        }
+        /* Matching message found*/
+        ICall_msgExtract(taskentry, msg, prev);
+        args->servId = servId;
+        args->dest = hdr->dstentity;
+        args->msg = msg;
+        errno = ICALL_ERRNO_SUCCESS;
+        break;
       }
       /* Message was received but it wasn't expected one.
-       * Add to the prepend queue */
-      ICall_msgEnqueue(&prependQueue, fetchArgs.msg);
+       * Leave it in the queue */
+      taskentry->unmatched = msg;
     }
 
     /* Prepare for timeout exit */
@@ -1432,8 +1457,6 @@ static ICall_Errno ICall_primWaitMatch(ICall_WaitMatchArgs *args)
     }
   }
 
-  /* Prepend retrieved irrelevant messages */
-  ICall_msgPrepend(&taskentry->queue, prependQueue);
   /* Re-increment the consumed semaphores */
   for (; consumedCount > 0; consumedCount--)
   {
@@ -1971,8 +1994,9 @@ static void ICall_initPrim(void)
   ICall_entities[0].service = ICALL_SERVICE_CLASS_PRIMITIVE;
   ICall_entities[0].fn = ICall_primService;
 
-  /* Initialize heap */
+  /* Initialize heap, and the message pools in front of it */
   ICall_heapInit();
+  ICall_poolInit();
 
   /* TODO: Think about freezing permanently allocated memory blocks
    * for optimization.
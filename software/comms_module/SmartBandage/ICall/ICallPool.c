@@ -0,0 +1,231 @@
+/**
+  @file  ICallPool.c
+  @brief Fixed block pools in front of the ICall heap.
+
+  Each pool is a static array of equal sized blocks threaded on a free list,
+  so allocating and freeing is a list pop or push with interrupts held off
+  for a few instructions. A block is returned to the pool whose array
+  contains it; anything else came from the heap.
+
+  The block sizes and counts can be overridden with compile options.
+  The defaults cover, on the CC26xx:
+  - 16 bytes: application events (sbpEvt_t), RTOS queue records
+    (queueRec_t) and small stack buffers.
+  - 48 bytes: stack messages, which carry an ICall_MsgHdr (12 bytes) in
+    front of a gattMsgEvent_t or GAP role event (up to 32 bytes).
+  - 96 bytes: notification and indication values at the largest ATT MTU.
+  The counters reported by ICall_poolGetUsage() are there to tune them.
+*/
+
+#include <string.h>
+
+#include <ti/sysbios/hal/Hwi.h>
+
+#include "ICallPool.h"
+
+#ifndef ICALL_POOL0_BLOCK_SIZE
+#define ICALL_POOL0_BLOCK_SIZE          16
+#endif
+
+#ifndef ICALL_POOL0_BLOCKS
+#define ICALL_POOL0_BLOCKS              16
+#endif
+
+#ifndef ICALL_POOL1_BLOCK_SIZE
+#define ICALL_POOL1_BLOCK_SIZE          48
+#endif
+
+#ifndef ICALL_POOL1_BLOCKS
+#define ICALL_POOL1_BLOCKS              8
+#endif
+
+#ifndef ICALL_POOL2_BLOCK_SIZE
+#define ICALL_POOL2_BLOCK_SIZE          96
+#endif
+
+#ifndef ICALL_POOL2_BLOCKS
+#define ICALL_POOL2_BLOCKS              4
+#endif
+
+/* Blocks are carved from uint64_t arrays so that every block is aligned
+ * for any type, and the block counts must fit the 8 bit counters. */
+#define ICALL_POOL_CHECK(idx, size, blocks)                             \
+  typedef char ICall_poolCheck##idx[((size) % sizeof(uint64_t) == 0 && \
+    (size) >= sizeof(void *) && (blocks) > 0 && (blocks) <= 0xFF) ? 1 : -1]
+
+ICALL_POOL_CHECK(0, ICALL_POOL0_BLOCK_SIZE, ICALL_POOL0_BLOCKS);
+ICALL_POOL_CHECK(1, ICALL_POOL1_BLOCK_SIZE, ICALL_POOL1_BLOCKS);
+ICALL_POOL_CHECK(2, ICALL_POOL2_BLOCK_SIZE, ICALL_POOL2_BLOCKS);
+
+#define ICALL_POOL_WORDS(size, blocks)  ((size) * (blocks) / sizeof(uint64_t))
+
+#define ICALL_POOL_COUNT(counter)                                       \
+  do { if ((uint16_t) ((counter) + 1) != 0) { (counter)++; } } while (0)
+
+/* Heap behind the pools, see ICall.c */
+extern void *ICall_heapMalloc(uint16_t size);
+extern void ICall_heapFree(void *blk);
+
+/**
+ * @internal A free block, linked through its first word.
+ */
+typedef struct ICall_PoolBlock
+{
+  struct ICall_PoolBlock *next;
+} ICall_PoolBlock;
+
+/**
+ * @internal A pool of equal sized blocks.
+ */
+typedef struct
+{
+  uint8_t *start;              /**< First block */
+  uint8_t *end;                /**< End of the last block */
+  ICall_PoolBlock *freeList;
+} ICall_Pool;
+
+static uint64_t ICall_pool0Mem[ICALL_POOL_WORDS(ICALL_POOL0_BLOCK_SIZE,
+                                                ICALL_POOL0_BLOCKS)];
+static uint64_t ICall_pool1Mem[ICALL_POOL_WORDS(ICALL_POOL1_BLOCK_SIZE,
+                                                ICALL_POOL1_BLOCKS)];
+static uint64_t ICall_pool2Mem[ICALL_POOL_WORDS(ICALL_POOL2_BLOCK_SIZE,
+                                                ICALL_POOL2_BLOCKS)];
+
+/* Pools in increasing block size */
+static ICall_Pool ICall_pools[ICALL_POOL_NUM];
+
+static ICall_PoolUsage ICall_poolUsage;
+
+/**
+ * @internal Threads every block of a pool on its free list.
+ * @param idx        index of the pool
+ * @param mem        memory of the pool
+ * @param blockSize  size of each block
+ * @param blocks     number of blocks
+ */
+static void ICall_poolBuild(uint8_t idx, uint64_t *mem, uint16_t blockSize,
+                            uint8_t blocks)
+{
+  ICall_Pool *pool = &ICall_pools[idx];
+  uint8_t i;
+
+  pool->start = (uint8_t *) mem;
+  pool->end = pool->start + (uint32_t) blockSize * blocks;
+  pool->freeList = NULL;
+
+  /* Push from the end so that blocks are handed out in address order */
+  for (i = blocks; i > 0; i--)
+  {
+    ICall_PoolBlock *blk =
+      (ICall_PoolBlock *) (pool->start + (uint32_t) blockSize * (i - 1));
+    blk->next = pool->freeList;
+    pool->freeList = blk;
+  }
+
+  ICall_poolUsage.pools[idx].blockSize = blockSize;
+  ICall_poolUsage.pools[idx].blocks = blocks;
+}
+
+/* See header file for comment */
+void ICall_poolInit(void)
+{
+  memset(&ICall_poolUsage, 0, sizeof(ICall_poolUsage));
+
+  ICall_poolBuild(0, ICall_pool0Mem, ICALL_POOL0_BLOCK_SIZE, ICALL_POOL0_BLOCKS);
+  ICall_poolBuild(1, ICall_pool1Mem, ICALL_POOL1_BLOCK_SIZE, ICALL_POOL1_BLOCKS);
+  ICall_poolBuild(2, ICall_pool2Mem, ICALL_POOL2_BLOCK_SIZE, ICALL_POOL2_BLOCKS);
+}
+
+/* See header file for comment */
+void *ICall_poolMalloc(uint16_t size)
+{
+  void *blk = NULL;
+  UInt key;
+  uint8_t i;
+
+  for (i = 0; i < ICALL_POOL_NUM; i++)
+  {
+    ICall_PoolStats *stats = &ICall_poolUsage.pools[i];
+
+    if (size > stats->blockSize)
+    {
+      continue;
+    }
+
+    key = Hwi_disable();
+    if (ICall_pools[i].freeList != NULL)
+    {
+      blk = ICall_pools[i].freeList;
+      ICall_pools[i].freeList = ICall_pools[i].freeList->next;
+
+      if (++stats->inUse > stats->highWater)
+      {
+        stats->highWater = stats->inUse;
+      }
+    }
+    else
+    {
+      ICALL_POOL_COUNT(stats->failures);
+    }
+    Hwi_restore(key);
+
+    /* Only the smallest pool that fits is tried, so that a burst of small
+     * allocations cannot starve the larger sizes. */
+    break;
+  }
+
+  if (blk == NULL)
+  {
+    blk = ICall_heapMalloc(size);
+
+    key = Hwi_disable();
+    if (blk != NULL)
+    {
+      ICALL_POOL_COUNT(ICall_poolUsage.heapAllocs);
+    }
+    else
+    {
+      ICALL_POOL_COUNT(ICall_poolUsage.heapFailures);
+    }
+    Hwi_restore(key);
+  }
+
+  return blk;
+}
+
+/* See header file for comment */
+void ICall_poolFree(void *blk)
+{
+  UInt key;
+  uint8_t i;
+
+  if (blk == NULL)
+  {
+    return;
+  }
+
+  for (i = 0; i < ICALL_POOL_NUM; i++)
+  {
+    ICall_Pool *pool = &ICall_pools[i];
+
+    if ((uint8_t *) blk >= pool->start && (uint8_t *) blk < pool->end)
+    {
+      key = Hwi_disable();
+      ((ICall_PoolBlock *) blk)->next = pool->freeList;
+      pool->freeList = (ICall_PoolBlock *) blk;
+      ICall_poolUsage.pools[i].inUse--;
+      Hwi_restore(key);
+      return;
+    }
+  }
+
+  ICall_heapFree(blk);
+}
+
+/* See header file for comment */
+void ICall_poolGetUsage(ICall_PoolUsage *usage)
+{
+  UInt key = Hwi_disable();
+  *usage = ICall_poolUsage;
+  Hwi_restore(key);
+}
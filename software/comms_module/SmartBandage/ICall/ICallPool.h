@@ -0,0 +1,80 @@
+/**
+  @file  ICallPool.h
+  @brief Fixed block pools in front of the ICall heap.
+
+  Messages and small buffers allocated through ICall (ICall_malloc(),
+  ICall_allocMsg(), and osal_mem_alloc() in the stack image) are taken from
+  a pool of fixed size blocks when one fits, so the common allocations take
+  constant time and do not fragment the heap. Requests that are too large,
+  or that find their pool empty, fall back to the heap.
+*/
+#ifndef ICALLPOOL_H
+#define ICALLPOOL_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Number of block sizes */
+#define ICALL_POOL_NUM                  3
+
+/**
+ * Usage of one pool. Counters saturate rather than wrap.
+ */
+typedef struct
+{
+  uint16_t blockSize;   /**< Size of each block in bytes */
+  uint8_t  blocks;      /**< Number of blocks in the pool */
+  uint8_t  inUse;       /**< Blocks currently allocated */
+  uint8_t  highWater;   /**< Most blocks ever allocated at once */
+  uint8_t  reserved;
+  uint16_t failures;    /**< Allocations that found the pool empty and went to the heap */
+} ICall_PoolStats;
+
+/**
+ * Usage of every pool and of the heap behind them.
+ * Laid out so that no padding is required.
+ */
+typedef struct
+{
+  ICall_PoolStats pools[ICALL_POOL_NUM];
+  uint16_t heapAllocs;  /**< Allocations served by the heap */
+  uint16_t heapFailures;/**< Allocations the heap could not serve either */
+} ICall_PoolUsage;
+
+/**
+ * Builds the free lists of every pool and clears the counters.
+ * Must be called before the first allocation.
+ */
+extern void ICall_poolInit(void);
+
+/**
+ * Allocates a memory block from the smallest pool that fits,
+ * or from the heap.
+ *
+ * @param size   size in bytes
+ * @return pointer to the allocated memory block or NULL
+ */
+extern void *ICall_poolMalloc(uint16_t size);
+
+/**
+ * Frees a memory block allocated with ICall_poolMalloc().
+ *
+ * @param blk   pointer to the memory block, may be NULL
+ */
+extern void ICall_poolFree(void *blk);
+
+/**
+ * Takes a snapshot of the pool and heap counters.
+ *
+ * @param usage   filled with the counters
+ */
+extern void ICall_poolGetUsage(ICall_PoolUsage *usage);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ICALLPOOL_H */
@@ -60,6 +60,15 @@
  * TYPEDEFS
  */
 
+// A run of consecutive 16-bit UUIDs, with their records indexed by
+// (UUID - base)
+typedef struct
+{
+  uint16 base;                    // First UUID of the group
+  uint8 numRecs;                  // Number of UUIDs in the group
+  const uint8 * const *pRecs;     // UUID records, NULL for unknown UUIDs
+} gattUUIDGroup_t;
+
 /*********************************************************************
  * GLOBAL VARIABLES
  */
@@ -210,6 +219,56 @@ CONST uint8 reportRefUUID[ATT_BT_UUID_SIZE] =
  * LOCAL VARIABLES
  */
 
+// GATT Declarations
+static const uint8 * const gattDeclRecs[] =
+{
+  [GATT_PRIMARY_SERVICE_UUID - GATT_PRIMARY_SERVICE_UUID]   = primaryServiceUUID,
+  [GATT_SECONDARY_SERVICE_UUID - GATT_PRIMARY_SERVICE_UUID] = secondaryServiceUUID,
+  [GATT_INCLUDE_UUID - GATT_PRIMARY_SERVICE_UUID]           = includeUUID,
+  [GATT_CHARACTER_UUID - GATT_PRIMARY_SERVICE_UUID]         = characterUUID
+};
+
+// GATT Descriptors
+static const uint8 * const gattDescRecs[] =
+{
+  [GATT_CHAR_EXT_PROPS_UUID - GATT_CHAR_EXT_PROPS_UUID]   = charExtPropsUUID,
+  [GATT_CHAR_USER_DESC_UUID - GATT_CHAR_EXT_PROPS_UUID]   = charUserDescUUID,
+  [GATT_CLIENT_CHAR_CFG_UUID - GATT_CHAR_EXT_PROPS_UUID]  = clientCharCfgUUID,
+  [GATT_SERV_CHAR_CFG_UUID - GATT_CHAR_EXT_PROPS_UUID]    = servCharCfgUUID,
+  [GATT_CHAR_FORMAT_UUID - GATT_CHAR_EXT_PROPS_UUID]      = charFormatUUID,
+  [GATT_CHAR_AGG_FORMAT_UUID - GATT_CHAR_EXT_PROPS_UUID]  = charAggFormatUUID,
+  [GATT_VALID_RANGE_UUID - GATT_CHAR_EXT_PROPS_UUID]      = validRangeUUID,
+  [GATT_EXT_REPORT_REF_UUID - GATT_CHAR_EXT_PROPS_UUID]   = extReportRefUUID,
+  [GATT_REPORT_REF_UUID - GATT_CHAR_EXT_PROPS_UUID]       = reportRefUUID
+};
+
+// GATT Characteristics
+static const uint8 * const gattCharRecs[] =
+{
+  [DEVICE_NAME_UUID - DEVICE_NAME_UUID]       = deviceNameUUID,
+  [APPEARANCE_UUID - DEVICE_NAME_UUID]        = appearanceUUID,
+  [PERI_PRIVACY_FLAG_UUID - DEVICE_NAME_UUID] = periPrivacyFlagUUID,
+  [RECONNECT_ADDR_UUID - DEVICE_NAME_UUID]    = reconnectAddrUUID,
+  [PERI_CONN_PARAM_UUID - DEVICE_NAME_UUID]   = periConnParamUUID,
+  [SERVICE_CHANGED_UUID - DEVICE_NAME_UUID]   = serviceChangedUUID
+};
+
+// GATT Services
+static const uint8 * const gattServiceRecs[] =
+{
+  [GAP_SERVICE_UUID - GAP_SERVICE_UUID]  = gapServiceUUID,
+  [GATT_SERVICE_UUID - GAP_SERVICE_UUID] = gattServiceUUID
+};
+
+// Every known 16-bit UUID, most looked up first
+static const gattUUIDGroup_t gattUUIDGroups[] =
+{
+  { GATT_PRIMARY_SERVICE_UUID, sizeof( gattDeclRecs ) / sizeof( gattDeclRecs[0] ), gattDeclRecs },
+  { GATT_CHAR_EXT_PROPS_UUID, sizeof( gattDescRecs ) / sizeof( gattDescRecs[0] ), gattDescRecs },
+  { DEVICE_NAME_UUID, sizeof( gattCharRecs ) / sizeof( gattCharRecs[0] ), gattCharRecs },
+  { GAP_SERVICE_UUID, sizeof( gattServiceRecs ) / sizeof( gattServiceRecs[0] ), gattServiceRecs }
+};
+
 /*********************************************************************
  * LOCAL FUNCTIONS
  */
@@ -236,104 +295,18 @@ const uint8 *GATT_FindUUIDRec( const uint8 *pUUID, uint8 len )
   {
     // 16-bit UUID
     uint16 uuid = BUILD_UINT16( pUUID[0], pUUID[1] );
-    switch ( uuid )
-    {
-      /*** GATT Services ***/
-
-      case GAP_SERVICE_UUID:
-        pRec = gapServiceUUID;
-        break;
-
-      case GATT_SERVICE_UUID:
-        pRec = gattServiceUUID;
-        break;
-
-      /*** GATT Declarations ***/
-
-      case GATT_PRIMARY_SERVICE_UUID:
-        pRec = primaryServiceUUID;
-        break;
-
-      case GATT_SECONDARY_SERVICE_UUID:
-        pRec = secondaryServiceUUID;
-        break;
-
-      case GATT_INCLUDE_UUID:
-        pRec = includeUUID;
-        break;
-
-      case GATT_CHARACTER_UUID:
-        pRec = characterUUID;
-        break;
-
-      /*** GATT Descriptors ***/
+    uint8 i;
 
-      case GATT_CHAR_EXT_PROPS_UUID:
-        pRec = charExtPropsUUID;
-        break;
-
-      case GATT_CHAR_USER_DESC_UUID:
-        pRec = charUserDescUUID;
-        break;
-
-      case GATT_CLIENT_CHAR_CFG_UUID:
-        pRec = clientCharCfgUUID;
-        break;
-
-      case GATT_SERV_CHAR_CFG_UUID:
-        pRec = servCharCfgUUID;
-        break;
-
-      case GATT_CHAR_FORMAT_UUID:
-        pRec = charFormatUUID;
-        break;
-
-      case GATT_CHAR_AGG_FORMAT_UUID:
-        pRec = charAggFormatUUID;
-        break;
-
-      case GATT_VALID_RANGE_UUID:
-        pRec = validRangeUUID;
-        break;
-
-      case GATT_EXT_REPORT_REF_UUID:
-        pRec = extReportRefUUID;
-        break;
-
-      case GATT_REPORT_REF_UUID:
-        pRec = reportRefUUID;
-        break;
-
-      /*** GATT Characteristics ***/
-
-      case DEVICE_NAME_UUID:
-        pRec = deviceNameUUID;
-        break;
-
-      case APPEARANCE_UUID:
-        pRec = appearanceUUID;
-        break;
-
-      case RECONNECT_ADDR_UUID:
-        pRec = reconnectAddrUUID;
-        break;
-
-      case PERI_PRIVACY_FLAG_UUID:
-        pRec = periPrivacyFlagUUID;
-        break;
-
-      case PERI_CONN_PARAM_UUID:
-        pRec = periConnParamUUID;
-        break;
-
-      case SERVICE_CHANGED_UUID:
-        pRec = serviceChangedUUID;
-        break;
-
-      /*** GATT Units ***/
+    for ( i = 0; i < sizeof( gattUUIDGroups ) / sizeof( gattUUIDGroups[0] ); i++ )
+    {
+      // Wraps around for UUIDs below the group
+      uint16 idx = uuid - gattUUIDGroups[i].base;
 
-      default:
+      if ( idx < gattUUIDGroups[i].numRecs )
+      {
+        pRec = gattUUIDGroups[i].pRecs[idx];
         break;
+      }
     }
   }
   else if ( len == ATT_UUID_SIZE )
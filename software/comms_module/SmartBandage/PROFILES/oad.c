@@ -62,6 +62,9 @@
  */
 #define ERROR_BLOCK       0xFFFF
 
+// Define OAD_VERIFY_READBACK to read a complete image back from flash and
+// check it against the CRC calculated while it was being written.
+
 /*********************************************************************
  * MACROS
  */
@@ -79,13 +82,16 @@ static const uint8_t oadServUUID[ATT_UUID_SIZE] =
 static const uint8_t oadCharUUID[OAD_CHAR_CNT][ATT_UUID_SIZE] =
 {
  // OAD Image Identify UUID
- TI_BASE_UUID_128(OAD_IMG_IDENTIFY_UUID),
+ { TI_BASE_UUID_128(OAD_IMG_IDENTIFY_UUID) },
 
  // OAD Image Block Request/Response UUID
- TI_BASE_UUID_128(OAD_IMG_BLOCK_UUID),
+ { TI_BASE_UUID_128(OAD_IMG_BLOCK_UUID) },
    
  // OAD Image Count UUID
- TI_BASE_UUID_128(OAD_IMG_COUNT_UUID)
+ { TI_BASE_UUID_128(OAD_IMG_COUNT_UUID) },
+
+ // OAD Image Control UUID
+ { TI_BASE_UUID_128(OAD_IMG_CONTROL_UUID) }
 };
 
 /*********************************************************************
@@ -96,7 +102,7 @@ static const uint8_t oadCharUUID[OAD_CHAR_CNT][ATT_UUID_SIZE] =
 static const gattAttrType_t oadService = { ATT_UUID_SIZE, oadServUUID };
 
 // Place holders for the GATT Server App to be able to lookup handles.
-static uint8_t oadCharVals[OAD_CHAR_CNT] = {0, 0 , 1};
+static uint8_t oadCharVals[OAD_CHAR_CNT] = {0, 0 , 1, 0};
 
 // OAD Characteristic Properties
 static uint8_t oadCharProps = GATT_PROP_WRITE_NO_RSP | GATT_PROP_WRITE 
@@ -107,11 +113,13 @@ static uint8_t oadCharCountProps = GATT_PROP_WRITE_NO_RSP | GATT_PROP_WRITE;
 // OAD Client Characteristic Configs
 static gattCharCfg_t *oadImgIdentifyConfig;
 static gattCharCfg_t *oadImgBlockConfig;
+static gattCharCfg_t *oadImgControlConfig;
 
 // OAD Characteristic user descriptions
 static const uint8_t oadImgIdentifyDesc[] = "Img Identify";
 static const uint8_t oadImgBlockDesc[] = "Img Block";
 static const uint8_t oadImgCountDesc[] = "Img Count";
+static const uint8_t oadImgControlDesc[] = "Img Control";
 
 /*********************************************************************
  * Profile Attributes - Table
@@ -213,7 +221,39 @@ static gattAttribute_t oadAttrTbl[] =
         GATT_PERMIT_READ,
         0,
         (uint8_t *)oadImgCountDesc
-      }      
+      },
+
+    // OAD Image Control Characteristic Declaration
+    {
+      { ATT_BT_UUID_SIZE, characterUUID },
+      GATT_PERMIT_READ,
+      0,
+      &oadCharProps
+    },
+
+      // OAD Image Control Characteristic Value
+      {
+        { ATT_UUID_SIZE, oadCharUUID[3] },
+        GATT_PERMIT_WRITE,
+        0,
+        oadCharVals+3
+      },
+
+      // Characteristic configuration
+      {
+        { ATT_BT_UUID_SIZE, clientCharCfgUUID },
+        GATT_PERMIT_READ | GATT_PERMIT_WRITE,
+        0,
+        (uint8_t *)&oadImgControlConfig
+      },
+
+      // OAD Image Control User Description
+      {
+        { ATT_BT_UUID_SIZE, charUserDescUUID },
+        GATT_PERMIT_READ,
+        0,
+        (uint8_t *)oadImgControlDesc
+      }
 };
 
 /*********************************************************************
@@ -226,10 +266,61 @@ static uint16_t oadBlkNum = 0, oadBlkTot = 0xFFFF;
 static uint32_t imageAddress;
 static uint16_t imagePage;
 
+// Windowed transfer state. oadWinBlks is 0 while transferring one block per
+// request.
+static uint8_t oadWinReq = 0;       // Max window requested for the next image
+static uint16_t oadWinConn = INVALID_CONNHANDLE; // Link that made the request
+static uint8_t oadWinBlks = 0;      // Blocks per window
+static uint8_t oadWinBlksPerWrite;  // Blocks carried by each Image Block write
+static uint16_t oadWinStart;        // First block of the outstanding window
+static uint32_t oadWinRcvd;         // Bitmap of window blocks received
+static uint32_t oadErasedAddr;      // Image area is erased below this address
+static uint8_t oadWinBuf[OAD_BURST_SIZE];
+
 #ifndef FEATURE_OAD_ONCHIP
 // Used to keep track of images written.
 static uint8_t flagRecord = 0;
+
+// CRC of the image blocks written so far.
+static uint16_t oadImageCrc;
 #endif //FEATURE_OAD_ONCHIP
+
+// CRC16 (poly 0x1021) of each byte value.
+static const uint16_t oadCrcTable[256] =
+{
+  0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+  0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+  0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+  0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+  0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+  0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+  0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+  0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+  0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+  0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+  0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+  0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+  0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+  0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+  0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+  0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+  0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+  0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+  0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+  0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+  0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+  0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+  0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+  0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+  0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+  0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+  0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+  0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+  0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+  0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+  0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+  0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
+};
 /*********************************************************************
  * LOCAL FUNCTIONS
  */
@@ -244,14 +335,23 @@ static bStatus_t oadWriteAttrCB(uint16_t connHandle, gattAttribute_t *pAttr,
 
 static void OAD_getNextBlockReq(uint16_t connHandle, uint16_t blkNum);
 static void OAD_rejectImage(uint16_t connHandle, img_hdr_t *pImgHdr);
+static void OAD_imageComplete(uint16_t connHandle);
+static void OAD_openWindow(uint16_t connHandle, uint8_t winReq);
+static void OAD_grantWindow(uint16_t connHandle, uint16_t blkNum);
+static void OAD_sendCredit(uint16_t connHandle);
+static void OAD_imgWindowWrite(uint16_t connHandle, uint8_t *pValue, uint16_t len);
+static void OAD_eraseThrough(uint32_t endAddr);
+static void OAD_sendControl(uint16_t connHandle, uint8_t *pData, uint8_t len);
 
 
 
 #if !defined FEATURE_OAD_ONCHIP
 static uint8_t CheckImageDownloadCount(void);
 static uint8_t checkDL(void);
+static void OAD_crcImage(uint32_t offset, uint8_t *pBuf, uint16_t len);
+#if defined OAD_VERIFY_READBACK
 static uint16_t crcCalcDL(void);
-static uint16_t crc16(uint16_t crc, uint8_t val);
+#endif // OAD_VERIFY_READBACK
 #endif  // !FEATURE_OAD_ONCHIP
 
 /*********************************************************************
@@ -295,10 +395,24 @@ bStatus_t OAD_addService(void)
     
     return (bleMemAllocError);
   }
+
+  // Allocate Client Characteristic Configuration table.
+  oadImgControlConfig = (gattCharCfg_t *)ICall_malloc(sizeof(gattCharCfg_t) *
+                                                      linkDBNumConns);
+
+  if (oadImgControlConfig == NULL)
+  {
+    // Free already allocated data.
+    ICall_free(oadImgIdentifyConfig);
+    ICall_free(oadImgBlockConfig);
+
+    return (bleMemAllocError);
+  }
   
   // Initialize Client Characteristic Configuration attributes.
   GATTServApp_InitCharCfg(INVALID_CONNHANDLE, oadImgIdentifyConfig);
   GATTServApp_InitCharCfg(INVALID_CONNHANDLE, oadImgBlockConfig);
+  GATTServApp_InitCharCfg(INVALID_CONNHANDLE, oadImgControlConfig);
 
   return GATTServApp_RegisterService(oadAttrTbl, GATT_NUM_ATTRS(oadAttrTbl), 
                                      GATT_MAX_ENCRYPT_KEY_SIZE, &oadCBs);
@@ -392,7 +506,7 @@ static bStatus_t oadWriteAttrCB(uint16_t connHandle, gattAttribute_t *pAttr,
       // Notify Application
       if (oadTargetWriteCB != NULL)
       {
-        (*oadTargetWriteCB)(OAD_WRITE_IDENTIFY_REQ, connHandle, pValue);
+        (*oadTargetWriteCB)(OAD_WRITE_IDENTIFY_REQ, connHandle, pValue, len);
       }
     }
     else if (!memcmp(pAttr->type.uuid, oadCharUUID[OAD_CHAR_IMG_BLOCK], 
@@ -401,11 +515,17 @@ static bStatus_t oadWriteAttrCB(uint16_t connHandle, gattAttribute_t *pAttr,
       /* OAD is ongoing.  
        * the OAD manager has sent a block from the new image. 
        */
-      
+
+      // A block number followed by one or more whole blocks.
+      if (len < 2 + OAD_BLOCK_SIZE || len > OAD_PACKET_MAX_SIZE ||
+          (len - 2) % OAD_BLOCK_SIZE != 0)
+      {
+        status = ATT_ERR_INVALID_VALUE_SIZE;
+      }
       // Notify the application.
-      if (oadTargetWriteCB != NULL)
+      else if (oadTargetWriteCB != NULL)
       {
-        (*oadTargetWriteCB)(OAD_WRITE_BLOCK_REQ, connHandle, pValue);
+        (*oadTargetWriteCB)(OAD_WRITE_BLOCK_REQ, connHandle, pValue, len);
       }
     }
     else if (!memcmp(pAttr->type.uuid, oadCharUUID[OAD_CHAR_IMG_COUNT],
@@ -426,6 +546,19 @@ static bStatus_t oadWriteAttrCB(uint16_t connHandle, gattAttribute_t *pAttr,
       }
 #endif // !FEATURE_OAD_ONCHIP
     }
+    else if (!memcmp(pAttr->type.uuid, oadCharUUID[OAD_CHAR_IMG_CONTROL],
+                     ATT_UUID_SIZE))
+    {
+      if (len != 2)
+      {
+        status = ATT_ERR_INVALID_VALUE_SIZE;
+      }
+      // Notify the application.
+      else if (oadTargetWriteCB != NULL)
+      {
+        (*oadTargetWriteCB)(OAD_WRITE_CONTROL_REQ, connHandle, pValue, len);
+      }
+    }
     else
     {
       status = ATT_ERR_ATTR_NOT_FOUND; // Should never get here!
@@ -451,6 +584,10 @@ void OAD_imgIdentifyWrite(uint16_t connHandle, uint8_t *pValue)
 {
   img_hdr_t ImgHdr;
   uint8_t hdrOffset = 0;
+  uint8_t winReq = oadWinReq;
+
+  // A windowed request applies to this image only; the next one must ask again.
+  oadWinReq = 0;
   
   if (OADTarget_hasExternalFlash())
   {
@@ -467,6 +604,10 @@ void OAD_imgIdentifyWrite(uint16_t connHandle, uint8_t *pValue)
   oadBlkTot = BUILD_UINT16(pValue[hdrOffset + 2], pValue[hdrOffset + 3]) / 
               (OAD_BLOCK_SIZE / HAL_FLASH_WORD_SIZE);
   oadBlkNum = 0;
+  oadWinBlks = 0;
+#if !defined FEATURE_OAD_ONCHIP
+  oadImageCrc = 0;
+#endif // !FEATURE_OAD_ONCHIP
 
   /* Requirements to begin OAD:
    * 1) LSB of image version cannot be the same, this would imply a code overlap
@@ -485,8 +626,18 @@ void OAD_imgIdentifyWrite(uint16_t connHandle, uint8_t *pValue)
     // Open the target interface
     OADTarget_open();
 
-    // Image accepted, request block 0.
-    OAD_getNextBlockReq(connHandle, 0);
+    oadErasedAddr = imageAddress;
+
+    if (winReq)
+    {
+      // Image accepted, grant the first window.
+      OAD_openWindow(connHandle, winReq);
+    }
+    else
+    {
+      // Image accepted, request block 0.
+      OAD_getNextBlockReq(connHandle, 0);
+    }
   }
   else
   {
@@ -503,13 +654,27 @@ void OAD_imgIdentifyWrite(uint16_t connHandle, uint8_t *pValue)
  *
  * @param   connHandle - connection message was received on
  * @param   pValue - pointer to data to be written
+ * @param   len - length of pValue
  *
  * @return  none
  */
-void OAD_imgBlockWrite(uint16_t connHandle, uint8_t *pValue)
+void OAD_imgBlockWrite(uint16_t connHandle, uint8_t *pValue, uint16_t len)
 {
   // N.B. This must be left volatile.
   volatile uint16_t blkNum = BUILD_UINT16(pValue[0], pValue[1]);
+
+  if (oadWinBlks)
+  {
+    OAD_imgWindowWrite(connHandle, pValue, len);
+    return;
+  }
+
+  // One block per request; ask for the block again if the write is malformed.
+  if (len != 2 + OAD_BLOCK_SIZE)
+  {
+    OAD_getNextBlockReq(connHandle, oadBlkNum);
+    return;
+  }
   
   // Check that this is the expected block number.
   if (oadBlkNum == blkNum)
@@ -527,6 +692,10 @@ void OAD_imgBlockWrite(uint16_t connHandle, uint8_t *pValue)
     OADTarget_writeFlash(imagePage, (blkNum * OAD_BLOCK_SIZE), pValue+2, 
                          OAD_BLOCK_SIZE);
     
+#if !defined FEATURE_OAD_ONCHIP
+    OAD_crcImage(blkNum * OAD_BLOCK_SIZE, pValue+2, OAD_BLOCK_SIZE);
+#endif // !FEATURE_OAD_ONCHIP
+
     // Increment received block count.
     oadBlkNum++;
   }
@@ -540,49 +709,358 @@ void OAD_imgBlockWrite(uint16_t connHandle, uint8_t *pValue)
   // Check if the OAD Image is complete.
   if (oadBlkNum == oadBlkTot)
   {
+    OAD_imageComplete(connHandle);
+  }
+  else
+  {
+    // Request the next OAD Image block.
+    OAD_getNextBlockReq(connHandle, oadBlkNum);
+  }
+}
+
+/*********************************************************************
+ * @fn      OAD_imgControlWrite
+ *
+ * @brief   Process the Image Control Write.
+ *
+ * @param   connHandle - connection message was received on
+ * @param   pValue - pointer to data to be written
+ *
+ * @return  none
+ */
+void OAD_imgControlWrite(uint16_t connHandle, uint8_t *pValue)
+{
+  switch (pValue[0])
+  {
+    case OAD_CTRL_WINDOWED:
+      // Applies to the next image identified.
+      oadWinReq = pValue[1];
+      oadWinConn = connHandle;
+      break;
+
+    default:
+      break;
+  }
+}
+
+/*********************************************************************
+ * @fn      OAD_linkTerminated
+ *
+ * @brief   Forget the windowed transfer requested or running on a link
+ *          that has closed, so the next OAD manager starts in the legacy
+ *          protocol unless it asks for windows itself.
+ *
+ * @param   connHandle - connection that closed, INVALID_CONNHANDLE for any
+ *
+ * @return  none
+ */
+void OAD_linkTerminated(uint16_t connHandle)
+{
+  if (connHandle == oadWinConn || connHandle == INVALID_CONNHANDLE)
+  {
+    oadWinReq = 0;
+    oadWinBlks = 0;
+    oadWinConn = INVALID_CONNHANDLE;
+  }
+}
+
+/*********************************************************************
+ * @fn      OAD_imageComplete
+ *
+ * @brief   Verify a fully received image and hand it over.
+ *
+ * @param   connHandle - connection message was received on
+ *
+ * @return  none
+ */
+static void OAD_imageComplete(uint16_t connHandle)
+{
+  oadWinBlks = 0;
+
 #if FEATURE_OAD_ONCHIP
-    // Handle CRC verification in BIM.
-    OADTarget_systemReset();
+  // Handle CRC verification in BIM.
+  OADTarget_systemReset();
 #else // !FEATURE_OAD_ONCHIP
-    // Run CRC check on new image.
-    if (checkDL())
+  // Run CRC check on new image.
+  if (checkDL())
+  {
+    // Store the flag of the downloaded image.
+    flagRecord |= getImageFlag();
+    
+    // Store the image information.
+    saveImageInfo();
+    
+    // Check if all expected images have been downloaded.
+    if (CheckImageDownloadCount())
     {
-      // Store the flag of the downloaded image.
-      flagRecord |= getImageFlag();
-      
-      // Store the image information.
-      saveImageInfo();
-      
-      // Check if all expected images have been downloaded.
-      if (CheckImageDownloadCount())
+      // If one image is a network processor image, inform the application now 
+      // so that it can take action on that image.
+      // Note: this callback is not being sent from the context of an 
+      // interrupt. It is ok to take any action here.
+      if (flagRecord & OAD_IMG_NP_FLAG)
       {
-        // If one image is a network processor image, inform the application now 
-        // so that it can take action on that image.
-        // Note: this callback is not being sent from the context of an 
-        // interrupt. It is ok to take any action here.
-        if (flagRecord & OAD_IMG_NP_FLAG)
-        {
-          (*oadTargetWriteCB)(OAD_IMAGE_COMPLETE, connHandle, NULL);
-        }
-          
-        // If one image is an application or stack image, perform the reset 
-        // here.
-        if (flagRecord & (OAD_IMG_APP_FLAG|OAD_IMG_STACK_FLAG))
-        {
-          OADTarget_systemReset();
-        }
+        (*oadTargetWriteCB)(OAD_IMAGE_COMPLETE, connHandle, NULL, 0);
+      }
         
-        flagRecord = 0;
+      // If one image is an application or stack image, perform the reset 
+      // here.
+      if (flagRecord & (OAD_IMG_APP_FLAG|OAD_IMG_STACK_FLAG))
+      {
+        OADTarget_systemReset();
       }
+      
+      flagRecord = 0;
     }
+  }
 #endif //FEATURE_OAD_ONCHIP
-    
-      OADTarget_close();
+
+  OADTarget_close();
+}
+
+/*********************************************************************
+ * @fn      OAD_openWindow
+ *
+ * @brief   Size the window for the connection and grant the first one.
+ *          Blocks per write follow from the MTU; the window is a whole
+ *          number of writes and never more than one burst.
+ *
+ * @param   connHandle - connection message was received on
+ * @param   winReq - most blocks per window the OAD manager asked for
+ *
+ * @return  none
+ */
+static void OAD_openWindow(uint16_t connHandle, uint8_t winReq)
+{
+  uint16_t mtu = ATT_GetMTU(connHandle);
+  uint8_t blks = (winReq < OAD_WINDOW_BLOCKS) ? winReq : OAD_WINDOW_BLOCKS;
+
+  // ATT write header (3) and block number (2) precede the blocks.
+  oadWinBlksPerWrite = (mtu >= 3 + 2 + OAD_BLOCK_SIZE) ?
+                       (mtu - 3 - 2) / OAD_BLOCK_SIZE : 1;
+
+  if (oadWinBlksPerWrite > blks)
+  {
+    oadWinBlksPerWrite = blks;
   }
-  else
+
+  oadWinBlks = blks - (blks % oadWinBlksPerWrite);
+  oadWinConn = connHandle;
+
+  OAD_grantWindow(connHandle, 0);
+
+  // Erase the first page while the first window is in flight.
+  OAD_eraseThrough(imageAddress + HAL_FLASH_PAGE_SIZE);
+}
+
+/*********************************************************************
+ * @fn      OAD_grantWindow
+ *
+ * @brief   Start the window at blkNum and credit it to the OAD manager.
+ *
+ * @param   connHandle - connection message was received on
+ * @param   blkNum - first block of the window
+ *
+ * @return  none
+ */
+static void OAD_grantWindow(uint16_t connHandle, uint16_t blkNum)
+{
+  oadWinStart = blkNum;
+  oadWinRcvd = 0;
+
+  OAD_sendCredit(connHandle);
+}
+
+/*********************************************************************
+ * @fn      OAD_sendCredit
+ *
+ * @brief   Credit the outstanding window to the OAD manager.
+ *
+ * @param   connHandle - connection message was received on
+ *
+ * @return  none
+ */
+static void OAD_sendCredit(uint16_t connHandle)
+{
+  uint8_t credit[5];
+  uint16_t blkNum = oadWinStart;
+  uint16_t left = oadBlkTot - blkNum;
+
+  credit[0] = OAD_CTRL_CREDIT;
+  credit[1] = LO_UINT16(blkNum);
+  credit[2] = HI_UINT16(blkNum);
+  credit[3] = (left < oadWinBlks) ? left : oadWinBlks;
+  credit[4] = oadWinBlksPerWrite;
+
+  OAD_sendControl(connHandle, credit, sizeof(credit));
+}
+
+/*********************************************************************
+ * @fn      OAD_imgWindowWrite
+ *
+ * @brief   Buffer the blocks of a windowed Image Block write. A complete
+ *          window is programmed in one burst after the next window has
+ *          been granted, so the OAD manager streams while flash is busy.
+ *          Blocks missing when the last write of a window arrives are
+ *          requested again.
+ *
+ *          The target never times out, so a lost write is recovered by
+ *          the OAD manager writing again once it has waited for a credit
+ *          or NAK in vain: a repeat of a write already received gets the
+ *          blocks still missing NAKed, and a write from a window already
+ *          committed gets the outstanding window credited again.
+ *
+ * @param   connHandle - connection message was received on
+ * @param   pValue - pointer to data to be written
+ * @param   len - length of pValue
+ *
+ * @return  none
+ */
+static void OAD_imgWindowWrite(uint16_t connHandle, uint8_t *pValue, uint16_t len)
+{
+  uint16_t blkNum = BUILD_UINT16(pValue[0], pValue[1]);
+  uint16_t left = oadBlkTot - oadWinStart;
+  uint8_t winCnt = (left < oadWinBlks) ? left : oadWinBlks;
+  uint16_t idx = blkNum - oadWinStart;
+  uint32_t full = (1UL << winCnt) - 1;
+  uint32_t blks;
+  uint8_t cnt, repeat;
+
+  if (blkNum < oadWinStart)
   {
-    // Request the next OAD Image block.
-    OAD_getNextBlockReq(connHandle, oadBlkNum);
+    OAD_sendCredit(connHandle);
+    return;
+  }
+
+  // Ignore blocks outside the window.
+  if (idx >= winCnt || (idx % oadWinBlksPerWrite) != 0)
+  {
+    return;
+  }
+
+  cnt = (winCnt - idx < oadWinBlksPerWrite) ? winCnt - idx : oadWinBlksPerWrite;
+
+  // A write carries exactly the blocks from its first to the next write's.
+  if (len != 2 + cnt * OAD_BLOCK_SIZE)
+  {
+    return;
+  }
+
+  blks = ((1UL << cnt) - 1) << idx;
+  repeat = (oadWinRcvd & blks) == blks;
+
+  memcpy(oadWinBuf + (idx * OAD_BLOCK_SIZE), pValue + 2, cnt * OAD_BLOCK_SIZE);
+  oadWinRcvd |= blks;
+
+  if (oadWinRcvd == full)
+  {
+    uint32_t offset = (uint32_t)oadWinStart * OAD_BLOCK_SIZE;
+    uint16_t len = winCnt * OAD_BLOCK_SIZE;
+
+    oadBlkNum = oadWinStart + winCnt;
+
+    // Let the OAD manager send the next window while this one is written.
+    // Its writes are only processed once this returns, so one buffer does.
+    if (oadBlkNum < oadBlkTot)
+    {
+      OAD_grantWindow(connHandle, oadBlkNum);
+    }
+
+    OAD_eraseThrough(imageAddress + offset + len);
+    OADTarget_writeFlash(imagePage, offset, oadWinBuf, len);
+#if !defined FEATURE_OAD_ONCHIP
+    OAD_crcImage(offset, oadWinBuf, len);
+#endif // !FEATURE_OAD_ONCHIP
+
+    if (oadBlkNum == oadBlkTot)
+    {
+      OAD_imageComplete(connHandle);
+    }
+    else
+    {
+      // Keep a page erased ahead of the write pointer.
+      OAD_eraseThrough(imageAddress + offset + len + HAL_FLASH_PAGE_SIZE);
+    }
+  }
+  else if (idx + cnt == winCnt || repeat)
+  {
+    // The window has ended with gaps, ask for just the missing blocks.
+    uint8_t nak[5];
+    uint16_t missing = (uint16_t)(full & ~oadWinRcvd);
+
+    nak[0] = OAD_CTRL_NAK;
+    nak[1] = LO_UINT16(oadWinStart);
+    nak[2] = HI_UINT16(oadWinStart);
+    nak[3] = LO_UINT16(missing);
+    nak[4] = HI_UINT16(missing);
+
+    OAD_sendControl(connHandle, nak, sizeof(nak));
+  }
+}
+
+/*********************************************************************
+ * @fn      OAD_eraseThrough
+ *
+ * @brief   Erase image pages up to endAddr, skipping those already erased.
+ *
+ * @param   endAddr - first address that does not need to be erased
+ *
+ * @return  none
+ */
+static void OAD_eraseThrough(uint32_t endAddr)
+{
+  uint32_t imageEnd = imageAddress + (uint32_t)oadBlkTot * OAD_BLOCK_SIZE;
+
+  if (endAddr > imageEnd)
+  {
+    endAddr = imageEnd;
+  }
+
+  while (oadErasedAddr < endAddr)
+  {
+    OADTarget_eraseFlash(oadErasedAddr / HAL_FLASH_PAGE_SIZE);
+    oadErasedAddr += HAL_FLASH_PAGE_SIZE;
+  }
+}
+
+/*********************************************************************
+ * @fn      OAD_sendControl
+ *
+ * @brief   Notify the OAD manager on the Image Control characteristic.
+ *
+ * @param   connHandle - connection message was received on
+ * @param   pData - notification payload
+ * @param   len - payload length
+ *
+ * @return  None
+ */
+static void OAD_sendControl(uint16_t connHandle, uint8_t *pData, uint8_t len)
+{
+  uint16_t value = GATTServApp_ReadCharCfg(connHandle, oadImgControlConfig);
+
+  // If notifications enabled
+  if (value & GATT_CLIENT_CFG_NOTIFY)
+  {
+    attHandleValueNoti_t noti;
+
+    noti.pValue = GATT_bm_alloc(connHandle, ATT_HANDLE_VALUE_NOTI, len, NULL);
+
+    if (noti.pValue != NULL)
+    {
+      gattAttribute_t *pAttr;
+
+      pAttr= GATTServApp_FindAttr(oadAttrTbl, GATT_NUM_ATTRS(oadAttrTbl),
+                                  oadCharVals+OAD_CHAR_IMG_CONTROL);
+
+      noti.handle = pAttr->handle;
+      noti.len = len;
+
+      memcpy(noti.pValue, pData, len);
+
+      if (GATT_Notification(connHandle, &noti, FALSE) != SUCCESS)
+      {
+        GATT_bm_free((gattMsg_t *)&noti, ATT_HANDLE_VALUE_NOTI);
+      }
+    }
   }
 }
 
@@ -679,12 +1157,61 @@ static void OAD_rejectImage(uint16_t connHandle, img_hdr_t *pImgHdr)
   OADTarget_close();
 }
 
+/*********************************************************************
+ * @fn      OAD_crc16
+ *
+ * @brief   Continue the image CRC16 over a buffer. The result matches
+ *          running the boot image manager's bitwise CRC over the same
+ *          bytes followed by the two zero bytes it appends.
+ *
+ * @param   crc  - CRC calculated so far, 0 to start
+ * @param   pBuf - data to add to the CRC
+ * @param   len  - length of pBuf
+ *
+ * @return  The updated CRC.
+ */
+uint16_t OAD_crc16(uint16_t crc, const uint8_t *pBuf, uint16_t len)
+{
+  while (len--)
+  {
+    crc = (crc << 8) ^ oadCrcTable[(crc >> 8) ^ *pBuf++];
+  }
+
+  return crc;
+}
+
 #if !defined FEATURE_OAD_ONCHIP
 
+/*********************************************************************
+ * @fn      OAD_crcImage
+ *
+ * @brief   Add blocks just written to the image CRC. Blocks must be
+ *          added in order. The CRC and its shadow at the start of the
+ *          image are not covered.
+ *
+ * @param   offset - offset of pBuf into the image
+ * @param   pBuf   - blocks written
+ * @param   len    - length of pBuf
+ *
+ * @return  None.
+ */
+static void OAD_crcImage(uint32_t offset, uint8_t *pBuf, uint16_t len)
+{
+  if (offset < HAL_FLASH_WORD_SIZE)
+  {
+    pBuf += HAL_FLASH_WORD_SIZE - offset;
+    len -= HAL_FLASH_WORD_SIZE - offset;
+  }
+
+  oadImageCrc = OAD_crc16(oadImageCrc, pBuf, len);
+}
+
+#if defined OAD_VERIFY_READBACK
 /*********************************************************************
  * @fn      crcCalcDL
  *
- * @brief   Run the CRC16 Polynomial calculation over the DL image.
+ * @brief   Run the CRC16 Polynomial calculation over the DL image as
+ *          read back from flash, in one sequential pass.
  *
  * @param   None
  *
@@ -693,50 +1220,25 @@ static void OAD_rejectImage(uint16_t connHandle, img_hdr_t *pImgHdr)
 static uint16_t crcCalcDL(void)
 {
   uint16_t imageCRC = 0;
-  uint8_t page;
-  uint8_t lastPage = oadBlkTot / OAD_BLOCKS_PER_PAGE;
-  
-  // Remainder of bytes not divisible by the size of a flash page in bytes.
-  uint16_t numRemBytes = (oadBlkTot - (lastPage * OAD_BLOCKS_PER_PAGE)) 
-                         * OAD_BLOCK_SIZE;
-
-  // Set last page to end of OAD image address range.
-  lastPage += imagePage;
-
-  // Read over downloaded pages
-  for (page = imagePage; page <= lastPage; page++)
-  {
-    uint16_t offset;
-	
-    // Read over all flash words in a page, excluding the CRC section of the
-    // first page and all bytes after remainder bytes on the last page.
-    for (offset = (page == imagePage) ? HAL_FLASH_WORD_SIZE : 0;
-         offset < HAL_FLASH_PAGE_SIZE && 
-         (page < lastPage || offset < numRemBytes); 
-         offset += HAL_FLASH_WORD_SIZE)
-    {
-      uint8_t buf[HAL_FLASH_WORD_SIZE];
-      uint8_t idx;
-      
-      // Read a word from flash.
-      OADTarget_readFlash(page, offset, buf, HAL_FLASH_WORD_SIZE);
-	  
-      // Calculate CRC of word, byte by byte.
-      for (idx = 0; idx < HAL_FLASH_WORD_SIZE; idx++)
-      {
-        imageCRC = crc16(imageCRC, buf[idx]);
-      }
-    }
+  uint32_t offset = HAL_FLASH_WORD_SIZE;
+  uint32_t end = (uint32_t)oadBlkTot * OAD_BLOCK_SIZE;
+
+  // The transfer is over, so the window buffer is free to read into.
+  while (offset < end)
+  {
+    uint16_t len = (end - offset < OAD_BURST_SIZE) ? end - offset : 
+                   OAD_BURST_SIZE;
+
+    OADTarget_readFlash(imagePage, offset, oadWinBuf, len);
+    imageCRC = OAD_crc16(imageCRC, oadWinBuf, len);
+
+    offset += len;
   }
-      
-  // IAR note explains that poly must be run with value zero for each byte of 
-  // the crc.
-  imageCRC = crc16(imageCRC, 0);
-  imageCRC = crc16(imageCRC, 0);
-  
+
   // Return the CRC calculated over the image.
-  return imageCRC;      
+  return imageCRC;
 }
+#endif // OAD_VERIFY_READBACK
 
 /*********************************************************************
  * @fn      checkDL
@@ -758,8 +1260,16 @@ static uint8_t checkDL(void)
     return FALSE;
   }
 
-  // Calculate CRC of downloaded image.
-  crc[1] = crcCalcDL();
+  // The CRC was calculated as the image was written.
+  crc[1] = oadImageCrc;
+
+#if defined OAD_VERIFY_READBACK
+  // Check that flash holds what was written.
+  if (crcCalcDL() != crc[1])
+  {
+    return FALSE;
+  }
+#endif // OAD_VERIFY_READBACK
  
   if (crc[1] == crc[0])
   {
@@ -770,42 +1280,6 @@ static uint8_t checkDL(void)
   return (crc[0] == crc[1]);
 }
 
-/*********************************************************************
- * @fn          crc16
- *
- * @brief       Run the CRC16 Polynomial calculation over the byte parameter.
- *
- * @param       crc - Running CRC calculated so far.
- * @param       val - Value on which to run the CRC16.
- *
- * @return      crc - Updated for the run.
- */
-static uint16_t crc16(uint16_t crc, uint8_t val)
-{
-  const uint16_t poly = 0x1021;
-  uint8_t cnt;
-
-  for (cnt = 0; cnt < 8; cnt++, val <<= 1)
-  {
-    uint8_t msb = (crc & 0x8000) ? 1 : 0;
-
-    crc <<= 1;
-    
-    if (val & 0x80)
-    {
-      crc |= 0x0001;
-    }
-    
-    if (msb)
-    {
-      crc ^= poly;
-    }
-  }
-
-  return crc;
-}
-
-
 /*********************************************************************
  * @fn          CheckImageDownloadCount
  *
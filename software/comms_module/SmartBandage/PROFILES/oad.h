@@ -68,9 +68,10 @@ extern "C"
  * Profile Callbacks
  */
 
-// Callback when a characteristic value has changed
+// Callback when a characteristic value has changed. Image Block writes can be
+// up to OAD_PACKET_MAX_SIZE bytes, so len bytes of pData must be copied.
 typedef void (*oadWriteCB_t)(uint8_t event, uint16_t connHandle, 
-                             uint8_t *pData);
+                             uint8_t *pData, uint16_t len);
 
 typedef struct
 {
@@ -135,14 +136,56 @@ extern void OAD_imgIdentifyWrite(uint16 connHandle, uint8 *pValue);
 /*********************************************************************
  * @fn      OAD_imgBlockWrite
  *
- * @brief   Process the Image Block Write.
+ * @brief   Process the Image Block Write. In windowed mode a write carries
+ *          as many consecutive blocks as the last credit allowed.
  *
  * @param   connHandle - connection message was received on
  * @param   pValue     - pointer to data to be written
+ * @param   len        - length of pValue
  *
  * @return  None.
  */
-extern void OAD_imgBlockWrite(uint16 connHandle, uint8 *pValue);
+extern void OAD_imgBlockWrite(uint16 connHandle, uint8 *pValue, uint16 len);
+
+/*********************************************************************
+ * @fn      OAD_imgControlWrite
+ *
+ * @brief   Process the Image Control Write. Selects the transfer mode
+ *          for the next image identified.
+ *
+ * @param   connHandle - connection message was received on
+ * @param   pValue     - pointer to data to be written
+ *
+ * @return  None.
+ */
+extern void OAD_imgControlWrite(uint16 connHandle, uint8 *pValue);
+
+/*********************************************************************
+ * @fn      OAD_linkTerminated
+ *
+ * @brief   Call when a connection closes. A windowed transfer requested
+ *          or running on it is forgotten.
+ *
+ * @param   connHandle - connection that closed, INVALID_CONNHANDLE for any
+ *
+ * @return  None.
+ */
+extern void OAD_linkTerminated(uint16 connHandle);
+
+/*********************************************************************
+ * @fn      OAD_crc16
+ *
+ * @brief   Continue the image CRC16 over a buffer. The result matches
+ *          running the boot image manager's bitwise CRC over the same
+ *          bytes followed by the two zero bytes it appends.
+ *
+ * @param   crc  - CRC calculated so far, 0 to start
+ * @param   pBuf - data to add to the CRC
+ * @param   len  - length of pBuf
+ *
+ * @return  The updated CRC.
+ */
+extern uint16 OAD_crc16(uint16 crc, const uint8 *pBuf, uint16 len);
 
 /*********************************************************************
 *********************************************************************/
@@ -60,6 +60,7 @@ extern "C"
 #define OAD_IMG_IDENTIFY_UUID  0xFFC1
 #define OAD_IMG_BLOCK_UUID     0xFFC2
 #define OAD_IMG_COUNT_UUID     0xFFC3
+#define OAD_IMG_CONTROL_UUID   0xFFC4
 
 #define OAD_RESET_SERVICE_UUID 0xFFD0
 #define OAD_RESET_CHAR_UUID    0xFFD1
@@ -71,12 +72,13 @@ extern "C"
 // shadow are NOT part of the image header.
 #define OAD_IMG_HDR_OSET       0x0004
 
-#define OAD_CHAR_CNT           3
+#define OAD_CHAR_CNT           4
 
 // OAD Characteristic Indices
 #define OAD_CHAR_IMG_IDENTIFY  0
 #define OAD_CHAR_IMG_BLOCK     1
 #define OAD_CHAR_IMG_COUNT     2
+#define OAD_CHAR_IMG_CONTROL   3
    
 // Image Identification size
 #define OAD_IMG_ID_SIZE        4
@@ -89,10 +91,26 @@ extern "C"
 #define OAD_BLOCKS_PER_PAGE    (HAL_FLASH_PAGE_SIZE / OAD_BLOCK_SIZE)
 #define OAD_BLOCK_MAX          (OAD_BLOCKS_PER_PAGE * OAD_IMG_D_AREA)
 
+// Windowed transfer: blocks are buffered and programmed one external flash
+// program page at a time, so a window never exceeds a page.
+#define OAD_BURST_SIZE         256
+#define OAD_WINDOW_BLOCKS      (OAD_BURST_SIZE / OAD_BLOCK_SIZE)
+
+// Largest Image Block write: block number followed by up to a window of blocks.
+#define OAD_PACKET_MAX_SIZE    (2 + OAD_BURST_SIZE)
+
+// Image Control commands (central to target)
+#define OAD_CTRL_WINDOWED      0x01 // [1] max blocks per window, 0 for one block per request
+
+// Image Control notifications (target to central)
+#define OAD_CTRL_CREDIT        0x01 // [1..2] first block, [3] blocks in window, [4] blocks per write
+#define OAD_CTRL_NAK           0x02 // [1..2] first block of window, [3..4] bitmap of blocks to resend
+
 //Callback Events
 #define OAD_WRITE_IDENTIFY_REQ 0x01
 #define OAD_WRITE_BLOCK_REQ    0x02
 #define OAD_IMAGE_COMPLETE     0x03
+#define OAD_WRITE_CONTROL_REQ  0x04
 
 // Default Image A Page
 #if !defined OAD_IMG_A_PAGE
@@ -225,6 +243,7 @@ typedef struct
   Queue_Elem _elem;
   uint8_t  event;
   uint16_t connHandle;
+  uint16_t len;
   uint8_t  *pData;
 } oadTargetWrite_t;
 #endif //BOOT_LOADER
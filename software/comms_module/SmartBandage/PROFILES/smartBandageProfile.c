@@ -53,6 +53,9 @@
 
 #include "smartBandageProfile.h"
 #include "../Application/Board.h"
+#include "../Application/scheduler.h"
+#include "../Application/energy.h"
+#include "../Application/trace.h"
 
 /*********************************************************************
  * MACROS
@@ -67,6 +70,12 @@
  * TYPEDEFS
  */
 
+// Entry of the attribute map, parallel to the attribute table
+typedef struct {
+	uint8 characteristic;			// SB_NUM_CHARACTERISTICS for the service declaration
+	const SB_PROFILE_ACCESS *access;	// NULL for attributes answered by the GATT server
+} SB_PROFILE_ATTRIBUTE;
+
 /*********************************************************************
  * GLOBAL VARIABLES
  */
@@ -92,6 +101,31 @@ static simpleProfileCBs_t *simpleProfile_AppCBs = NULL;
 static bool _readingsNotificationStateChanged = false;
 uint16_t * getExtraDataPtr(uint8_t dataNo);
 
+static bStatus_t readValue(uint16 connHandle, uint8 c, uint8 *pValue, uint16 *pLen, uint16 offset, uint16 maxLen);
+static bStatus_t readExtraData(uint16 connHandle, uint8 c, uint8 *pValue, uint16 *pLen, uint16 offset, uint16 maxLen);
+static bStatus_t readDescription(uint16 connHandle, uint8 c, uint8 *pValue, uint16 *pLen, uint16 offset, uint16 maxLen);
+static bStatus_t readMemStats(uint16 connHandle, uint8 c, uint8 *pValue, uint16 *pLen, uint16 offset, uint16 maxLen);
+static bStatus_t readWakeStats(uint16 connHandle, uint8 c, uint8 *pValue, uint16 *pLen, uint16 offset, uint16 maxLen);
+static bStatus_t readEnergyStats(uint16 connHandle, uint8 c, uint8 *pValue, uint16 *pLen, uint16 offset, uint16 maxLen);
+static bStatus_t readTrace(uint16 connHandle, uint8 c, uint8 *pValue, uint16 *pLen, uint16 offset, uint16 maxLen);
+static bStatus_t writeValue(uint16 connHandle, uint8 c, gattAttribute_t *pAttr, uint8 *pValue, uint16 len, uint16 offset);
+static bStatus_t writeAcknowledge(uint16 connHandle, uint8 c, gattAttribute_t *pAttr, uint8 *pValue, uint16 len, uint16 offset);
+static bStatus_t writeExtraData(uint16 connHandle, uint8 c, gattAttribute_t *pAttr, uint8 *pValue, uint16 len, uint16 offset);
+static bStatus_t writeConfig(uint16 connHandle, uint8 c, gattAttribute_t *pAttr, uint8 *pValue, uint16 len, uint16 offset);
+static bStatus_t writeTrace(uint16 connHandle, uint8 c, gattAttribute_t *pAttr, uint8 *pValue, uint16 len, uint16 offset);
+
+// Handlers shared by attributes of the same kind
+static CONST SB_PROFILE_ACCESS readOnlyAccess    = { readValue,       NULL };
+static CONST SB_PROFILE_ACCESS readWriteAccess   = { readValue,       writeValue };
+static CONST SB_PROFILE_ACCESS acknowledgeAccess = { readValue,       writeAcknowledge };
+static CONST SB_PROFILE_ACCESS extraDataAccess   = { readExtraData,   writeExtraData };
+static CONST SB_PROFILE_ACCESS configAccess      = { NULL,            writeConfig };
+static CONST SB_PROFILE_ACCESS descriptionAccess = { readDescription, NULL };
+static CONST SB_PROFILE_ACCESS memStatsAccess    = { readMemStats,    NULL };
+static CONST SB_PROFILE_ACCESS wakeStatsAccess   = { readWakeStats,   NULL };
+static CONST SB_PROFILE_ACCESS energyStatsAccess = { readEnergyStats, NULL };
+static CONST SB_PROFILE_ACCESS traceAccess       = { readTrace,       writeTrace };
+
 /*********************************************************************
  * Profile Attributes - variables
  */
@@ -116,7 +150,7 @@ static uint8 charValReadingDataOffsets[SB_BLE_READINGDATAOFFSETS_LEN];
 
 static uint8 charValExtraPtr[SB_BLE_EXTRAPTR_LEN];
 
-static gattCharCfg_t *readingsCharConfig;
+static uint8 charValSnapshot[SB_BLE_SNAPSHOT_LEN];
 
 // Characteristic structs
 static SB_PROFILE_CHARACTERISTIC characteristics[SB_NUM_CHARACTERISTICS] = {
@@ -203,6 +237,7 @@ static SB_PROFILE_CHARACTERISTIC characteristics[SB_NUM_CHARACTERISTICS] = {
 		.uuidptr	 = { LO_UINT16(SB_BLE_SYSTEMTIME_UUID), HI_UINT16(SB_BLE_SYSTEMTIME_UUID) },
 		.props  	 = GATT_PROP_READ | GATT_PROP_WRITE,
 		.perms		 = GATT_PERMIT_READ | GATT_PERMIT_WRITE,
+		.access 	 = &readWriteAccess,
 		.value  	 = charValSystemTime,
 		.length 	 = SB_BLE_SYSTEMTIME_LEN,
 		.description = "SystemTime",
@@ -236,6 +271,7 @@ static SB_PROFILE_CHARACTERISTIC characteristics[SB_NUM_CHARACTERISTICS] = {
 		.uuidptr	 = { LO_UINT16(SB_BLE_READINGCOUNT_UUID), HI_UINT16(SB_BLE_READINGCOUNT_UUID) },
 		.props  	 = GATT_PROP_READ  | GATT_PROP_WRITE_NO_RSP,
 		.perms		 = GATT_PERMIT_READ | GATT_PERMIT_WRITE,
+		.access 	 = &acknowledgeAccess,
 		.value  	 = charValReadingCount,
 		.length 	 = SB_BLE_READINGCOUNT_LEN,
 		.description = "ReadingCount",
@@ -258,6 +294,7 @@ static SB_PROFILE_CHARACTERISTIC characteristics[SB_NUM_CHARACTERISTICS] = {
 		.uuidptr	 = { LO_UINT16(SB_BLE_EXTRAPTR_UUID), HI_UINT16(SB_BLE_EXTRAPTR_UUID) },
 		.props  	 = GATT_PROP_READ | GATT_PROP_WRITE,
 		.perms		 = GATT_PERMIT_READ | GATT_PERMIT_WRITE,
+		.access 	 = &readWriteAccess,
 		.value  	 = charValExtraPtr,
 		.length 	 = SB_BLE_EXTRAPTR_LEN,
 		.description = "Extra Pointer",
@@ -269,10 +306,71 @@ static SB_PROFILE_CHARACTERISTIC characteristics[SB_NUM_CHARACTERISTICS] = {
 		.uuidptr	 = { LO_UINT16(SB_BLE_EXTRADATA_UUID), HI_UINT16(SB_BLE_EXTRADATA_UUID) },
 		.props  	 = GATT_PROP_READ | GATT_PROP_WRITE,
 		.perms		 = GATT_PERMIT_READ | GATT_PERMIT_WRITE,
+		.access 	 = &extraDataAccess,
 		.value  	 = NULL,
 		.length 	 = SB_BLE_EXTRADATA_LEN,
 		.description = "Extra Data",
 	},
+
+	// Live snapshot characteristic
+	{
+		.uuid   	 = SB_BLE_SNAPSHOT_UUID,
+		.uuidptr	 = { LO_UINT16(SB_BLE_SNAPSHOT_UUID), HI_UINT16(SB_BLE_SNAPSHOT_UUID) },
+		.props  	 = GATT_PROP_READ | GATT_PROP_NOTIFY,
+		.perms		 = GATT_PERMIT_READ,
+		.value  	 = charValSnapshot,
+		.length 	 = SB_BLE_SNAPSHOT_LEN,
+		.description = "Snapshot",
+	},
+
+	// Message pool usage, for sizing the heap and pools from field data
+	{
+		.uuid   	 = SB_BLE_MEMSTATS_UUID,
+		.uuidptr	 = { LO_UINT16(SB_BLE_MEMSTATS_UUID), HI_UINT16(SB_BLE_MEMSTATS_UUID) },
+		.props  	 = GATT_PROP_READ,
+		.perms		 = GATT_PERMIT_READ,
+		.access 	 = &memStatsAccess,
+		.value  	 = NULL,
+		.length 	 = SB_BLE_MEMSTATS_LEN,
+		.description = "Memory Stats",
+	},
+
+	// Wakeup counters of the sensing loop, for checking the effect of the wake scheduler on power
+	{
+		.uuid   	 = SB_BLE_WAKESTATS_UUID,
+		.uuidptr	 = { LO_UINT16(SB_BLE_WAKESTATS_UUID), HI_UINT16(SB_BLE_WAKESTATS_UUID) },
+		.props  	 = GATT_PROP_READ,
+		.perms		 = GATT_PERMIT_READ,
+		.access 	 = &wakeStatsAccess,
+		.value  	 = NULL,
+		.length 	 = SB_BLE_WAKESTATS_LEN,
+		.description = "Wake Stats",
+	},
+
+	// Time per state and per load, flash operations and gauge charge for the last few hours, newest first
+	{
+		.uuid   	 = SB_BLE_ENERGYSTATS_UUID,
+		.uuidptr	 = { LO_UINT16(SB_BLE_ENERGYSTATS_UUID), HI_UINT16(SB_BLE_ENERGYSTATS_UUID) },
+		.props  	 = GATT_PROP_READ,
+		.perms		 = GATT_PERMIT_READ,
+		.access 	 = &energyStatsAccess,
+		.value  	 = NULL,
+		.length 	 = SB_BLE_ENERGYSTATS_LEN,
+		.description = "Energy Stats",
+	},
+
+	// Oldest records of the trace log, removed from it once the central writes back how many bytes
+	// it read. Decoded by host/traceDecode.
+	{
+		.uuid   	 = SB_BLE_TRACE_UUID,
+		.uuidptr	 = { LO_UINT16(SB_BLE_TRACE_UUID), HI_UINT16(SB_BLE_TRACE_UUID) },
+		.props  	 = GATT_PROP_READ | GATT_PROP_WRITE,
+		.perms		 = GATT_PERMIT_READ | GATT_PERMIT_WRITE,
+		.access 	 = &traceAccess,
+		.value  	 = NULL,
+		.length 	 = SB_BLE_TRACE_LEN,
+		.description = "Trace",
+	},
 };
 
 /*********************************************************************
@@ -290,6 +388,9 @@ static gattAttribute_t simpleProfileAttrTbl[SERVAPP_NUM_ATTR_SUPPORTED] =
   },
 };
 
+// Characteristic and handlers of each attribute, indexed by position in the attribute table
+static SB_PROFILE_ATTRIBUTE attributeMap[SERVAPP_NUM_ATTR_SUPPORTED];
+
 /*********************************************************************
  * LOCAL FUNCTIONS
  */
@@ -331,50 +432,76 @@ CONST gattServiceCBs_t simpleProfileCBs =
  */
 bStatus_t SB_Profile_AddService( uint32 services )
 {
-	uint8 status, i = 1;
+	uint8 status, i = 1, numConfigs = 0;
 	SB_CHARACTERISTIC c;
+	gattCharCfg_t *configs;
+
+	for (c = (SB_CHARACTERISTIC)0; c < SB_NUM_CHARACTERISTICS; ++c) {
+		if (characteristics[c].props & (GATT_PROP_NOTIFY | GATT_PROP_INDICATE)) {
+			++numConfigs;
+		}
+	}
+
+	// The attribute table is sized at compile time
+	if (SB_NUM_CHARACTERISTICS*SERVAPP_NUM_PROP_PER_CHARACTERISTIC + 1 + numConfigs != SERVAPP_NUM_ATTR_SUPPORTED) {
+		return INVALID_MEM_SIZE;
+	}
+
+	// Every notifying characteristic gets its own slice of a single configuration block
+	configs = (gattCharCfg_t *) ICall_malloc( sizeof(gattCharCfg_t) * linkDBNumConns * numConfigs );
+
+	if (NULL == configs) {
+		return INVALID_MEM_SIZE;
+	}
 
 	// Init the profile attribute table
+	attributeMap[0].characteristic = SB_NUM_CHARACTERISTICS;
+	attributeMap[0].access = NULL;
+
 	for (c = (SB_CHARACTERISTIC)0; c < SB_NUM_CHARACTERISTICS; ++c) {
 		// Declare the characteristic
+		attributeMap[i].characteristic        = c;
+		attributeMap[i].access                = NULL;
 		simpleProfileAttrTbl[i  ].type.len    = ATT_BT_UUID_SIZE;
 		simpleProfileAttrTbl[i  ].type.uuid   = characterUUID;
 		simpleProfileAttrTbl[i  ].permissions = GATT_PERMIT_READ;
-		simpleProfileAttrTbl[i  ].handle 	  = NULL;
+		simpleProfileAttrTbl[i  ].handle 	  = 0;
 		simpleProfileAttrTbl[i++].pValue 	  = &characteristics[c].props;
 
 		// Characteristic value
+		attributeMap[i].characteristic        = c;
+		attributeMap[i].access                = characteristics[c].access ? characteristics[c].access : &readOnlyAccess;
 		simpleProfileAttrTbl[i  ].type.len    = ATT_BT_UUID_SIZE;
 		simpleProfileAttrTbl[i  ].type.uuid   = characteristics[c].uuidptr;
 		simpleProfileAttrTbl[i  ].permissions = characteristics[c].perms;
-		simpleProfileAttrTbl[i  ].handle 	  = NULL;
+		simpleProfileAttrTbl[i  ].handle 	  = 0;
 		simpleProfileAttrTbl[i++].pValue 	  = characteristics[c].value;
 
-		// Characteristic configuration (notify only)
-		if (characteristics[c].props & GATT_PROP_NOTIFY || characteristics[c].props & GATT_PROP_INDICATE) {
+		// Characteristic configuration (notify/indicate only)
+		if (characteristics[c].props & (GATT_PROP_NOTIFY | GATT_PROP_INDICATE)) {
+			characteristics[c].config = configs;
+			configs += linkDBNumConns;
+			GATTServApp_InitCharCfg( INVALID_CONNHANDLE, characteristics[c].config );
+
+			attributeMap[i].characteristic        = c;
+			attributeMap[i].access                = &configAccess;
 			simpleProfileAttrTbl[i  ].type.len    = ATT_BT_UUID_SIZE;
 			simpleProfileAttrTbl[i  ].type.uuid   = clientCharCfgUUID;
 			simpleProfileAttrTbl[i  ].permissions = GATT_PERMIT_READ | GATT_PERMIT_WRITE;
-			simpleProfileAttrTbl[i  ].handle 	  = NULL;
-			simpleProfileAttrTbl[i++].pValue 	  = (uint8_t*) &readingsCharConfig;
+			simpleProfileAttrTbl[i  ].handle 	  = 0;
+			simpleProfileAttrTbl[i++].pValue 	  = (uint8_t*) &characteristics[c].config;
 		}
 
 		// Characteristic description
+		attributeMap[i].characteristic        = c;
+		attributeMap[i].access                = &descriptionAccess;
 		simpleProfileAttrTbl[i  ].type.len    = ATT_BT_UUID_SIZE;
 		simpleProfileAttrTbl[i  ].type.uuid   = charUserDescUUID;
 		simpleProfileAttrTbl[i  ].permissions = GATT_PERMIT_READ;
-		simpleProfileAttrTbl[i  ].handle 	  = NULL;
+		simpleProfileAttrTbl[i  ].handle 	  = 0;
 		simpleProfileAttrTbl[i++].pValue 	  = (uint8*)characteristics[c].description;
 	}
 
-	readingsCharConfig = (gattCharCfg_t *) ICall_malloc( sizeof(gattCharCfg_t) * linkDBNumConns );
-
-	if (NULL == readingsCharConfig) {
-		return INVALID_MEM_SIZE;
-	}
-
-	GATTServApp_InitCharCfg( INVALID_CONNHANDLE, readingsCharConfig );
-
 	if ( services & SB_BLE_SERVICE )
 	{
 		// Register GATT attribute list and CBs with GATT Server App
@@ -539,11 +666,8 @@ bStatus_t SB_Profile_GetParameter( SB_CHARACTERISTIC param, void *value, int max
 bStatus_t SB_Profile_MarkParameterUpdated( SB_CHARACTERISTIC param ) {
 	bStatus_t status;
 
-	if (param >= SB_NUM_CHARACTERISTICS || !(characteristics[param].props & GATT_PROP_NOTIFY || characteristics[param].props & GATT_PROP_INDICATE)) {
-		return INVALIDPARAMETER;
-	}
-
-	if (param != SB_CHARACTERISTIC_READINGS)  {
+	// Only characteristics that can notify or indicate have a configuration table
+	if (param >= SB_NUM_CHARACTERISTICS || NULL == characteristics[param].config) {
 		return INVALIDPARAMETER;
 	}
 
@@ -553,7 +677,7 @@ bStatus_t SB_Profile_MarkParameterUpdated( SB_CHARACTERISTIC param ) {
 	}
 
 	status = GATTServApp_ProcessCharCfg(
-		readingsCharConfig,
+		characteristics[param].config,
 		characteristics[param].value,
 		false,
 		simpleProfileAttrTbl,
@@ -573,22 +697,27 @@ bStatus_t SB_Profile_MarkParameterUpdated( SB_CHARACTERISTIC param ) {
  * @return  SUCCESS if notification properly sent or an error code
  */
 bool SB_Profile_ReadingsNotificationsEnabled() {
-	uint8_t i;
-	gattAttribute_t * attr = NULL;
+	return SB_Profile_NotificationsEnabled( SB_CHARACTERISTIC_READINGS );
+}
 
-	for (i = 0; i < SERVAPP_NUM_ATTR_SUPPORTED; ++i) {
-		if (simpleProfileAttrTbl[i].pValue == (uint8_t*)&readingsCharConfig) {
-			attr = &simpleProfileAttrTbl[i];
-			break;
-		}
-	}
+/*********************************************************************
+ * @fn      SB_Profile_NotificationsEnabled
+ *
+ * @brief   Returns true if any connection has notifications or indications enabled for the parameter
+ *
+ * @param   param - Profile parameter ID
+ * @return  True if notifications enabled
+ */
+bool SB_Profile_NotificationsEnabled( SB_CHARACTERISTIC param ) {
+	uint8_t i;
+	gattCharCfg_t *charConfig;
 
-	if (NULL == attr) {
+	if (param >= SB_NUM_CHARACTERISTICS || NULL == (charConfig = characteristics[param].config)) {
 		return false;
 	}
 
 	for (i = 0; i < linkDBNumConns; ++i) {
-		if ((readingsCharConfig[i].value & GATT_CLIENT_CFG_NOTIFY) || (readingsCharConfig[i].value & GATT_CLIENT_CFG_INDICATE)) {
+		if (charConfig[i].value & (GATT_CLIENT_CFG_NOTIFY | GATT_CLIENT_CFG_INDICATE)) {
 			return true;
 		}
 	}
@@ -623,21 +752,45 @@ bool SB_Profile_NotificationStateChanged(SB_CHARACTERISTIC param ) {
  */
 bStatus_t SB_Profile_ClearNotificationState() {
 	uint8_t i, result;
+	SB_CHARACTERISTIC c;
+	gattCharCfg_t *charConfig;
 
 	uint8_t entity = ICall_getEntityId();
 	if (entity == ICALL_INVALID_ENTITY_ID) {
 		return INVALID_TASK;
 	}
 
-	for (i = 0; i < linkDBNumConns; ++i) {
-		if (SUCCESS != (GATTServApp_WriteCharCfg(readingsCharConfig[i].connHandle, readingsCharConfig, 0))) {
-			return result;
+	for (c = (SB_CHARACTERISTIC)0; c < SB_NUM_CHARACTERISTICS; ++c) {
+		if (NULL == (charConfig = characteristics[c].config)) {
+			continue;
+		}
+
+		for (i = 0; i < linkDBNumConns; ++i) {
+			// The link may be up again already, and the next central keeps its subscriptions
+			if (INVALID_CONNHANDLE != charConfig[i].connHandle && linkDB_Up(charConfig[i].connHandle)) {
+				continue;
+			}
+
+			if (SUCCESS != (result = GATTServApp_WriteCharCfg(charConfig[i].connHandle, charConfig, 0))) {
+				return result;
+			}
 		}
 	}
 
 	return SUCCESS;
 }
 
+/**
+ * Gets the attribute map entry of an attribute in the profile attribute table
+ */
+static SB_PROFILE_ATTRIBUTE * getAttribute(gattAttribute_t *pAttr) {
+	if (pAttr < simpleProfileAttrTbl || pAttr >= simpleProfileAttrTbl + SERVAPP_NUM_ATTR_SUPPORTED) {
+		return NULL;
+	}
+
+	return &attributeMap[pAttr - simpleProfileAttrTbl];
+}
+
 /*********************************************************************
  * @fn          simpleProfile_ReadAttrCB
  *
@@ -659,7 +812,9 @@ static bStatus_t simpleProfile_ReadAttrCB(uint16_t connHandle,
                                           uint16_t offset, uint16_t maxLen,
                                           uint8_t method)
 {
-	bStatus_t status = SUCCESS;
+	SB_PROFILE_ATTRIBUTE *attribute;
+
+	*pLen = 0;
 
 	// If attribute permissions require authorization to read, return error
 	if ( gattPermitAuthorRead( pAttr->permissions ) ) {
@@ -667,67 +822,11 @@ static bStatus_t simpleProfile_ReadAttrCB(uint16_t connHandle,
 		return ( ATT_ERR_INSUFFICIENT_AUTHOR );
 	}
 
-	if ( pAttr->type.len == ATT_BT_UUID_SIZE ) {
-		uint16 uuid = BUILD_UINT16( pAttr->type.uuid[0], pAttr->type.uuid[1]);
-		uint8 c = uuid - SB_BLE_SERV_UUID - 1;
-
-		// Validate the characteristic
-		if (c >= SB_NUM_CHARACTERISTICS) {
-			// Invalid characteristic
-			*pLen = 0;
-			return ATT_ERR_ATTR_NOT_FOUND;
-		}
-
-		// Validate offset
-		if ( offset > characteristics[c].length) {
-			*pLen = 0;
-			return ( ATT_ERR_INVALID_OFFSET );
-		}
-
-		*pLen = characteristics[c].length - offset;
-
-		// Ensure we don't write too much data
-		if (*pLen > maxLen) {
-			*pLen = maxLen;
-		}
-
-		// Copy the data to the output buffer
-		if (c == SB_CHARACTERISTIC_EXTRADATA) {
-			uint16_t * value = getExtraDataPtr(*charValExtraPtr);
-			if (NULL == value) {
-				return ATT_ERR_UNSUPPORTED_REQ;
-			}
-
-			memcpy( pValue, value + offset, *pLen );
-		} else {
-			memcpy( pValue, pAttr->pValue + offset, *pLen );
-		}
-	} else {
-		// 128-bit UUID
-		*pLen = 0;
-		status = ATT_ERR_INVALID_HANDLE;
+	if (NULL == (attribute = getAttribute(pAttr)) || NULL == attribute->access || NULL == attribute->access->read) {
+		return ATT_ERR_ATTR_NOT_FOUND;
 	}
 
-	return ( status );
-}
-
-/**
- * Getes the extra data read/write pointer for the given value
- */
-uint16_t * getExtraDataPtr(uint8_t dataNo) {
-	switch (dataNo) {
-	case 0:
-		return &SB_GlobalDeviceConfiguration.CheckSleepIntervalMS;
-	case 1:
-		return &SB_GlobalDeviceConfiguration.BLECheckInterval;
-	case 2:
-		return &SB_GlobalDeviceConfiguration.CheckReadDelayMS;
-	case 3:
-		return &SB_GlobalDeviceConfiguration.MaxTransmitStateTimeS;
-
-	default:
-		return NULL;
-	}
+	return attribute->access->read( connHandle, attribute->characteristic, pValue, pLen, offset, maxLen );
 }
 
 /*********************************************************************
@@ -749,8 +848,8 @@ static bStatus_t simpleProfile_WriteAttrCB(uint16_t connHandle,
                                            uint8_t *pValue, uint16_t len,
                                            uint16_t offset, uint8_t method)
 {
-	bStatus_t status = SUCCESS;
-	uint8 notifyApp = 0xFF;
+	bStatus_t status;
+	SB_PROFILE_ATTRIBUTE *attribute;
 
 	// If attribute permissions require authorization to write, return error
 	if ( gattPermitAuthorWrite( pAttr->permissions ) ) {
@@ -758,107 +857,221 @@ static bStatus_t simpleProfile_WriteAttrCB(uint16_t connHandle,
 		return ( ATT_ERR_INSUFFICIENT_AUTHOR );
 	}
 
-	if ( pAttr->type.len == ATT_BT_UUID_SIZE ) {
-		// 16-bit UUID
-		uint16 uuid = BUILD_UINT16( pAttr->type.uuid[0], pAttr->type.uuid[1]);
-		uint8 c = uuid - SB_BLE_SERV_UUID - 1;
+	if (NULL == (attribute = getAttribute(pAttr))) {
+		return ATT_ERR_ATTR_NOT_FOUND;
+	}
 
-		switch ( uuid )
-		{
-		case SB_BLE_SYSTEMTIME_UUID:
-			// Ensure the length and offset don't cause us to overwrite
-			if  (offset >= characteristics[c].length || ((uint16)characteristics[c].length) - offset < len) {
-				status = ATT_ERR_INVALID_VALUE_SIZE;
-				break;
-			}
+	if (NULL == attribute->access || NULL == attribute->access->write) {
+		// Attribute doesn't have write permissions
+		return ATT_ERR_WRITE_NOT_PERMITTED;
+	}
 
-			//Write the value
-			memcpy(pAttr->pValue + offset, pValue, len);
+	status = attribute->access->write( connHandle, attribute->characteristic, pAttr, pValue, len, offset );
 
-			// Notify the application that system time changed
-			notifyApp = SB_CHARACTERISTIC_SYSTEMTIME;
+	// If a characteristic value changed then callback function to notify application of change
+	if ( SUCCESS == status && simpleProfile_AppCBs && simpleProfile_AppCBs->pfnSimpleProfileChange ) {
+		simpleProfile_AppCBs->pfnSimpleProfileChange( connHandle, attribute->characteristic );
+	}
+
+	return ( status );
+}
 
-			break;
+/**
+ * Validates that a write stays within the characteristic value
+ */
+static bStatus_t checkWriteRange(uint8 c, uint16 len, uint16 offset) {
+	if (offset >= characteristics[c].length || ((uint16)characteristics[c].length) - offset < len) {
+		return ATT_ERR_INVALID_VALUE_SIZE;
+	}
 
-		case SB_BLE_READINGCOUNT_UUID:
-			// Ensure the length and offset don't cause us to overwrite
-			if  (offset >= characteristics[c].length || ((uint16)characteristics[c].length) - offset < len) {
-				status = ATT_ERR_INVALID_VALUE_SIZE;
-				break;
-			}
+	return SUCCESS;
+}
 
-			// The value does not actually get changed by the write
+/**
+ * Copies out part of a buffer, limited to the maximum the read can hold
+ */
+static bStatus_t readBuffer(const uint8 *source, uint16 length, uint8 *pValue, uint16 *pLen, uint16 offset, uint16 maxLen) {
+	// Validate offset
+	if (offset > length) {
+		*pLen = 0;
+		return ATT_ERR_INVALID_OFFSET;
+	}
 
-			// Notify the application that the write was performed
-			notifyApp = SB_CHARACTERISTIC_READINGCOUNT;
+	*pLen = length - offset;
 
-			break;
+	// Ensure we don't write too much data
+	if (*pLen > maxLen) {
+		*pLen = maxLen;
+	}
 
-		case SB_BLE_EXTRAPTR_UUID:
-			// Ensure the length and offset don't cause us to overwrite
-			if  (offset >= characteristics[c].length || ((uint16)characteristics[c].length) - offset < len) {
-				status = ATT_ERR_INVALID_VALUE_SIZE;
-				break;
-			}
+	memcpy( pValue, source + offset, *pLen );
 
-			//Write the value
-			memcpy(pAttr->pValue + offset, pValue, len);
+	return SUCCESS;
+}
 
-			// Notify the application that system time changed
-			notifyApp = SB_CHARACTERISTIC_EXTRAPTR;
-			break;
+/**
+ * Reads a characteristic value
+ */
+static bStatus_t readValue(uint16 connHandle, uint8 c, uint8 *pValue, uint16 *pLen, uint16 offset, uint16 maxLen) {
+	return readBuffer( characteristics[c].value, characteristics[c].length, pValue, pLen, offset, maxLen );
+}
 
-		case SB_BLE_EXTRADATA_UUID:
-			// Ensure the length and offset don't cause us to overwrite
-			if  (offset >= characteristics[c].length || ((uint16)characteristics[c].length) - offset < len) {
-				status = ATT_ERR_INVALID_VALUE_SIZE;
-				break;
-			}
+/**
+ * Reads the configuration value selected by the extra pointer characteristic
+ */
+static bStatus_t readExtraData(uint16 connHandle, uint8 c, uint8 *pValue, uint16 *pLen, uint16 offset, uint16 maxLen) {
+	uint16_t * value = getExtraDataPtr(*charValExtraPtr);
 
-			{
-				// Check the value being written
-				uint16_t *value = getExtraDataPtr(*charValExtraPtr);
+	if (NULL == value) {
+		return ATT_ERR_UNSUPPORTED_REQ;
+	}
 
-				if (NULL == value) {
-					status = ATT_ERR_UNSUPPORTED_REQ;
-					break;
-				}
+	return readBuffer( (uint8*)value, characteristics[c].length, pValue, pLen, offset, maxLen );
+}
 
-				//Write the value
-				memcpy(value + offset, pValue, len);
-			}
+/**
+ * Reads the user description of a characteristic
+ */
+static bStatus_t readDescription(uint16 connHandle, uint8 c, uint8 *pValue, uint16 *pLen, uint16 offset, uint16 maxLen) {
+	return readBuffer( (uint8*)characteristics[c].description, strlen(characteristics[c].description), pValue, pLen, offset, maxLen );
+}
+
+/**
+ * Reads a snapshot of the ICall message pool counters. Long reads may see counters from different snapshots.
+ */
+static bStatus_t readMemStats(uint16 connHandle, uint8 c, uint8 *pValue, uint16 *pLen, uint16 offset, uint16 maxLen) {
+	ICall_PoolUsage usage;
 
-			// Notify the application that system time changed
-			notifyApp = SB_CHARACTERISTIC_EXTRADATA;
-			break;
+	ICall_poolGetUsage(&usage);
 
-		case GATT_CLIENT_CHAR_CFG_UUID:
-			status = GATTServApp_ProcessCCCWriteReq( connHandle, pAttr, pValue, len,
-													 offset, GATT_CLIENT_CFG_INDICATE );
+	return readBuffer( (uint8*)&usage, characteristics[c].length, pValue, pLen, offset, maxLen );
+}
 
-			notifyApp = SB_CHARACTERISTIC_READINGS;
+/**
+ * Reads a snapshot of the wakeup counters of the sensing loop
+ */
+static bStatus_t readWakeStats(uint16 connHandle, uint8 c, uint8 *pValue, uint16 *pLen, uint16 offset, uint16 maxLen) {
+	SB_WakeStats stats;
 
-			break;
+	SB_schedulerGetStats(&stats);
 
-		default:
-			// Characteristic not found, or doesn't have write permissions
-			if (c < SB_NUM_CHARACTERISTICS) {
-				status = ATT_ERR_WRITE_NOT_PERMITTED;
-			} else {
-				status = ATT_ERR_ATTR_NOT_FOUND;
-			}
-		}
-	} else {
-		// 128-bit UUID
-		status = ATT_ERR_INVALID_HANDLE;
+	return readBuffer( (uint8*)&stats, characteristics[c].length, pValue, pLen, offset, maxLen );
+}
+
+/**
+ * Reads the energy accounting of the last few hours. The hours roll over during a long read, so it is
+ * served from a snapshot taken when the read starts. Hours not reached yet read as zeros.
+ */
+static bStatus_t readEnergyStats(uint16 connHandle, uint8 c, uint8 *pValue, uint16 *pLen, uint16 offset, uint16 maxLen) {
+	static SB_EnergyHour hours[SB_ENERGY_NUM_HOURS];
+
+	if (0 == offset) {
+		memset(hours, 0, sizeof(hours));
+		SB_energyGetHours(hours, SB_ENERGY_NUM_HOURS);
 	}
 
-	// If a characteristic value changed then callback function to notify application of change
-	if ( (notifyApp != 0xFF ) && simpleProfile_AppCBs && simpleProfile_AppCBs->pfnSimpleProfileChange ) {
-		simpleProfile_AppCBs->pfnSimpleProfileChange( notifyApp );
+	return readBuffer( (uint8*)hours, characteristics[c].length, pValue, pLen, offset, maxLen );
+}
+
+/**
+ * Reads the oldest trace records straight out of the ring. They stay there until acknowledged, so
+ * every part of a long read, and a read repeated after a dropped link, sees the same records.
+ * Reads as empty once the ring is empty.
+ */
+static bStatus_t readTrace(uint16 connHandle, uint8 c, uint8 *pValue, uint16 *pLen, uint16 offset, uint16 maxLen) {
+	*pLen = SB_tracePeek(pValue, offset, maxLen, characteristics[c].length);
+
+	return SUCCESS;
+}
+
+/**
+ * Writes a characteristic value
+ */
+static bStatus_t writeValue(uint16 connHandle, uint8 c, gattAttribute_t *pAttr, uint8 *pValue, uint16 len, uint16 offset) {
+	bStatus_t status;
+
+	// Ensure the length and offset don't cause us to overwrite
+	if (SUCCESS != (status = checkWriteRange(c, len, offset))) {
+		return status;
 	}
 
-	return ( status );
+	memcpy(characteristics[c].value + offset, pValue, len);
+
+	return SUCCESS;
+}
+
+/**
+ * Accepts a write without changing the value. Used where the write itself is the signal.
+ */
+static bStatus_t writeAcknowledge(uint16 connHandle, uint8 c, gattAttribute_t *pAttr, uint8 *pValue, uint16 len, uint16 offset) {
+	return checkWriteRange(c, len, offset);
+}
+
+/**
+ * Writes the configuration value selected by the extra pointer characteristic
+ */
+static bStatus_t writeExtraData(uint16 connHandle, uint8 c, gattAttribute_t *pAttr, uint8 *pValue, uint16 len, uint16 offset) {
+	bStatus_t status;
+	uint16_t *value;
+
+	// Ensure the length and offset don't cause us to overwrite
+	if (SUCCESS != (status = checkWriteRange(c, len, offset))) {
+		return status;
+	}
+
+	// Check the value being written
+	if (NULL == (value = getExtraDataPtr(*charValExtraPtr))) {
+		return ATT_ERR_UNSUPPORTED_REQ;
+	}
+
+	memcpy((uint8*)value + offset, pValue, len);
+
+	return SUCCESS;
+}
+
+/**
+ * Writes the client configuration of a characteristic. Indications are used where the characteristic supports them.
+ */
+static bStatus_t writeConfig(uint16 connHandle, uint8 c, gattAttribute_t *pAttr, uint8 *pValue, uint16 len, uint16 offset) {
+	return GATTServApp_ProcessCCCWriteReq( connHandle, pAttr, pValue, len, offset,
+			(characteristics[c].props & GATT_PROP_INDICATE) ? GATT_CLIENT_CFG_INDICATE : GATT_CLIENT_CFG_NOTIFY );
+}
+
+/**
+ * Removes the trace records a central has read. The value is the number of bytes it read, which
+ * must end on a record boundary. Only one central should drain the trace at a time.
+ */
+static bStatus_t writeTrace(uint16 connHandle, uint8 c, gattAttribute_t *pAttr, uint8 *pValue, uint16 len, uint16 offset) {
+	if (0 != offset || sizeof(uint16) != len) {
+		return ATT_ERR_INVALID_VALUE_SIZE;
+	}
+
+	if (NoError != SB_traceDiscard(BUILD_UINT16(pValue[0], pValue[1]))) {
+		return ATT_ERR_INVALID_VALUE;
+	}
+
+	return SUCCESS;
+}
+
+/**
+ * Getes the extra data read/write pointer for the given value
+ */
+uint16_t * getExtraDataPtr(uint8_t dataNo) {
+	switch (dataNo) {
+	case 0:
+		return &SB_GlobalDeviceConfiguration.CheckSleepIntervalMS;
+	case 1:
+		return &SB_GlobalDeviceConfiguration.BLECheckInterval;
+	case 2:
+		return &SB_GlobalDeviceConfiguration.CheckReadDelayMS;
+	case 3:
+		return &SB_GlobalDeviceConfiguration.MaxTransmitStateTimeS;
+	case 4:
+		return &SB_GlobalDeviceConfiguration.TemperatureResolution;
+
+	default:
+		return NULL;
+	}
 }
 
 /*********************************************************************
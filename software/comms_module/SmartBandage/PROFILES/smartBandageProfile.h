@@ -42,6 +42,8 @@
 
 #include "hci_tl.h"
 #include "gatt.h"
+#include "gattservapp.h"
+#include "ICallPool.h"
 
 
 #ifdef __cplusplus
@@ -78,14 +80,20 @@ extern "C"
 #define SB_BLE_EXTRAPTR_UUID		        (SB_BLE_SERV_UUID +1+ SB_CHARACTERISTIC_EXTRAPTR)
 #define SB_BLE_EXTRADATA_UUID		        (SB_BLE_SERV_UUID +1+ SB_CHARACTERISTIC_EXTRADATA)
 
+#define SB_BLE_SNAPSHOT_UUID		        (SB_BLE_SERV_UUID +1+ SB_CHARACTERISTIC_SNAPSHOT)
+#define SB_BLE_MEMSTATS_UUID		        (SB_BLE_SERV_UUID +1+ SB_CHARACTERISTIC_MEMSTATS)
+#define SB_BLE_WAKESTATS_UUID		        (SB_BLE_SERV_UUID +1+ SB_CHARACTERISTIC_WAKESTATS)
+#define SB_BLE_ENERGYSTATS_UUID		        (SB_BLE_SERV_UUID +1+ SB_CHARACTERISTIC_ENERGYSTATS)
+#define SB_BLE_TRACE_UUID			        (SB_BLE_SERV_UUID +1+ SB_CHARACTERISTIC_TRACE)
+
 // For each characteristic the server has three entries, plus on for the service
-#define SERVAPP_NUM_NOTIFY_PROPS 			1
+// and one configuration entry for every characteristic that can notify or indicate
+#define SERVAPP_NUM_NOTIFY_PROPS 			2
 #define SERVAPP_NUM_PROP_PER_CHARACTERISTIC 3
 #define SERVAPP_NUM_ATTR_SUPPORTED         (SB_NUM_CHARACTERISTICS*SERVAPP_NUM_PROP_PER_CHARACTERISTIC + 1 + SERVAPP_NUM_NOTIFY_PROPS)
 
 // Simple Keys Profile Services bit fields
 #define SB_BLE_SERVICE               0x00000001
-#define SB_MAX_NUM_CONNS			 2
 
 // Length of Characteristics in bytes
 #define SB_BLE_TEMPERATURE_LEN           8
@@ -103,6 +111,11 @@ extern "C"
 #define SB_BLE_READINGDATAOFFSETS_LEN    4
 #define SB_BLE_EXTRAPTR_LEN				 1
 #define SB_BLE_EXTRADATA_LEN			 2
+#define SB_BLE_SNAPSHOT_LEN				 sizeof(SB_PROFILE_SNAPSHOT)
+#define SB_BLE_MEMSTATS_LEN				 sizeof(ICall_PoolUsage)
+#define SB_BLE_WAKESTATS_LEN			 sizeof(SB_WakeStats)
+#define SB_BLE_ENERGYSTATS_LEN			 (SB_ENERGY_NUM_HOURS * sizeof(SB_EnergyHour))
+#define SB_BLE_TRACE_LEN				 240
 
 /*********************************************************************
  * TYPEDEFS
@@ -122,10 +135,26 @@ typedef enum {
 	SB_CHARACTERISTIC_READINGDATAOFFSETS,
 	SB_CHARACTERISTIC_EXTRAPTR,
 	SB_CHARACTERISTIC_EXTRADATA,
+	SB_CHARACTERISTIC_SNAPSHOT,
+	SB_CHARACTERISTIC_MEMSTATS,
+	SB_CHARACTERISTIC_WAKESTATS,
+	SB_CHARACTERISTIC_ENERGYSTATS,
+	SB_CHARACTERISTIC_TRACE,
 
 	SB_NUM_CHARACTERISTICS
 } SB_CHARACTERISTIC;
 
+// Live view of every channel from a single sensing cycle. Laid out so that no padding is required,
+// and 20 bytes so that it fits one notification or read response at the default ATT MTU of 23.
+typedef struct {
+	uint32 timestamp;
+	uint16 temperatures[SB_BLE_TEMPERATURE_LEN/sizeof(uint16)];
+	uint8  sequence;											// Per cycle, so that a gap shows a missed notification
+	uint8  humidity;											// %
+	uint8  battCharge;											// State of charge, %
+	uint8  moistures[SB_BLE_MOISTUREMAP_LEN/sizeof(uint16)];	// %
+} SB_PROFILE_SNAPSHOT;
+
 /*********************************************************************
  * MACROS
  */
@@ -135,7 +164,7 @@ typedef enum {
  */
 
 // Callback when a characteristic value has changed
-typedef void (*simpleProfileChange_t)( uint8 paramID );
+typedef void (*simpleProfileChange_t)( uint16 connHandle, uint8 paramID );
 
 typedef struct
 {
@@ -144,6 +173,17 @@ typedef struct
 
 #define SB_PROFILE_UUID_LEN ATT_BT_UUID_SIZE
 
+// Attribute access handlers. paramID is the characteristic the attribute belongs to.
+typedef bStatus_t (*SB_ProfileReadHandler_t)( uint16 connHandle, uint8 paramID, uint8 *pValue,
+                                              uint16 *pLen, uint16 offset, uint16 maxLen );
+typedef bStatus_t (*SB_ProfileWriteHandler_t)( uint16 connHandle, uint8 paramID, gattAttribute_t *pAttr,
+                                               uint8 *pValue, uint16 len, uint16 offset );
+
+typedef struct {
+	SB_ProfileReadHandler_t read;	// NULL if the attribute cannot be read through the profile
+	SB_ProfileWriteHandler_t write;	// NULL if the attribute cannot be written
+} SB_PROFILE_ACCESS;
+
 typedef struct {
 	uint16 uuid;
 	uint8 uuidptr[SB_PROFILE_UUID_LEN];
@@ -152,6 +192,8 @@ typedef struct {
 	uint8*value;
 	uint8 length;
 	char* description;
+	const SB_PROFILE_ACCESS *access;	// Value handlers, NULL for a plain read-only value
+	gattCharCfg_t *config;				// Client configuration table, set up for notify/indicate characteristics
 } SB_PROFILE_CHARACTERISTIC;
     
 
@@ -270,7 +312,7 @@ extern bool SB_Profile_NotificationStateChanged(SB_CHARACTERISTIC param );
 /*********************************************************************
  * @fn      SB_Profile_ClearNotificationState
  *
- * @brief   Clears the notification subscription
+ * @brief   Clears the notification subscriptions of connections that are no longer up
  *
  * @return  SUCCESS if notification properly sent or an error code
  */
@@ -285,6 +327,16 @@ extern bStatus_t SB_Profile_ClearNotificationState();
  */
 extern bool SB_Profile_ReadingsNotificationsEnabled();
 
+/*********************************************************************
+ * @fn      SB_Profile_NotificationsEnabled
+ *
+ * @brief   Returns true if any connection has notifications or indications enabled for the parameter
+ *
+ * @param   param - Profile parameter ID
+ * @return  True if notifications enabled
+ */
+extern bool SB_Profile_NotificationsEnabled( SB_CHARACTERISTIC param );
+
 /*********************************************************************
 *********************************************************************/
 
@@ -116,6 +116,14 @@ typedef struct
   uint8  *pData;
 } hciExtCmd_t;
 
+// Handler of an ICall Host subgroup
+typedef uint8 (*icallHostHandler_t)(uint8 cmdID, ICall_CmdMsg *msg_ptr,
+                                    uint8 *pRspDataLen, uint8 *pSendCS);
+
+// Handler of a Dispatch subgroup
+typedef uint8 (*dispHandler_t)(ICall_CmdMsg *msg_ptr, uint8 *pRspDataLen,
+                               uint8 *pSendCS);
+
 /*********************************************************************
  * GLOBAL VARIABLES
  */
@@ -179,11 +187,11 @@ static uint8 buildRevision(ICall_BuildRevision *pBuildRev);
 #if defined(HOST_CONFIG)
 #if (HOST_CONFIG & (CENTRAL_CFG | PERIPHERAL_CFG))
 static uint8 processICallL2CAP(uint8 cmdID, ICall_CmdMsg *msg_ptr,
-                               uint8 *pSendCS);
+                               uint8 *pRspDataLen, uint8 *pSendCS);
 static uint8 processICallATT(uint8 cmdID, ICall_CmdMsg *msg_ptr,
-                             uint8 *pSendCS);
+                             uint8 *pRspDataLen, uint8 *pSendCS);
 static uint8 processICallGATT(uint8 cmdID, ICall_CmdMsg *msg_ptr,
-                              uint8 *pSendCS);
+                              uint8 *pRspDataLen, uint8 *pSendCS);
 #endif // (CENTRAL_CFG | PERIPHERAL_CFG)
 static uint8 processICallGAP(uint8 cmdID, ICall_CmdMsg *msg_ptr,
                              uint8 *pRspDataLen, uint8 *pSendCS);
@@ -191,18 +199,22 @@ static uint8 processICallGAP(uint8 cmdID, ICall_CmdMsg *msg_ptr,
 
 /*** For Dispatch messages ***/
 static uint8 processDispMsg(ICall_CmdMsg *msg_ptr);
-static uint8 processDispGeneral(ICall_CmdMsg *msg_ptr, uint8 *pSendCS);
+static uint8 processDispGeneral(ICall_CmdMsg *msg_ptr, uint8 *pRspDataLen,
+                                uint8 *pSendCS);
 
 #if defined(HOST_CONFIG)
 static uint8 processDispGAPProfile(ICall_CmdMsg *msg_ptr, uint8 *pRspDataLen,
                                    uint8 *pSendCS);
 
 #if (HOST_CONFIG & (CENTRAL_CFG | PERIPHERAL_CFG))
-static uint8 processDispGATTProfile(ICall_CmdMsg *msg_ptr, uint8 *pSendCS);
+static uint8 processDispGATTProfile(ICall_CmdMsg *msg_ptr, uint8 *pRspDataLen,
+                                    uint8 *pSendCS);
 
 #if !defined(GATT_DB_OFF_CHIP)
-static uint8 processDispGGS(ICall_CmdMsg *msg_ptr, uint8 *pSendCS);
-static uint8 processDispGSA(ICall_CmdMsg *msg_ptr, uint8 *pSendCS);
+static uint8 processDispGGS(ICall_CmdMsg *msg_ptr, uint8 *pRspDataLen,
+                            uint8 *pSendCS);
+static uint8 processDispGSA(ICall_CmdMsg *msg_ptr, uint8 *pRspDataLen,
+                            uint8 *pSendCS);
 #endif // !GATT_DB_OFF_CHIP
 #endif // (CENTRAL_CFG | PERIPHERAL_CFG)
 #endif // HOST_CONFIG
@@ -261,6 +273,70 @@ static uint8 *createPayload( uint8 *pBuf, uint16 len, uint8 sigLen );
 #endif // HOST_CONFIG
 #endif // HCI_TL_FULL
 
+/*********************************************************************
+ * SUBGROUP HANDLERS
+ */
+
+// ICall Host message handlers, indexed by the opcode's command subgroup
+// (HCI_EXT_L2CAP_SUBGRP to HCI_EXT_UTIL_SUBGRP). Link Layer commands are
+// handled by processICallLL().
+#define ICALL_HOST_SUBGRP_NUM            8
+
+static const icallHostHandler_t icallHostHandlers[ICALL_HOST_SUBGRP_NUM] =
+{
+  NULL,                    // HCI_OPCODE_CSG_LINK_LAYER
+#if defined(HOST_CONFIG)
+#if (HOST_CONFIG & (CENTRAL_CFG | PERIPHERAL_CFG))
+  processICallL2CAP,       // HCI_EXT_L2CAP_SUBGRP
+  processICallATT,         // HCI_EXT_ATT_SUBGRP
+  processICallGATT,        // HCI_EXT_GATT_SUBGRP
+#else // !(CENTRAL_CFG | PERIPHERAL_CFG)
+  NULL,
+  NULL,
+  NULL,
+#endif // (CENTRAL_CFG | PERIPHERAL_CFG)
+  processICallGAP,         // HCI_EXT_GAP_SUBGRP
+#else // !HOST_CONFIG
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+#endif // HOST_CONFIG
+  processICallUTIL,        // HCI_EXT_UTIL_SUBGRP
+  NULL,
+  NULL
+};
+
+// Dispatch message handlers, indexed by the subgroup
+#define DISPATCH_SUBGRP_NUM              (DISPATCH_GATT_SERV_APP + 1)
+
+static const dispHandler_t dispHandlers[DISPATCH_SUBGRP_NUM] =
+{
+  processDispGeneral,      // DISPATCH_GENERAL
+#if defined(HOST_CONFIG)
+  processDispGAPProfile,   // DISPATCH_GAP_PROFILE
+#if (HOST_CONFIG & (CENTRAL_CFG | PERIPHERAL_CFG))
+  processDispGATTProfile,  // DISPATCH_GATT_PROFILE
+#if !defined(GATT_DB_OFF_CHIP)
+  processDispGGS,          // DISPATCH_GAP_GATT_SERV
+  processDispGSA           // DISPATCH_GATT_SERV_APP
+#else // GATT_DB_OFF_CHIP
+  NULL,
+  NULL
+#endif // !GATT_DB_OFF_CHIP
+#else // !(CENTRAL_CFG | PERIPHERAL_CFG)
+  NULL,
+  NULL,
+  NULL
+#endif // (CENTRAL_CFG | PERIPHERAL_CFG)
+#else // !HOST_CONFIG
+  NULL,
+  NULL,
+  NULL,
+  NULL
+#endif // HOST_CONFIG
+};
+
 /*********************************************************************
  * @fn      bleDispatch_Init
  *
@@ -475,40 +551,14 @@ static uint8 processICallMsg(ICall_CmdMsg *msg_ptr)
 static uint8 processICallHost(uint16 opCode, ICall_CmdMsg *msg_ptr,
                               uint8 *pRspDataLen, uint8 *pSendCS)
 {
-  bStatus_t stat;
+  icallHostHandler_t pfnHandler = icallHostHandlers[(opCode >> 7) & 0x07];
 
-  switch((opCode >> 7) & 0x07)
+  if (pfnHandler == NULL)
   {
-#if defined(HOST_CONFIG)
-#if (HOST_CONFIG & (CENTRAL_CFG | PERIPHERAL_CFG))
-    case HCI_EXT_L2CAP_SUBGRP:
-      stat = processICallL2CAP((opCode & 0x007F), msg_ptr, pSendCS);
-      break;
-
-    case HCI_EXT_ATT_SUBGRP:
-      stat = processICallATT((opCode & 0x007F), msg_ptr, pSendCS);
-      break;
-
-    case HCI_EXT_GATT_SUBGRP:
-      stat = processICallGATT((opCode & 0x007F), msg_ptr, pSendCS);
-      break;
-#endif // (CENTRAL_CFG | PERIPHERAL_CFG)
-
-    case HCI_EXT_GAP_SUBGRP:
-      stat = processICallGAP((opCode & 0x007F), msg_ptr, pRspDataLen, pSendCS);
-      break;
-#endif // HOST_CONFIG
-
-    case HCI_EXT_UTIL_SUBGRP:
-      stat = processICallUTIL((opCode & 0x007F), msg_ptr, pRspDataLen, pSendCS);
-      break;
-
-    default:
-      stat = FAILURE;
-      break;
+    return (FAILURE);
   }
 
-  return (stat);
+  return (pfnHandler((opCode & 0x007F), msg_ptr, pRspDataLen, pSendCS));
 }
 
 /*********************************************************************
@@ -1145,12 +1195,13 @@ void bleDispatch_BMFree(uint8_t type, void *pBuf, uint8_t opcode)
  *
  * @param   cmdID - incoming message command ID
  * @param   msg_ptr - pointer to incoming ICall message
+ * @param   pRspDataLen - response data length to be returned.
  * @param   pSendCS - whether to send Command Status response back.
   *
  * @return  SUCCESS or FAILURE
  */
 static uint8 processICallL2CAP(uint8 cmdID, ICall_CmdMsg *msg_ptr,
-                               uint8 *pSendCS)
+                               uint8 *pRspDataLen, uint8 *pSendCS)
 {
   bStatus_t stat;
 
@@ -1229,12 +1280,14 @@ static uint8 processICallL2CAP(uint8 cmdID, ICall_CmdMsg *msg_ptr,
  *
  * @param   cmdID - incoming message command ID
  * @param   msg_ptr - pointer to incoming ICall message
+ * @param   pRspDataLen - response data length to be returned.
  * @param   pSendCS - whether to send Command Status response back.
  *
  * @return  SUCCESS, INVALIDPARAMETER, FAILURE,
  *          bleInvalidPDU or bleMemAllocError
  */
-static uint8 processICallATT(uint8 cmdID, ICall_CmdMsg *msg_ptr, uint8 *pSendCS)
+static uint8 processICallATT(uint8 cmdID, ICall_CmdMsg *msg_ptr,
+                             uint8 *pRspDataLen, uint8 *pSendCS)
 {
   uint16 connHandle = msg_ptr->attParamAndPtr.connHandle;
   attMsg_t *pMsg = msg_ptr->attParamAndPtr.pMsg;
@@ -1287,13 +1340,14 @@ static uint8 processICallATT(uint8 cmdID, ICall_CmdMsg *msg_ptr, uint8 *pSendCS)
  *
  * @param   cmdID - incoming message command ID
  * @param   msg_ptr - pointer to incoming ICall message
+ * @param   pRspDataLen - response data length to be returned.
  * @param   pSendCS - whether to send Command Status response back.
  *
  * @return  SUCCESS, INVALIDPARAMETER, FAILURE,
  *          bleInvalidPDU or bleMemAllocError
  */
 static uint8 processICallGATT(uint8 cmdID, ICall_CmdMsg *msg_ptr,
-                              uint8 *pSendCS)
+                              uint8 *pRspDataLen, uint8 *pSendCS)
 {
 #if !defined(GATT_NO_CLIENT)
   attMsg_t *pReq = msg_ptr->gattReq.pReq;
@@ -1746,37 +1800,13 @@ static uint8 processDispMsg(ICall_CmdMsg *msg_ptr)
   uint8 cmdId = msg_ptr->hciExtCmd.cmdId;
   uint8 taskId = msg_ptr->hciExtCmd.srctaskid;
 
-  switch(subGroup)
+  if ((subGroup < DISPATCH_SUBGRP_NUM) && (dispHandlers[subGroup] != NULL))
   {
-    case DISPATCH_GENERAL:
-      stat = processDispGeneral(msg_ptr, &sendCmdStatus);
-      break;
-
-#if defined(HOST_CONFIG)
-    case DISPATCH_GAP_PROFILE:
-      stat = processDispGAPProfile(msg_ptr, &rspDataLen, &sendCmdStatus);
-      break;
-
-#if (HOST_CONFIG & (CENTRAL_CFG | PERIPHERAL_CFG))
-    case DISPATCH_GATT_PROFILE:
-      stat = processDispGATTProfile(msg_ptr, &sendCmdStatus);
-      break;
-
-#if !defined(GATT_DB_OFF_CHIP)
-    case DISPATCH_GAP_GATT_SERV:
-      stat = processDispGGS(msg_ptr, &sendCmdStatus);
-      break;
-
-    case DISPATCH_GATT_SERV_APP:
-      stat = processDispGSA(msg_ptr, &sendCmdStatus);
-      break;
-#endif // !GATT_DB_OFF_CHIP
-#endif // CENTRAL_CFG | PERIPHERAL_CFG
-#endif // HOST_CONFIG
-
-    default:
-      stat = FAILURE;
-      break;
+    stat = dispHandlers[subGroup](msg_ptr, &rspDataLen, &sendCmdStatus);
+  }
+  else
+  {
+    stat = FAILURE;
   }
 
   // Deallocate here to free up heap space for the serial message set out HCI.
@@ -1798,11 +1828,13 @@ static uint8 processDispMsg(ICall_CmdMsg *msg_ptr)
  * @brief   Parse and process incoming Dispatch General message
  *
  * @param   msg_ptr - pointer to incoming ICall message
+ * @param   pRspDataLen - response data length to be returned.
  * @param   pSendCS - whether to send Command Status response back.
  *
  * @return  SUCCESS, INVALIDPARAMETER or FAILURE
  */
-static uint8 processDispGeneral(ICall_CmdMsg *msg_ptr, uint8 *pSendCS)
+static uint8 processDispGeneral(ICall_CmdMsg *msg_ptr, uint8 *pRspDataLen,
+                                uint8 *pSendCS)
 {
   bStatus_t stat = SUCCESS;
   uint16 cmdID = msg_ptr->hciExtCmd.cmdId;
@@ -1950,11 +1982,13 @@ static uint8 processDispGAPProfile(ICall_CmdMsg *msg_ptr, uint8 *pRspDataLen,
  *          message
  *
  * @param   msg_ptr - pointer to incoming ICall message
+ * @param   pRspDataLen - response data length to be returned.
  * @param   pSendCS - whether to send Command Status response back.
  *
  * @return  SUCCESS, INVALIDPARAMETER or FAILURE
  */
-static uint8 processDispGATTProfile(ICall_CmdMsg *msg_ptr, uint8 *pSendCS)
+static uint8 processDispGATTProfile(ICall_CmdMsg *msg_ptr, uint8 *pRspDataLen,
+                                    uint8 *pSendCS)
 {
   bStatus_t stat = SUCCESS;
   uint16 cmdID = msg_ptr->hciExtCmd.cmdId;
@@ -2013,11 +2047,13 @@ static uint8 processDispGATTProfile(ICall_CmdMsg *msg_ptr, uint8 *pSendCS)
  * @brief   Parse and process incoming Dispatch GAP GATT Service
  *
  * @param   msg_ptr - pointer to incoming ICall message
+ * @param   pRspDataLen - response data length to be returned.
  * @param   pSendCS - whether to send Command Status response back.
  *
  * @return  SUCCESS, INVALIDPARAMETER or FAILURE
  */
-static uint8 processDispGGS(ICall_CmdMsg *msg_ptr, uint8 *pSendCS)
+static uint8 processDispGGS(ICall_CmdMsg *msg_ptr, uint8 *pRspDataLen,
+                            uint8 *pSendCS)
 {
   bStatus_t stat;
   uint16 cmdID = msg_ptr->hciExtCmd.cmdId;
@@ -2062,11 +2098,13 @@ static uint8 processDispGGS(ICall_CmdMsg *msg_ptr, uint8 *pSendCS)
  * @brief   Parse and process incoming Dispatch GATT Server App
  *
  * @param   msg_ptr - pointer to incoming ICall message
+ * @param   pRspDataLen - response data length to be returned.
  * @param   pSendCS - whether to send Command Status response back.
  *
  * @return  SUCCESS, INVALIDPARAMETER or FAILURE
  */
-static uint8 processDispGSA(ICall_CmdMsg *msg_ptr, uint8 *pSendCS)
+static uint8 processDispGSA(ICall_CmdMsg *msg_ptr, uint8 *pRspDataLen,
+                            uint8 *pSendCS)
 {
   bStatus_t stat = SUCCESS;
   uint16 cmdID = msg_ptr->hciExtCmd.cmdId;
@@ -79,16 +79,38 @@
 #define OSAL_PROXY_ID_FLAG       0x80
 #endif // USE_ICALL
 
+// Number of distinct events counted per task queue. Messages with further
+// events pending for the same task are counted together, and found by
+// scanning that task's queue.
+#ifndef OSAL_MSG_EVENT_SLOTS
+#define OSAL_MSG_EVENT_SLOTS     4
+#endif // OSAL_MSG_EVENT_SLOTS
+
+// osal_msg_count() event for messages of any event
+#define OSAL_MSG_ALL_EVENTS      0xFF
+
 /*********************************************************************
  * TYPEDEFS
  */
 
+// Message queue of a task, with the number of its messages per event.
+// A slot is free when its count is zero.
+typedef struct
+{
+  osal_msg_q_t head;
+  osal_msg_q_t tail;
+  uint8 count;                                // All messages
+  uint8 other;                                // Messages not in a slot
+  uint8 event[OSAL_MSG_EVENT_SLOTS];
+  uint8 eventCount[OSAL_MSG_EVENT_SLOTS];
+} osal_msg_task_q_t;
+
 /*********************************************************************
  * GLOBAL VARIABLES
  */
 
-// Message Pool Definitions
-osal_msg_q_t osal_qHead;
+// Message Pool Definitions, one queue per task
+static osal_msg_task_q_t *osal_taskQs;
 
 #ifdef USE_ICALL
 // OSAL event loop hook function pointer 
@@ -155,6 +177,9 @@ static uint8 osal_notask_entity;
  */
 
 static uint8 osal_msg_enqueue_push( uint8 destination_task, uint8 *msg_ptr, uint8 urgent );
+static uint8 *osal_msg_task_slot( osal_msg_task_q_t *q, uint8 event );
+static void osal_msg_task_counted( osal_msg_task_q_t *q, uint8 event );
+static void osal_msg_task_uncounted( osal_msg_task_q_t *q, uint8 event );
 
 #ifdef USE_ICALL
 static uint8 osal_alien2proxy(ICall_EntityID entity);
@@ -707,6 +732,9 @@ uint8 osal_msg_push_front( uint8 destination_task, uint8 *msg_ptr )
  */
 static uint8 osal_msg_enqueue_push( uint8 destination_task, uint8 *msg_ptr, uint8 push )
 {
+  osal_msg_task_q_t *q;
+  halIntState_t intState;
+
   if ( msg_ptr == NULL )
   {
     return ( INVALID_MSG_POINTER );
@@ -735,17 +763,40 @@ static uint8 osal_msg_enqueue_push( uint8 destination_task, uint8 *msg_ptr, uint
 
   OSAL_MSG_ID( msg_ptr ) = destination_task;
 
+  q = &osal_taskQs[destination_task];
+
+  // Hold off interrupts
+  HAL_ENTER_CRITICAL_SECTION(intState);
+
   if ( push == TRUE )
   {
     // prepend the message
-    osal_msg_push( &osal_qHead, msg_ptr );
+    OSAL_MSG_NEXT( msg_ptr ) = q->head;
+    q->head = msg_ptr;
+    if ( q->tail == NULL )
+    {
+      q->tail = msg_ptr;
+    }
   }
   else
   {
     // append the message
-    osal_msg_enqueue( &osal_qHead, msg_ptr );
+    if ( q->tail == NULL )
+    {
+      q->head = msg_ptr;
+    }
+    else
+    {
+      OSAL_MSG_NEXT( q->tail ) = msg_ptr;
+    }
+    q->tail = msg_ptr;
   }
 
+  osal_msg_task_counted( q, ((osal_event_hdr_t *)msg_ptr)->event );
+
+  // Release interrupts
+  HAL_EXIT_CRITICAL_SECTION(intState);
+
   // Signal the task that a message is waiting
   osal_set_event( destination_task, SYS_EVENT_MSG );
 
@@ -767,42 +818,40 @@ static uint8 osal_msg_enqueue_push( uint8 destination_task, uint8 *msg_ptr, uint
  */
 uint8 *osal_msg_receive( uint8 task_id )
 {
-  osal_msg_hdr_t *listHdr;
-  osal_msg_hdr_t *prevHdr = NULL;
-  osal_msg_hdr_t *foundHdr = NULL;
+  osal_msg_task_q_t *q;
+  osal_msg_hdr_t *foundHdr;
   halIntState_t   intState;
 
+  if ( task_id >= tasksCnt )
+  {
+    return ( NULL );
+  }
+
+  q = &osal_taskQs[task_id];
+
   // Hold off interrupts
   HAL_ENTER_CRITICAL_SECTION(intState);
 
-  // Point to the top of the queue
-  listHdr = osal_qHead;
+  // The task's first message, if any
+  foundHdr = q->head;
 
-  // Look through the queue for a message that belongs to the asking task
-  while ( listHdr != NULL )
+  // Did we find a message?
+  if ( foundHdr != NULL )
   {
-    if ( (listHdr - 1)->dest_id == task_id )
+    // Take it off the task's queue
+    q->head = OSAL_MSG_NEXT( foundHdr );
+    if ( q->head == NULL )
     {
-      if ( foundHdr == NULL )
-      {
-        // Save the first one
-        foundHdr = listHdr;
-      }
-      else
-      {
-        // Second msg found, stop looking
-        break;
-      }
-    }
-    if ( foundHdr == NULL )
-    {
-      prevHdr = listHdr;
+      q->tail = NULL;
     }
-    listHdr = OSAL_MSG_NEXT( listHdr );
+    OSAL_MSG_NEXT( foundHdr ) = NULL;
+    OSAL_MSG_ID( foundHdr ) = TASK_NO_TASK;
+
+    osal_msg_task_uncounted( q, ((osal_event_hdr_t *)foundHdr)->event );
   }
 
   // Is there more than one?
-  if ( listHdr != NULL )
+  if ( q->head != NULL )
   {
     // Yes, Signal the task that a message is waiting
     osal_set_event( task_id, SYS_EVENT_MSG );
@@ -813,13 +862,6 @@ uint8 *osal_msg_receive( uint8 task_id )
     osal_clear_event( task_id, SYS_EVENT_MSG );
   }
 
-  // Did we find a message?
-  if ( foundHdr != NULL )
-  {
-    // Take out of the link list
-    osal_msg_extract( &osal_qHead, foundHdr, prevHdr );
-  }
-
   // Release interrupts
   HAL_EXIT_CRITICAL_SECTION(intState);
 
@@ -846,22 +888,32 @@ uint8 *osal_msg_receive( uint8 task_id )
  */
 osal_event_hdr_t *osal_msg_find(uint8 task_id, uint8 event)
 {
-  osal_msg_hdr_t *pHdr;
+  osal_msg_task_q_t *q;
+  osal_msg_hdr_t *pHdr = NULL;
+  uint8 *pCount;
   halIntState_t intState;
 
+  if (task_id >= tasksCnt)
+  {
+    return NULL;
+  }
+
+  q = &osal_taskQs[task_id];
+
   HAL_ENTER_CRITICAL_SECTION(intState);  // Hold off interrupts.
 
-  pHdr = osal_qHead;  // Point to the top of the queue.
+  pCount = osal_msg_task_slot(q, event);
 
-  // Look through the queue for a message that matches the task_id and event parameters.
-  while (pHdr != NULL)
+  // Only look through the task's queue if it holds such a message, or may.
+  if (q->other != 0 || (pCount != NULL && *pCount != 0))
   {
-    if (((pHdr-1)->dest_id == task_id) && (((osal_event_hdr_t *)pHdr)->event == event))
+    for (pHdr = q->head; pHdr != NULL; pHdr = OSAL_MSG_NEXT(pHdr))
     {
-      break;
+      if (((osal_event_hdr_t *)pHdr)->event == event)
+      {
+        break;
+      }
     }
-
-    pHdr = OSAL_MSG_NEXT(pHdr);
   }
 
   HAL_EXIT_CRITICAL_SECTION(intState);  // Release interrupts.
@@ -891,23 +943,40 @@ osal_event_hdr_t *osal_msg_find(uint8 task_id, uint8 event)
 uint8 osal_msg_count( uint8 task_id, uint8 event )
 {
   uint8 count = 0;
+  osal_msg_task_q_t *q;
   osal_msg_hdr_t *pHdr;
+  uint8 *pCount;
   halIntState_t intState;
 
-  HAL_ENTER_CRITICAL_SECTION(intState);  // Hold off interrupts.
+  if ( task_id >= tasksCnt )
+  {
+    return ( 0 );
+  }
+
+  q = &osal_taskQs[task_id];
 
-  pHdr = osal_qHead;  // Point to the top of the queue.
+  HAL_ENTER_CRITICAL_SECTION(intState);  // Hold off interrupts.
 
-  // Look through the queue for a message that matches the task_id and event parameters.
-  while (pHdr != NULL)
+  if ( event == OSAL_MSG_ALL_EVENTS )
+  {
+    count = q->count;
+  }
+  else if ( q->other == 0 )
+  {
+    // Every message is in a slot
+    pCount = osal_msg_task_slot( q, event );
+    count = ( pCount != NULL ) ? *pCount : 0;
+  }
+  else
   {
-    if ( ((pHdr-1)->dest_id == task_id) 
-        && ((event == 0xFF) || (((osal_event_hdr_t *)pHdr)->event == event)) )
+    // Look through the task's queue for messages that match the event parameter.
+    for ( pHdr = q->head; pHdr != NULL; pHdr = OSAL_MSG_NEXT( pHdr ) )
     {
-      count++;
+      if ( ((osal_event_hdr_t *)pHdr)->event == event )
+      {
+        count++;
+      }
     }
-
-    pHdr = OSAL_MSG_NEXT(pHdr);
   }
 
   HAL_EXIT_CRITICAL_SECTION(intState);  // Release interrupts.
@@ -915,6 +984,104 @@ uint8 osal_msg_count( uint8 task_id, uint8 event )
   return ( count );
 }
 
+/*********************************************************************
+ * @fn      osal_msg_task_slot
+ *
+ * @brief
+ *
+ *    This function finds the count of a task queue's messages with
+ *    the given event. Called with interrupts held off.
+ *
+ * @param   osal_msg_task_q_t *q - task queue
+ * @param   uint8 event - message event
+ *
+ * @return  pointer to the event's count, or NULL if it has no slot
+ */
+static uint8 *osal_msg_task_slot( osal_msg_task_q_t *q, uint8 event )
+{
+  uint8 i;
+
+  for ( i = 0; i < OSAL_MSG_EVENT_SLOTS; i++ )
+  {
+    if ( q->eventCount[i] != 0 && q->event[i] == event )
+    {
+      return ( &q->eventCount[i] );
+    }
+  }
+
+  return ( NULL );
+}
+
+/*********************************************************************
+ * @fn      osal_msg_task_counted
+ *
+ * @brief
+ *
+ *    This function counts a message just put on a task queue, in its
+ *    event's slot, a free slot, or with the other messages. Called
+ *    with interrupts held off.
+ *
+ * @param   osal_msg_task_q_t *q - task queue
+ * @param   uint8 event - message event
+ *
+ * @return  none
+ */
+static void osal_msg_task_counted( osal_msg_task_q_t *q, uint8 event )
+{
+  uint8 *pCount = osal_msg_task_slot( q, event );
+  uint8 i;
+
+  q->count++;
+
+  if ( pCount == NULL )
+  {
+    for ( i = 0; i < OSAL_MSG_EVENT_SLOTS && q->eventCount[i] != 0; i++ );
+
+    if ( i == OSAL_MSG_EVENT_SLOTS )
+    {
+      q->other++;
+      return;
+    }
+
+    q->event[i] = event;
+    pCount = &q->eventCount[i];
+  }
+
+  (*pCount)++;
+}
+
+/*********************************************************************
+ * @fn      osal_msg_task_uncounted
+ *
+ * @brief
+ *
+ *    This function uncounts a message just taken off a task queue.
+ *    The event's slot never counts more messages than are queued
+ *    with that event, so while other messages are counted outside
+ *    the slots, the message may be taken from either. Called with
+ *    interrupts held off.
+ *
+ * @param   osal_msg_task_q_t *q - task queue
+ * @param   uint8 event - message event
+ *
+ * @return  none
+ */
+static void osal_msg_task_uncounted( osal_msg_task_q_t *q, uint8 event )
+{
+  uint8 *pCount = osal_msg_task_slot( q, event );
+
+  q->count--;
+
+  if ( pCount != NULL )
+  {
+    (*pCount)--;
+  }
+  else
+  {
+    q->other--;
+  }
+}
+
 /*********************************************************************
  * @fn      osal_msg_enqueue
  *
@@ -1319,7 +1486,8 @@ uint8 osal_int_disable( uint8 interrupt_id )
  *
  * @param   void
  *
- * @return  SUCCESS
+ * @return  SUCCESS, or MSG_BUFFER_NOT_AVAIL if the task message queues
+ *          could not be allocated
  */
 uint8 osal_init_system( void )
 {
@@ -1328,8 +1496,13 @@ uint8 osal_init_system( void )
   osal_mem_init();
 #endif /* !defined USE_ICALL && !defined OSAL_PORT2TIRTOS */
 
-  // Initialize the message queue
-  osal_qHead = NULL;
+  // Initialize the message queues
+  osal_taskQs = (osal_msg_task_q_t *) osal_mem_alloc( sizeof( osal_msg_task_q_t ) * tasksCnt );
+  if ( osal_taskQs == NULL )
+  {
+    return ( MSG_BUFFER_NOT_AVAIL );
+  }
+  osal_memset( osal_taskQs, 0, sizeof( osal_msg_task_q_t ) * tasksCnt );
 
   // Initialize the timers
   osalTimerInit();
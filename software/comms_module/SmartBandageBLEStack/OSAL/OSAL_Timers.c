@@ -51,35 +51,45 @@
  * MACROS
  */
 
+// Wrap safe comparison of two osal_systemClock values. Timeouts are at most
+// OSAL_TIMERS_MAX_TIMEOUT, well within half the range.
+#define OSAL_TIMER_BEFORE( a, b )  ( (int32)((a) - (b)) < 0 )
+
+#define OSAL_TIMER_HASH( task_id, event_flag ) \
+  ( ((task_id) ^ (event_flag) ^ ((event_flag) >> 5) ^ ((event_flag) >> 10)) & (OSAL_TIMERS_HASH_SIZE - 1) )
+
 /*********************************************************************
  * CONSTANTS
  */
 
+// Buckets in the task/event lookup. A power of two.
+#ifndef OSAL_TIMERS_HASH_SIZE
+  #define OSAL_TIMERS_HASH_SIZE  16
+#endif
+
+// Slots allocated for the heap when the first timer is started. Doubled as needed.
+#ifndef OSAL_TIMERS_HEAP_INIT
+  #define OSAL_TIMERS_HEAP_INIT  8
+#endif
+
 /*********************************************************************
  * TYPEDEFS
  */
 
-typedef union {
-  uint32 time32;
-  uint16 time16[2];
-  uint8 time8[4];
-} osalTime_t;
-
-typedef struct
+typedef struct osalTimerRec
 {
-  void   *next;
-  osalTime_t timeout;
+  struct osalTimerRec *next;  // Next timer in the same hash bucket
+  uint32 expiry;              // osal_systemClock value at which the timer expires
+  uint32 reloadTimeout;
   uint16 event_flag;
+  uint16 heapIdx;             // Position in timerHeap
   uint8  task_id;
-  uint32 reloadTimeout;
 } osalTimerRec_t;
 
 /*********************************************************************
  * GLOBAL VARIABLES
  */
 
-osalTimerRec_t *timerHead;
-
 /*********************************************************************
  * EXTERNAL VARIABLES
  */
@@ -94,6 +104,15 @@ osalTimerRec_t *timerHead;
 // Milliseconds since last reboot
 static uint32 osal_systemClock;
 
+// Active timers as a binary min-heap on expiry, so the next timer to expire
+// is always timerHeap[0].
+static osalTimerRec_t **timerHeap;
+static uint16 timerHeapSize;
+static uint16 timerHeapCapacity;
+
+// Active timers by task and event
+static osalTimerRec_t *timerHash[OSAL_TIMERS_HASH_SIZE];
+
 /*********************************************************************
  * LOCAL FUNCTION PROTOTYPES
  */
@@ -101,6 +120,11 @@ osalTimerRec_t  *osalAddTimer( uint8 task_id, uint16 event_flag, uint32 timeout
 osalTimerRec_t *osalFindTimer( uint8 task_id, uint16 event_flag );
 void osalDeleteTimer( osalTimerRec_t *rmTimer );
 
+static void osalHeapSet( uint16 idx, osalTimerRec_t *timer );
+static void osalHeapUp( uint16 idx );
+static void osalHeapDown( uint16 idx );
+static uint32 osalTimerRemaining( osalTimerRec_t *timer );
+
 /*********************************************************************
  * FUNCTIONS
  *********************************************************************/
@@ -119,10 +143,123 @@ void osalTimerInit( void )
   osal_systemClock = 0;
 }
 
+/*********************************************************************
+ * @fn      osalHeapSet
+ *
+ * @brief   Place a timer in a heap slot.
+ *
+ * @param   idx
+ * @param   timer
+ *
+ * @return  none
+ */
+static void osalHeapSet( uint16 idx, osalTimerRec_t *timer )
+{
+  timerHeap[idx] = timer;
+  timer->heapIdx = idx;
+}
+
+/*********************************************************************
+ * @fn      osalHeapUp
+ *
+ * @brief   Move a timer towards the top of the heap until its parent
+ *          expires no later than it does.
+ *          Ints must be disabled.
+ *
+ * @param   idx - slot of the timer
+ *
+ * @return  none
+ */
+static void osalHeapUp( uint16 idx )
+{
+  osalTimerRec_t *timer = timerHeap[idx];
+  uint16 parent;
+
+  while ( idx > 0 )
+  {
+    parent = (idx - 1) / 2;
+
+    if ( !OSAL_TIMER_BEFORE( timer->expiry, timerHeap[parent]->expiry ) )
+    {
+      break;
+    }
+
+    osalHeapSet( idx, timerHeap[parent] );
+    idx = parent;
+  }
+
+  osalHeapSet( idx, timer );
+}
+
+/*********************************************************************
+ * @fn      osalHeapDown
+ *
+ * @brief   Move a timer towards the bottom of the heap until neither
+ *          child expires before it.
+ *          Ints must be disabled.
+ *
+ * @param   idx - slot of the timer
+ *
+ * @return  none
+ */
+static void osalHeapDown( uint16 idx )
+{
+  osalTimerRec_t *timer = timerHeap[idx];
+  uint16 child;
+
+  for ( ;; )
+  {
+    child = 2 * idx + 1;
+
+    if ( child >= timerHeapSize )
+    {
+      break;
+    }
+
+    // Pick the earlier of the two children
+    if ( child + 1 < timerHeapSize &&
+         OSAL_TIMER_BEFORE( timerHeap[child + 1]->expiry, timerHeap[child]->expiry ) )
+    {
+      child++;
+    }
+
+    if ( !OSAL_TIMER_BEFORE( timerHeap[child]->expiry, timer->expiry ) )
+    {
+      break;
+    }
+
+    osalHeapSet( idx, timerHeap[child] );
+    idx = child;
+  }
+
+  osalHeapSet( idx, timer );
+}
+
+/*********************************************************************
+ * @fn      osalTimerRemaining
+ *
+ * @brief   Milliseconds until a timer expires.
+ *          Ints must be disabled.
+ *
+ * @param   timer
+ *
+ * @return  Remaining time, zero if already due
+ */
+static uint32 osalTimerRemaining( osalTimerRec_t *timer )
+{
+  if ( OSAL_TIMER_BEFORE( osal_systemClock, timer->expiry ) )
+  {
+    return ( timer->expiry - osal_systemClock );
+  }
+
+  return ( 0 );
+}
+
 /*********************************************************************
  * @fn      osalAddTimer
  *
- * @brief   Add a timer to the timer list.
+ * @brief   Add a timer to the timer heap, or restart it if it is already
+ *          there.
  *          Ints must be disabled.
  *
  * @param   task_id
@@ -134,63 +271,77 @@ void osalTimerInit( void )
 osalTimerRec_t * osalAddTimer( uint8 task_id, uint16 event_flag, uint32 timeout )
 {
   osalTimerRec_t *newTimer;
-  osalTimerRec_t *srchTimer;
+  osalTimerRec_t **newHeap;
+  uint16 newCapacity;
+  uint8 bucket;
 
   // Look for an existing timer first
   newTimer = osalFindTimer( task_id, event_flag );
   if ( newTimer )
   {
     // Timer is found - update it.
-    newTimer->timeout.time32 = timeout;
+    newTimer->expiry = osal_systemClock + timeout;
+    osalHeapUp( newTimer->heapIdx );
+    osalHeapDown( newTimer->heapIdx );
 
     return ( newTimer );
   }
-  else
+
+  // Make room in the heap
+  if ( timerHeapSize == timerHeapCapacity )
   {
-    // New Timer
-    newTimer = osal_mem_alloc( sizeof( osalTimerRec_t ) );
+    newCapacity = timerHeapCapacity ? 2 * timerHeapCapacity : OSAL_TIMERS_HEAP_INIT;
 
-    if ( newTimer )
+    // osal_mem_alloc() takes a 16 bit size
+    if ( newCapacity > 0xFFFF / sizeof( osalTimerRec_t * ) )
     {
-      // Fill in new timer
-      newTimer->task_id = task_id;
-      newTimer->event_flag = event_flag;
-      newTimer->timeout.time32 = timeout;
-      newTimer->next = (void *)NULL;
-      newTimer->reloadTimeout = 0;
-
-      // Does the timer list already exist
-      if ( timerHead == NULL )
-      {
-        // Start task list
-        timerHead = newTimer;
-      }
-      else
-      {
-        // Add it to the end of the timer list
-        srchTimer = timerHead;
-
-        // Stop at the last record
-        while ( srchTimer->next )
-          srchTimer = srchTimer->next;
-
-        // Add to the list
-        srchTimer->next = newTimer;
-      }
-
-      return ( newTimer );
+      return ( (osalTimerRec_t *)NULL );
     }
-    else
+
+    newHeap = osal_mem_alloc( newCapacity * sizeof( osalTimerRec_t * ) );
+    if ( newHeap == NULL )
     {
       return ( (osalTimerRec_t *)NULL );
     }
+
+    if ( timerHeap )
+    {
+      osal_memcpy( newHeap, timerHeap, timerHeapSize * sizeof( osalTimerRec_t * ) );
+      osal_mem_free( timerHeap );
+    }
+
+    timerHeap = newHeap;
+    timerHeapCapacity = newCapacity;
   }
+
+  // New Timer
+  newTimer = osal_mem_alloc( sizeof( osalTimerRec_t ) );
+
+  if ( newTimer )
+  {
+    // Fill in new timer
+    newTimer->task_id = task_id;
+    newTimer->event_flag = event_flag;
+    newTimer->expiry = osal_systemClock + timeout;
+    newTimer->reloadTimeout = 0;
+
+    // Add it to its hash bucket
+    bucket = OSAL_TIMER_HASH( task_id, event_flag );
+    newTimer->next = timerHash[bucket];
+    timerHash[bucket] = newTimer;
+
+    // And to the bottom of the heap, from where it rises to its place
+    osalHeapSet( timerHeapSize++, newTimer );
+    osalHeapUp( newTimer->heapIdx );
+  }
+
+  return ( newTimer );
 }
 
 /*********************************************************************
  * @fn      osalFindTimer
  *
- * @brief   Find a timer in a timer list.
+ * @brief   Find a timer in the timer hash.
  *          Ints must be disabled.
  *
  * @param   task_id
@@ -202,8 +353,8 @@ osalTimerRec_t *osalFindTimer( uint8 task_id, uint16 event_flag )
 {
   osalTimerRec_t *srchTimer;
 
-  // Head of the timer list
-  srchTimer = timerHead;
+  // Only timers in this bucket can match
+  srchTimer = timerHash[OSAL_TIMER_HASH( task_id, event_flag )];
 
   // Stop when found or at the end
   while ( srchTimer )
@@ -224,21 +375,40 @@ osalTimerRec_t *osalFindTimer( uint8 task_id, uint16 event_flag )
 /*********************************************************************
  * @fn      osalDeleteTimer
  *
- * @brief   Delete a timer from a timer list.
+ * @brief   Take a timer out of the timer heap and hash. The caller
+ *          frees it, outside the critical section.
+ *          Ints must be disabled.
  *
- * @param   table
  * @param   rmTimer
  *
  * @return  none
  */
 void osalDeleteTimer( osalTimerRec_t *rmTimer )
 {
-  // Does the timer list really exist
-  if ( rmTimer )
+  osalTimerRec_t **link;
+  osalTimerRec_t *last;
+
+  // Does the timer really exist
+  if ( rmTimer == NULL )
+  {
+    return;
+  }
+
+  // Unlink it from its hash bucket
+  link = &timerHash[OSAL_TIMER_HASH( rmTimer->task_id, rmTimer->event_flag )];
+  while ( *link != rmTimer )
   {
-    // Clear the event flag and osalTimerUpdate() will delete
-    // the timer from the list.
-    rmTimer->event_flag = 0;
+    link = &(*link)->next;
+  }
+  *link = rmTimer->next;
+
+  // Fill its heap slot with the last timer, and move that one into place
+  last = timerHeap[--timerHeapSize];
+  if ( last != rmTimer )
+  {
+    osalHeapSet( rmTimer->heapIdx, last );
+    osalHeapUp( last->heapIdx );
+    osalHeapDown( last->heapIdx );
   }
 }
 
@@ -336,6 +506,11 @@ uint8 osal_stop_timerEx( uint8 task_id, uint16 event_id )
 
   HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
 
+  if ( foundTimer )
+  {
+    osal_mem_free( foundTimer );
+  }
+
   return ( (foundTimer != NULL) ? SUCCESS : INVALID_EVENT_ID );
 }
 
@@ -361,7 +536,7 @@ uint32 osal_get_timeoutEx( uint8 task_id, uint16 event_id )
 
   if ( tmr )
   {
-    rtrn = tmr->timeout.time32;
+    rtrn = osalTimerRemaining( tmr );
   }
 
   HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
@@ -381,30 +556,22 @@ uint32 osal_get_timeoutEx( uint8 task_id, uint16 event_id )
 uint8 osal_timer_num_active( void )
 {
   halIntState_t intState;
-  uint8 num_timers = 0;
-  osalTimerRec_t *srchTimer;
+  uint16 num_timers;
 
   HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
 
-  // Head of the timer list
-  srchTimer = timerHead;
-
-  // Count timers in the list
-  while ( srchTimer != NULL )
-  {
-    num_timers++;
-    srchTimer = srchTimer->next;
-  }
+  num_timers = timerHeapSize;
 
   HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
 
-  return num_timers;
+  return ( (num_timers > 0xFF) ? 0xFF : (uint8)num_timers );
 }
 
 /*********************************************************************
  * @fn      osalTimerUpdate
  *
- * @brief   Update the timer structures for a timer tick.
+ * @brief   Update the timer structures for a timer tick. Only the timers
+ *          that expire are touched, each in its own critical section.
  *
  * @param   none
  *
@@ -413,116 +580,56 @@ uint8 osal_timer_num_active( void )
 void osalTimerUpdate( uint32 updateTime )
 {
   halIntState_t intState;
-  osalTimerRec_t *srchTimer;
-  osalTimerRec_t *prevTimer;
-
-  osalTime_t timeUnion;
-  timeUnion.time32 = updateTime;
+  osalTimerRec_t *freeTimer;
+  uint16 event_flag;
+  uint8 task_id;
+  uint8 due;
 
   HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
   // Update the system time
   osal_systemClock += updateTime;
   HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
 
-  // Look for open timer slot
-  if ( timerHead != NULL )
+  do
   {
-    // Add it to the end of the timer list
-    srchTimer = timerHead;
-    prevTimer = (void *)NULL;
+    freeTimer = NULL;
 
-    // Look for open timer slot
-    while ( srchTimer )
-    {
-      osalTimerRec_t *freeTimer = NULL;
+    HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
 
-      HAL_ENTER_CRITICAL_SECTION( intState );  // Hold off interrupts.
-
-      // To minimize time in this critical section, avoid 32-bit math
-      if ((timeUnion.time16[1] == 0) && (timeUnion.time8[1] == 0))
-      {
-        // If upper 24 bits are zero, check lower 8 bits for roll over
-        if (srchTimer->timeout.time8[0] >= timeUnion.time8[0])
-        {
-          // 8-bit math
-          srchTimer->timeout.time8[0] -= timeUnion.time8[0];
-        }
-        else
-        {
-          // 32-bit math
-          if (srchTimer->timeout.time32 > timeUnion.time32)
-          {
-            srchTimer->timeout.time32 -= timeUnion.time32;
-          }
-          else
-          {
-            srchTimer->timeout.time32 = 0;
-          }
-        }
-      }
-      else
-      {
-          // 32-bit math
-        if (srchTimer->timeout.time32 > timeUnion.time32)
-        {
-          srchTimer->timeout.time32 -= timeUnion.time32;
-        }
-        else
-        {
-          srchTimer->timeout.time32 = 0;
-        }
-      }
+    // The earliest timer is on top of the heap
+    due = ( timerHeapSize > 0 ) && !OSAL_TIMER_BEFORE( osal_systemClock, timerHeap[0]->expiry );
+    if ( due )
+    {
+      task_id = timerHeap[0]->task_id;
+      event_flag = timerHeap[0]->event_flag;
 
-      // Check for reloading
-      if ( (srchTimer->timeout.time16[0] == 0) && (srchTimer->timeout.time16[1] == 0) &&
-           (srchTimer->reloadTimeout) && (srchTimer->event_flag) )
+      if ( timerHeap[0]->reloadTimeout )
       {
-        // Notify the task of a timeout
-        osal_set_event( srchTimer->task_id, srchTimer->event_flag );
-
         // Reload the timer timeout value
-        srchTimer->timeout.time32 = srchTimer->reloadTimeout;
-      }
-
-      // When timeout or delete (event_flag == 0)
-      if ( ((srchTimer->timeout.time16[0] == 0) && (srchTimer->timeout.time16[1] == 0)) ||
-            (srchTimer->event_flag == 0) )
-      {
-        // Take out of list
-        if ( prevTimer == NULL )
-        {
-          timerHead = srchTimer->next;
-        }
-        else
-        {
-          prevTimer->next = srchTimer->next;
-        }
-
-        // Setup to free memory
-        freeTimer = srchTimer;
-
-        // Next
-        srchTimer = srchTimer->next;
+        timerHeap[0]->expiry = osal_systemClock + timerHeap[0]->reloadTimeout;
+        osalHeapDown( 0 );
       }
       else
       {
-        // Get next
-        prevTimer = srchTimer;
-        srchTimer = srchTimer->next;
+        // Take out of heap and setup to free memory
+        freeTimer = timerHeap[0];
+        osalDeleteTimer( freeTimer );
       }
+    }
 
-      HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
+    HAL_EXIT_CRITICAL_SECTION( intState );   // Re-enable interrupts.
 
-      if ( freeTimer )
-      {
-        if ( (freeTimer->timeout.time16[0] == 0) && (freeTimer->timeout.time16[1] == 0) )
-        {
-          osal_set_event( freeTimer->task_id, freeTimer->event_flag );
-        }
-        osal_mem_free( freeTimer );
-      }
+    if ( due )
+    {
+      // Notify the task of a timeout
+      osal_set_event( task_id, event_flag );
     }
-  }
+
+    if ( freeTimer )
+    {
+      osal_mem_free( freeTimer );
+    }
+  } while ( due );
 }
 
 #ifdef POWER_SAVING
@@ -539,7 +646,7 @@ void osal_adjust_timers( void )
 {
   uint32 eTime;
 
-  if ( timerHead != NULL )
+  if ( timerHeapSize > 0 )
   {
     // Compute elapsed time (msec)
     eTime = TimerElapsed() / TICK_COUNT;
@@ -558,8 +665,10 @@ void osal_adjust_timers( void )
  *
  * @brief
  *
- *   Search timer table to return the lowest timeout value. If the
- *   timer list is empty, then the returned timeout will be zero.
+ *   Return the lowest timeout value, that of the timer on top of the
+ *   heap. If there are no timers, then the returned timeout will be
+ *   zero; a timer that is already due is returned as 1 ms, so it is
+ *   not taken for none.
  *
  * @param   none
  *
@@ -568,23 +677,18 @@ void osal_adjust_timers( void )
 uint32 osal_next_timeout( void )
 {
   uint32 nextTimeout;
-  osalTimerRec_t *srchTimer;
 
-  if ( timerHead != NULL )
+  if ( timerHeapSize > 0 )
   {
-    // Head of the timer list
-    srchTimer = timerHead;
-    nextTimeout = OSAL_TIMERS_MAX_TIMEOUT;
+    nextTimeout = osalTimerRemaining( timerHeap[0] );
 
-    // Look for the next timeout timer
-    while ( srchTimer != NULL )
+    if ( nextTimeout == 0 )
     {
-      if (srchTimer->timeout.time32 < nextTimeout)
-      {
-        nextTimeout = srchTimer->timeout.time32;
-      }
-      // Check next timer
-      srchTimer = srchTimer->next;
+      nextTimeout = 1;
+    }
+    else if ( nextTimeout > OSAL_TIMERS_MAX_TIMEOUT )
+    {
+      nextTimeout = OSAL_TIMERS_MAX_TIMEOUT;
     }
   }
   else
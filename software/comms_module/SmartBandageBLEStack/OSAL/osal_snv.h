@@ -131,6 +131,31 @@ extern uint8 osal_snv_write( osalSnvId_t id, osalSnvLen_t len, void *pBuf);
  */
 extern uint8 osal_snv_compact( uint8 threshold );
 
+/*********************************************************************
+ * @fn      osal_snv_defer
+ *
+ * @brief   Keep written CCC tables in RAM until they are flushed, so
+ *          that rewriting one costs no flash program. Other items, and
+ *          tables that do not fit the cache, are still written through.
+ *
+ * @param   defer - TRUE to defer writes, FALSE to write through again.
+ *                  Deferred items stay in RAM until flushed.
+ *
+ * @return  none
+ */
+extern void osal_snv_defer( uint8 defer );
+
+/*********************************************************************
+ * @fn      osal_snv_flush
+ *
+ * @brief   Write deferred items to NV.
+ *
+ * @param   maxItems - most items to write, 0 for all of them.
+ *
+ * @return  number of deferred items left.
+ */
+extern uint8 osal_snv_flush( uint8 maxItems );
+
 /*********************************************************************
 *********************************************************************/
 
@@ -42,11 +42,22 @@
 #define OSAL_SNV 2
 #endif
 
+// With NV, the flash implementations below are renamed and the write cache
+// at the end of this file provides the osal_snv interface.
+#if OSAL_SNV != 0 && !defined(NO_OSAL_SNV)
+#define OSAL_SNV_CACHE
+#define osal_snv_init     osalSnvInitNV
+#define osal_snv_read     osalSnvReadNV
+#define osal_snv_write    osalSnvWriteNV
+#define osal_snv_compact  osalSnvCompactNV
+#endif
+
 // Map 2 and 0 to 2 page SNV.  0 was arbitrarily chosen to go here.
 #if OSAL_SNV == 2 || OSAL_SNV == 0
 #if OSAL_SNV == 0 && !defined(NO_OSAL_SNV)
 #define NO_OSAL_SNV
 #endif //OSAL_SNV == 0 && !defined(NO_OSAL_SNV)
+#include "osal_snv.h"
 #include "osal_snv.c"
 #elif OSAL_SNV == 1 // This is the 1 page SNV
 #include "osal_snv.h"
@@ -144,3 +155,285 @@ uint8 osal_snv_compact( uint8 threshold )
 #else // bad OSAL_SNV value
 #error "Valid OSAL_SNV values are 0, 1, or 2!"
 #endif //OSAL_SNV
+
+#include "OSAL.h"
+
+#if defined( OSAL_SNV_CACHE )
+
+#include "bcomdef.h"
+
+#undef osal_snv_init
+#undef osal_snv_read
+#undef osal_snv_write
+#undef osal_snv_compact
+
+/*********************************************************************
+ * CONSTANTS
+ */
+// Number of items the write cache holds, and the longest item it takes
+#if !defined( OSAL_SNV_CACHE_ITEMS )
+  #define OSAL_SNV_CACHE_ITEMS        8
+#endif
+#if !defined( OSAL_SNV_CACHE_ITEM_LEN )
+  #define OSAL_SNV_CACHE_ITEM_LEN     16
+#endif
+
+// Items that may be deferred: the bond manager's CCC tables, which peers
+// rewrite throughout a connection. Bond records and keys are written
+// through so a reset never loses a pairing.
+#if !defined( OSAL_SNV_CACHE_ID_FIRST )
+  #define OSAL_SNV_CACHE_ID_FIRST     BLE_NVID_GATT_CFG_START
+#endif
+#if !defined( OSAL_SNV_CACHE_ID_LAST )
+  #define OSAL_SNV_CACHE_ID_LAST      BLE_NVID_GATT_CFG_END
+#endif
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+// An item written while writes are deferred
+typedef struct
+{
+  osalSnvId_t  id;
+  osalSnvLen_t len;                           // 0 if the entry is unused
+  uint8        buf[OSAL_SNV_CACHE_ITEM_LEN];
+} osalSnvCacheItem_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+static osalSnvCacheItem_t snvCache[OSAL_SNV_CACHE_ITEMS];
+static uint8 snvDefer = FALSE;
+
+/*********************************************************************
+ * @fn      osalSnvCacheFind
+ *
+ * @brief   Find the deferred copy of an item.
+ *
+ * @param   id - Valid NV item Id.
+ *
+ * @return  the cache entry, NULL if the item is not deferred.
+ */
+static osalSnvCacheItem_t *osalSnvCacheFind( osalSnvId_t id )
+{
+  uint8 i;
+
+  for ( i = 0; i < OSAL_SNV_CACHE_ITEMS; i++ )
+  {
+    if ( ( snvCache[i].len != 0 ) && ( snvCache[i].id == id ) )
+    {
+      return ( &snvCache[i] );
+    }
+  }
+
+  return ( NULL );
+}
+
+/*********************************************************************
+ * @fn      osalSnvCacheFlushItem
+ *
+ * @brief   Write a deferred item to NV and free its entry. The entry
+ *          is freed even if the write fails, as it would have been
+ *          lost written through.
+ *
+ * @param   pItem - cache entry in use.
+ *
+ * @return  SUCCESS if successful, NV_OPER_FAILED if failed.
+ */
+static uint8 osalSnvCacheFlushItem( osalSnvCacheItem_t *pItem )
+{
+  uint8 ret = osalSnvWriteNV( pItem->id, pItem->len, pItem->buf );
+
+  pItem->len = 0;
+
+  return ( ret );
+}
+
+/*********************************************************************
+ * @fn      osal_snv_init
+ *
+ * @brief   Initialize NV service.
+ *
+ * @param   none
+ *
+ * @return  SUCCESS if initialization succeeds. FAILURE, otherwise.
+ */
+uint8 osal_snv_init( void )
+{
+  VOID osal_memset( snvCache, 0, sizeof( snvCache ) );
+  snvDefer = FALSE;
+
+  return ( osalSnvInitNV() );
+}
+
+/*********************************************************************
+ * @fn      osal_snv_read
+ *
+ * @brief   Read data from NV, or its deferred copy.
+ *
+ * @param   id   - Valid NV item Id.
+ * @param   len  - Length of data to read.
+ * @param   *pBuf - Data is read into this buffer.
+ *
+ * @return  SUCCESS if successful.
+ *          Otherwise, NV_OPER_FAILED for failure.
+ */
+uint8 osal_snv_read( osalSnvId_t id, osalSnvLen_t len, void *pBuf )
+{
+  osalSnvCacheItem_t *pItem = osalSnvCacheFind( id );
+
+  if ( pItem != NULL )
+  {
+    if ( len <= pItem->len )
+    {
+      VOID osal_memcpy( pBuf, pItem->buf, len );
+
+      return ( SUCCESS );
+    }
+
+    // Longer than written, so read it the way NV would return it
+    VOID osalSnvCacheFlushItem( pItem );
+  }
+
+  return ( osalSnvReadNV( id, len, pBuf ) );
+}
+
+/*********************************************************************
+ * @fn      osal_snv_write
+ *
+ * @brief   Write a data item to NV. While writes are deferred, CCC
+ *          tables are kept in RAM and a rewrite replaces the copy.
+ *
+ * @param   id   - Valid NV item Id.
+ * @param   len  - Length of data to write.
+ * @param   *pBuf - Data to write.
+ *
+ * @return  SUCCESS if successful, NV_OPER_FAILED if failed.
+ */
+uint8 osal_snv_write( osalSnvId_t id, osalSnvLen_t len, void *pBuf )
+{
+  osalSnvCacheItem_t *pItem = osalSnvCacheFind( id );
+
+  if ( snvDefer && ( id >= OSAL_SNV_CACHE_ID_FIRST ) &&
+       ( id <= OSAL_SNV_CACHE_ID_LAST ) && ( len != 0 ) &&
+       ( len <= OSAL_SNV_CACHE_ITEM_LEN ) )
+  {
+    uint8 i;
+
+    for ( i = 0; ( pItem == NULL ) && ( i < OSAL_SNV_CACHE_ITEMS ); i++ )
+    {
+      if ( snvCache[i].len == 0 )
+      {
+        pItem = &snvCache[i];
+      }
+    }
+
+    if ( pItem != NULL )
+    {
+      pItem->id = id;
+      pItem->len = len;
+      VOID osal_memcpy( pItem->buf, pBuf, len );
+
+      return ( SUCCESS );
+    }
+  }
+
+  // Written through, any deferred copy is out of date
+  if ( pItem != NULL )
+  {
+    pItem->len = 0;
+  }
+
+  return ( osalSnvWriteNV( id, len, pBuf ) );
+}
+
+/*********************************************************************
+ * @fn      osal_snv_defer
+ *
+ * @brief   Keep written items in RAM until they are flushed.
+ *
+ * Public function defined in osal_snv.h.
+ */
+void osal_snv_defer( uint8 defer )
+{
+  snvDefer = defer;
+}
+
+/*********************************************************************
+ * @fn      osal_snv_flush
+ *
+ * @brief   Write deferred items to NV.
+ *
+ * Public function defined in osal_snv.h.
+ */
+uint8 osal_snv_flush( uint8 maxItems )
+{
+  uint8 written = 0;
+  uint8 left = 0;
+  uint8 i;
+
+  for ( i = 0; i < OSAL_SNV_CACHE_ITEMS; i++ )
+  {
+    if ( snvCache[i].len != 0 )
+    {
+      if ( ( maxItems == 0 ) || ( written < maxItems ) )
+      {
+        VOID osalSnvCacheFlushItem( &snvCache[i] );
+        written++;
+      }
+      else
+      {
+        left++;
+      }
+    }
+  }
+
+  return ( left );
+}
+
+/*********************************************************************
+ * @fn      osal_snv_compact
+ *
+ * @brief   Write the deferred items, then compact NV if its usage has
+ *          reached a specific threshold.
+ *
+ * @param   threshold - compaction threshold.
+ *
+ * @return  as the NV implementation's compaction.
+ */
+uint8 osal_snv_compact( uint8 threshold )
+{
+  VOID osal_snv_flush( 0 );
+
+  return ( osalSnvCompactNV( threshold ) );
+}
+
+#else // !OSAL_SNV_CACHE
+
+/*********************************************************************
+ * @fn      osal_snv_defer
+ *
+ * @brief   Without NV, there is nothing to defer.
+ *
+ * Public function defined in osal_snv.h.
+ */
+void osal_snv_defer( uint8 defer )
+{
+  VOID defer;
+}
+
+/*********************************************************************
+ * @fn      osal_snv_flush
+ *
+ * @brief   Without NV, there is nothing to flush.
+ *
+ * Public function defined in osal_snv.h.
+ */
+uint8 osal_snv_flush( uint8 maxItems )
+{
+  VOID maxItems;
+
+  return ( 0 );
+}
+
+#endif // OSAL_SNV_CACHE
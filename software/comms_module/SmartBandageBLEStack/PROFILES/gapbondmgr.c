@@ -69,10 +69,20 @@
 #define GAP_BOND_SYNC_CC_EVT                            0x0001 // Sync char config
 #define GAP_BOND_SAVE_REC_EVT                           0x0002 // Save bond record in NV
 #define GAP_BOND_SAVE_RCA_EVT                           0x0004 // Save reconnection address in NV
+#define GAP_BOND_NV_IDLE_EVT                            0x0008 // Write deferred NV items, then compact NV
 
 // Once NV usage reaches this percentage threshold, NV compaction gets triggered.
 #define NV_COMPACT_THRESHOLD                            80
 
+// Number of resolved private addresses remembered
+#if !defined ( GAP_BOND_RPA_CACHE_SIZE )
+  #define GAP_BOND_RPA_CACHE_SIZE                       4
+#endif
+
+#if ( GAP_BONDINGS_MAX > 16 )
+  #error "bondIRKs has one bit per bond, 16 bonds at most"
+#endif
+
 // Bonded State Flags
 #define GAP_BONDED_STATE_AUTHENTICATED                  0x0001
 #define GAP_BONDED_STATE_SERVICE_CHANGED                0x0002
@@ -154,6 +164,13 @@ typedef struct
   uint8  value;       // attribute value for this device
 } gapBondCharCfg_t;
 
+// A resolved private address and the bond it resolved to
+typedef struct
+{
+  uint8 addr[B_ADDR_LEN];  // Resolvable private address
+  uint8 idx;               // Bond index, GAP_BONDINGS_MAX if unused
+} gapBondRPA_t;
+
 /*********************************************************************
  * GLOBAL VARIABLES
  */
@@ -202,12 +219,26 @@ static const gapBondCBs_t *pGapBondCB = NULL;
 // Local RAM shadowed bond records
 static gapBondRec_t bonds[GAP_BONDINGS_MAX] = {0};
 
+// One byte hash of each bond's public address, compared before the address
+static uint8 bondAddrHash[GAP_BONDINGS_MAX] = {0};
+
+// Bonds with the connected device's IRK in NV, one bit per bond
+static uint16 bondIRKs = 0;
+
+// Recently resolved private addresses, replaced oldest first. A device keeps
+// its address for minutes, and it is resolved several times per connection.
+static gapBondRPA_t bondRPACache[GAP_BOND_RPA_CACHE_SIZE];
+static uint8 bondRPANext = 0;
+
 static uint8 autoSyncWhiteList = FALSE;
 
 static uint8 eraseAllBonds = FALSE;
 
 static uint8 bondsToDelete[GAP_BONDINGS_MAX] = {FALSE};
 
+// NV compaction waiting for the deferred NV items to be written
+static uint8 nvCompactPending = FALSE;
+
 // Globals used for saving bond record and CCC values in NV
 static uint8 bondIdx = GAP_BONDINGS_MAX;
 static gapAuthCompleteEvent_t *pAuthEvt = NULL;
@@ -234,6 +265,8 @@ static bStatus_t gapBondMgrGetPublicAddr( uint8 idx, uint8 *pAddr );
 static uint8 gapBondMgrFindReconnectAddr( uint8 *pReconnectAddr );
 static uint8 gapBondMgrFindAddr( uint8 *pDevAddr );
 static uint8 gapBondMgrResolvePrivateAddr( uint8 *pAddr );
+static uint8 gapBondMgrAddrHash( uint8 *pAddr );
+static void gapBondMgrFlushRPACache( void );
 static void gapBondMgrReadBonds( void );
 static uint8 gapBondMgrFindEmpty( void );
 static uint8 gapBondMgrBondTotal( void );
@@ -643,6 +676,10 @@ bStatus_t GAPBondMgr_LinkEst( uint8 addrType, uint8 *pDevAddr, uint16 connHandle
   uint8 publicAddr[B_ADDR_LEN]        // Place to put the public address
       = {0, 0, 0, 0, 0, 0};
 
+  // Keep CCC writes in RAM while connected, they are written once the
+  // last link is gone. Bond records and keys are still written through.
+  osal_snv_defer( TRUE );
+
   idx = GAPBondMgr_ResolveAddr( addrType, pDevAddr, publicAddr );
   if ( idx < GAP_BONDINGS_MAX )
   {
@@ -737,6 +774,8 @@ void GAPBondMgr_LinkTerm(uint16 connHandle)
   
   if ( GAP_NumActiveConnections() == 0 )
   {
+    osal_snv_defer( FALSE );
+
     // See if we're asked to erase all bonding records
     if ( eraseAllBonds == TRUE )
     {
@@ -760,11 +799,13 @@ void GAPBondMgr_LinkTerm(uint16 connHandle)
       }
     }
 
-    // See if NV needs a compaction
-    VOID osal_snv_compact( NV_COMPACT_THRESHOLD );
-
     // Make sure Bond RAM Shadow is up-to-date
     gapBondMgrReadBonds();
+
+    // Write the deferred items and see if NV needs a compaction, in the
+    // background
+    nvCompactPending = TRUE;
+    osal_set_event( gapBondMgr_TaskID, GAP_BOND_NV_IDLE_EVT );
   }
 }
 
@@ -1464,6 +1505,11 @@ static uint8 gapBondMgrAddBond( gapBondRec_t *pBondRec, gapAuthCompleteEvent_t *
 
       // Update Bond RAM Shadow just with the newly added bond entry
       VOID osal_memcpy( &(bonds[bondIdx]), pBondRec, sizeof ( gapBondRec_t ) );
+      bondAddrHash[bondIdx] = gapBondMgrAddrHash( bonds[bondIdx].publicAddr );
+
+      // Any IRK of a previous bond in this entry is replaced
+      bondIRKs &= ~(1 << bondIdx);
+      gapBondMgrFlushRPACache();
       
       // Keep the OSAL message to store the security keys later - will be freed then
       pAuthEvt = pPkt;
@@ -1487,6 +1533,7 @@ static uint8 gapBondMgrAddBond( gapBondRec_t *pBondRec, gapAuthCompleteEvent_t *
       {
         VOID osal_snv_write( devIRKNvID(bondIdx), KEYLEN, pAuthEvt->pIdentityInfo->irk );
         pAuthEvt->pIdentityInfo = NULL;
+        bondIRKs |= (1 << bondIdx);
       }
       // If available, save the connected device's Signature information
       else if ( pAuthEvt->pSigningInfo )
@@ -1608,12 +1655,13 @@ static uint8 gapBondMgrFindReconnectAddr( uint8 *pReconnectAddr )
  */
 static uint8 gapBondMgrFindAddr( uint8 *pDevAddr )
 {
-  // Item doesn't exist, so create all the items
+  uint8 hash = gapBondMgrAddrHash( pDevAddr );
   uint8 idx;
   for ( idx = 0; idx < GAP_BONDINGS_MAX; idx++ )
   {
-    // Read in NV Main Bond Record and compare public address
-    if ( osal_memcmp( bonds[idx].publicAddr, pDevAddr, B_ADDR_LEN ) )
+    // Compare the RAM shadow's public address when the hash matches
+    if ( ( bondAddrHash[idx] == hash ) &&
+         osal_memcmp( bonds[idx].publicAddr, pDevAddr, B_ADDR_LEN ) )
     {
       return ( idx ); // Found it
     }
@@ -1636,16 +1684,38 @@ static uint8 gapBondMgrFindAddr( uint8 *pDevAddr )
 static uint8 gapBondMgrResolvePrivateAddr( uint8 *pDevAddr )
 {
   uint8 idx;
+
+  // See if the address has been resolved already
+  for ( idx = 0; idx < GAP_BOND_RPA_CACHE_SIZE; idx++ )
+  {
+    if ( ( bondRPACache[idx].idx < GAP_BONDINGS_MAX ) &&
+         osal_memcmp( bondRPACache[idx].addr, pDevAddr, B_ADDR_LEN ) )
+    {
+      return ( bondRPACache[idx].idx ); // Found it
+    }
+  }
+
   for ( idx = 0; idx < GAP_BONDINGS_MAX; idx++ )
   {
     uint8 IRK[KEYLEN];
 
+    // Only bonds with an IRK can resolve the address
+    if ( ( bondIRKs & (1 << idx) ) == 0 )
+    {
+      continue;
+    }
+
     // Read in NV IRK Record and compare resolvable address
     if ( osal_snv_read( devIRKNvID(idx), KEYLEN, IRK ) == SUCCESS )
     {
       if ( ( osal_isbufset( IRK, 0xFF, KEYLEN ) == FALSE ) &&
            ( GAP_ResolvePrivateAddr( IRK, pDevAddr ) == SUCCESS ) )
       {
+        // Remember it in place of the oldest entry
+        VOID osal_memcpy( bondRPACache[bondRPANext].addr, pDevAddr, B_ADDR_LEN );
+        bondRPACache[bondRPANext].idx = idx;
+        bondRPANext = ( bondRPANext + 1 ) % GAP_BOND_RPA_CACHE_SIZE;
+
         return ( idx ); // Found it
       }
     }
@@ -1654,6 +1724,50 @@ static uint8 gapBondMgrResolvePrivateAddr( uint8 *pDevAddr )
   return ( GAP_BONDINGS_MAX );
 }
 
+/*********************************************************************
+ * @fn      gapBondMgrAddrHash
+ *
+ * @brief   Hash a device address to one byte.
+ *
+ * @param   pAddr - device address
+ *
+ * @return  hash of the address
+ */
+static uint8 gapBondMgrAddrHash( uint8 *pAddr )
+{
+  uint8 hash = 0;
+  uint8 i;
+
+  for ( i = 0; i < B_ADDR_LEN; i++ )
+  {
+    hash = (uint8)( ( hash << 1 ) | ( hash >> 7 ) ) ^ pAddr[i];
+  }
+
+  return ( hash );
+}
+
+/*********************************************************************
+ * @fn      gapBondMgrFlushRPACache
+ *
+ * @brief   Forget the resolved private addresses, when a bond or its
+ *          IRK changes.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void gapBondMgrFlushRPACache( void )
+{
+  uint8 i;
+
+  for ( i = 0; i < GAP_BOND_RPA_CACHE_SIZE; i++ )
+  {
+    bondRPACache[i].idx = GAP_BONDINGS_MAX;
+  }
+
+  bondRPANext = 0;
+}
+
 /*********************************************************************
  * @fn      gapBondMgrReadBonds
  *
@@ -1666,8 +1780,14 @@ static uint8 gapBondMgrResolvePrivateAddr( uint8 *pDevAddr )
 static void gapBondMgrReadBonds( void )
 {
   uint8 idx;
+
+  bondIRKs = 0;
+  gapBondMgrFlushRPACache();
+
   for ( idx = 0; idx < GAP_BONDINGS_MAX; idx++ )
   {
+    uint8 IRK[KEYLEN];
+
     // See if the entry exists in NV
     if ( osal_snv_read( mainRecordNvID(idx), sizeof( gapBondRec_t ), &(bonds[idx]) ) != SUCCESS )
     {
@@ -1676,6 +1796,16 @@ static void gapBondMgrReadBonds( void )
       VOID osal_memset( bonds[idx].reconnectAddr, 0xFF, B_ADDR_LEN );
       bonds[idx].stateFlags = 0;
     }
+
+    bondAddrHash[idx] = gapBondMgrAddrHash( bonds[idx].publicAddr );
+
+    // Note the bonds that can resolve a private address
+    if ( ( osal_isbufset( bonds[idx].publicAddr, 0xFF, B_ADDR_LEN ) == FALSE ) &&
+         ( osal_snv_read( devIRKNvID(idx), KEYLEN, IRK ) == SUCCESS ) &&
+         ( osal_isbufset( IRK, 0xFF, KEYLEN ) == FALSE ) )
+    {
+      bondIRKs |= (1 << idx);
+    }
   }
 
   if ( autoSyncWhiteList )
@@ -1789,6 +1919,10 @@ static bStatus_t gapBondMgrEraseBonding( uint8 idx )
 
     gapBondFreeAuthEvt();
   }
+
+  // Addresses must no longer resolve to this bond
+  bondIRKs &= ~(1 << idx);
+  gapBondMgrFlushRPACache();
   
 #if ( HOST_CONFIG & PERIPHERAL_CFG )
 
@@ -1942,6 +2076,26 @@ uint16 GAPBondMgr_ProcessEvent( uint8 task_id, uint16 events )
     return (events ^ GAP_BOND_SAVE_RCA_EVT);
   }
 
+  if ( events & GAP_BOND_NV_IDLE_EVT )
+  {
+    // One flash write, or the compaction, per event so other events are
+    // not held up. A new link stops the work until it is gone.
+    if ( GAP_NumActiveConnections() == 0 )
+    {
+      if ( osal_snv_flush( 1 ) > 0 )
+      {
+        osal_set_event( gapBondMgr_TaskID, GAP_BOND_NV_IDLE_EVT );
+      }
+      else if ( nvCompactPending )
+      {
+        nvCompactPending = FALSE;
+        VOID osal_snv_compact( NV_COMPACT_THRESHOLD );
+      }
+    }
+
+    return (events ^ GAP_BOND_NV_IDLE_EVT);
+  }
+
   // Discard unknown events
   return 0;
 }
@@ -328,7 +328,18 @@ uint8 GATTServApp_WriteCharCfg( uint16 connHandle, gattCharCfg_t *charCfgTbl,
   pItem = gattServApp_FindCharCfgItem( connHandle, charCfgTbl );
   if ( pItem == NULL )
   {
-    pItem = gattServApp_FindCharCfgItem( INVALID_CONNHANDLE, charCfgTbl );
+    // Use the entry at the connection handle if it is free, so the
+    // client is found there from now on
+    if ( ( connHandle < linkDBNumConns ) &&
+         ( charCfgTbl[connHandle].connHandle == INVALID_CONNHANDLE ) )
+    {
+      pItem = &(charCfgTbl[connHandle]);
+    }
+    else
+    {
+      pItem = gattServApp_FindCharCfgItem( INVALID_CONNHANDLE, charCfgTbl );
+    }
+
     if ( pItem == NULL )
     {
       return ( ATT_ERR_INSUFFICIENT_RESOURCES );
@@ -347,8 +358,9 @@ uint8 GATTServApp_WriteCharCfg( uint16 connHandle, gattCharCfg_t *charCfgTbl,
  * @fn      gattServApp_FindCharCfgItem
  *
  * @brief   Find the characteristic configuration for a given client.
- *          Uses the connection handle to search the characteristic
- *          configuration table of a client.
+ *          A client's entry is normally at its connection handle, as
+ *          handles are given out from 0; otherwise the characteristic
+ *          configuration table is searched.
  *
  * @param   connHandle - connection handle (0xFFFF for empty entry)
  * @param   charCfgTbl - characteristic configuration table.
@@ -359,6 +371,13 @@ static gattCharCfg_t *gattServApp_FindCharCfgItem( uint16 connHandle,
                                                    gattCharCfg_t *charCfgTbl )
 {
   uint8 i;
+
+  if ( ( connHandle < linkDBNumConns ) &&
+       ( charCfgTbl[connHandle].connHandle == connHandle ) )
+  {
+    return ( &(charCfgTbl[connHandle]) );
+  }
+
   for ( i = 0; i < linkDBNumConns; i++ )
   {
     if ( charCfgTbl[i].connHandle == connHandle )
@@ -210,7 +210,11 @@ int stack_main( void *arg )
   osal_snv_init( );
 
   // Initialize the operating system
-  osal_init_system();
+  if (osal_init_system() != SUCCESS)
+  {
+    /* abort */
+    ICall_abort();
+  }
 
   // Allow interrupts
   //osal_int_enable( INTS_ALL );
@@ -0,0 +1,436 @@
+/*
+ * bondBenchmark.c
+ *
+ * Counts what resolving a reconnecting device's private address costs the bond manager, with
+ * the NV scan gapbondmgr.c used to do and with the bond index and resolved address cache of the
+ * gapbondmgr.c linked in here. The NV reads and the AES-128 operations of
+ * GAP_ResolvePrivateAddr() are what they cost on the device, and are counted; the benchmark
+ * supplies them, and the rest of the stack the bond manager needs.
+ *
+ * The bonded devices reconnect in turn, each keeping its private address for a few connections
+ * before moving to a new one. Some connections are from devices that are not bonded. The bond
+ * manager resolves the address on link establishment and again on characteristic configuration
+ * writes and service change indications; three lookups are made per connection.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bcomdef.h"
+#include "OSAL.h"
+#include "osal_snv.h"
+#include "hci.h"
+#include "linkdb.h"
+#include "gattservapp.h"
+#include "gapgattserver.h"
+#include "gapbondmgr.h"
+
+#define BENCH_TASK                0
+#define BENCH_LOOKUPS_PER_CONN    3
+#define BENCH_DEFAULT_CONNS       1000
+#define BENCH_DEFAULT_ROTATE      4
+#define BENCH_DEFAULT_STRANGERS   10      // % of connections
+
+// A bond's NV items, as gapbondmgr.c lays them out
+#define BENCH_BOND_REC_IDS        6
+#define BENCH_REC_NV_ID(idx)      (BLE_NVID_GAP_BOND_START + (idx) * BENCH_BOND_REC_IDS)
+#define BENCH_IRK_NV_ID(idx)      (BENCH_REC_NV_ID(idx) + 3)
+#define BENCH_NV_ITEM_MAX         32
+
+typedef struct {
+	uint32 snvReads;
+	uint32 resolutions;
+} BenchCost;
+
+typedef struct {
+	const char *name;
+	void (*readBonds)(void);
+	uint8 (*resolve)(uint8 *addr);
+} BenchLookup;
+
+typedef struct {
+	uint8 irk[KEYLEN];
+	uint8 addr[B_ADDR_LEN];
+	uint32 rotateAt;
+} BenchDevice;
+
+// The NV items, as the bond manager reads them
+static struct {
+	uint8 len;
+	uint8 data[BENCH_NV_ITEM_MAX];
+} nv[0x100];
+
+static BenchCost cost;
+static uint32 rngState;
+
+/*
+ * Stands in for ah(), the AES-128 based hash of a private address's random part. Only whether
+ * an address resolves with an IRK matters here.
+ */
+static uint32 ah(const uint8 *irk, const uint8 *prand) {
+	uint32 x = prand[0] | prand[1] << 8 | prand[2] << 16;
+	uint8 i;
+
+	for (i = 0; i < KEYLEN; ++i) {
+		x = (x ^ irk[i]) * 0x01000193;
+	}
+
+	return x & 0xFFFFFF;
+}
+
+/*********************************************************************
+ * What gapbondmgr.c needs from the rest of the stack
+ */
+uint8 osal_snv_read(osalSnvId_t id, osalSnvLen_t len, void *pBuf) {
+	++cost.snvReads;
+
+	if (0 == nv[id].len) {
+		return NV_OPER_FAILED;
+	}
+
+	memcpy(pBuf, nv[id].data, MIN(len, nv[id].len));
+	return SUCCESS;
+}
+
+uint8 osal_snv_write(osalSnvId_t id, osalSnvLen_t len, void *pBuf) {
+	if (len > BENCH_NV_ITEM_MAX) {
+		return NV_OPER_FAILED;
+	}
+
+	memcpy(nv[id].data, pBuf, len);
+	nv[id].len = len;
+	return SUCCESS;
+}
+
+uint8 osal_snv_compact(uint8 threshold) {
+	return SUCCESS;
+}
+
+void osal_snv_defer(uint8 defer) {
+}
+
+uint8 osal_snv_flush(uint8 max) {
+	return 0;
+}
+
+uint8 osal_isbufset(uint8 *buf, uint8 val, uint8 len) {
+	while (len--) {
+		if (*buf++ != val) {
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+void *osal_revmemcpy(void *dst, const void *src, unsigned int len) {
+	uint8 *d = dst;
+	const uint8 *s = (const uint8 *)src + len;
+
+	while (len--) {
+		*d++ = *--s;
+	}
+
+	return dst;
+}
+
+uint8 *osal_msg_receive(uint8 task_id) {
+	return NULL;
+}
+
+uint8 osal_msg_deallocate(uint8 *msg_ptr) {
+	return SUCCESS;
+}
+
+uint8 osal_set_event(uint8 task_id, uint16 event_flag) {
+	return SUCCESS;
+}
+
+uint8 osal_clear_event(uint8 task_id, uint16 event_flag) {
+	return SUCCESS;
+}
+
+// The address is hash[3] then prand[3], as the stack holds it
+bStatus_t GAP_ResolvePrivateAddr(uint8 *pIRK, uint8 *pAddr) {
+	++cost.resolutions;
+	return ah(pIRK, pAddr + 3) == (uint32)(pAddr[0] | pAddr[1] << 8 | pAddr[2] << 16) ? SUCCESS : FAILURE;
+}
+
+bStatus_t GAP_SetParamValue(uint16 paramID, uint16 paramValue) {
+	return SUCCESS;
+}
+
+uint16 GAP_GetParamValue(uint16 paramID) {
+	return 0;
+}
+
+uint8 GAP_NumActiveConnections(void) {
+	return 0;
+}
+
+bStatus_t GAP_Authenticate(gapAuthParams_t *pParams, gapPairingReq_t *pPairReq) {
+	return SUCCESS;
+}
+
+bStatus_t GAP_TerminateAuth(uint16 connectionHandle, uint8 reason) {
+	return SUCCESS;
+}
+
+bStatus_t GAP_PasscodeUpdate(uint32 passcode, uint16 connectionHandle) {
+	return SUCCESS;
+}
+
+bStatus_t GAP_SendSlaveSecurityRequest(uint16 connectionHandle, uint8 authReq) {
+	return SUCCESS;
+}
+
+bStatus_t GAP_Signable(uint16 connectionHandle, uint8 authenticated, smSigningInfo_t *pParams) {
+	return SUCCESS;
+}
+
+bStatus_t GAP_Bond(uint16 connectionHandle, uint8 authenticated, smSecurityInfo_t *pParams,
+		uint8 startEncryption) {
+	return SUCCESS;
+}
+
+bStatus_t GGS_SetParameter(uint8 param, uint8 len, void *value) {
+	return SUCCESS;
+}
+
+bStatus_t HCI_LE_ClearWhiteListCmd(void) {
+	return SUCCESS;
+}
+
+bStatus_t HCI_LE_AddWhiteListCmd(uint8 addrType, uint8 *devAddr) {
+	return SUCCESS;
+}
+
+linkDBItem_t *linkDB_Find(uint16 connectionHandle) {
+	return NULL;
+}
+
+gattAttribute_t *GATT_FindHandleUUID(uint16 startHandle, uint16 endHandle, const uint8 *pUUID,
+		uint16 len, uint16 *pHandle) {
+	return NULL;
+}
+
+gattAttribute_t *GATT_FindNextAttr(gattAttribute_t *pAttr, uint16 endHandle, uint16 service,
+		uint16 *pLastHandle) {
+	return NULL;
+}
+
+void GATT_bm_free(gattMsg_t *pMsg, uint8 opcode) {
+}
+
+void GATTServApp_RegisterForMsg(uint8 taskID) {
+}
+
+bStatus_t GATTServApp_ReadAttr(uint16 connHandle, gattAttribute_t *pAttr, uint16 service,
+		uint8 *pValue, uint16 *pLen, uint16 offset, uint16 maxLen, uint8 method) {
+	return FAILURE;
+}
+
+bStatus_t GATTServApp_UpdateCharCfg(uint16 connHandle, uint16 attrHandle, uint16 value) {
+	return SUCCESS;
+}
+
+/*********************************************************************
+ * gapBondMgrResolvePrivateAddr() as it was: every bond's IRK is read from NV
+ */
+static void scanReadBonds(void) {
+}
+
+static uint8 scanResolve(uint8 *addr) {
+	uint8 idx;
+
+	for (idx = 0; idx < GAP_BONDINGS_MAX; ++idx) {
+		uint8 irk[KEYLEN];
+
+		if (SUCCESS == osal_snv_read(BENCH_IRK_NV_ID(idx), KEYLEN, irk)
+				&& FALSE == osal_isbufset(irk, 0xFF, KEYLEN)
+				&& SUCCESS == GAP_ResolvePrivateAddr(irk, addr)) {
+			return idx;
+		}
+	}
+
+	return GAP_BONDINGS_MAX;
+}
+
+/*********************************************************************
+ * gapbondmgr.c now: resolved addresses are remembered, and only bonds known to have an IRK are
+ * read
+ */
+static void indexReadBonds(void) {
+	GAPBondMgr_Init(BENCH_TASK);
+}
+
+static uint8 indexResolve(uint8 *addr) {
+	return GAPBondMgr_ResolveAddr(ADDRTYPE_PRIVATE_RESOLVE, addr, NULL);
+}
+
+/*********************************************************************
+ * The run
+ */
+static uint32 rand32() {
+	rngState = rngState * 1103515245 + 12345;
+	return rngState >> 8;
+}
+
+static void newKey(uint8 *irk) {
+	uint8 i;
+
+	for (i = 0; i < KEYLEN; ++i) {
+		irk[i] = rand32();
+	}
+}
+
+static void newAddr(const uint8 *irk, uint8 *addr) {
+	uint32 hash;
+
+	addr[3] = rand32();
+	addr[4] = rand32();
+	addr[5] = (rand32() & 0x3F) | 0x40;    // Resolvable private address
+
+	hash = ah(irk, addr + 3);
+	addr[0] = hash;
+	addr[1] = hash >> 8;
+	addr[2] = hash >> 16;
+}
+
+/*
+ * Makes conns connections from bonds bonded devices and some strangers, looking each address up
+ * with both lookups. Returns the number of lookups that found the wrong bond, or missed one.
+ */
+static uint32 run(const BenchLookup *lookups, uint8 bonds, uint32 conns, uint32 rotate, uint32 strangers,
+		BenchCost *costs) {
+	BenchDevice devices[GAP_BONDINGS_MAX], stranger;
+	uint8 expected, found;
+	uint32 conn, mismatches = 0;
+	uint8 d, k, l;
+
+	rngState = 0x5B4D0001 + bonds;
+
+	// The bonded devices' records and IRKs; the other bonds were never written
+	memset(nv, 0, sizeof(nv));
+	for (d = 0; d < bonds; ++d) {
+		uint8 rec[2 * B_ADDR_LEN + 2];
+
+		memset(rec, 0, sizeof(rec));
+		memset(rec, d + 1, B_ADDR_LEN);             // Public address
+		memset(rec + B_ADDR_LEN, 0xFF, B_ADDR_LEN); // No reconnection address
+		osal_snv_write(BENCH_REC_NV_ID(d), sizeof(rec), rec);
+
+		newKey(devices[d].irk);
+		osal_snv_write(BENCH_IRK_NV_ID(d), KEYLEN, devices[d].irk);
+		devices[d].rotateAt = 0;
+	}
+	newKey(stranger.irk);
+
+	for (k = 0; k < 2; ++k) {
+		cost.snvReads = cost.resolutions = 0;
+		lookups[k].readBonds();
+	}
+
+	memset(costs, 0, 2 * sizeof(BenchCost));
+
+	for (conn = 0; conn < conns; ++conn) {
+		BenchDevice *device;
+
+		if (rand32() % 100 < strangers) {
+			device = &stranger;
+			newAddr(device->irk, device->addr);
+			expected = GAP_BONDINGS_MAX;
+		} else {
+			d = conn % bonds;
+			device = &devices[d];
+			if (conn >= device->rotateAt) {
+				newAddr(device->irk, device->addr);
+				device->rotateAt = conn + rotate * bonds;
+			}
+			expected = d;
+		}
+
+		for (k = 0; k < 2; ++k) {
+			cost = costs[k];
+			for (l = 0; l < BENCH_LOOKUPS_PER_CONN; ++l) {
+				found = lookups[k].resolve(device->addr);
+				mismatches += found != expected;
+			}
+			costs[k] = cost;
+		}
+	}
+
+	return mismatches;
+}
+
+static void usage(const char *name) {
+	fprintf(stderr, "Usage: %s [-b bonds (at most %u)] [-c connections] [-r connections per address] "
+			"[-u %% strangers]\n", name, GAP_BONDINGS_MAX);
+}
+
+int main(int argc, char **argv) {
+	static const uint8 defaultBonds[] = { 1, 4, GAP_BONDINGS_MAX };
+	static const BenchLookup lookups[] = {
+		{ "scan", scanReadBonds, scanResolve },
+		{ "index", indexReadBonds, indexResolve },
+	};
+	uint32 conns = BENCH_DEFAULT_CONNS, rotate = BENCH_DEFAULT_ROTATE, strangers = BENCH_DEFAULT_STRANGERS;
+	uint32 bonds = 0, mismatches;
+	uint8 b, k, runs;
+	BenchCost costs[2];
+	int opt, failures = 0;
+
+	while (-1 != (opt = getopt(argc, argv, "b:c:r:u:h"))) {
+		switch (opt) {
+		case 'b':
+			bonds = strtoul(optarg, NULL, 0);
+			if (0 == bonds || bonds > GAP_BONDINGS_MAX) {
+				usage(argv[0]);
+				return 2;
+			}
+			break;
+
+		case 'c':
+			conns = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'r':
+			rotate = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'u':
+			strangers = strtoul(optarg, NULL, 0);
+			break;
+
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	if (0 == conns || 0 == rotate || strangers > 100) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	runs = bonds ? 1 : sizeof(defaultBonds);
+
+	printf("%-6s %5s %7s %9s %9s\n", "lookup", "bonds", "conns", "NV/conn", "AES/conn");
+
+	for (k = 0; k < runs; ++k) {
+		b = bonds ? bonds : defaultBonds[k];
+		mismatches = run(lookups, b, conns, rotate, strangers, costs);
+
+		printf("%-6s %5u %7u %9.2f %9.2f\n", lookups[0].name, b, conns,
+			(double)costs[0].snvReads / conns, (double)costs[0].resolutions / conns);
+		printf("%-6s %5u %7u %9.2f %9.2f%s\n", lookups[1].name, b, conns,
+			(double)costs[1].snvReads / conns, (double)costs[1].resolutions / conns,
+			mismatches ? "  FAILED" : "");
+
+		failures += mismatches > 0;
+	}
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,166 @@
+/*
+ * clockBenchmark.c
+ *
+ * Runs the clock on a crystal that is off by some parts per million: the phone sets the time at
+ * every sync for a couple of days, then the device is left alone for several days and takes a
+ * timestamp three times per sensing cycle. Compares the result with the true time for:
+ *   - the clock.c that added whole elapsed seconds on every call and dropped the remainder
+ *   - the current clock without drift correction (the time of the last sync plus the ticks since)
+ *   - the current clock
+ *
+ * The phone sends whole seconds and its writes land at any point within the second.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <ti/sysbios/knl/Clock.h>
+
+#include "Board.h"
+#include "clock.h"
+#include "emulator.h"
+
+#define BENCH_START_TIME          1458000000U
+#define BENCH_DEFAULT_DRIFT_PPM   40
+#define BENCH_DEFAULT_DAYS        3
+#define BENCH_SYNC_PERIOD_S       (12*60*60)
+#define BENCH_SYNC_DAYS           2
+#define BENCH_CYCLE_MS            1000
+
+static double driftPpm = BENCH_DEFAULT_DRIFT_PPM;
+static uint64_t trueUs;          // True time since the start
+static uint64_t deviceTicks;     // Ticks the device has counted since the start
+
+/*
+ * The clock.c this replaces
+ */
+static struct {
+	uint32_t lastTimestamp;
+	uint32_t lastReferenceTicks;
+} legacy;
+
+static void legacySetTime(uint32_t timestamp) {
+	legacy.lastTimestamp = timestamp;
+	legacy.lastReferenceTicks = Clock_getTicks();
+}
+
+static uint32_t legacyGetTime() {
+	uint32_t referenceTicks = Clock_getTicks();
+	legacy.lastTimestamp += (referenceTicks - legacy.lastReferenceTicks)/NTICKS_PER_SECOND;
+	legacy.lastReferenceTicks = referenceTicks;
+	return legacy.lastTimestamp;
+}
+
+/*
+ * Moves true time forward, and the device's ticks by as much as its crystal counts in that time
+ */
+static void advance(uint64_t us) {
+	uint64_t target;
+
+	trueUs += us;
+	target = (uint64_t)(trueUs * (1.0 + driftPpm / 1e6) / Clock_tickPeriod);
+
+	while (deviceTicks < target) {
+		uint32 step = target - deviceTicks > 0x40000000 ? 0x40000000 : target - deviceTicks;
+
+		SB_emuAdvanceTicks(step);
+		deviceTicks += step;
+	}
+}
+
+/*
+ * A timestamp taken by the device, with both clocks
+ */
+static void timestamp() {
+	legacyGetTime();
+	SB_clockGetTimeMs();
+}
+
+/*
+ * Sensing cycles, timestamping their readings
+ */
+static void runCycles(uint32 seconds) {
+	uint32 c;
+
+	for (c = 0; c < seconds * (1000 / BENCH_CYCLE_MS); ++c) {
+		advance(BENCH_CYCLE_MS * 1000 - 50000);
+		timestamp();
+		advance(20000);
+		timestamp();
+		advance(30000);
+		timestamp();
+	}
+}
+
+static int64_t trueTimeMs() {
+	return (int64_t)BENCH_START_TIME * 1000 + trueUs / 1000;
+}
+
+static void usage(const char *name) {
+	fprintf(stderr, "Usage: %s [-p drift_ppm] [-d days_offline]\n", name);
+}
+
+int main(int argc, char **argv) {
+	uint32 days = BENCH_DEFAULT_DAYS, lastSync = 0, s;
+	uint64_t lastSyncTicks = 0;
+	int64_t errLegacy = 0, errUncorrected = 0, errCorrected = 0, err;
+	int opt, failures = 0;
+
+	while (-1 != (opt = getopt(argc, argv, "p:d:h"))) {
+		switch (opt) {
+		case 'p':
+			driftPpm = strtod(optarg, NULL);
+			break;
+
+		case 'd':
+			days = strtoul(optarg, NULL, 0);
+			break;
+
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	if (driftPpm < -SB_CLOCK_MAX_DRIFT_PPM || driftPpm > SB_CLOCK_MAX_DRIFT_PPM || 0 == days) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	srand(0x5B4D0001);
+	SB_clockInit();
+
+	// Syncs with the phone, each at some point within a second
+	for (s = 0; s <= BENCH_SYNC_DAYS * 24 * 60 * 60 / BENCH_SYNC_PERIOD_S; ++s) {
+		runCycles(s ? BENCH_SYNC_PERIOD_S : 0);
+		advance(rand() % 1000000);
+
+		lastSync = trueTimeMs() / 1000;
+		lastSyncTicks = SB_clockGetTicks();
+		SB_clockSetTime(lastSync);
+		legacySetTime(lastSync);
+	}
+
+	// Offline
+	runCycles(days * 24 * 60 * 60);
+
+	errLegacy = (int64_t)legacyGetTime() * 1000 - trueTimeMs();
+	errUncorrected = (int64_t)lastSync * 1000 + (SB_clockGetTicks() - lastSyncTicks) / (NTICKS_PER_SECOND / 1000) - trueTimeMs();
+	errCorrected = (int64_t)SB_clockGetTimeMs() - trueTimeMs();
+
+	printf("drift %.1f ppm, learned %.3f ppm, %u days offline\n", driftPpm, SB_clockGetDriftPpb() / 1000.0, days);
+	printf("%-12s %12s\n", "clock", "error_ms");
+	printf("%-12s %12lld\n", "truncating", (long long)errLegacy);
+	printf("%-12s %12lld\n", "uncorrected", (long long)errUncorrected);
+	printf("%-12s %12lld\n", "corrected", (long long)errCorrected);
+
+	// The phone's whole seconds limit the estimate to about a second over the span it was learned from
+	err = errCorrected < 0 ? -errCorrected : errCorrected;
+	if (err > 1000 * (1 + (int64_t)days * 24 * 60 * 60 / (BENCH_SYNC_DAYS * 24 * 60 * 60))) {
+		printf("FAILED: corrected clock is %lld ms off\n", (long long)errCorrected);
+		++failures;
+	}
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,171 @@
+/*
+ * crcBenchmark.c
+ *
+ * Compares the bytewise CRC16 that oad.c used to verify a downloaded image with the
+ * table-driven OAD_crc16() it now runs over each block as it is written.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bcomdef.h"
+
+#include "oad.h"
+#include "oad_target.h"
+
+#define BENCH_DEFAULT_IMAGE_KB    128
+#define BENCH_DEFAULT_PASSES      20
+
+static uint8 image[1024 * 1024];
+
+/*
+ * The bytewise CRC16 from oad.c
+ */
+static uint16 crc16(uint16 crc, uint8 val) {
+	const uint16 poly = 0x1021;
+	uint8 cnt;
+
+	for (cnt = 0; cnt < 8; cnt++, val <<= 1) {
+		uint8 msb = (crc & 0x8000) ? 1 : 0;
+
+		crc <<= 1;
+
+		if (val & 0x80) {
+			crc |= 0x0001;
+		}
+
+		if (msb) {
+			crc ^= poly;
+		}
+	}
+
+	return crc;
+}
+
+static uint16 crcBytewise(const uint8 *data, uint32 len) {
+	uint16 crc = 0;
+	uint32 i;
+
+	for (i = 0; i < len; ++i) {
+		crc = crc16(crc, data[i]);
+	}
+
+	crc = crc16(crc, 0);
+	return crc16(crc, 0);
+}
+
+/*
+ * In the largest pieces OAD_crc16() takes
+ */
+static uint16 crcTable(const uint8 *data, uint32 len) {
+	uint16 crc = 0, n;
+	uint32 i;
+
+	for (i = 0; i < len; i += n) {
+		n = len - i < 0x8000 ? len - i : 0x8000;
+		crc = OAD_crc16(crc, data + i, n);
+	}
+
+	return crc;
+}
+
+/*
+ * As oad.c calls it: one block at a time
+ */
+static uint16 crcTableBlocks(const uint8 *data, uint32 len) {
+	uint16 crc = 0;
+	uint32 i;
+
+	for (i = 0; i < len; i += OAD_BLOCK_SIZE) {
+		crc = OAD_crc16(crc, data + i, OAD_BLOCK_SIZE);
+	}
+
+	return crc;
+}
+
+static double nowNs() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double timeCrc(uint16 (*fn)(const uint8 *, uint32), uint32 len, uint32 passes, uint16 *crc) {
+	double start = nowNs();
+	uint32 i;
+
+	for (i = 0; i < passes; ++i) {
+		*crc = fn(image, len);
+	}
+
+	return (nowNs() - start) / passes;
+}
+
+static void usage(const char *name) {
+	fprintf(stderr, "Usage: %s [-k image_kb] [-n passes]\n", name);
+}
+
+int main(int argc, char **argv) {
+	static const struct {
+		const char *name;
+		uint16 (*fn)(const uint8 *, uint32);
+	} kernels[] = {
+		{ "bytewise", crcBytewise },
+		{ "table", crcTable },
+		{ "table/16", crcTableBlocks },
+	};
+	uint32 len = BENCH_DEFAULT_IMAGE_KB * 1024, passes = BENCH_DEFAULT_PASSES, seed = 0x5B4D0001, i;
+	uint16 crc, reference = 0;
+	double ns, baseNs = 0;
+	int opt, k, failures = 0;
+
+	while (-1 != (opt = getopt(argc, argv, "k:n:h"))) {
+		switch (opt) {
+		case 'k':
+			len = strtoul(optarg, NULL, 0) * 1024;
+			if (0 == len || len > sizeof(image)) {
+				usage(argv[0]);
+				return 2;
+			}
+			break;
+
+		case 'n':
+			passes = strtoul(optarg, NULL, 0);
+			if (0 == passes) {
+				usage(argv[0]);
+				return 2;
+			}
+			break;
+
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	for (i = 0; i < len; ++i) {
+		seed = seed * 1103515245 + 12345;
+		image[i] = (uint8)(seed >> 16);
+	}
+
+	printf("%-9s %6s %6s %10s %8s %8s\n", "kernel", "kb", "crc", "ms/image", "MB/s", "speedup");
+
+	for (k = 0; k < sizeof(kernels)/sizeof(kernels[0]); ++k) {
+		ns = timeCrc(kernels[k].fn, len, passes, &crc);
+
+		if (0 == k) {
+			reference = crc;
+			baseNs = ns;
+		}
+
+		printf("%-9s %6u 0x%04x %10.3f %8.1f %7.1fx%s\n",
+			kernels[k].name, len / 1024, crc, ns / 1e6, len / (ns / 1e3), baseNs / ns,
+			crc == reference ? "" : "  FAILED");
+
+		failures += crc != reference;
+	}
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,455 @@
+/*
+ * dispatchBenchmark.c
+ *
+ * Replays the application's calls into the stack through the routing of the stack's ICall
+ * dispatcher, ICallBLE/bleDispatch.c, which indexes tables of subgroup handlers, and through the
+ * subgroup switches it used before. The calls are captured on the emulator over a sync: start
+ * up, connect, the central subscribes and confirms indications until the backlog is drained,
+ * disconnect.
+ *
+ * bleDispatch.c needs far more of the stack than the host has, so its routing is modelled here:
+ * the ICall/Dispatch message switch, then the Host or Link Layer split and the subgroup lookup,
+ * as icallHostHandlers[] and dispHandlers[] against the old switches. The subgroup handlers
+ * themselves, with their switches on the command ID, are the same for both, and stand in for the
+ * real ones. Both must route every call to the same handler.
+ *
+ * The host compiler turns the small subgroup switches into jump tables too, so the timings say
+ * little about the target; what they do show is the cost of the routing against the handlers.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bcomdef.h"
+#include "bleDispatch.h"
+
+#include "ble.h"
+#include "clock.h"
+#include "flash.h"
+#include "readingsManager.h"
+#include "smartBandageProfile.h"
+
+#include "emulator.h"
+
+#define BENCH_DEFAULT_READINGS    300
+#define BENCH_DEFAULT_ROUNDS      2000
+#define BENCH_MAX_CMDS            4096
+#define BENCH_START_TIME          1458000000
+#define BENCH_INTERVAL_MS         100
+#define BENCH_PDUS_PER_EVENT      4
+#define BENCH_CONN                0
+
+#define BENCH_VENDOR_SPECIFIC_OGF 0x3F
+
+// Subgroup handlers, in the order their calls are counted
+typedef enum {
+	H_LL,
+	H_L2CAP,
+	H_ATT,
+	H_GATT,
+	H_GAP,
+	H_UTIL,
+	H_DISP_GENERAL,
+	H_DISP_GAP_PROFILE,
+	H_DISP_GATT_PROFILE,
+	H_DISP_GGS,
+	H_DISP_GSA,
+	H_NONE,
+	H_COUNT
+} BenchHandler;
+
+static const char *handlerNames[H_COUNT] = {
+	"LL", "L2CAP", "ATT", "GATT", "GAP", "UTIL",
+	"general", "GAP profile", "GATT profile", "GGS", "GSA", "none"
+};
+
+typedef struct {
+	const char *name;
+	uint8 (*dispatch)(const SB_EmuStackCmd *cmd);
+} BenchRouter;
+
+typedef uint8 (*HostHandler)(uint8 cmdID, const SB_EmuStackCmd *cmd, uint8 *pRspDataLen, uint8 *pSendCS);
+typedef uint8 (*DispHandler)(const SB_EmuStackCmd *cmd, uint8 *pRspDataLen, uint8 *pSendCS);
+
+// Calls routed to each handler by the router being run
+static uint32 routed[H_COUNT];
+
+static SB_EmuStackCmd cmds[BENCH_MAX_CMDS];
+static uint32 numCmds;
+
+static volatile uint32 sink;
+
+/*********************************************************************
+ * The subgroup handlers, the same for both routers: a switch on the command ID
+ */
+static __attribute__((noinline)) uint8 handle(BenchHandler h, uint8 cmdID) {
+	++routed[h];
+
+	switch (cmdID & 0x07) {
+	case 0: return SUCCESS;
+	case 1: return h;
+	case 2: return cmdID;
+	case 3: return h ^ cmdID;
+	case 4: return h + cmdID;
+	case 5: return FAILURE;
+	case 6: return INVALIDPARAMETER;
+	default: return SUCCESS;
+	}
+}
+
+static uint8 processLL(uint16 opCode, const SB_EmuStackCmd *cmd, uint8 *pRspDataLen, uint8 *pSendCS) {
+	return handle(H_LL, opCode);
+}
+
+static uint8 processL2CAP(uint8 cmdID, const SB_EmuStackCmd *cmd, uint8 *pRspDataLen, uint8 *pSendCS) {
+	return handle(H_L2CAP, cmdID);
+}
+
+static uint8 processATT(uint8 cmdID, const SB_EmuStackCmd *cmd, uint8 *pRspDataLen, uint8 *pSendCS) {
+	return handle(H_ATT, cmdID);
+}
+
+static uint8 processGATT(uint8 cmdID, const SB_EmuStackCmd *cmd, uint8 *pRspDataLen, uint8 *pSendCS) {
+	return handle(H_GATT, cmdID);
+}
+
+static uint8 processGAP(uint8 cmdID, const SB_EmuStackCmd *cmd, uint8 *pRspDataLen, uint8 *pSendCS) {
+	return handle(H_GAP, cmdID);
+}
+
+static uint8 processUTIL(uint8 cmdID, const SB_EmuStackCmd *cmd, uint8 *pRspDataLen, uint8 *pSendCS) {
+	return handle(H_UTIL, cmdID);
+}
+
+static uint8 processDispGeneral(const SB_EmuStackCmd *cmd, uint8 *pRspDataLen, uint8 *pSendCS) {
+	return handle(H_DISP_GENERAL, cmd->cmdId);
+}
+
+static uint8 processDispGAPProfile(const SB_EmuStackCmd *cmd, uint8 *pRspDataLen, uint8 *pSendCS) {
+	return handle(H_DISP_GAP_PROFILE, cmd->cmdId);
+}
+
+static uint8 processDispGATTProfile(const SB_EmuStackCmd *cmd, uint8 *pRspDataLen, uint8 *pSendCS) {
+	return handle(H_DISP_GATT_PROFILE, cmd->cmdId);
+}
+
+static uint8 processDispGGS(const SB_EmuStackCmd *cmd, uint8 *pRspDataLen, uint8 *pSendCS) {
+	return handle(H_DISP_GGS, cmd->cmdId);
+}
+
+static uint8 processDispGSA(const SB_EmuStackCmd *cmd, uint8 *pRspDataLen, uint8 *pSendCS) {
+	return handle(H_DISP_GSA, cmd->cmdId);
+}
+
+/*********************************************************************
+ * processICallHost() and processDispMsg() as they were: a switch on the subgroup
+ */
+static uint8 switchICallHost(uint16 opCode, const SB_EmuStackCmd *cmd, uint8 *pRspDataLen, uint8 *pSendCS) {
+	uint8 stat;
+
+	switch ((opCode >> 7) & 0x07) {
+	case SB_EMU_CSG_L2CAP:
+		stat = processL2CAP(opCode & 0x007F, cmd, pRspDataLen, pSendCS);
+		break;
+
+	case SB_EMU_CSG_ATT:
+		stat = processATT(opCode & 0x007F, cmd, pRspDataLen, pSendCS);
+		break;
+
+	case SB_EMU_CSG_GATT:
+		stat = processGATT(opCode & 0x007F, cmd, pRspDataLen, pSendCS);
+		break;
+
+	case SB_EMU_CSG_GAP:
+		stat = processGAP(opCode & 0x007F, cmd, pRspDataLen, pSendCS);
+		break;
+
+	case SB_EMU_CSG_UTIL:
+		stat = processUTIL(opCode & 0x007F, cmd, pRspDataLen, pSendCS);
+		break;
+
+	default:
+		stat = handle(H_NONE, 0);
+		break;
+	}
+
+	return stat;
+}
+
+static uint8 switchDispMsg(const SB_EmuStackCmd *cmd, uint8 *pRspDataLen, uint8 *pSendCS) {
+	uint8 stat;
+
+	switch (cmd->opCode) {
+	case DISPATCH_GENERAL:
+		stat = processDispGeneral(cmd, pRspDataLen, pSendCS);
+		break;
+
+	case DISPATCH_GAP_PROFILE:
+		stat = processDispGAPProfile(cmd, pRspDataLen, pSendCS);
+		break;
+
+	case DISPATCH_GATT_PROFILE:
+		stat = processDispGATTProfile(cmd, pRspDataLen, pSendCS);
+		break;
+
+	case DISPATCH_GAP_GATT_SERV:
+		stat = processDispGGS(cmd, pRspDataLen, pSendCS);
+		break;
+
+	case DISPATCH_GATT_SERV_APP:
+		stat = processDispGSA(cmd, pRspDataLen, pSendCS);
+		break;
+
+	default:
+		stat = handle(H_NONE, 0);
+		break;
+	}
+
+	return stat;
+}
+
+/*********************************************************************
+ * processICallHost() and processDispMsg() now: the subgroup indexes a table of handlers
+ */
+static const HostHandler hostHandlers[8] = {
+	[SB_EMU_CSG_L2CAP] = processL2CAP,
+	[SB_EMU_CSG_ATT]   = processATT,
+	[SB_EMU_CSG_GATT]  = processGATT,
+	[SB_EMU_CSG_GAP]   = processGAP,
+	[SB_EMU_CSG_UTIL]  = processUTIL,
+};
+
+static const DispHandler dispHandlers[DISPATCH_GATT_SERV_APP + 1] = {
+	[DISPATCH_GENERAL]       = processDispGeneral,
+	[DISPATCH_GAP_PROFILE]   = processDispGAPProfile,
+	[DISPATCH_GATT_PROFILE]  = processDispGATTProfile,
+	[DISPATCH_GAP_GATT_SERV] = processDispGGS,
+	[DISPATCH_GATT_SERV_APP] = processDispGSA,
+};
+
+static uint8 tableICallHost(uint16 opCode, const SB_EmuStackCmd *cmd, uint8 *pRspDataLen, uint8 *pSendCS) {
+	HostHandler pfnHandler = hostHandlers[(opCode >> 7) & 0x07];
+
+	if (NULL == pfnHandler) {
+		return handle(H_NONE, 0);
+	}
+
+	return pfnHandler(opCode & 0x007F, cmd, pRspDataLen, pSendCS);
+}
+
+static uint8 tableDispMsg(const SB_EmuStackCmd *cmd, uint8 *pRspDataLen, uint8 *pSendCS) {
+	if (cmd->opCode < sizeof(dispHandlers) / sizeof(dispHandlers[0]) && NULL != dispHandlers[cmd->opCode]) {
+		return dispHandlers[cmd->opCode](cmd, pRspDataLen, pSendCS);
+	}
+
+	return handle(H_NONE, 0);
+}
+
+/*********************************************************************
+ * bleDispatch_ProcessEvent() down to the subgroup handlers, with either
+ */
+static inline uint8 processICallMsg(const SB_EmuStackCmd *cmd,
+		uint8 (*host)(uint16, const SB_EmuStackCmd *, uint8 *, uint8 *)) {
+	uint8 rspDataLen = 0, sendCmdStatus = TRUE;
+	uint16 opCode = cmd->opCode;
+
+	if ((opCode >> 10) == BENCH_VENDOR_SPECIFIC_OGF && ((opCode >> 7) & 0x07) != SB_EMU_CSG_LINK_LAYER) {
+		return host(opCode, cmd, &rspDataLen, &sendCmdStatus);
+	}
+
+	return processLL(opCode, cmd, &rspDataLen, &sendCmdStatus);
+}
+
+static uint8 switchDispatch(const SB_EmuStackCmd *cmd) {
+	uint8 rspDataLen = 0, sendCmdStatus = TRUE;
+
+	switch (cmd->event) {
+	case SB_EMU_ICALL_CMD:
+		return processICallMsg(cmd, switchICallHost);
+
+	case SB_EMU_DISPATCH_CMD:
+		return switchDispMsg(cmd, &rspDataLen, &sendCmdStatus);
+
+	default:
+		return handle(H_NONE, 0);
+	}
+}
+
+static uint8 tableDispatch(const SB_EmuStackCmd *cmd) {
+	uint8 rspDataLen = 0, sendCmdStatus = TRUE;
+
+	switch (cmd->event) {
+	case SB_EMU_ICALL_CMD:
+		return processICallMsg(cmd, tableICallHost);
+
+	case SB_EMU_DISPATCH_CMD:
+		return tableDispMsg(cmd, &rspDataLen, &sendCmdStatus);
+
+	default:
+		return handle(H_NONE, 0);
+	}
+}
+
+/*********************************************************************
+ * The run
+ */
+static double nowNs() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void fillReading(uint32 sequence, SB_PeripheralReadings *reading) {
+	memset(reading, 0, sizeof(*reading));
+
+	reading->temperatures[0] = (uint16)sequence;
+	reading->moistures[0] = (uint16)sequence;
+	reading->timeDiff = 60000;
+}
+
+/*
+ * Captures the stack calls of starting up, and of a central draining a backlog of readings by
+ * indications. Returns false if the device could not be set up.
+ */
+static bool captureSync(uint32 numReadings) {
+	uint8 enable[2] = { LO_UINT16(GATT_CLIENT_CFG_INDICATE), HI_UINT16(GATT_CLIENT_CFG_INDICATE) };
+	SB_PeripheralReadings reading;
+	SB_EmuPDU pdu;
+	uint32 i;
+
+	SB_emuCaptureStackCmds(cmds, BENCH_MAX_CMDS);
+	SB_emuInit(1, BENCH_INTERVAL_MS, BENCH_PDUS_PER_EVENT);
+
+	SB_clockInit();
+	SB_clockSetTime(BENCH_START_TIME);
+
+	if (NoError != SB_flashInit(sizeof(SB_PeripheralReadings), true)) {
+		return false;
+	}
+
+	SimpleBLEPeripheral_init();
+
+	if (NoError != SB_readingsManagerInit()) {
+		return false;
+	}
+
+	for (i = 0; i < numReadings; ++i) {
+		fillReading(i, &reading);
+
+		if (NoError != SB_flashWriteReadings(&reading)) {
+			return false;
+		}
+	}
+
+	SB_setClearReadingsMode(true);
+	SB_newReadingsAvailable();
+	SB_enableBLE();
+	SB_emuRunApp();
+
+	SB_emuConnect(BENCH_CONN, ATT_MTU_SIZE);
+	SB_emuRunApp();
+
+	SB_emuWrite(BENCH_CONN, SB_emuFindCCCHandle(SB_emuFindHandle(SB_BLE_READINGS_UUID, 0)), enable,
+			sizeof(enable), true);
+	SB_emuRunApp();
+
+	for (i = 0; i <= numReadings && SB_emuReceive(BENCH_CONN, &pdu); ++i) {
+		SB_emuConfirm(BENCH_CONN);
+		SB_emuRunApp();
+	}
+
+	SB_emuDisconnect(BENCH_CONN);
+	SB_emuRunApp();
+
+	numCmds = SB_emuStackCmdsCaptured();
+	SB_emuCaptureStackCmds(NULL, 0);
+
+	return true;
+}
+
+/*
+ * Replays the captured calls rounds times, returning the time taken in ns
+ */
+static double replay(const BenchRouter *router, uint32 rounds) {
+	double start;
+	uint32 r, k, acc = 0;
+
+	memset(routed, 0, sizeof(routed));
+	start = nowNs();
+
+	for (r = 0; r < rounds; ++r) {
+		for (k = 0; k < numCmds; ++k) {
+			acc += router->dispatch(&cmds[k]);
+		}
+	}
+
+	sink = acc;
+
+	return nowNs() - start;
+}
+
+static void usage(const char *name) {
+	fprintf(stderr, "Usage: %s [-n readings] [-r rounds]\n", name);
+}
+
+int main(int argc, char **argv) {
+	static const BenchRouter routers[] = {
+		{ "switch", switchDispatch },
+		{ "table", tableDispatch },
+	};
+	uint32 numReadings = BENCH_DEFAULT_READINGS, rounds = BENCH_DEFAULT_ROUNDS;
+	uint32 counts[2][H_COUNT];
+	double ns[2];
+	int opt, k, h, mismatched = 0;
+
+	while (-1 != (opt = getopt(argc, argv, "n:r:h"))) {
+		switch (opt) {
+		case 'n':
+			numReadings = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'r':
+			rounds = strtoul(optarg, NULL, 0);
+			if (0 == rounds) {
+				usage(argv[0]);
+				return 2;
+			}
+			break;
+
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	if (!captureSync(numReadings) || 0 == numCmds) {
+		fprintf(stderr, "Device setup failed\n");
+		return 1;
+	}
+
+	for (k = 0; k < 2; ++k) {
+		ns[k] = replay(&routers[k], rounds);
+		memcpy(counts[k], routed, sizeof(routed));
+	}
+
+	printf("%-13s %8s\n", "handler", "calls");
+	for (h = 0; h < H_COUNT; ++h) {
+		mismatched += counts[0][h] != counts[1][h];
+
+		if (counts[0][h] || counts[1][h]) {
+			printf("%-13s %8u\n", handlerNames[h], counts[0][h] / rounds);
+		}
+	}
+
+	printf("\n%-7s %6s %8s %8s\n", "router", "calls", "ns/call", "speedup");
+	for (k = 0; k < 2; ++k) {
+		printf("%-7s %6u %8.2f %7.2fx%s\n", routers[k].name, numCmds, ns[k] / rounds / numCmds,
+				ns[0] / ns[k], k > 0 && mismatched ? "  FAILED" : "");
+	}
+
+	return mismatched ? 1 : 0;
+}
@@ -0,0 +1,123 @@
+/*
+ * emuFlash.c
+ *
+ * RAM-backed implementation of the readings store API in Application/flash.h. It keeps the
+ * same observable behaviour as flash.c: a FIFO of readings that share one reference
+ * timestamp, consumed destructively by SB_flashReadNext().
+ */
+
+#include <stdlib.h>
+
+#include "flash.h"
+#include "clock.h"
+
+#define SB_EMU_FLASH_CAPACITY 8192
+
+static struct {
+	SB_FLASH_READING_TYPE readings[SB_EMU_FLASH_CAPACITY];
+	SB_FLASH_COUNT_T first;
+	SB_FLASH_COUNT_T entryCount;
+	SB_TIMESTAMP_T timestamp;
+} FLASH;
+
+SB_Error SB_flashInit(uint8 readingSizeBytes, bool reinit) {
+	if (readingSizeBytes != sizeof(SB_FLASH_READING_TYPE)) {
+		return InvalidParameter;
+	}
+
+	FLASH.first = 0;
+	FLASH.entryCount = 0;
+	FLASH.timestamp = SB_clockIsSet() ? SB_clockGetTime() : UINT32_MAX;
+
+	return NoError;
+}
+
+SB_Error SB_flashWriteReadings(SB_FLASH_READING_TYPE * readings) {
+	if (NULL == readings) {
+		return InvalidParameter;
+	}
+
+	if (FLASH.entryCount >= SB_EMU_FLASH_CAPACITY) {
+		return OutOfMemory;
+	}
+
+	FLASH.readings[(FLASH.first + FLASH.entryCount++) % SB_EMU_FLASH_CAPACITY] = *readings;
+
+	return NoError;
+}
+
+SB_FLASH_COUNT_T SB_flashReadingCount() {
+	return FLASH.entryCount;
+}
+
+const SB_FLASH_COUNT_T* SB_flashReadingCountRef() {
+	return &FLASH.entryCount;
+}
+
+SB_Error SB_flashGetReading(SB_FLASH_COUNT_T index, SB_FLASH_READING_TYPE * reading, uint32_t * refTimestamp) {
+	if (index >= FLASH.entryCount) {
+		return NoDataAvailable;
+	}
+
+	*reading = FLASH.readings[(FLASH.first + index) % SB_EMU_FLASH_CAPACITY];
+
+	if (NULL != refTimestamp) {
+		*refTimestamp = FLASH.timestamp;
+	}
+
+	return NoError;
+}
+
+SB_Error SB_flashReadNext(SB_FLASH_READING_TYPE * reading, uint32_t * refTimestamp) {
+	SB_Error result;
+
+	if (NoError != (result = SB_flashGetReading(0, reading, refTimestamp))) {
+		return result;
+	}
+
+	return SB_flashDiscard(1);
+}
+
+SB_Error SB_flashDiscard(SB_FLASH_COUNT_T count) {
+	if (count > FLASH.entryCount) {
+		return InvalidParameter;
+	}
+
+	FLASH.first = (FLASH.first + count) % SB_EMU_FLASH_CAPACITY;
+	FLASH.entryCount -= count;
+
+	// flash.c erases storage and starts a new reference time once it is empty
+	if (0 == FLASH.entryCount) {
+		FLASH.first = 0;
+		FLASH.timestamp = SB_clockIsSet() ? SB_clockGetTime() : UINT32_MAX;
+	}
+
+	return NoError;
+}
+
+SB_Error SB_flashMigrate() {
+	// One tier only, nothing to move
+	return NoError;
+}
+
+SB_Error SB_flashPrepShutdown() {
+	return NoError;
+}
+
+SB_Error SB_flashTimeSet() {
+	if (SB_flashHasTime()) {
+		return NoError;
+	}
+
+	FLASH.timestamp = (SB_clockGetTimeMs() - SB_clockGetUptimeMs()) / 1000;
+
+	return NoError;
+}
+
+uint32_t SB_flashGetReferenceTime() {
+	return FLASH.timestamp == UINT32_MAX ? 0 : FLASH.timestamp;
+}
+
+bool SB_flashHasTime() {
+	return FLASH.timestamp != UINT32_MAX;
+}
@@ -0,0 +1,150 @@
+/*
+ * emuOadTarget.c
+ *
+ * RAM-backed implementation of the OAD target interface in PROFILES/oad_target.h, standing in
+ * for oad_target_externalFlash.c. Flash behaves like the external NOR part: erase sets a page
+ * to 0xFF and programming can only clear bits. Every operation keeps the application busy
+ * for about as long as the SPI flash would.
+ */
+
+#include <stdio.h>
+
+#include <ti/sysbios/knl/Clock.h>
+
+#include "hal_flash.h"
+#include "oad_target.h"
+
+#include "emulator.h"
+
+#define SB_EMU_OAD_PAGES            28
+#define SB_EMU_OAD_SIZE             (SB_EMU_OAD_PAGES * HAL_FLASH_PAGE_SIZE)
+
+// Sector erase and page program times of the external flash, plus SPI transfer at 4MHz
+#define SB_EMU_OAD_ERASE_US         40000
+#define SB_EMU_OAD_PROGRAM_US       100
+#define SB_EMU_OAD_PROGRAM_BYTE_US  5
+#define SB_EMU_OAD_READ_US          20
+#define SB_EMU_OAD_READ_BYTE_US     2
+
+#define US_TO_TICKS(us)             ((us) / Clock_tickPeriod)
+
+SB_EmuOadStats SB_emuOadStats;
+
+static struct {
+	uint8 flash[SB_EMU_OAD_SIZE];
+	uint16 crc[2];
+} OAD;
+
+static bool inRange(uint32_t addr, uint16_t len) {
+	if (addr > SB_EMU_OAD_SIZE || SB_EMU_OAD_SIZE - addr < len) {
+		fprintf(stderr, "emu: OAD flash access out of range: 0x%x+%u\n", addr, len);
+		return false;
+	}
+
+	return true;
+}
+
+void SB_emuOadInit() {
+	memset(&OAD, 0, sizeof(OAD));
+	memset(&SB_emuOadStats, 0, sizeof(SB_emuOadStats));
+}
+
+const uint8 * SB_emuOadImage() {
+	return OAD.flash;
+}
+
+uint8_t OADTarget_open(void) {
+	return TRUE;
+}
+
+void OADTarget_close(void) {
+}
+
+bool OADTarget_hasExternalFlash(void) {
+	return true;
+}
+
+void OADTarget_storeImageHeader(uint8_t *pValue) {
+	OAD.crc[0] = BUILD_UINT16(pValue[0], pValue[1]);
+	OAD.crc[1] = BUILD_UINT16(pValue[2], pValue[3]);
+}
+
+void OADTarget_getCurrentImageHeader(img_hdr_t *pHdr) {
+	memset(pHdr, 0, sizeof(*pHdr));
+}
+
+void OADTarget_getCrc(uint16_t *pCrc) {
+	pCrc[0] = OAD.crc[0];
+	pCrc[1] = OAD.crc[1];
+}
+
+void OADTarget_setCrc(uint16_t *pCrc) {
+	OAD.crc[1] = pCrc[1];
+}
+
+uint32_t OADTarget_imageAddress(uint8_t *pValue) {
+	return 0;
+}
+
+uint8_t OADTarget_validateNewImage(uint8_t *pValue, img_hdr_t *ImgHdr, uint16_t blkTot) {
+	return blkTot > 0 && blkTot <= SB_EMU_OAD_SIZE / OAD_BLOCK_SIZE;
+}
+
+void OADTarget_readFlash(uint8_t page, uint32_t offset, uint8_t *pBuf, uint16_t len) {
+	uint32_t addr = FLASH_ADDRESS(page, offset);
+
+	if (!inRange(addr, len)) {
+		memset(pBuf, 0xFF, len);
+		return;
+	}
+
+	memcpy(pBuf, OAD.flash + addr, len);
+
+	++SB_emuOadStats.reads;
+	SB_emuAppBusy(US_TO_TICKS(SB_EMU_OAD_READ_US + len * SB_EMU_OAD_READ_BYTE_US));
+}
+
+void OADTarget_writeFlash(uint8_t page, uint32_t offset, uint8_t *pBuf, uint16_t len) {
+	uint32_t addr = FLASH_ADDRESS(page, offset);
+	uint16_t i;
+
+	if (!inRange(addr, len)) {
+		return;
+	}
+
+	for (i = 0; i < len; ++i) {
+		if (0xFF != OAD.flash[addr + i]) {
+			++SB_emuOadStats.overwrites;
+		}
+
+		OAD.flash[addr + i] &= pBuf[i];
+	}
+
+	++SB_emuOadStats.programs;
+	SB_emuOadStats.programmedBytes += len;
+	SB_emuAppBusy(US_TO_TICKS(SB_EMU_OAD_PROGRAM_US + len * SB_EMU_OAD_PROGRAM_BYTE_US));
+}
+
+void OADTarget_eraseFlash(uint8_t page) {
+	uint32_t addr = FLASH_ADDRESS(page, 0);
+
+	if (!inRange(addr, HAL_FLASH_PAGE_SIZE)) {
+		return;
+	}
+
+	memset(OAD.flash + addr, 0xFF, HAL_FLASH_PAGE_SIZE);
+
+	++SB_emuOadStats.erases;
+	SB_emuAppBusy(US_TO_TICKS(SB_EMU_OAD_ERASE_US));
+}
+
+void OADTarget_systemReset(void) {
+	SB_emuOadStats.resetRequested = true;
+}
+
+void saveImageInfo(void) {
+}
+
+uint8_t getImageFlag(void) {
+	return OAD_IMG_APP_FLAG;
+}
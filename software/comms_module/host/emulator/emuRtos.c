@@ -0,0 +1,237 @@
+/*
+ * emuRtos.c
+ *
+ * Emulated TI-RTOS kernel objects and XDC runtime. Time is virtual: ticks only advance
+ * through SB_emuAdvanceTicks() (or Task_sleep()/ICall_wait(), which call it), and clock
+ * functions run synchronously from there.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <xdc/std.h>
+#include <xdc/runtime/System.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/knl/Queue.h>
+#include <ti/sysbios/knl/Semaphore.h>
+#include <ti/sysbios/knl/Task.h>
+
+#include "Board.h"
+#include "emulator.h"
+
+bool SB_emuVerbose = false;
+
+static struct {
+	UInt32 ticks;
+	uint64_t totalTicks;
+	uint64_t appFreeAt;
+	Clock_Struct *clocks;
+} RTOS;
+
+/*********************************************************************
+ * Board globals normally provided by Board.c
+ */
+struct GlobalDeviceConfigurationStruct SB_GlobalDeviceConfiguration = {
+	.CheckSleepIntervalMS = 1000,
+	.BLECheckInterval = 10,
+	.CheckReadDelayMS = 0,
+	.MaxTransmitStateTimeS = 10,
+	.TemperatureResolution = 3, // MCP9808_RESOLUTION_0P0625
+};
+
+/*********************************************************************
+ * Virtual time
+ */
+void SB_emuAdvanceTicks(uint32 ticks) {
+	UInt32 target = RTOS.ticks + ticks;
+	Clock_Struct *clock, *next;
+
+	do {
+		// Find the earliest clock that expires within the window
+		next = NULL;
+		for (clock = RTOS.clocks; NULL != clock; clock = clock->next) {
+			if (clock->active && (Int)(clock->deadline - target) <= 0
+					&& (NULL == next || (Int)(clock->deadline - next->deadline) < 0)) {
+				next = clock;
+			}
+		}
+
+		if (NULL != next) {
+			if ((Int)(next->deadline - RTOS.ticks) > 0) {
+				RTOS.ticks = next->deadline;
+			}
+
+			if (next->period) {
+				next->deadline += next->period;
+			} else {
+				next->active = false;
+			}
+
+			next->fxn(next->arg);
+		}
+	} while (NULL != next);
+
+	RTOS.ticks = target;
+	RTOS.totalTicks += ticks;
+}
+
+uint64_t SB_emuTicks() {
+	return RTOS.totalTicks;
+}
+
+uint64_t SB_emuTimeMs() {
+	return RTOS.totalTicks / (1000 / Clock_tickPeriod);
+}
+
+void SB_emuAppBusy(uint32 ticks) {
+	if (RTOS.appFreeAt < RTOS.totalTicks) {
+		RTOS.appFreeAt = RTOS.totalTicks;
+	}
+
+	RTOS.appFreeAt += ticks;
+}
+
+uint64_t SB_emuAppFreeAt() {
+	return RTOS.appFreeAt < RTOS.totalTicks ? RTOS.totalTicks : RTOS.appFreeAt;
+}
+
+UInt32 Clock_getTicks(void) {
+	return RTOS.ticks;
+}
+
+/*********************************************************************
+ * Clock
+ */
+void Clock_Params_init(Clock_Params *params) {
+	memset(params, 0, sizeof(*params));
+}
+
+void Clock_construct(Clock_Struct *obj, Clock_FuncPtr fxn, UInt timeout, const Clock_Params *params) {
+	Clock_Struct *clock;
+
+	for (clock = RTOS.clocks; NULL != clock && clock != obj; clock = clock->next);
+
+	if (NULL == clock) {
+		obj->next = RTOS.clocks;
+		RTOS.clocks = obj;
+	}
+
+	obj->fxn = fxn;
+	obj->timeout = timeout;
+	obj->period = params->period;
+	obj->arg = params->arg;
+	obj->active = false;
+
+	if (params->startFlag) {
+		Clock_start(obj);
+	}
+}
+
+void Clock_start(Clock_Handle handle) {
+	handle->deadline = RTOS.ticks + handle->timeout;
+	handle->active = true;
+}
+
+void Clock_stop(Clock_Handle handle) {
+	handle->active = false;
+}
+
+Bool Clock_isActive(Clock_Handle handle) {
+	return handle->active;
+}
+
+void Clock_setTimeout(Clock_Handle handle, UInt32 timeout) {
+	handle->timeout = timeout;
+}
+
+void Clock_setPeriod(Clock_Handle handle, UInt32 period) {
+	handle->period = period;
+}
+
+/*********************************************************************
+ * Semaphore
+ */
+void Semaphore_construct(Semaphore_Struct *obj, Int count, void *params) {
+	obj->count = count;
+}
+
+void Semaphore_post(Semaphore_Handle handle) {
+	++handle->count;
+	++SB_emuStats.appWakeups;
+}
+
+Bool Semaphore_pend(Semaphore_Handle handle, UInt32 timeout) {
+	if (0 == handle->count) {
+		return false;
+	}
+
+	--handle->count;
+	return true;
+}
+
+/*********************************************************************
+ * Queue
+ */
+void Queue_construct(Queue_Struct *obj, void *params) {
+	obj->elem.next = &obj->elem;
+	obj->elem.prev = &obj->elem;
+}
+
+Bool Queue_empty(Queue_Handle handle) {
+	return handle->elem.next == &handle->elem;
+}
+
+void Queue_enqueue(Queue_Handle handle, Queue_Elem *elem) {
+	elem->next = &handle->elem;
+	elem->prev = handle->elem.prev;
+	handle->elem.prev->next = elem;
+	handle->elem.prev = elem;
+}
+
+void *Queue_dequeue(Queue_Handle handle) {
+	Queue_Elem *elem = handle->elem.next;
+
+	if (elem == &handle->elem) {
+		return NULL;
+	}
+
+	handle->elem.next = elem->next;
+	elem->next->prev = &handle->elem;
+
+	return elem;
+}
+
+/*********************************************************************
+ * Task
+ */
+void Task_sleep(UInt32 nticks) {
+	SB_emuAdvanceTicks(nticks);
+}
+
+/*********************************************************************
+ * System
+ */
+Int System_printf(const char *fmt, ...) {
+	va_list args;
+	Int result = 0;
+
+	if (SB_emuVerbose) {
+		va_start(args, fmt);
+		result = vprintf(fmt, args);
+		va_end(args);
+	}
+
+	return result;
+}
+
+void System_flush(void) {
+	if (SB_emuVerbose) {
+		fflush(stdout);
+	}
+}
+
+void System_abort(const char *str) {
+	fprintf(stderr, "System_abort: %s\n", str);
+	abort();
+}
@@ -0,0 +1,21 @@
+/*
+ * emuSnv.h
+ *
+ * Counters of the simple NV stand-in, emulator/osal_snv.c. Kept apart from emulator.h, as the
+ * stand-in is built with the stack's own OSAL headers rather than the host ones.
+ */
+
+#ifndef HOST_EMU_SNV_H
+#define HOST_EMU_SNV_H
+
+typedef struct {
+	uint32 programs;
+	uint32 programmedBytes;
+	uint32 reads;
+	uint32 compactions;
+	uint16 pageUsed;		// Bytes of the active page taken by item versions
+} SB_EmuSnvStats;
+
+extern SB_EmuSnvStats SB_emuSnvStats;
+
+#endif /* HOST_EMU_SNV_H */
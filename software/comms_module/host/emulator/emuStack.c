@@ -0,0 +1,865 @@
+/*
+ * emuStack.c
+ *
+ * Emulated ICall dispatcher, GAP roles and GATT server. Only one application entity is
+ * supported; every stack message is addressed to it.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <ti/sysbios/knl/Clock.h>
+
+#include "ICall.h"
+#include "ICallPool.h"
+#include "gatt.h"
+#include "gattservapp.h"
+#include "gapgattserver.h"
+#include "gapbondmgr.h"
+#include "peripheral.h"
+#include "linkdb.h"
+#include "hci_tl.h"
+#include "bleDispatch.h"
+
+#include "emulator.h"
+
+#define SB_EMU_APP_ENTITY      1
+#define SB_EMU_MAX_SERVICES    4
+#define SB_EMU_MAX_STACK_MSGS  32
+
+#define GATT_PRIMARY_SERVICE_UUID  0x2800
+#define GATT_CHARACTER_UUID        0x2803
+#define GATT_CLIENT_CHAR_CFG_UUID  0x2902
+
+// Command IDs of the HCI extension commands the stack calls are made with (hci.h)
+#define EMU_GAP_MAKE_DISCOVERABLE  0x06
+#define EMU_GAP_END_DISC           0x08
+#define EMU_GAP_TERMINATE_LINK     0x0A
+#define EMU_GAP_SET_PARAM          0x30
+#define EMU_GAP_BOND_SET_PARAM     0x36
+#define EMU_LL_SET_BDADDR          0x0C
+#define EMU_LL_CONN_EVENT_NOTICE   0x18
+
+#define captureICall(csg, cmd)     captureCmd(SB_EMU_ICALL_CMD, SB_EMU_HCI_EXT_OPCODE(csg, cmd), 0)
+#define captureDispatch(sub, cmd)  captureCmd(SB_EMU_DISPATCH_CMD, sub, cmd)
+
+typedef struct {
+	gattAttribute_t *pAttrs;
+	uint16 numAttrs;
+	CONST gattServiceCBs_t *pCBs;
+} SB_EmuService;
+
+typedef struct {
+	bool connected;
+	uint8 peerAddr[B_ADDR_LEN];
+	uint16 mtu;
+	bool indicationPending;
+	uint8 eventPDUs;
+	SB_EmuPDU pdus[SB_EMU_MAX_PDU_QUEUE];
+	uint8 pduHead;
+	uint8 pduCount;
+} SB_EmuConn;
+
+uint8 linkDBNumConns = 1;
+
+SB_EmuStats SB_emuStats;
+
+static struct {
+	Semaphore_Struct appSem;
+	bool appRegistered;
+
+	gapRolesCBs_t *gapRoleCBs;
+	bool advertising;
+
+	SB_EmuService services[SB_EMU_MAX_SERVICES];
+	uint8 numServices;
+	uint16 nextHandle;
+
+	SB_EmuConn conns[SB_EMU_MAX_CONNS];
+	uint16 lastConnHandle;
+	uint16 writingConnHandle;	// Link whose write the stack is handling, INVALID_CONNHANDLE if none
+	uint8 privateAddrs;
+	uint16 connIntervalTicks;
+	uint8 pdusPerEvent;
+
+	void *stackMsgs[SB_EMU_MAX_STACK_MSGS];
+	uint8 stackMsgHead;
+	uint8 stackMsgCount;
+} EMU;
+
+// Kept apart from EMU, to capture across SB_emuInit()
+static struct {
+	SB_EmuStackCmd *cmds;
+	uint32 max;
+	uint32 count;
+} capture;
+
+extern uint8_t SB_processBLEMessages();
+
+/*********************************************************************
+ * Local helpers
+ */
+static void captureCmd(uint8 event, uint16 opCode, uint8 cmdId) {
+	if (NULL != capture.cmds && capture.count < capture.max) {
+		capture.cmds[capture.count].event = event;
+		capture.cmds[capture.count].opCode = opCode;
+		capture.cmds[capture.count].cmdId = cmdId;
+		++capture.count;
+	}
+}
+
+static void chargeRoundTrip() {
+	SB_emuAdvanceTicks(EMU.connIntervalTicks);
+	++SB_emuStats.connEvents;
+}
+
+static void chargeUnacked(SB_EmuConn *conn) {
+	if (++conn->eventPDUs > EMU.pdusPerEvent) {
+		conn->eventPDUs = 1;
+		chargeRoundTrip();
+	}
+}
+
+static SB_EmuConn * getConn(uint16 connHandle) {
+	if (connHandle >= linkDBNumConns || !EMU.conns[connHandle].connected) {
+		return NULL;
+	}
+
+	return &EMU.conns[connHandle];
+}
+
+static uint16 attrUUID(const gattAttribute_t *pAttr) {
+	// 128-bit UUIDs are matched on their 16-bit alias within the base UUID
+	if (ATT_UUID_SIZE == pAttr->type.len) {
+		return BUILD_UINT16(pAttr->type.uuid[12], pAttr->type.uuid[13]);
+	}
+
+	return BUILD_UINT16(pAttr->type.uuid[0], pAttr->type.uuid[1]);
+}
+
+static gattAttribute_t * findAttr(uint16 handle, SB_EmuService **service) {
+	uint8 s;
+	uint16 i;
+
+	for (s = 0; s < EMU.numServices; ++s) {
+		for (i = 0; i < EMU.services[s].numAttrs; ++i) {
+			if (EMU.services[s].pAttrs[i].handle == handle) {
+				*service = &EMU.services[s];
+				return &EMU.services[s].pAttrs[i];
+			}
+		}
+	}
+
+	return NULL;
+}
+
+static void resetCharCfgs(uint16 connHandle) {
+	uint8 s;
+	uint16 i;
+
+	for (s = 0; s < EMU.numServices; ++s) {
+		for (i = 0; i < EMU.services[s].numAttrs; ++i) {
+			gattAttribute_t *pAttr = &EMU.services[s].pAttrs[i];
+
+			if (GATT_CLIENT_CHAR_CFG_UUID == attrUUID(pAttr) && NULL != GATT_CCC_TBL(pAttr->pValue)) {
+				GATTServApp_InitCharCfg(connHandle, GATT_CCC_TBL(pAttr->pValue));
+			}
+		}
+	}
+}
+
+static void postStackMsg(void *pMsg) {
+	if (EMU.stackMsgCount >= SB_EMU_MAX_STACK_MSGS) {
+		fprintf(stderr, "emu: stack message queue overflow\n");
+		ICall_freeMsg(pMsg);
+		return;
+	}
+
+	EMU.stackMsgs[(EMU.stackMsgHead + EMU.stackMsgCount++) % SB_EMU_MAX_STACK_MSGS] = pMsg;
+	Semaphore_post(&EMU.appSem);
+}
+
+static void postGattEvent(uint16 connHandle, uint8 method, const gattMsg_t *msg) {
+	gattMsgEvent_t *pEvt = ICall_allocMsg(sizeof(gattMsgEvent_t));
+
+	memset(pEvt, 0, sizeof(*pEvt));
+	pEvt->hdr.event = GATT_MSG_EVENT;
+	pEvt->hdr.status = SUCCESS;
+	pEvt->connHandle = connHandle;
+	pEvt->method = method;
+
+	if (NULL != msg) {
+		pEvt->msg = *msg;
+	}
+
+	postStackMsg(pEvt);
+}
+
+static void queueServerPDU(SB_EmuConn *conn, uint8 method, attHandleValueNoti_t *pNoti) {
+	SB_EmuPDU *pdu;
+
+	if (conn->pduCount >= SB_EMU_MAX_PDU_QUEUE) {
+		fprintf(stderr, "emu: server PDU queue overflow\n");
+		return;
+	}
+
+	pdu = &conn->pdus[(conn->pduHead + conn->pduCount++) % SB_EMU_MAX_PDU_QUEUE];
+	pdu->method = method;
+	pdu->handle = pNoti->handle;
+	pdu->len = pNoti->len;
+	pdu->readyAt = SB_emuAppFreeAt();
+	memcpy(pdu->value, pNoti->pValue, pNoti->len);
+
+	SB_emuStats.serverBytes += pNoti->len;
+}
+
+/*********************************************************************
+ * Harness interface
+ */
+void SB_emuInit(uint8 numConns, uint16 connIntervalMs, uint8 pdusPerEvent) {
+	static bool poolReady = false;
+
+	memset(&EMU, 0, sizeof(EMU));
+
+	// Like ICall_init(), once per process: blocks may still be held across runs
+	if (!poolReady) {
+		ICall_poolInit();
+		poolReady = true;
+	}
+
+	linkDBNumConns = numConns > SB_EMU_MAX_CONNS ? SB_EMU_MAX_CONNS : numConns;
+	EMU.connIntervalTicks = connIntervalMs * (1000 / Clock_tickPeriod);
+	EMU.pdusPerEvent = pdusPerEvent ? pdusPerEvent : 1;
+	EMU.nextHandle = 1;
+	EMU.writingConnHandle = INVALID_CONNHANDLE;
+
+	Semaphore_construct(&EMU.appSem, 0, NULL);
+	SB_emuResetStats();
+}
+
+void SB_emuResetStats() {
+	memset(&SB_emuStats, 0, sizeof(SB_emuStats));
+}
+
+void SB_emuCaptureStackCmds(SB_EmuStackCmd *cmds, uint32 max) {
+	capture.cmds = cmds;
+	capture.max = max;
+	capture.count = 0;
+}
+
+uint32 SB_emuStackCmdsCaptured() {
+	return capture.count;
+}
+
+uint32 SB_emuRunApp() {
+	uint32 total = 0;
+	uint8 processed;
+
+	while (0 != (processed = SB_processBLEMessages())) {
+		total += processed;
+	}
+
+	EMU.appSem.count = 0;
+
+	return total;
+}
+
+bStatus_t SB_emuConnect(uint16 connHandle, uint16 mtu) {
+	return SB_emuConnectPeer(connHandle, mtu, connHandle);
+}
+
+bStatus_t SB_emuConnectPeer(uint16 connHandle, uint16 mtu, uint8 peer) {
+	SB_EmuConn *conn;
+	gattMsg_t msg;
+
+	if (connHandle >= linkDBNumConns || EMU.conns[connHandle].connected) {
+		return INVALIDPARAMETER;
+	}
+
+	conn = &EMU.conns[connHandle];
+	memset(conn, 0, sizeof(*conn));
+	conn->connected = true;
+	conn->mtu = ATT_MTU_SIZE;
+
+	// A resolvable private address: the random part changes every connection, the hash
+	// (standing in for the IRK) identifies the peer
+	conn->peerAddr[0] = ++EMU.privateAddrs;
+	conn->peerAddr[1] = peer;
+	conn->peerAddr[B_ADDR_LEN - 1] = 0x40;
+	EMU.lastConnHandle = connHandle;
+
+	if (NULL != EMU.gapRoleCBs && NULL != EMU.gapRoleCBs->pfnStateChange) {
+		EMU.gapRoleCBs->pfnStateChange(GAPROLE_CONNECTED);
+	}
+
+	if (mtu > ATT_MTU_SIZE) {
+		// Exchange MTU request/response
+		conn->mtu = mtu;
+		++SB_emuStats.mtuExchanges;
+		chargeRoundTrip();
+
+		msg.mtuEvt.MTU = mtu;
+		postGattEvent(connHandle, ATT_MTU_UPDATED_EVENT, &msg);
+	}
+
+	return SUCCESS;
+}
+
+bStatus_t SB_emuDisconnect(uint16 connHandle) {
+	SB_EmuConn *conn;
+	uint16 i;
+
+	if (NULL == (conn = getConn(connHandle))) {
+		return bleNotConnected;
+	}
+
+	conn->connected = false;
+	conn->pduCount = 0;
+	conn->indicationPending = false;
+
+	// The stack forgets a client's CCC values when its link drops
+	resetCharCfgs(connHandle);
+
+	if (NULL != EMU.gapRoleCBs && NULL != EMU.gapRoleCBs->pfnStateChange) {
+		EMU.gapRoleCBs->pfnStateChange(GAPROLE_WAITING);
+
+		// Like peripheral.c, advertising starts again if it is still enabled and no link is up
+		for (i = 0; i < linkDBNumConns && !EMU.conns[i].connected; ++i);
+
+		if (i == linkDBNumConns && EMU.advertising) {
+			EMU.gapRoleCBs->pfnStateChange(GAPROLE_ADVERTISING);
+		}
+	}
+
+	return SUCCESS;
+}
+
+bool SB_emuConnected(uint16 connHandle) {
+	return NULL != getConn(connHandle);
+}
+
+uint16 SB_emuFindHandle(uint16 uuid, uint8 nth) {
+	uint8 s;
+	uint16 i;
+
+	for (s = 0; s < EMU.numServices; ++s) {
+		for (i = 0; i < EMU.services[s].numAttrs; ++i) {
+			if (attrUUID(&EMU.services[s].pAttrs[i]) == uuid && 0 == nth--) {
+				return EMU.services[s].pAttrs[i].handle;
+			}
+		}
+	}
+
+	return 0;
+}
+
+uint16 SB_emuFindCCCHandle(uint16 valueHandle) {
+	SB_EmuService *service;
+	gattAttribute_t *pAttr = findAttr(valueHandle, &service);
+
+	if (NULL == pAttr) {
+		return 0;
+	}
+
+	// Descriptors follow the value until the next characteristic declaration
+	for (++pAttr; pAttr < service->pAttrs + service->numAttrs; ++pAttr) {
+		if (GATT_CHARACTER_UUID == attrUUID(pAttr)) {
+			break;
+		}
+
+		if (GATT_CLIENT_CHAR_CFG_UUID == attrUUID(pAttr)) {
+			return pAttr->handle;
+		}
+	}
+
+	return 0;
+}
+
+gattAttribute_t *SB_emuFindAttr(uint16 handle) {
+	SB_EmuService *service;
+
+	return findAttr(handle, &service);
+}
+
+bStatus_t SB_emuRead(uint16 connHandle, uint16 handle, uint16 offset, uint8 *value, uint16 *len) {
+	SB_EmuConn *conn;
+	SB_EmuService *service;
+	gattAttribute_t *pAttr;
+	bStatus_t status;
+
+	*len = 0;
+
+	if (NULL == (conn = getConn(connHandle))) {
+		return bleNotConnected;
+	}
+
+	if (0 == offset) {
+		++SB_emuStats.reads;
+	} else {
+		++SB_emuStats.readBlobs;
+	}
+
+	chargeRoundTrip();
+
+	if (NULL == (pAttr = findAttr(handle, &service))) {
+		return ATT_ERR_INVALID_HANDLE;
+	}
+
+	if (!gattPermitRead(pAttr->permissions)) {
+		return ATT_ERR_READ_NOT_PERMITTED;
+	}
+
+	if (GATT_CLIENT_CHAR_CFG_UUID == attrUUID(pAttr)) {
+		// CCC reads are answered by the GATT server itself
+		uint16 cfg = GATTServApp_ReadCharCfg(connHandle, GATT_CCC_TBL(pAttr->pValue));
+		value[0] = LO_UINT16(cfg);
+		value[1] = HI_UINT16(cfg);
+		*len = 2;
+		status = SUCCESS;
+	} else {
+		status = service->pCBs->pfnReadAttrCB(connHandle, pAttr, value, len, offset,
+			conn->mtu - 1, 0 == offset ? ATT_READ_REQ : ATT_READ_BLOB_REQ);
+	}
+
+	if (SUCCESS == status) {
+		SB_emuStats.serverBytes += *len;
+	}
+
+	return status;
+}
+
+bStatus_t SB_emuReadLong(uint16 connHandle, uint16 handle, uint8 *value, uint16 maxLen, uint16 *len) {
+	SB_EmuConn *conn;
+	bStatus_t status;
+	uint16 partLen;
+
+	*len = 0;
+
+	if (NULL == (conn = getConn(connHandle))) {
+		return bleNotConnected;
+	}
+
+	// A full response means there may be more to read
+	do {
+		if (SUCCESS != (status = SB_emuRead(connHandle, handle, *len, value + *len, &partLen))) {
+			return status;
+		}
+
+		*len += partLen;
+	} while (partLen == conn->mtu - 1 && *len + conn->mtu - 1 <= maxLen);
+
+	return SUCCESS;
+}
+
+bStatus_t SB_emuWrite(uint16 connHandle, uint16 handle, const uint8 *value, uint16 len, bool withResponse) {
+	SB_EmuConn *conn;
+	SB_EmuService *service;
+	gattAttribute_t *pAttr;
+	uint8 buf[SB_EMU_MAX_ATT_VALUE];
+	bStatus_t status;
+
+	if (NULL == (conn = getConn(connHandle))) {
+		return bleNotConnected;
+	}
+
+	if (len > conn->mtu - 3 || len > sizeof(buf)) {
+		return ATT_ERR_INVALID_VALUE_SIZE;
+	}
+
+	if (withResponse) {
+		++SB_emuStats.writes;
+		chargeRoundTrip();
+	} else {
+		++SB_emuStats.writeCmds;
+		chargeUnacked(conn);
+	}
+
+	if (NULL == (pAttr = findAttr(handle, &service))) {
+		return ATT_ERR_INVALID_HANDLE;
+	}
+
+	if (!gattPermitWrite(pAttr->permissions)) {
+		return ATT_ERR_WRITE_NOT_PERMITTED;
+	}
+
+	memcpy(buf, value, len);
+
+	// The stack is handling this link's request, so the GAP role reports its central meanwhile
+	EMU.writingConnHandle = connHandle;
+	status = service->pCBs->pfnWriteAttrCB(connHandle, pAttr, buf, len, 0,
+		withResponse ? ATT_WRITE_REQ : ATT_WRITE_CMD);
+	EMU.writingConnHandle = INVALID_CONNHANDLE;
+
+	return status;
+}
+
+bool SB_emuReceive(uint16 connHandle, SB_EmuPDU *pdu) {
+	SB_EmuConn *conn;
+
+	if (NULL == (conn = getConn(connHandle)) || 0 == conn->pduCount) {
+		return false;
+	}
+
+	*pdu = conn->pdus[conn->pduHead];
+	conn->pduHead = (conn->pduHead + 1) % SB_EMU_MAX_PDU_QUEUE;
+	--conn->pduCount;
+
+	if (pdu->readyAt > SB_emuTicks()) {
+		SB_emuAdvanceTicks(pdu->readyAt - SB_emuTicks());
+	}
+
+	return true;
+}
+
+void SB_emuNextEvent(uint16 connHandle) {
+	SB_EmuConn *conn;
+
+	if (NULL != (conn = getConn(connHandle))) {
+		conn->eventPDUs = 0;
+		chargeRoundTrip();
+	}
+}
+
+bStatus_t SB_emuConfirm(uint16 connHandle) {
+	SB_EmuConn *conn;
+
+	if (NULL == (conn = getConn(connHandle))) {
+		return bleNotConnected;
+	}
+
+	if (!conn->indicationPending) {
+		return INVALIDPARAMETER;
+	}
+
+	conn->indicationPending = false;
+	++SB_emuStats.confirmations;
+	chargeRoundTrip();
+
+	postGattEvent(connHandle, ATT_HANDLE_VALUE_CFM, NULL);
+
+	return SUCCESS;
+}
+
+/*********************************************************************
+ * ICall
+ */
+ICall_Errno ICall_registerApp(ICall_EntityID *entity, ICall_Semaphore *msgsem) {
+	EMU.appRegistered = true;
+	*entity = SB_EMU_APP_ENTITY;
+	*msgsem = &EMU.appSem;
+
+	return ICALL_ERRNO_SUCCESS;
+}
+
+ICall_Errno ICall_fetchServiceMsg(ICall_ServiceEnum *src, ICall_EntityID *dest, void **msg) {
+	if (0 == EMU.stackMsgCount) {
+		return ICALL_ERRNO_NOMSG;
+	}
+
+	*src = ICALL_SERVICE_CLASS_BLE;
+	*dest = SB_EMU_APP_ENTITY;
+	*msg = EMU.stackMsgs[EMU.stackMsgHead];
+
+	EMU.stackMsgHead = (EMU.stackMsgHead + 1) % SB_EMU_MAX_STACK_MSGS;
+	--EMU.stackMsgCount;
+
+	return ICALL_ERRNO_SUCCESS;
+}
+
+ICall_Errno ICall_wait(uint_fast32_t milliseconds) {
+	if (Semaphore_pend(&EMU.appSem, 0)) {
+		return ICALL_ERRNO_SUCCESS;
+	}
+
+	SB_emuAdvanceTicks(milliseconds * (1000 / Clock_tickPeriod));
+
+	return Semaphore_pend(&EMU.appSem, 0) ? ICALL_ERRNO_SUCCESS : ICALL_ERRNO_TIMEOUT;
+}
+
+ICall_EntityID ICall_getEntityId(void) {
+	return EMU.appRegistered ? SB_EMU_APP_ENTITY : ICALL_INVALID_ENTITY_ID;
+}
+
+// Allocations go through the firmware's block pools, with the C heap standing in for heapmgr
+void *ICall_heapMalloc(uint16_t size) {
+	return malloc(size);
+}
+
+void ICall_heapFree(void *blk) {
+	free(blk);
+}
+
+void *ICall_malloc(uint_least16_t size) {
+	return ICall_poolMalloc(size);
+}
+
+void ICall_free(void *msg) {
+	ICall_poolFree(msg);
+}
+
+void *ICall_allocMsg(size_t size) {
+	return ICall_poolMalloc(size);
+}
+
+void ICall_freeMsg(void *msg) {
+	ICall_poolFree(msg);
+}
+
+/*********************************************************************
+ * GATT
+ */
+void *GATT_bm_alloc(uint16 connHandle, uint8 opcode, uint16 size, uint16 *pSizeAlloc) {
+	SB_EmuConn *conn;
+	uint16 maxSize;
+
+	if (NULL == (conn = getConn(connHandle))) {
+		return NULL;
+	}
+
+	maxSize = conn->mtu - 3;
+	if (size > maxSize) {
+		size = maxSize;
+	}
+
+	if (NULL != pSizeAlloc) {
+		*pSizeAlloc = size;
+	}
+
+	// The stack takes payloads from its OSAL heap, which is ICall's
+	return ICall_malloc(size);
+}
+
+void GATT_bm_free(gattMsg_t *pMsg, uint8 opcode) {
+	if (ATT_HANDLE_VALUE_NOTI == opcode || ATT_HANDLE_VALUE_IND == opcode) {
+		ICall_free(pMsg->handleValueNoti.pValue);
+		pMsg->handleValueNoti.pValue = NULL;
+	}
+}
+
+bStatus_t GATT_Notification(uint16 connHandle, attHandleValueNoti_t *pNoti, uint8 authenticated) {
+	SB_EmuConn *conn;
+
+	captureICall(SB_EMU_CSG_GATT, ATT_HANDLE_VALUE_NOTI);
+
+	if (NULL == (conn = getConn(connHandle))) {
+		return bleNotConnected;
+	}
+
+	++SB_emuStats.notifications;
+	queueServerPDU(conn, ATT_HANDLE_VALUE_NOTI, pNoti);
+	chargeUnacked(conn);
+
+	// The stack owns the payload once the notification is accepted
+	ICall_free(pNoti->pValue);
+
+	return SUCCESS;
+}
+
+bStatus_t GATT_Indication(uint16 connHandle, attHandleValueInd_t *pInd, uint8 authenticated, uint8 taskId) {
+	SB_EmuConn *conn;
+
+	captureICall(SB_EMU_CSG_GATT, ATT_HANDLE_VALUE_IND);
+
+	if (NULL == (conn = getConn(connHandle))) {
+		return bleNotConnected;
+	}
+
+	// Only one indication may be outstanding per connection
+	if (conn->indicationPending) {
+		return blePending;
+	}
+
+	conn->indicationPending = true;
+	++SB_emuStats.indications;
+	queueServerPDU(conn, ATT_HANDLE_VALUE_IND, pInd);
+
+	ICall_free(pInd->pValue);
+
+	return SUCCESS;
+}
+
+uint16 ATT_GetMTU(uint16 connHandle) {
+	SB_EmuConn *conn = getConn(connHandle);
+
+	return NULL != conn ? conn->mtu : ATT_MTU_SIZE;
+}
+
+bStatus_t GATT_SendRsp(uint16 connHandle, uint8 method, gattMsg_t *pRsp) {
+	captureDispatch(DISPATCH_GATT_PROFILE, DISPATCH_GATT_SEND_RSP);
+	return SUCCESS;
+}
+
+void GATT_RegisterForMsgs(uint8 taskId) {
+	captureDispatch(DISPATCH_GATT_PROFILE, DISPATCH_GATT_REG_FOR_MSG);
+}
+
+/*********************************************************************
+ * GATT Server Application
+ */
+bStatus_t GATTServApp_RegisterService(gattAttribute_t *pAttrs, uint16 numAttrs,
+                                      uint8 encKeySize, CONST gattServiceCBs_t *pServiceCBs) {
+	uint16 i;
+
+	captureDispatch(DISPATCH_GATT_SERV_APP, DISPATCH_PROFILE_REG_SERVICE);
+
+	if (EMU.numServices >= SB_EMU_MAX_SERVICES) {
+		return bleNoResources;
+	}
+
+	for (i = 0; i < numAttrs; ++i) {
+		pAttrs[i].handle = EMU.nextHandle++;
+	}
+
+	EMU.services[EMU.numServices].pAttrs = pAttrs;
+	EMU.services[EMU.numServices].numAttrs = numAttrs;
+	EMU.services[EMU.numServices].pCBs = pServiceCBs;
+	++EMU.numServices;
+
+	return SUCCESS;
+}
+
+bStatus_t GATTServApp_AddService(uint32 services) {
+	captureDispatch(DISPATCH_GATT_SERV_APP, DISPATCH_PROFILE_ADD_SERVICE);
+	return SUCCESS;
+}
+
+/*********************************************************************
+ * GAP
+ */
+bStatus_t GAPRole_SetParameter(uint16 param, uint8 len, void *pValue) {
+	uint16 i;
+
+	if (GAPROLE_ADVERT_ENABLED != param || *(uint8 *)pValue == EMU.advertising) {
+		return SUCCESS;
+	}
+
+	EMU.advertising = *(uint8 *)pValue;
+	captureICall(SB_EMU_CSG_GAP, EMU.advertising ? EMU_GAP_MAKE_DISCOVERABLE : EMU_GAP_END_DISC);
+
+	// Like peripheral.c, the state only follows advertising while no link is up
+	for (i = 0; i < linkDBNumConns && !EMU.conns[i].connected; ++i);
+
+	if (i == linkDBNumConns && NULL != EMU.gapRoleCBs && NULL != EMU.gapRoleCBs->pfnStateChange) {
+		EMU.gapRoleCBs->pfnStateChange(EMU.advertising ? GAPROLE_ADVERTISING : GAPROLE_WAITING);
+	}
+
+	return SUCCESS;
+}
+
+bStatus_t GAPRole_GetParameter(uint16 param, void *pValue) {
+	switch (param) {
+	case GAPROLE_BD_ADDR:
+		memset(pValue, 0, B_ADDR_LEN);
+		break;
+
+	case GAPROLE_CONN_BD_ADDR:
+		memcpy(pValue, EMU.conns[INVALID_CONNHANDLE == EMU.writingConnHandle ? EMU.lastConnHandle : EMU.writingConnHandle].peerAddr, B_ADDR_LEN);
+		break;
+
+	case GAPROLE_BD_ADDR_TYPE:
+		*(uint8 *)pValue = ADDRTYPE_PRIVATE_RESOLVE;
+		break;
+
+	case GAPROLE_CONNHANDLE:
+		// Like peripheral.c, this is the most recently established link
+		*(uint16 *)pValue = EMU.lastConnHandle;
+		break;
+
+	default:
+		break;
+	}
+
+	return SUCCESS;
+}
+
+bStatus_t GAPRole_StartDevice(gapRolesCBs_t *pAppCallbacks) {
+	EMU.gapRoleCBs = pAppCallbacks;
+
+	if (NULL != pAppCallbacks && NULL != pAppCallbacks->pfnStateChange) {
+		pAppCallbacks->pfnStateChange(GAPROLE_STARTED);
+	}
+
+	return SUCCESS;
+}
+
+bStatus_t GAPRole_TerminateConnection(void) {
+	uint16 i;
+
+	for (i = 0; i < linkDBNumConns; ++i) {
+		if (EMU.conns[i].connected) {
+			captureICall(SB_EMU_CSG_GAP, EMU_GAP_TERMINATE_LINK);
+			SB_emuDisconnect(i);
+		}
+	}
+
+	return SUCCESS;
+}
+
+bStatus_t GAP_SetParamValue(uint16 paramID, uint16 paramValue) {
+	captureICall(SB_EMU_CSG_GAP, EMU_GAP_SET_PARAM);
+	return SUCCESS;
+}
+
+void GAP_RegisterForMsgs(uint8 taskID) {
+	captureDispatch(DISPATCH_GAP_PROFILE, DISPATCH_GAP_REG_FOR_MSG);
+}
+
+bStatus_t GGS_SetParameter(uint8 param, uint8 len, void *value) {
+	captureDispatch(DISPATCH_GAP_GATT_SERV, DISPATCH_PROFILE_SET_PARAM);
+	return SUCCESS;
+}
+
+bStatus_t GGS_AddService(uint32 services) {
+	captureDispatch(DISPATCH_GAP_GATT_SERV, DISPATCH_PROFILE_ADD_SERVICE);
+	return SUCCESS;
+}
+
+bStatus_t GAPBondMgr_SetParameter(uint16 param, uint8 len, void *pValue) {
+	captureICall(SB_EMU_CSG_GAP, EMU_GAP_BOND_SET_PARAM);
+	return SUCCESS;
+}
+
+bStatus_t GAPBondMgr_Register(gapBondCBs_t *pCB) {
+	captureDispatch(DISPATCH_GAP_PROFILE, DISPATCH_PROFILE_REG_CB);
+	return SUCCESS;
+}
+
+uint8 GAPBondMgr_ResolveAddr(uint8 addrType, uint8 *pDevAddr, uint8 *pResolvedAddr) {
+	captureDispatch(DISPATCH_GAP_PROFILE, DISPATCH_GAP_BOND_RESOLVE_ADDR);
+
+	// Every peer is bonded, at the index of its number
+	if (ADDRTYPE_PRIVATE_RESOLVE != addrType || 0x40 != pDevAddr[B_ADDR_LEN - 1]) {
+		return GAP_BONDINGS_MAX;
+	}
+
+	if (NULL != pResolvedAddr) {
+		memset(pResolvedAddr, 0, B_ADDR_LEN);
+		pResolvedAddr[0] = pDevAddr[1];
+	}
+
+	return pDevAddr[1] % GAP_BONDINGS_MAX;
+}
+
+/*********************************************************************
+ * Link database
+ */
+uint8 linkDB_State(uint16 connectionHandle, uint8 state) {
+	bool up = NULL != getConn(connectionHandle);
+
+	captureDispatch(DISPATCH_GAP_PROFILE, DISPATCH_GAP_LINKDB_STATE);
+
+	return LINK_CONNECTED == state ? up : !up;
+}
+
+/*********************************************************************
+ * HCI
+ */
+bStatus_t HCI_EXT_ConnEventNoticeCmd(uint16 connHandle, uint8 taskID, uint16 taskEvent) {
+	captureICall(SB_EMU_CSG_LINK_LAYER, EMU_LL_CONN_EVENT_NOTICE);
+	return SUCCESS;
+}
+
+bStatus_t HCI_EXT_SetBDADDRCmd(uint8 *bdAddr) {
+	captureICall(SB_EMU_CSG_LINK_LAYER, EMU_LL_SET_BDADDR);
+	return SUCCESS;
+}
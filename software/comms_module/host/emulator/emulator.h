@@ -0,0 +1,150 @@
+/*
+ * emulator.h
+ *
+ * Host-side emulation of the parts of the BLE stack and TI-RTOS that the Smart Bandage
+ * application talks to. The real application and profile sources are compiled against
+ * the headers in host/include and driven by a scripted central through this interface.
+ *
+ * Timing model: every ATT exchange that needs an answer from the other side (read, read
+ * blob, write request, indication/confirmation, MTU exchange) costs one connection
+ * interval. Unacknowledged PDUs (notifications, write commands) share a connection event
+ * with up to `pdusPerEvent` other PDUs.
+ */
+
+#ifndef HOST_EMULATOR_H
+#define HOST_EMULATOR_H
+
+#include "bcomdef.h"
+#include "gatt.h"
+
+#define SB_EMU_MAX_CONNS        4
+#define SB_EMU_MAX_PDU_QUEUE    16
+#define SB_EMU_MAX_ATT_VALUE    512
+
+typedef struct {
+	uint32 reads;
+	uint32 readBlobs;
+	uint32 writes;
+	uint32 writeCmds;
+	uint32 notifications;
+	uint32 indications;
+	uint32 confirmations;
+	uint32 mtuExchanges;
+	uint32 connEvents;
+	uint32 serverBytes;
+	uint32 appWakeups;
+} SB_EmuStats;
+
+typedef struct {
+	uint8 method;
+	uint16 handle;
+	uint16 len;
+	uint8 value[SB_EMU_MAX_ATT_VALUE];
+	uint64_t readyAt;		// Virtual tick at which the application had sent it
+} SB_EmuPDU;
+
+typedef struct {
+	uint32 erases;
+	uint32 programs;
+	uint32 programmedBytes;
+	uint32 reads;
+	uint32 overwrites;		// Programs over bytes that were not erased
+	bool resetRequested;
+} SB_EmuOadStats;
+
+// An application call into the stack, as the stack's ICall dispatcher (ICallBLE/bleDispatch.c)
+// gets it: an ICall command with its HCI extension opcode, or a Dispatch command with its
+// subgroup and command ID
+typedef struct {
+	uint8 event;			// SB_EMU_ICALL_CMD or SB_EMU_DISPATCH_CMD
+	uint16 opCode;			// HCI extension opcode, or Dispatch subgroup
+	uint8 cmdId;			// Dispatch command ID
+} SB_EmuStackCmd;
+
+#define SB_EMU_ICALL_CMD        0
+#define SB_EMU_DISPATCH_CMD     1
+
+// HCI extension opcodes: vendor specific OGF, command subgroup and command ID
+#define SB_EMU_HCI_EXT_OPCODE(csg, cmd)  (0xFC00 | (csg) << 7 | (cmd))
+#define SB_EMU_CSG_LINK_LAYER   0
+#define SB_EMU_CSG_L2CAP        1
+#define SB_EMU_CSG_ATT          2
+#define SB_EMU_CSG_GATT         3
+#define SB_EMU_CSG_GAP          4
+#define SB_EMU_CSG_UTIL         5
+
+extern bool SB_emuVerbose;
+extern SB_EmuStats SB_emuStats;
+extern SB_EmuOadStats SB_emuOadStats;
+
+/*********************************************************************
+ * Setup
+ */
+void SB_emuInit(uint8 numConns, uint16 connIntervalMs, uint8 pdusPerEvent);
+void SB_emuResetStats();
+
+// Records up to max of the application's stack calls from now on, across SB_emuInit(); NULL stops
+void SB_emuCaptureStackCmds(SB_EmuStackCmd *cmds, uint32 max);
+// Number of stack calls recorded
+uint32 SB_emuStackCmdsCaptured();
+
+/*********************************************************************
+ * Virtual time
+ */
+void SB_emuAdvanceTicks(uint32 ticks);
+// Virtual time since start; unlike Clock_getTicks() these never wrap
+uint64_t SB_emuTicks();
+uint64_t SB_emuTimeMs();
+
+// The application is blocked (e.g. on flash) for the given time. The radio keeps running,
+// so this only delays what the application sends afterwards.
+void SB_emuAppBusy(uint32 ticks);
+// Virtual tick at which the application has finished all its blocking work
+uint64_t SB_emuAppFreeAt();
+
+/*********************************************************************
+ * Application task
+ */
+// Runs the application's BLE message loop until nothing is left to process
+uint32 SB_emuRunApp();
+
+/*********************************************************************
+ * Link control
+ */
+bStatus_t SB_emuConnect(uint16 connHandle, uint16 mtu);
+// Connects a bonded central, which uses a new resolvable private address every time. Centrals
+// connected with SB_emuConnect() are the peer numbered after their connection handle.
+bStatus_t SB_emuConnectPeer(uint16 connHandle, uint16 mtu, uint8 peer);
+bStatus_t SB_emuDisconnect(uint16 connHandle);
+bool SB_emuConnected(uint16 connHandle);
+
+/*********************************************************************
+ * Central (GATT client) operations
+ */
+// Gets the handle of the nth (0-based) attribute with the given 16-bit type UUID
+uint16 SB_emuFindHandle(uint16 uuid, uint8 nth);
+// Gets the handle of the CCC descriptor belonging to the characteristic value handle
+uint16 SB_emuFindCCCHandle(uint16 valueHandle);
+// Gets the attribute registered with the given handle, NULL past the last one
+gattAttribute_t *SB_emuFindAttr(uint16 handle);
+
+bStatus_t SB_emuRead(uint16 connHandle, uint16 handle, uint16 offset, uint8 *value, uint16 *len);
+bStatus_t SB_emuReadLong(uint16 connHandle, uint16 handle, uint8 *value, uint16 maxLen, uint16 *len);
+bStatus_t SB_emuWrite(uint16 connHandle, uint16 handle, const uint8 *value, uint16 len, bool withResponse);
+
+// Pops the next server-initiated PDU (notification or indication), false if none queued.
+// Waits for the application to have sent it if it was held up by blocking work.
+bool SB_emuReceive(uint16 connHandle, SB_EmuPDU *pdu);
+// Waits for the next connection event, e.g. before responding to a notification
+void SB_emuNextEvent(uint16 connHandle);
+// Confirms the outstanding indication
+bStatus_t SB_emuConfirm(uint16 connHandle);
+
+/*********************************************************************
+ * OAD target (external flash image area)
+ */
+void SB_emuOadInit();
+// Contents of the image area
+const uint8 * SB_emuOadImage();
+
+#endif /* HOST_EMULATOR_H */
@@ -0,0 +1,84 @@
+/*
+ * osal_snv.c
+ *
+ * RAM-backed stand-in for the stack's two page simple NV, included by
+ * SmartBandageBLEStack/OSAL/osal_snv_wrapper.c in place of the SDK's osal_snv.c.
+ *
+ * As on the device, every write appends a new version of the item to the active page, and a
+ * full page is compacted, copying the current version of each item to the other page, in the
+ * middle of the write that did not fit.
+ */
+
+#include <string.h>
+
+#include "emuSnv.h"
+
+#define SB_EMU_SNV_PAGE_SIZE      4096
+#define SB_EMU_SNV_HEADER_SIZE    4
+#define SB_EMU_SNV_ITEMS          256
+
+// Bytes an item version takes in the page
+#define SB_EMU_SNV_SIZE(len)      (SB_EMU_SNV_HEADER_SIZE + (((len) + 3) & ~3))
+
+static struct {
+	uint8 len[SB_EMU_SNV_ITEMS];	// 0 if never written
+	uint8 data[SB_EMU_SNV_ITEMS][0xFF];
+} SNV;
+
+SB_EmuSnvStats SB_emuSnvStats;
+
+static void emuSnvCompact() {
+	uint16 i;
+
+	SB_emuSnvStats.pageUsed = 0;
+	for (i = 0; i < SB_EMU_SNV_ITEMS; ++i) {
+		if (SNV.len[i]) {
+			SB_emuSnvStats.pageUsed += SB_EMU_SNV_SIZE(SNV.len[i]);
+		}
+	}
+
+	++SB_emuSnvStats.compactions;
+}
+
+uint8 osal_snv_init(void) {
+	memset(&SNV, 0, sizeof(SNV));
+	memset(&SB_emuSnvStats, 0, sizeof(SB_emuSnvStats));
+	return SUCCESS;
+}
+
+uint8 osal_snv_read(osalSnvId_t id, osalSnvLen_t len, void *pBuf) {
+	++SB_emuSnvStats.reads;
+
+	if (0 == SNV.len[id]) {
+		return NV_OPER_FAILED;
+	}
+
+	memcpy(pBuf, SNV.data[id], len);
+	return SUCCESS;
+}
+
+uint8 osal_snv_write(osalSnvId_t id, osalSnvLen_t len, void *pBuf) {
+	if (SB_emuSnvStats.pageUsed + SB_EMU_SNV_SIZE(len) > SB_EMU_SNV_PAGE_SIZE) {
+		emuSnvCompact();
+	}
+
+	SNV.len[id] = len;
+	memcpy(SNV.data[id], pBuf, len);
+
+	SB_emuSnvStats.pageUsed += SB_EMU_SNV_SIZE(len);
+	SB_emuSnvStats.programmedBytes += SB_EMU_SNV_SIZE(len);
+	++SB_emuSnvStats.programs;
+	return SUCCESS;
+}
+
+uint8 osal_snv_compact(uint8 threshold) {
+	if (threshold > 100) {
+		return INVALIDPARAMETER;
+	}
+
+	if (SB_emuSnvStats.pageUsed >= (uint32)SB_EMU_SNV_PAGE_SIZE * threshold / 100) {
+		emuSnvCompact();
+	}
+
+	return SUCCESS;
+}
@@ -0,0 +1,398 @@
+/*
+ * energyReplay.c
+ *
+ * Decodes the Energy Stats characteristic and splits the charge the gas gauge measured in each
+ * hour between the states and loads, in proportion to what a current model says each of them
+ * drew over the time recorded.
+ *
+ * With -f, the characteristic value is read from a file of hex bytes as copied from a BLE client.
+ * Otherwise some hours of the sensing loop are replayed on the emulator, against a battery that
+ * draws what the model says plus a leak the model doesn't know about, and the characteristic is
+ * read over the emulated link. -o saves what was read in the format -f takes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bcomdef.h"
+
+#include "ble.h"
+#include "clock.h"
+#include "energy.h"
+#include "flash.h"
+#include "fsm.h"
+#include "readingsManager.h"
+#include "smartBandageProfile.h"
+
+#include "emulator.h"
+#include "hexFile.h"
+
+#define MS(ms)                    (NTICKS_PER_MILLSECOND * (ms))
+
+#define BENCH_DEFAULT_HOURS       3
+#define BENCH_INTERVAL_MS         1000
+#define BENCH_BLE_INTERVAL        10
+#define BENCH_INIT_MS             20      // initPeripherals()
+#define BENCH_ADC_MS              100     // SB_beginReadBandageImpedances() settling and conversions
+#define BENCH_READ_MS             30      // The I2C sensors
+#define BENCH_ADVERTISE_MS        500     // S_TRANSMIT until the central connects
+#define BENCH_CONNECTED_MS        1500
+#define BENCH_MIGRATE_READINGS    128     // Readings moved to the archive at a time
+#define BENCH_LEAK_UA             4.0     // Drawn by the battery and not by anything the model knows about
+#define BENCH_START_SOC           (80 * 512)
+#define BENCH_CONN                0
+
+#define SOC_LSB_UAH               (GASGAUGE_BATT_CAPACITY * 1000.0 / (100 * 512))
+
+static const char *stateNames[SB_NUM_STATES] = {
+	[S_SLEEP] = "sleep", [S_CHECK] = "check", [S_TRANSMIT] = "transmit",
+	[S_ERROR_TEMP] = "error_temp", [S_ERROR_PERM] = "error_perm", [S_INIT] = "init",
+};
+
+static const char *loadNames[SB_NUM_LOADS] = {
+	[SB_LOAD_PERIPHERALS] = "peripherals", [SB_LOAD_PWRMUX] = "pwrmux",
+	[SB_LOAD_ADC] = "adc", [SB_LOAD_RADIO] = "radio",
+};
+
+/*
+ * Current model, from the data sheets
+ */
+
+// Drawn in each state with every load off, uA. Outside of S_SLEEP the CPU is mostly running.
+static const double stateUA[SB_NUM_STATES] = {
+	[S_SLEEP] = 2.5, [S_CHECK] = 1400, [S_TRANSMIT] = 1400,
+	[S_ERROR_TEMP] = 1400, [S_ERROR_PERM] = 1400, [S_INIT] = 1400,
+};
+
+// Drawn by each load on top of that, uA
+static const double loadUA[SB_NUM_LOADS] = {
+	[SB_LOAD_PERIPHERALS] = 450, [SB_LOAD_PWRMUX] = 60,
+	[SB_LOAD_ADC] = 950, [SB_LOAD_RADIO] = 6100,
+};
+
+// Charge of each flash operation, uAs
+static const double flashUAs[SB_NUM_FLASH_OPS] = {
+	[SB_FLASH_OP_PROGRAM] = 0.3, [SB_FLASH_OP_ERASE] = 170,
+	[SB_FLASH_OP_EXT_PROGRAM] = 12, [SB_FLASH_OP_EXT_ERASE] = 650,
+};
+
+/*
+ * The replayed device: what it is doing, and the charge its battery has given
+ */
+static struct {
+	uint8_t loads;
+	double drawnUAs;
+	uint32_t readings;
+} device;
+
+static double modelUA() {
+	double ua = stateUA[SB_currentState()];
+	uint8_t i;
+
+	for (i = 0; i < SB_NUM_LOADS; ++i) {
+		if (device.loads & (1 << i)) {
+			ua += loadUA[i];
+		}
+	}
+
+	return ua;
+}
+
+static void step(uint32 ms) {
+	device.drawnUAs += (modelUA() + BENCH_LEAK_UA) * ms / 1000.0;
+	SB_emuAdvanceTicks(MS(ms));
+}
+
+static void setLoad(SB_EnergyLoad load, bool on) {
+	device.loads = on ? device.loads | (1 << load) : device.loads & ~(1 << load);
+	SB_energySetLoad(load, on);
+}
+
+static void flashOp(SB_EnergyFlashOp op) {
+	device.drawnUAs += flashUAs[op];
+	SB_energyCountFlashOp(op);
+}
+
+static void gaugeSample() {
+	uint16_t soc = BENCH_START_SOC - (uint16_t)(device.drawnUAs / 3600 / SOC_LSB_UAH);
+
+	// A single cell, roughly linear over the range replayed, 16x mV
+	SB_energyGaugeSample(soc, (uint16_t)(16 * (3300 + 900.0 * soc / (100 * 512))));
+}
+
+/*
+ * The sensing loop of peripheralManager.c, as far as power goes
+ */
+static void runCheck() {
+	setLoad(SB_LOAD_PERIPHERALS, true);
+	step(BENCH_INIT_MS);
+
+	setLoad(SB_LOAD_PWRMUX, true);
+	setLoad(SB_LOAD_ADC, true);
+	step(BENCH_ADC_MS);
+	setLoad(SB_LOAD_ADC, false);
+	setLoad(SB_LOAD_PWRMUX, false);
+
+	step(BENCH_READ_MS);
+	gaugeSample();
+
+	flashOp(SB_FLASH_OP_PROGRAM);
+	if (0 == ++device.readings % BENCH_MIGRATE_READINGS) {
+		flashOp(SB_FLASH_OP_EXT_ERASE);
+		flashOp(SB_FLASH_OP_EXT_PROGRAM);
+		flashOp(SB_FLASH_OP_ERASE);
+	}
+
+	setLoad(SB_LOAD_PERIPHERALS, false);
+}
+
+static void runTransmit() {
+	// The radio load follows the GAP role state through ble.c
+	SB_enableBLE();
+	SB_emuRunApp();
+	device.loads |= 1 << SB_LOAD_RADIO;
+	step(BENCH_ADVERTISE_MS);
+
+	SB_emuConnect(BENCH_CONN, ATT_MTU_SIZE);
+	SB_emuRunApp();
+	step(BENCH_CONNECTED_MS);
+
+	SB_disableBLE();
+	SB_emuRunApp();
+	device.loads &= ~(1 << SB_LOAD_RADIO);
+}
+
+static bool replay(uint32 hours, uint8 *value, uint16 *len) {
+	uint64_t end;
+	uint8 nChecks = 0;
+
+	SB_emuInit(1, DEFAULT_DESIRED_MIN_CONN_INTERVAL, 4);
+	SB_clockInit();
+
+	if (NoError != SB_flashInit(sizeof(SB_PeripheralReadings), true)) {
+		return false;
+	}
+
+	SimpleBLEPeripheral_init();
+
+	if (NoError != SB_readingsManagerInit() || NoError != SB_energyInit()) {
+		return false;
+	}
+
+	SB_emuRunApp();
+	SB_handleEvent(E_CYCLE_COMPLETE);
+	gaugeSample();
+
+	end = SB_emuTicks() + (uint64_t)hours * 3600 * NTICKS_PER_SECOND + MS(BENCH_INTERVAL_MS / 2);
+	while (SB_emuTicks() < end) {
+		step(BENCH_INTERVAL_MS);
+
+		if (++nChecks < BENCH_BLE_INTERVAL) {
+			SB_handleEvent(E_CHECK_TIMER_EXPIRED);
+			runCheck();
+		} else {
+			SB_handleEvent(E_BLE_TIMER_EXPIRED);
+			runTransmit();
+			nChecks = 0;
+		}
+
+		SB_handleEvent(E_CYCLE_COMPLETE);
+	}
+
+	// A phone reads the characteristic
+	SB_emuConnect(BENCH_CONN, ATT_MTU_SIZE);
+	SB_emuRunApp();
+
+	if (SUCCESS != SB_emuReadLong(BENCH_CONN, SB_emuFindHandle(SB_BLE_ENERGYSTATS_UUID, 0), value, SB_EMU_MAX_ATT_VALUE, len)) {
+		return false;
+	}
+
+	SB_emuDisconnect(BENCH_CONN);
+	SB_emuRunApp();
+
+	return true;
+}
+
+/*
+ * The model's charge for each state and load of an hour, uAh. Flash operations go in the last entry.
+ */
+static double modelCharge(const SB_EnergyHour *hour, double charge[SB_NUM_STATES + SB_NUM_LOADS + 1]) {
+	double total = 0;
+	uint8_t i;
+
+	for (i = 0; i < SB_NUM_STATES; ++i) {
+		charge[i] = stateUA[i] * hour->stateMs[i] / 3600000.0;
+	}
+
+	for (i = 0; i < SB_NUM_LOADS; ++i) {
+		charge[SB_NUM_STATES + i] = loadUA[i] * hour->loadMs[i] / 3600000.0;
+	}
+
+	charge[SB_NUM_STATES + SB_NUM_LOADS] = 0;
+	for (i = 0; i < SB_NUM_FLASH_OPS; ++i) {
+		charge[SB_NUM_STATES + SB_NUM_LOADS] += flashUAs[i] * hour->flashOps[i] / 3600;
+	}
+
+	for (i = 0; i < SB_NUM_STATES + SB_NUM_LOADS + 1; ++i) {
+		total += charge[i];
+	}
+
+	return total;
+}
+
+static void printHours(const SB_EnergyHour *hours, uint8 numHours) {
+	double charge[SB_NUM_STATES + SB_NUM_LOADS + 1], model, scale;
+	const SB_EnergyHour *hour;
+	char flash[4 * sizeof("65535")];	// Four saturated counters, with separators
+	int8 h;
+	uint8 i;
+
+	printf("%-6s %8s %8s %8s %8s %8s %8s %8s %15s %9s %9s %8s\n", "hour", "sleep_s", "check_s", "xmit_s",
+		"periph_s", "mux_s", "adc_s", "radio_s", "flash p/e/xp/xe", "gauge_uAh", "model_uAh", "batt_mV");
+
+	// Oldest first
+	for (h = numHours - 1; h >= 0; --h) {
+		hour = &hours[h];
+		model = modelCharge(hour, charge);
+
+		snprintf(flash, sizeof(flash), "%u/%u/%u/%u", hour->flashOps[SB_FLASH_OP_PROGRAM], hour->flashOps[SB_FLASH_OP_ERASE],
+			hour->flashOps[SB_FLASH_OP_EXT_PROGRAM], hour->flashOps[SB_FLASH_OP_EXT_ERASE]);
+
+		printf("%-5u%c %8.1f %8.1f %8.1f %8.1f %8.1f %8.1f %8.1f %15s %9d %9.1f %8.1f\n",
+			hour->hour, 0 == h ? '*' : ' ',
+			hour->stateMs[S_SLEEP] / 1000.0, hour->stateMs[S_CHECK] / 1000.0, hour->stateMs[S_TRANSMIT] / 1000.0,
+			hour->loadMs[SB_LOAD_PERIPHERALS] / 1000.0, hour->loadMs[SB_LOAD_PWRMUX] / 1000.0,
+			hour->loadMs[SB_LOAD_ADC] / 1000.0, hour->loadMs[SB_LOAD_RADIO] / 1000.0, flash, hour->gaugeUAh, model, hour->voltage / 16.0);
+	}
+
+	printf("* still being filled in\n");
+
+	// The measured charge of the newest complete hour, split the way the model splits it
+	if (numHours < 2) {
+		return;
+	}
+
+	hour = &hours[1];
+	model = modelCharge(hour, charge);
+	scale = model > 0 && hour->gaugeUAh > 0 ? hour->gaugeUAh / model : 1;
+
+	printf("\nhour %u: %d uAh measured, %.1f uAh modelled\n", hour->hour, hour->gaugeUAh, model);
+	printf("%-12s %10s %8s\n", "", "uAh", "share");
+
+	for (i = 0; i < SB_NUM_STATES + SB_NUM_LOADS + 1; ++i) {
+		if (charge[i] <= 0) {
+			continue;
+		}
+
+		printf("%-12s %10.1f %7.1f%%\n",
+			i < SB_NUM_STATES ? stateNames[i] : i < SB_NUM_STATES + SB_NUM_LOADS ? loadNames[i - SB_NUM_STATES] : "flash",
+			charge[i] * scale, 100 * charge[i] / model);
+	}
+}
+
+static void usage(const char *name) {
+	fprintf(stderr, "Usage: %s [-H hours] [-o dump_file]\n"
+	                "       %s -f dump_file\n", name, name);
+}
+
+int main(int argc, char **argv) {
+	uint8 value[SB_EMU_MAX_ATT_VALUE];
+	SB_EnergyHour hours[SB_ENERGY_NUM_HOURS], direct[SB_ENERGY_NUM_HOURS];
+	const char *inPath = NULL, *outPath = NULL;
+	double charge[SB_NUM_STATES + SB_NUM_LOADS + 1], expected, tolerance;
+	uint32 numHours = BENCH_DEFAULT_HOURS, totalMs;
+	uint16 len = 0;
+	uint8 n, h, i;
+	int opt, failures = 0;
+
+	while (-1 != (opt = getopt(argc, argv, "H:f:o:h"))) {
+		switch (opt) {
+		case 'H':
+			numHours = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'f':
+			inPath = optarg;
+			break;
+
+		case 'o':
+			outPath = optarg;
+			break;
+
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	if (0 == numHours || numHours > 24 * 7) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	memset(value, 0, sizeof(value));
+
+	if (NULL != inPath) {
+		if (!SB_readHexFile(inPath, value, sizeof(value), &len)) {
+			return 2;
+		}
+	} else if (!replay(numHours, value, &len)) {
+		printf("FAILED: replay could not run\n");
+		return 1;
+	}
+
+	if (0 == len || len > sizeof(hours) || 0 != len % sizeof(SB_EnergyHour)) {
+		printf("FAILED: %u bytes is not a whole number of %u byte hours\n", len, (unsigned)sizeof(SB_EnergyHour));
+		return 1;
+	}
+
+	// Hours not reached yet read as zeros. Only the newest can be hour 0.
+	memcpy(hours, value, len);
+	for (n = 1; n < len / sizeof(SB_EnergyHour) && hours[n].hour + n == hours[0].hour; ++n);
+
+	if (NULL != outPath && !SB_writeHexFile(outPath, value, len)) {
+		return 2;
+	}
+
+	printHours(hours, n);
+
+	if (NULL != inPath) {
+		return 0;
+	}
+
+	// What was read over the air must be what the device holds
+	if (n != SB_energyGetHours(direct, SB_ENERGY_NUM_HOURS) || 0 != memcmp(hours + 1, direct + 1, (n - 1) * sizeof(SB_EnergyHour))) {
+		printf("FAILED: characteristic doesn't match the accounting\n");
+		++failures;
+	}
+
+	if (n != (numHours + 1 < SB_ENERGY_NUM_HOURS ? numHours + 1 : SB_ENERGY_NUM_HOURS)) {
+		printf("FAILED: %u hours kept after %u\n", n, numHours);
+		++failures;
+	}
+
+	for (h = 1; h < n; ++h) {
+		for (i = 0, totalMs = 0; i < SB_NUM_STATES; ++i) {
+			totalMs += hours[h].stateMs[i];
+		}
+
+		// Each state loses less than a millisecond to rounding
+		if (totalMs > 3600000 || totalMs + SB_NUM_STATES < 3600000) {
+			printf("FAILED: hour %u accounts for %u ms\n", hours[h].hour, totalMs);
+			++failures;
+		}
+
+		// The battery drew what the model says plus the leak. The gauge counts whole steps and the
+		// hour it reports ends at the last reading in it, a cycle or so from the end of the hour.
+		expected = modelCharge(&hours[h], charge) + BENCH_LEAK_UA;
+		tolerance = 2 * SOC_LSB_UAH + (stateUA[S_TRANSMIT] + loadUA[SB_LOAD_RADIO]) * 3 / 3600.0;
+		if (hours[h].gaugeUAh < expected - tolerance || hours[h].gaugeUAh > expected + tolerance) {
+			printf("FAILED: hour %u gauge %d uAh, battery drew %.1f uAh\n", hours[h].hour, hours[h].gaugeUAh, expected);
+			++failures;
+		}
+	}
+
+	return failures ? 1 : 0;
+}
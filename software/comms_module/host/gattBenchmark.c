@@ -0,0 +1,297 @@
+/*
+ * gattBenchmark.c
+ *
+ * Times the GATT server's per-request lookups on the attributes the firmware registers: the UUID
+ * record of each attribute type, with the grouped tables of PROFILES/gatt_uuid.c against the
+ * switch it used to have, and each client's characteristic configuration, with the entry at the
+ * connection handle of gattservapp_util.c against the scan of the whole table it used to do.
+ *
+ * Clients subscribe to every characteristic configuration in reverse order of their connection
+ * handles, as happens when the last to connect is the first to subscribe, so the scan finds the
+ * first client last. Both lookups must give the same records and configuration values.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bcomdef.h"
+#include "gatt_uuid.h"
+#include "gattservapp.h"
+#include "linkdb.h"
+
+#include "devinfoservice.h"
+#include "oad.h"
+#include "smartBandageProfile.h"
+
+#include "emulator.h"
+
+#define BENCH_DEFAULT_ROUNDS      20000
+#define BENCH_MAX_ATTRS           256
+#define BENCH_MAX_CCCS            16
+#define BENCH_INTERVAL_MS         100
+#define BENCH_PDUS_PER_EVENT      4
+
+typedef struct {
+	gattAttribute_t *attrs[BENCH_MAX_ATTRS];
+	uint16 numAttrs;
+	gattCharCfg_t *cccs[BENCH_MAX_CCCS];
+	gattCharCfg_t oldCccs[BENCH_MAX_CCCS][SB_EMU_MAX_CONNS];
+	uint8 numCccs;
+} BenchServer;
+
+static BenchServer server;
+static volatile uintptr_t sink;
+
+/*********************************************************************
+ * GATT_FindUUIDRec() as it was, for 16-bit UUIDs. The old lookups are kept out of line, as the
+ * new ones are in their own files.
+ */
+static __attribute__((noinline)) const uint8 *switchFindUUIDRec(const uint8 *pUUID, uint8 len) {
+	const uint8 *pRec = NULL;
+
+	if (len == ATT_BT_UUID_SIZE) {
+		switch (BUILD_UINT16(pUUID[0], pUUID[1])) {
+		case GAP_SERVICE_UUID:           pRec = gapServiceUUID; break;
+		case GATT_SERVICE_UUID:          pRec = gattServiceUUID; break;
+		case GATT_PRIMARY_SERVICE_UUID:  pRec = primaryServiceUUID; break;
+		case GATT_SECONDARY_SERVICE_UUID: pRec = secondaryServiceUUID; break;
+		case GATT_INCLUDE_UUID:          pRec = includeUUID; break;
+		case GATT_CHARACTER_UUID:        pRec = characterUUID; break;
+		case GATT_CHAR_EXT_PROPS_UUID:   pRec = charExtPropsUUID; break;
+		case GATT_CHAR_USER_DESC_UUID:   pRec = charUserDescUUID; break;
+		case GATT_CLIENT_CHAR_CFG_UUID:  pRec = clientCharCfgUUID; break;
+		case GATT_SERV_CHAR_CFG_UUID:    pRec = servCharCfgUUID; break;
+		case GATT_CHAR_FORMAT_UUID:      pRec = charFormatUUID; break;
+		case GATT_CHAR_AGG_FORMAT_UUID:  pRec = charAggFormatUUID; break;
+		case GATT_VALID_RANGE_UUID:      pRec = validRangeUUID; break;
+		case GATT_EXT_REPORT_REF_UUID:   pRec = extReportRefUUID; break;
+		case GATT_REPORT_REF_UUID:       pRec = reportRefUUID; break;
+		case DEVICE_NAME_UUID:           pRec = deviceNameUUID; break;
+		case APPEARANCE_UUID:            pRec = appearanceUUID; break;
+		case RECONNECT_ADDR_UUID:        pRec = reconnectAddrUUID; break;
+		case PERI_PRIVACY_FLAG_UUID:     pRec = periPrivacyFlagUUID; break;
+		case PERI_CONN_PARAM_UUID:       pRec = periConnParamUUID; break;
+		case SERVICE_CHANGED_UUID:       pRec = serviceChangedUUID; break;
+		default:                         break;
+		}
+	}
+
+	return pRec;
+}
+
+/*********************************************************************
+ * GATTServApp_ReadCharCfg() and GATTServApp_WriteCharCfg() as they were: the table is scanned
+ */
+static gattCharCfg_t *scanFindCharCfgItem(uint16 connHandle, gattCharCfg_t *charCfgTbl) {
+	uint8 i;
+
+	for (i = 0; i < linkDBNumConns; ++i) {
+		if (charCfgTbl[i].connHandle == connHandle) {
+			return &charCfgTbl[i];
+		}
+	}
+
+	return NULL;
+}
+
+static __attribute__((noinline)) uint16 scanReadCharCfg(uint16 connHandle, gattCharCfg_t *charCfgTbl) {
+	gattCharCfg_t *pItem = scanFindCharCfgItem(connHandle, charCfgTbl);
+
+	return pItem ? pItem->value : GATT_CFG_NO_OPERATION;
+}
+
+static uint8 scanWriteCharCfg(uint16 connHandle, gattCharCfg_t *charCfgTbl, uint16 value) {
+	gattCharCfg_t *pItem = scanFindCharCfgItem(connHandle, charCfgTbl);
+
+	if (NULL == pItem) {
+		if (NULL == (pItem = scanFindCharCfgItem(INVALID_CONNHANDLE, charCfgTbl))) {
+			return ATT_ERR_INSUFFICIENT_RESOURCES;
+		}
+
+		pItem->connHandle = connHandle;
+	}
+
+	pItem->value = value;
+	return SUCCESS;
+}
+
+/*********************************************************************
+ * The run
+ */
+static double nowNs() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*
+ * Registers the firmware's services for numConns clients, and subscribes every client to every
+ * characteristic configuration, in both the live tables and copies of them for the scan.
+ */
+static bStatus_t setup(uint8 numConns) {
+	uint16 handle;
+	gattAttribute_t *attr;
+	uint8 c, i;
+	int conn;
+
+	SB_emuInit(numConns, BENCH_INTERVAL_MS, BENCH_PDUS_PER_EVENT);
+
+	if (SUCCESS != SB_Profile_AddService(GATT_ALL_SERVICES) || SUCCESS != DevInfo_AddService()
+			|| SUCCESS != OAD_addService()) {
+		return FAILURE;
+	}
+
+	memset(&server, 0, sizeof(server));
+
+	for (handle = 1; NULL != (attr = SB_emuFindAttr(handle)) && server.numAttrs < BENCH_MAX_ATTRS; ++handle) {
+		server.attrs[server.numAttrs++] = attr;
+
+		if (ATT_BT_UUID_SIZE == attr->type.len
+				&& GATT_CLIENT_CHAR_CFG_UUID == BUILD_UINT16(attr->type.uuid[0], attr->type.uuid[1])
+				&& server.numCccs < BENCH_MAX_CCCS) {
+			server.cccs[server.numCccs++] = GATT_CCC_TBL(attr->pValue);
+		}
+	}
+
+	for (c = 0; c < server.numCccs; ++c) {
+		GATTServApp_InitCharCfg(INVALID_CONNHANDLE, server.cccs[c]);
+		memcpy(server.oldCccs[c], server.cccs[c], numConns * sizeof(gattCharCfg_t));
+
+		for (conn = numConns - 1; conn >= 0; --conn) {
+			i = (c + conn) % 3;
+			if (SUCCESS != GATTServApp_WriteCharCfg(conn, server.cccs[c], i)
+					|| SUCCESS != scanWriteCharCfg(conn, server.oldCccs[c], i)) {
+				return FAILURE;
+			}
+		}
+	}
+
+	return SUCCESS;
+}
+
+/*
+ * Looks up every attribute's UUID record rounds times, returning the time taken in ns. Counts
+ * the records that differ from the switch's.
+ */
+static double findUUIDRecs(const uint8 *(*find)(const uint8 *, uint8), uint32 rounds, uint32 *mismatches) {
+	double start = nowNs();
+	uintptr_t acc = 0;
+	uint32 r;
+	uint16 a;
+
+	for (r = 0; r < rounds; ++r) {
+		for (a = 0; a < server.numAttrs; ++a) {
+			acc += (uintptr_t)find(server.attrs[a]->type.uuid, server.attrs[a]->type.len);
+		}
+	}
+
+	sink = acc;
+	start = nowNs() - start;
+
+	for (a = 0; a < server.numAttrs; ++a) {
+		*mismatches += find(server.attrs[a]->type.uuid, server.attrs[a]->type.len)
+				!= switchFindUUIDRec(server.attrs[a]->type.uuid, server.attrs[a]->type.len);
+	}
+
+	return start;
+}
+
+/*
+ * Reads every client's configuration of every characteristic rounds times, as a notification
+ * to all of them does, returning the time taken in ns. Counts the values that differ from the
+ * scan's.
+ */
+static double readCharCfgs(bool scan, uint32 rounds, uint32 *mismatches) {
+	double start = nowNs();
+	uint32 r, acc = 0;
+	uint8 c, conn;
+
+	for (r = 0; r < rounds; ++r) {
+		for (c = 0; c < server.numCccs; ++c) {
+			for (conn = 0; conn < linkDBNumConns; ++conn) {
+				acc += scan ? scanReadCharCfg(conn, server.oldCccs[c]) : GATTServApp_ReadCharCfg(conn, server.cccs[c]);
+			}
+		}
+	}
+
+	sink = acc;
+	start = nowNs() - start;
+
+	for (c = 0; c < server.numCccs; ++c) {
+		for (conn = 0; conn < linkDBNumConns; ++conn) {
+			*mismatches += GATTServApp_ReadCharCfg(conn, server.cccs[c]) != scanReadCharCfg(conn, server.oldCccs[c]);
+		}
+	}
+
+	return start;
+}
+
+static void usage(const char *name) {
+	fprintf(stderr, "Usage: %s [-n clients (at most %u)] [-r rounds]\n", name, SB_EMU_MAX_CONNS);
+}
+
+int main(int argc, char **argv) {
+	static const uint8 defaultConns[] = { 1, 2, SB_EMU_MAX_CONNS };
+	uint32 rounds = BENCH_DEFAULT_ROUNDS, conns = 0, mismatches;
+	double uuidNs[2], cccNs[2];
+	uint8 n, k, runs;
+	int opt, failures = 0;
+
+	while (-1 != (opt = getopt(argc, argv, "n:r:h"))) {
+		switch (opt) {
+		case 'n':
+			conns = strtoul(optarg, NULL, 0);
+			if (0 == conns || conns > SB_EMU_MAX_CONNS) {
+				usage(argv[0]);
+				return 2;
+			}
+			break;
+
+		case 'r':
+			rounds = strtoul(optarg, NULL, 0);
+			if (0 == rounds) {
+				usage(argv[0]);
+				return 2;
+			}
+			break;
+
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	runs = conns ? 1 : sizeof(defaultConns);
+
+	printf("%-7s %5s %4s %12s %12s %12s %12s\n", "clients", "attrs", "cccs", "switch_ns", "table_ns",
+			"scan_ccc_ns", "slot_ccc_ns");
+
+	for (k = 0; k < runs; ++k) {
+		n = conns ? conns : defaultConns[k];
+		mismatches = 0;
+
+		if (SUCCESS != setup(n)) {
+			printf("%-7u  could not register the services  FAILED\n", n);
+			++failures;
+			continue;
+		}
+
+		uuidNs[0] = findUUIDRecs(switchFindUUIDRec, rounds, &mismatches);
+		uuidNs[1] = findUUIDRecs(GATT_FindUUIDRec, rounds, &mismatches);
+		cccNs[0] = readCharCfgs(TRUE, rounds, &mismatches);
+		cccNs[1] = readCharCfgs(FALSE, rounds, &mismatches);
+
+		printf("%-7u %5u %4u %12.2f %12.2f %12.2f %12.2f%s\n", n, server.numAttrs, server.numCccs,
+			uuidNs[0] / rounds / server.numAttrs, uuidNs[1] / rounds / server.numAttrs,
+			cccNs[0] / rounds / server.numCccs / n, cccNs[1] / rounds / server.numCccs / n,
+			mismatches ? "  FAILED" : "");
+
+		failures += mismatches > 0;
+	}
+
+	return failures ? 1 : 0;
+}
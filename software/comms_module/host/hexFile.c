@@ -0,0 +1,81 @@
+/*
+ * hexFile.c
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "hexFile.h"
+
+/*
+ * Reads hex bytes, in any grouping, with or without 0x
+ */
+bool SB_readHexFile(const char *path, uint8 *value, uint16 maxLen, uint16 *len) {
+	FILE *file = strcmp(path, "-") ? fopen(path, "r") : stdin;
+	int c, next, nibbles = 0;
+	uint8 byte = 0;
+
+	if (NULL == file) {
+		perror(path);
+		return false;
+	}
+
+	*len = 0;
+	while (EOF != (c = fgetc(file))) {
+		if ('0' == c && 0 == nibbles) {
+			next = fgetc(file);
+			if ('x' == next || 'X' == next) {
+				continue;
+			}
+			ungetc(next, file);
+		}
+
+		if (!isxdigit(c)) {
+			if (0 != nibbles) {
+				break;
+			}
+			continue;
+		}
+
+		byte = (byte << 4) | (isdigit(c) ? c - '0' : tolower(c) - 'a' + 10);
+		if (2 == ++nibbles) {
+			if (*len == maxLen) {
+				break;
+			}
+
+			value[(*len)++] = byte;
+			nibbles = 0;
+			byte = 0;
+		}
+	}
+
+	if (stdin != file) {
+		fclose(file);
+	}
+
+	if (0 != nibbles) {
+		fprintf(stderr, "%s: odd number of hex digits\n", path);
+		return false;
+	}
+
+	return true;
+}
+
+bool SB_writeHexFile(const char *path, const uint8 *value, uint16 len) {
+	FILE *file = fopen(path, "w");
+	uint16 i;
+
+	if (NULL == file) {
+		perror(path);
+		return false;
+	}
+
+	for (i = 0; i < len; ++i) {
+		fprintf(file, "%02x%c", value[i], 15 == i % 16 || i + 1 == len ? '\n' : ' ');
+	}
+
+	fclose(file);
+
+	return true;
+}
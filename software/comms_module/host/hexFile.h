@@ -0,0 +1,19 @@
+/*
+ * hexFile.h
+ *
+ * Characteristic values saved as text, as copied from a BLE client: hex bytes in any grouping,
+ * with or without 0x. Shared by the host tools that decode a characteristic read off a device.
+ */
+
+#ifndef HOST_HEXFILE_H
+#define HOST_HEXFILE_H
+
+#include "bcomdef.h"
+
+// Reads up to maxLen bytes. A path of - reads stdin.
+bool SB_readHexFile(const char *path, uint8 *value, uint16 maxLen, uint16 *len);
+
+// Writes sixteen bytes to a line
+bool SB_writeHexFile(const char *path, const uint8 *value, uint16 len);
+
+#endif /* HOST_HEXFILE_H */
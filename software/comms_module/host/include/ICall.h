@@ -0,0 +1,292 @@
+/*
+ * ICall.h
+ *
+ * Host replacement for the ICall dispatcher interface. Messages are delivered to the single
+ * registered application entity by the emulated stack (see emulator/emuStack.c).
+ *
+ * The primitive service's arguments are also declared, as far as SmartBandage/ICall/ICall.c
+ * uses them, so that ICall.c itself can be built (see matchBenchmark.c).
+ */
+
+#ifndef HOST_ICALL_H
+#define HOST_ICALL_H
+
+#include "bcomdef.h"
+#include <ti/sysbios/knl/Semaphore.h>
+
+typedef uint8_t ICall_EntityID;
+typedef uint_least16_t ICall_ServiceEnum;
+typedef int_fast8_t ICall_Errno;
+typedef Semaphore_Handle ICall_Semaphore;
+typedef uint8_t ICall_MSGFormat;
+
+#define ICALL_ERRNO_SUCCESS      0
+#define ICALL_ERRNO_TIMEOUT      3
+#define ICALL_ERRNO_NOMSG        4
+#define ICALL_ERRNO_INVALID_SERVICE    -1
+#define ICALL_ERRNO_INVALID_FUNCTION   -2
+#define ICALL_ERRNO_INVALID_PARAMETER  -3
+#define ICALL_ERRNO_NO_RESOURCE        -4
+#define ICALL_ERRNO_UNKNOWN_THREAD     -5
+#define ICALL_ERRNO_CORRUPT_MSG        -6
+
+#define ICALL_SERVICE_CLASS_PRIMITIVE  0x0008
+#define ICALL_SERVICE_CLASS_BLE        0x0018
+#define ICALL_SERVICE_CLASS_MASK       0xFFF8
+#define ICALL_INVALID_ENTITY_ID  0xFF
+#define ICALL_UNDEF_DEST_ID      0xFF
+#define ICALL_TIMEOUT_FOREVER    0xFFFFFFFF
+
+typedef struct {
+	uint8 event;
+	uint8 status;
+} ICall_Hdr;
+
+typedef struct {
+	uint16 signature;
+	uint16 event_flag;
+} ICall_Event;
+
+typedef struct {
+	ICall_Hdr hdr;
+} ICall_HciExtEvt;
+
+// Only named by the stack's OSAL.h and ICall.c
+typedef struct {
+	uint16 len;
+	void *next;
+	uint8 dest_id;
+	ICall_EntityID srcentity;
+	ICall_EntityID dstentity;
+	ICall_MSGFormat format;
+} ICall_MsgHdr;
+
+typedef struct {
+	ICall_ServiceEnum service;
+	uint8 func;
+} ICall_FuncArgsHdr;
+
+extern ICall_Errno ICall_registerApp(ICall_EntityID *entity, ICall_Semaphore *msgsem);
+extern ICall_Errno ICall_fetchServiceMsg(ICall_ServiceEnum *src, ICall_EntityID *dest, void **msg);
+extern ICall_Errno ICall_wait(uint_fast32_t milliseconds);
+extern ICall_EntityID ICall_getEntityId(void);
+extern void *ICall_malloc(uint_least16_t size);
+extern void ICall_free(void *msg);
+extern void *ICall_allocMsg(size_t size);
+extern void ICall_freeMsg(void *msg);
+
+/*********************************************************************
+ * The dispatcher and its primitive service
+ */
+typedef uint_least32_t ICall_CSState;
+typedef ICall_CSState (*ICall_EnterCS)(void);
+typedef void (*ICall_LeaveCS)(ICall_CSState key);
+typedef ICall_Errno (*ICall_Dispatcher)(ICall_FuncArgsHdr *args);
+typedef ICall_Dispatcher ICall_ServiceFunc;
+typedef bool (*ICall_MsgMatchFn)(ICall_ServiceEnum src, ICall_EntityID dest, const void *msg);
+typedef void (*ICall_TimerCback)(void *arg);
+typedef void *ICall_TimerID;
+
+typedef struct {
+	ICall_Dispatcher dispatch;
+	ICall_EnterCS entercs;
+	ICall_LeaveCS leavecs;
+} ICall_RemoteTaskArg;
+
+typedef void (*ICall_RemoteTaskEntry)(const ICall_RemoteTaskArg *fptr, void *arg);
+
+#define ICALL_INVALID_TIMER_ID       NULL
+#define ICALL_SEMAPHORE_MODE_BINARY  1
+#define ICALL_HOOK_ABORT_FUNC()      ICall_abort()
+
+// The primitive service's functions, in the order of ICall.c's ICall_primSvcFuncs[]
+enum {
+	ICALL_PRIMITIVE_FUNC_ENROLL,
+	ICALL_PRIMITIVE_FUNC_REGISTER_APP,
+	ICALL_PRIMITIVE_FUNC_MSG_ALLOC,
+	ICALL_PRIMITIVE_FUNC_MSG_FREE,
+	ICALL_PRIMITIVE_FUNC_MALLOC,
+	ICALL_PRIMITIVE_FUNC_FREE,
+	ICALL_PRIMITIVE_FUNC_SEND_MSG,
+	ICALL_PRIMITIVE_FUNC_FETCH_MSG,
+	ICALL_PRIMITIVE_FUNC_SEND_SERV_MSG,
+	ICALL_PRIMITIVE_FUNC_FETCH_SERV_MSG,
+	ICALL_PRIMITIVE_FUNC_WAIT,
+	ICALL_PRIMITIVE_FUNC_SIGNAL,
+	ICALL_PRIMITIVE_FUNC_ABORT,
+	ICALL_PRIMITIVE_FUNC_ENABLE_INT,
+	ICALL_PRIMITIVE_FUNC_DISABLE_INT,
+	ICALL_PRIMITIVE_FUNC_ENABLE_MINT,
+	ICALL_PRIMITIVE_FUNC_DISABLE_MINT,
+	ICALL_PRIMITIVE_FUNC_REGISTER_ISR,
+	ICALL_PRIMITIVE_FUNC_GET_TICKS,
+	ICALL_PRIMITIVE_FUNC_SET_TIMER_MSECS,
+	ICALL_PRIMITIVE_FUNC_GET_TICK_PERIOD,
+	ICALL_PRIMITIVE_FUNC_GET_MAX_MILLISECONDS,
+	ICALL_PRIMITIVE_FUNC_ENTITY2SERVICE,
+	ICALL_PRIMITIVE_FUNC_PWR_UPD_ACTIVITY_COUNTER,
+	ICALL_PRIMITIVE_FUNC_PWR_REGISTER_NOTIFY,
+	ICALL_PRIMITIVE_FUNC_WAIT_MATCH,
+	ICALL_PRIMITIVE_FUNC_GET_ENTITY_ID,
+	ICALL_PRIMITIVE_FUNC_SET_TIMER,
+	ICALL_PRIMITIVE_FUNC_STOP_TIMER,
+	ICALL_PRIMITIVE_FUNC_PWR_CONFIG_AC_ACTION,
+	ICALL_PRIMITIVE_FUNC_PWR_REQUIRE,
+	ICALL_PRIMITIVE_FUNC_PWR_DISPENSE,
+	ICALL_PRIMITIVE_FUNC_THREAD_SERVES,
+	ICALL_PRIMITIVE_FUNC_PWR_IS_STABLE_XOSC_HF,
+	ICALL_PRIMITIVE_FUNC_PWR_GET_TRANSITION_STATE,
+	ICALL_PRIMITIVE_FUNC_CREATE_TASK,
+	ICALL_PRIMITIVE_FUNC_CREATE_SEMAPHORE,
+	ICALL_PRIMITIVE_FUNC_WAIT_SEMAPHORE,
+	ICALL_PRIMITIVE_FUNC_SWITCH_XOSC_HF,
+	ICALL_PRIMITIVE_FUNC_PWR_GET_XOSC_STARTUP_TIME,
+	ICALL_PRIMITIVE_FUNC_REGISTER_ISR_EXT,
+};
+
+typedef union {
+	ICall_EntityID entityId;
+	ICall_ServiceEnum servId;
+} ICall_EntityServiceUnion;
+
+typedef struct {
+	ICall_FuncArgsHdr hdr;
+	ICall_ServiceEnum service;
+	ICall_ServiceFunc fn;
+	ICall_EntityID entity;
+	ICall_Semaphore msgsem;
+} ICall_EnrollServiceArgs;
+
+typedef struct {
+	ICall_FuncArgsHdr hdr;
+	ICall_EntityID entity;
+	ICall_Semaphore msgsem;
+} ICall_RegisterAppArgs;
+
+typedef struct {
+	ICall_FuncArgsHdr hdr;
+	size_t size;
+	void *ptr;
+} ICall_AllocArgs;
+
+typedef struct {
+	ICall_FuncArgsHdr hdr;
+	void *ptr;
+} ICall_FreeArgs;
+
+typedef struct {
+	ICall_FuncArgsHdr hdr;
+	ICall_EntityID src;
+	ICall_EntityServiceUnion dest;
+	ICall_MSGFormat format;
+	void *msg;
+} ICall_SendArgs;
+
+typedef struct {
+	ICall_FuncArgsHdr hdr;
+	ICall_EntityServiceUnion src;
+	ICall_EntityID dest;
+	void *msg;
+} ICall_FetchMsgArgs;
+
+typedef struct {
+	ICall_FuncArgsHdr hdr;
+	ICall_EntityID entityId;
+	ICall_ServiceEnum servId;
+} ICall_EntityId2ServiceIdArgs;
+
+typedef struct {
+	ICall_FuncArgsHdr hdr;
+	uint_fast32_t milliseconds;
+} ICall_WaitArgs;
+
+typedef struct {
+	ICall_FuncArgsHdr hdr;
+	ICall_Semaphore sem;
+} ICall_SignalArgs;
+
+typedef struct {
+	ICall_FuncArgsHdr hdr;
+	int_least32_t intnum;
+} ICall_IntNumArgs;
+
+typedef struct {
+	ICall_FuncArgsHdr hdr;
+	int_least32_t intnum;
+	void (*isrfunc)(void);
+} ICall_RegisterISRArgs;
+
+typedef struct {
+	ICall_FuncArgsHdr hdr;
+	int_least32_t intnum;
+	void (*isrfunc)(void);
+	int_least32_t intPriority;
+} ICall_RegisterISRArgs_Ext;
+
+typedef struct {
+	ICall_FuncArgsHdr hdr;
+	uint_least32_t value;
+} ICall_GetUint32Args;
+
+typedef struct {
+	ICall_FuncArgsHdr hdr;
+	uint_least32_t timeout;
+	ICall_TimerID timerid;
+	ICall_TimerCback cback;
+	void *arg;
+} ICall_SetTimerArgs;
+
+typedef struct {
+	ICall_FuncArgsHdr hdr;
+	ICall_TimerID timerid;
+} ICall_StopTimerArgs;
+
+typedef struct {
+	ICall_FuncArgsHdr hdr;
+	uint_fast32_t milliseconds;
+	ICall_MsgMatchFn matchFn;
+	ICall_ServiceEnum servId;
+	ICall_EntityID dest;
+	void *msg;
+} ICall_WaitMatchArgs;
+
+typedef struct {
+	ICall_FuncArgsHdr hdr;
+	ICall_EntityID entity;
+} ICall_GetEntityIdArgs;
+
+typedef struct {
+	ICall_FuncArgsHdr hdr;
+	ICall_ServiceEnum servId;
+	uint_fast8_t result;
+} ICall_ThreadServesArgs;
+
+typedef struct {
+	ICall_FuncArgsHdr hdr;
+	ICall_RemoteTaskEntry entryfn;
+	int priority;
+	uint_least16_t stacksize;
+	uint32_t arg;
+} ICall_CreateTaskArgs;
+
+typedef struct {
+	ICall_FuncArgsHdr hdr;
+	uint_least8_t mode;
+	int initcount;
+	ICall_Semaphore sem;
+} ICall_CreateSemaphoreArgs;
+
+typedef struct {
+	ICall_FuncArgsHdr hdr;
+	ICall_Semaphore sem;
+	uint_fast32_t milliseconds;
+} ICall_WaitSemaphoreArgs;
+
+extern ICall_Dispatcher ICall_dispatcher;
+extern ICall_EnterCS ICall_enterCriticalSection;
+extern ICall_LeaveCS ICall_leaveCriticalSection;
+
+extern void ICall_init(void);
+extern void ICall_abort(void);
+
+#endif /* HOST_ICALL_H */
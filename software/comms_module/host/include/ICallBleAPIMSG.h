@@ -0,0 +1,13 @@
+/*
+ * ICallBleAPIMSG.h
+ *
+ * Host replacement for the ICall BLE message definitions.
+ */
+
+#ifndef HOST_ICALLBLEAPIMSG_H
+#define HOST_ICALLBLEAPIMSG_H
+
+#include "ICall.h"
+#include "gatt.h"
+
+#endif /* HOST_ICALLBLEAPIMSG_H */
@@ -0,0 +1,23 @@
+/*
+ * ICallPlatform.h
+ *
+ * Host replacement for the ICall platform power services. ICall.c only puts them in its
+ * primitive service table; whoever builds ICall.c supplies them.
+ */
+
+#ifndef HOST_ICALLPLATFORM_H
+#define HOST_ICALLPLATFORM_H
+
+#include "ICall.h"
+
+extern ICall_Errno ICallPlatform_pwrUpdActivityCounter(ICall_FuncArgsHdr *args);
+extern ICall_Errno ICallPlatform_pwrRegisterNotify(ICall_FuncArgsHdr *args);
+extern ICall_Errno ICallPlatform_pwrConfigACAction(ICall_FuncArgsHdr *args);
+extern ICall_Errno ICallPlatform_pwrRequire(ICall_FuncArgsHdr *args);
+extern ICall_Errno ICallPlatform_pwrDispense(ICall_FuncArgsHdr *args);
+extern ICall_Errno ICallPlatform_pwrIsStableXOSCHF(ICall_FuncArgsHdr *args);
+extern ICall_Errno ICallPlatform_pwrGetTransitionState(ICall_FuncArgsHdr *args);
+extern ICall_Errno ICallPlatform_pwrSwitchXOSCHF(ICall_FuncArgsHdr *args);
+extern ICall_Errno ICallPlatform_pwrGetXOSCStartupTime(ICall_FuncArgsHdr *args);
+
+#endif /* HOST_ICALLPLATFORM_H */
@@ -0,0 +1,29 @@
+/*
+ * OSAL.h
+ *
+ * Host replacement for the OSAL interface used by the profiles.
+ */
+
+#ifndef HOST_OSAL_H
+#define HOST_OSAL_H
+
+#include "bcomdef.h"
+#include "ICall.h"
+
+typedef ICall_Hdr osal_event_hdr_t;
+
+#define SYS_EVENT_MSG              0x8000
+
+#define osal_memcpy(dst, src, len) memcpy((dst), (src), (len))
+#define osal_memset(dst, val, len) memset((dst), (val), (len))
+#define osal_memcmp(a, b, len)     (0 == memcmp((a), (b), (len)))
+
+extern void *osal_revmemcpy(void *dst, const void *src, unsigned int len);
+extern uint8 osal_isbufset(uint8 *buf, uint8 val, uint8 len);
+
+extern uint8 *osal_msg_receive(uint8 task_id);
+extern uint8 osal_msg_deallocate(uint8 *msg_ptr);
+extern uint8 osal_set_event(uint8 task_id, uint16 event_flag);
+extern uint8 osal_clear_event(uint8 task_id, uint16 event_flag);
+
+#endif /* HOST_OSAL_H */
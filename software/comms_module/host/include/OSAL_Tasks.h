@@ -0,0 +1,22 @@
+/*
+ * OSAL_Tasks.h
+ *
+ * Host replacement for the OSAL task table. The benchmark that links OSAL.c supplies it.
+ */
+
+#ifndef HOST_OSAL_TASKS_H
+#define HOST_OSAL_TASKS_H
+
+#include "bcomdef.h"
+
+#define TASK_NO_TASK 0xFF
+
+typedef unsigned short (*pTaskEventHandlerFn)(unsigned char task_id, unsigned short event);
+
+extern const pTaskEventHandlerFn tasksArr[];
+extern const uint8 tasksCnt;
+extern uint16 *tasksEvents;
+
+extern void osalInitTasks(void);
+
+#endif /* HOST_OSAL_TASKS_H */
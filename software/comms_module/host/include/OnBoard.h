@@ -0,0 +1,20 @@
+/*
+ * OnBoard.h
+ *
+ * Host replacement for the board definitions used by the OSAL sources. The host is single
+ * threaded, so critical sections do nothing.
+ */
+
+#ifndef HOST_ONBOARD_H
+#define HOST_ONBOARD_H
+
+#include "bcomdef.h"
+
+#define TICK_COUNT 1
+
+#define HAL_ENTER_CRITICAL_SECTION(x) ((x) = 0)
+#define HAL_EXIT_CRITICAL_SECTION(x)  ((void)(x))
+
+extern uint16 Onboard_rand(void);
+
+#endif /* HOST_ONBOARD_H */
@@ -0,0 +1,63 @@
+/*
+ * att.h
+ *
+ * Host replacement for the ATT definitions. Values match the BLE stack headers in
+ * SmartBandageBLEStack/INCLUDE/att.h.
+ */
+
+#ifndef HOST_ATT_H
+#define HOST_ATT_H
+
+#include "bcomdef.h"
+
+#define ATT_MTU_SIZE                     23
+#define ATT_BT_UUID_SIZE                 2
+#define ATT_UUID_SIZE                    16
+
+#define ATT_EXCHANGE_MTU_REQ             0x02
+#define ATT_READ_REQ                     0x0a
+#define ATT_READ_BLOB_REQ                0x0c
+#define ATT_WRITE_REQ                    0x12
+#define ATT_HANDLE_VALUE_NOTI            0x1b
+#define ATT_HANDLE_VALUE_IND             0x1d
+#define ATT_HANDLE_VALUE_CFM             0x1e
+#define ATT_WRITE_CMD                    0x52
+
+#define ATT_FLOW_CTRL_VIOLATED_EVENT     0x7E
+#define ATT_MTU_UPDATED_EVENT            0x7F
+
+#define ATT_ERR_INVALID_HANDLE           0x01
+#define ATT_ERR_READ_NOT_PERMITTED       0x02
+#define ATT_ERR_WRITE_NOT_PERMITTED      0x03
+#define ATT_ERR_INVALID_PDU              0x04
+#define ATT_ERR_INSUFFICIENT_AUTHEN      0x05
+#define ATT_ERR_UNSUPPORTED_REQ          0x06
+#define ATT_ERR_INVALID_OFFSET           0x07
+#define ATT_ERR_INSUFFICIENT_AUTHOR      0x08
+#define ATT_ERR_ATTR_NOT_FOUND           0x0a
+#define ATT_ERR_ATTR_NOT_LONG            0x0b
+#define ATT_ERR_INVALID_VALUE_SIZE       0x0d
+#define ATT_ERR_UNLIKELY                 0x0e
+#define ATT_ERR_INSUFFICIENT_RESOURCES   0x11
+#define ATT_ERR_INVALID_VALUE            0x80
+
+typedef struct {
+	uint16 handle;
+	uint16 len;
+	uint8 *pValue;
+} attHandleValueNoti_t;
+
+typedef attHandleValueNoti_t attHandleValueInd_t;
+
+typedef struct {
+	uint8 opcode;
+	uint8 pendingOpcode;
+} attFlowCtrlViolatedEvt_t;
+
+typedef struct {
+	uint16 MTU;
+} attMtuUpdatedEvt_t;
+
+extern uint16 ATT_GetMTU(uint16 connHandle);
+
+#endif /* HOST_ATT_H */
@@ -0,0 +1,87 @@
+/*
+ * bcomdef.h
+ *
+ * Host replacement for the BLE stack common definitions. Only the types, status codes
+ * and helpers used by the application and profile sources are provided.
+ */
+
+#ifndef HOST_BCOMDEF_H
+#define HOST_BCOMDEF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef uint8_t  uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef int8_t   int8;
+typedef int16_t  int16;
+typedef int32_t  int32;
+
+typedef uint8 Status_t;
+typedef Status_t bStatus_t;
+typedef uint8 halIntState_t;
+
+#define CONST const
+#define VOID (void)
+
+#ifndef TRUE
+# define TRUE 1
+#endif
+
+#ifndef FALSE
+# define FALSE 0
+#endif
+
+#define BUILD_UINT16(loByte, hiByte) \
+	((uint16)(((loByte) & 0x00FF) + (((hiByte) & 0x00FF) << 8)))
+
+#define LO_UINT16(a) ((a) & 0xFF)
+#define HI_UINT16(a) (((a) >> 8) & 0xFF)
+
+#ifndef MIN
+#define MIN(n, m) (((n) < (m)) ? (n) : (m))
+#endif
+
+/*********************************************************************
+ * Generic status codes
+ */
+#define SUCCESS                   0x00
+#define FAILURE                   0x01
+#define INVALIDPARAMETER          0x02
+#define INVALID_TASK              0x03
+#define MSG_BUFFER_NOT_AVAIL      0x04
+#define INVALID_MSG_POINTER       0x05
+#define INVALID_EVENT_ID          0x06
+#define NO_TIMER_AVAIL            0x08
+#define NV_OPER_FAILED            0x0A
+#define INVALID_MEM_SIZE          0x0B
+
+/*********************************************************************
+ * BLE status codes
+ */
+#define bleNotReady               0x10
+#define bleAlreadyInRequestedMode 0x11
+#define bleIncorrectMode          0x12
+#define bleMemAllocError          0x13
+#define bleNotConnected           0x14
+#define bleNoResources            0x15
+#define blePending                0x16
+#define bleTimeout                0x17
+#define bleInvalidRange           0x18
+
+#define B_ADDR_LEN                6
+#define B_RANDOM_NUM_SIZE         8
+#define KEYLEN                    16
+
+/*********************************************************************
+ * NV item IDs used by the stack
+ */
+#define BLE_NVID_GAP_BOND_START   0x20
+#define BLE_NVID_GAP_BOND_END     0x5f
+#define BLE_NVID_GATT_CFG_START   0x70
+#define BLE_NVID_GATT_CFG_END     0x79
+
+#endif /* HOST_BCOMDEF_H */
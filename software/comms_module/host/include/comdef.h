@@ -0,0 +1,12 @@
+/*
+ * comdef.h
+ *
+ * Host replacement for the OSAL common definitions.
+ */
+
+#ifndef HOST_COMDEF_H
+#define HOST_COMDEF_H
+
+#include "bcomdef.h"
+
+#endif /* HOST_COMDEF_H */
@@ -0,0 +1,10 @@
+/*
+ * rom.h
+ *
+ * Host replacement for the driverlib ROM function table. Nothing is used on the host.
+ */
+
+#ifndef HOST_DRIVERLIB_ROM_H
+#define HOST_DRIVERLIB_ROM_H
+
+#endif /* HOST_DRIVERLIB_ROM_H */
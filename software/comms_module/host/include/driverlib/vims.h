@@ -0,0 +1,10 @@
+/*
+ * vims.h
+ *
+ * Host replacement for the driverlib flash cache (VIMS) interface. Nothing is used on the host.
+ */
+
+#ifndef HOST_DRIVERLIB_VIMS_H
+#define HOST_DRIVERLIB_VIMS_H
+
+#endif /* HOST_DRIVERLIB_VIMS_H */
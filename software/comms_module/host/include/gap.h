@@ -0,0 +1,142 @@
+/*
+ * gap.h
+ *
+ * Host replacement for the GAP definitions used by the application and the bond manager.
+ */
+
+#ifndef HOST_GAP_H
+#define HOST_GAP_H
+
+#include "bcomdef.h"
+#include "OSAL.h"
+#include "sm.h"
+
+#define GAP_MSG_EVENT                         0xD0
+
+#define GAP_DEVICE_NAME_LEN                   (20+1)
+
+#define GAP_ADTYPE_FLAGS                      0x01
+#define GAP_ADTYPE_16BIT_MORE                 0x02
+#define GAP_ADTYPE_LOCAL_NAME_COMPLETE        0x09
+#define GAP_ADTYPE_POWER_LEVEL                0x0A
+#define GAP_ADTYPE_SLAVE_CONN_INTERVAL_RANGE  0x12
+
+#define ADDRTYPE_PUBLIC                       0x00
+#define ADDRTYPE_STATIC                       0x01
+#define ADDRTYPE_PRIVATE_NONRESOLVE           0x02
+#define ADDRTYPE_PRIVATE_RESOLVE              0x03
+
+#define GAP_PROFILE_PERIPHERAL                0x04
+#define GAP_PROFILE_CENTRAL                   0x08
+
+#define GAP_PASSCODE_MAX                      999999
+
+#define GAP_ADTYPE_FLAGS_LIMITED              0x01
+#define GAP_ADTYPE_FLAGS_GENERAL              0x02
+#define GAP_ADTYPE_FLAGS_BREDR_NOT_SUPPORTED  0x04
+
+#define TGAP_GEN_DISC_ADV_INT_MIN             2
+#define TGAP_GEN_DISC_ADV_INT_MAX             3
+#define TGAP_LIM_DISC_ADV_INT_MIN             4
+#define TGAP_LIM_DISC_ADV_INT_MAX             5
+#define TGAP_CONN_PAUSE_PERIPHERAL            27
+#define TGAP_AUTH_TASK_ID                     37
+#define TGAP_PARAMID_MAX                      38
+
+// GAP message opcodes
+#define GAP_LINK_TERMINATED_EVENT             0x06
+#define GAP_SIGNATURE_UPDATED_EVENT           0x09
+#define GAP_AUTHENTICATION_COMPLETE_EVENT     0x0A
+#define GAP_PASSKEY_NEEDED_EVENT              0x0B
+#define GAP_SLAVE_REQUESTED_SECURITY_EVENT    0x0C
+#define GAP_BOND_COMPLETE_EVENT               0x0E
+#define GAP_PAIRING_REQ_EVENT                 0x0F
+
+typedef struct {
+	uint8 ioCap;
+	uint8 oobDataFlag;
+	uint8 authReq;
+	uint8 maxEncKeySize;
+	keyDist_t keyDist;
+} gapPairingReq_t;
+
+typedef struct {
+	uint16 connectionHandle;
+	smLinkSecurityReq_t secReqs;
+} gapAuthParams_t;
+
+typedef struct {
+	osal_event_hdr_t hdr;
+	uint8 opcode;
+} gapEventHdr_t;
+
+typedef struct {
+	osal_event_hdr_t hdr;
+	uint8 opcode;
+	uint16 connectionHandle;
+	uint8 reason;
+} gapTerminateLinkEvent_t;
+
+typedef struct {
+	osal_event_hdr_t hdr;
+	uint8 opcode;
+	uint8 addrType;
+	uint8 devAddr[B_ADDR_LEN];
+	uint32 signCounter;
+} gapSignUpdateEvent_t;
+
+typedef struct {
+	osal_event_hdr_t hdr;
+	uint8 opcode;
+	uint16 connectionHandle;
+	uint8 authState;
+	smSecurityInfo_t *pSecurityInfo;
+	smIdentityInfo_t *pIdentityInfo;
+	smSigningInfo_t *pSigningInfo;
+	smSecurityInfo_t *pDevSecInfo;
+} gapAuthCompleteEvent_t;
+
+typedef struct {
+	osal_event_hdr_t hdr;
+	uint8 opcode;
+	uint8 deviceAddr[B_ADDR_LEN];
+	uint16 connectionHandle;
+	uint8 uiInputs;
+	uint8 uiOutputs;
+} gapPasskeyNeededEvent_t;
+
+typedef struct {
+	osal_event_hdr_t hdr;
+	uint8 opcode;
+	uint16 connectionHandle;
+	uint8 authReq;
+} gapSlaveSecurityReqEvent_t;
+
+typedef struct {
+	osal_event_hdr_t hdr;
+	uint8 opcode;
+	uint16 connectionHandle;
+} gapBondCompleteEvent_t;
+
+typedef struct {
+	osal_event_hdr_t hdr;
+	uint8 opcode;
+	uint16 connectionHandle;
+	gapPairingReq_t pairReq;
+} gapPairingReqEvent_t;
+
+extern bStatus_t GAP_SetParamValue(uint16 paramID, uint16 paramValue);
+extern uint16 GAP_GetParamValue(uint16 paramID);
+extern void GAP_RegisterForMsgs(uint8 taskID);
+extern uint8 GAP_NumActiveConnections(void);
+
+extern bStatus_t GAP_Authenticate(gapAuthParams_t *pParams, gapPairingReq_t *pPairReq);
+extern bStatus_t GAP_TerminateAuth(uint16 connectionHandle, uint8 reason);
+extern bStatus_t GAP_PasscodeUpdate(uint32 passcode, uint16 connectionHandle);
+extern bStatus_t GAP_SendSlaveSecurityRequest(uint16 connectionHandle, uint8 authReq);
+extern bStatus_t GAP_Signable(uint16 connectionHandle, uint8 authenticated, smSigningInfo_t *pParams);
+extern bStatus_t GAP_Bond(uint16 connectionHandle, uint8 authenticated, smSecurityInfo_t *pParams,
+                          uint8 startEncryption);
+extern bStatus_t GAP_ResolvePrivateAddr(uint8 *pIRK, uint8 *pAddr);
+
+#endif /* HOST_GAP_H */
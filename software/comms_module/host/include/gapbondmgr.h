@@ -0,0 +1,39 @@
+/*
+ * gapbondmgr.h
+ *
+ * Host replacement for the GAP bond manager interface.
+ */
+
+#ifndef HOST_GAPBONDMGR_H
+#define HOST_GAPBONDMGR_H
+
+#include "bcomdef.h"
+
+#define GAPBOND_PAIRING_MODE               0x400
+#define GAPBOND_MITM_PROTECTION            0x402
+#define GAPBOND_IO_CAPABILITIES            0x403
+#define GAPBOND_BONDING_ENABLED            0x406
+#define GAPBOND_DEFAULT_PASSCODE           0x408
+
+#define GAPBOND_PAIRING_MODE_NO_PAIRING    0x00
+#define GAPBOND_PAIRING_MODE_WAIT_FOR_REQ  0x01
+#define GAPBOND_PAIRING_MODE_INITIATE      0x02
+
+#define GAPBOND_IO_CAP_DISPLAY_ONLY        0x00
+
+#define GAP_BONDINGS_MAX                   10
+
+typedef void (*pfnPasscodeCB_t)(uint8 *deviceAddr, uint16 connectionHandle,
+                                uint8 uiInputs, uint8 uiOutputs);
+typedef void (*pfnPairStateCB_t)(uint16 connectionHandle, uint8 state, uint8 status);
+
+typedef struct {
+	pfnPasscodeCB_t passcodeCB;
+	pfnPairStateCB_t pairStateCB;
+} gapBondCBs_t;
+
+extern bStatus_t GAPBondMgr_SetParameter(uint16 param, uint8 len, void *pValue);
+extern bStatus_t GAPBondMgr_Register(gapBondCBs_t *pCB);
+extern uint8 GAPBondMgr_ResolveAddr(uint8 addrType, uint8 *pDevAddr, uint8 *pResolvedAddr);
+
+#endif /* HOST_GAPBONDMGR_H */
@@ -0,0 +1,18 @@
+/*
+ * gapgattserver.h
+ *
+ * Host replacement for the GAP GATT server.
+ */
+
+#ifndef HOST_GAPGATTSERVER_H
+#define HOST_GAPGATTSERVER_H
+
+#include "bcomdef.h"
+
+#define GGS_DEVICE_NAME_ATT          0
+#define GGS_PERI_PRIVACY_FLAG_PROPS  9
+
+extern bStatus_t GGS_SetParameter(uint8 param, uint8 len, void *value);
+extern bStatus_t GGS_AddService(uint32 services);
+
+#endif /* HOST_GAPGATTSERVER_H */
@@ -0,0 +1,98 @@
+/*
+ * gatt.h
+ *
+ * Host replacement for the GATT definitions. The attribute record keeps pValue writable
+ * since the Smart Bandage profile builds its attribute table at run time.
+ */
+
+#ifndef HOST_GATT_H
+#define HOST_GATT_H
+
+#include "bcomdef.h"
+#include "OSAL.h"
+#include "att.h"
+
+#define GATT_PERMIT_READ                 0x01
+#define GATT_PERMIT_WRITE                0x02
+#define GATT_PERMIT_AUTHEN_READ          0x04
+#define GATT_PERMIT_AUTHEN_WRITE         0x08
+#define GATT_PERMIT_AUTHOR_READ          0x10
+#define GATT_PERMIT_AUTHOR_WRITE         0x20
+#define GATT_PERMIT_ENCRYPT_READ         0x40
+#define GATT_PERMIT_ENCRYPT_WRITE        0x80
+
+#define GATT_PROP_BCAST                  0x01
+#define GATT_PROP_READ                   0x02
+#define GATT_PROP_WRITE_NO_RSP           0x04
+#define GATT_PROP_WRITE                  0x08
+#define GATT_PROP_NOTIFY                 0x10
+#define GATT_PROP_INDICATE               0x20
+
+#define GATT_CFG_NO_OPERATION            0x0000
+#define GATT_CLIENT_CFG_NOTIFY           0x0001
+#define GATT_CLIENT_CFG_INDICATE         0x0002
+
+#define GATT_MAX_ENCRYPT_KEY_SIZE        16
+#define GATT_MAX_MTU                     0xFFFF
+#define GATT_LOCAL_READ                  0xFF
+
+#define GATT_MSG_EVENT                   0xB0
+
+#define GATT_INVALID_HANDLE              0x0000
+#define GATT_MIN_HANDLE                  0x0001
+#define GATT_MAX_HANDLE                  0xFFFF
+
+#define gattPermitRead( a )              ( (a) & GATT_PERMIT_READ )
+#define gattPermitWrite( a )             ( (a) & GATT_PERMIT_WRITE )
+#define gattPermitAuthorRead( a )        ( (a) & GATT_PERMIT_AUTHOR_READ )
+#define gattPermitAuthorWrite( a )       ( (a) & GATT_PERMIT_AUTHOR_WRITE )
+
+#define GATT_NUM_ATTRS( attrs )          ( sizeof( attrs ) / sizeof( gattAttribute_t ) )
+
+// F000XXXX-0451-4000-B000-000000000000
+#define TI_BASE_UUID_128( uuid )         0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xB0, \
+                                         0x00, 0x40, 0x51, 0x04, LO_UINT16( uuid ), HI_UINT16( uuid ), 0x00, 0xF0
+
+typedef struct {
+	uint8 len;
+	const uint8 *uuid;
+} gattAttrType_t;
+
+typedef struct attAttribute_t {
+	gattAttrType_t type;
+	uint8 permissions;
+	uint16 handle;
+	uint8 *pValue;
+} gattAttribute_t;
+
+typedef struct {
+	uint16 connHandle;
+	uint8 value;
+} gattCharCfg_t;
+
+typedef union {
+	attHandleValueNoti_t handleValueNoti;
+	attHandleValueInd_t handleValueInd;
+	attFlowCtrlViolatedEvt_t flowCtrlEvt;
+	attMtuUpdatedEvt_t mtuEvt;
+} gattMsg_t;
+
+typedef struct {
+	osal_event_hdr_t hdr;
+	uint16 connHandle;
+	uint8 method;
+	gattMsg_t msg;
+} gattMsgEvent_t;
+
+extern void *GATT_bm_alloc(uint16 connHandle, uint8 opcode, uint16 size, uint16 *pSizeAlloc);
+extern void GATT_bm_free(gattMsg_t *pMsg, uint8 opcode);
+extern bStatus_t GATT_Notification(uint16 connHandle, attHandleValueNoti_t *pNoti, uint8 authenticated);
+extern bStatus_t GATT_Indication(uint16 connHandle, attHandleValueInd_t *pInd, uint8 authenticated, uint8 taskId);
+extern bStatus_t GATT_SendRsp(uint16 connHandle, uint8 method, gattMsg_t *pRsp);
+extern void GATT_RegisterForMsgs(uint8 taskId);
+extern gattAttribute_t *GATT_FindHandleUUID(uint16 startHandle, uint16 endHandle, const uint8 *pUUID,
+                                            uint16 len, uint16 *pHandle);
+extern gattAttribute_t *GATT_FindNextAttr(gattAttribute_t *pAttr, uint16 endHandle, uint16 service,
+                                          uint16 *pLastHandle);
+
+#endif /* HOST_GATT_H */
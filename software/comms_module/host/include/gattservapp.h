@@ -0,0 +1,72 @@
+/*
+ * gattservapp.h
+ *
+ * Host replacement for the GATT Server Application interface. The utility functions are
+ * provided by the stack's own PROFILES/gattservapp_util.c, the rest by the emulator.
+ */
+
+#ifndef HOST_GATTSERVAPP_H
+#define HOST_GATTSERVAPP_H
+
+#include "gatt.h"
+
+#define GATT_ALL_SERVICES 0xFFFFFFFF
+
+#define GATT_SERV_MSG_EVENT                 0xB1
+#define GATT_CLIENT_CHAR_CFG_UPDATED_EVENT  0x00
+
+// Gets the CCC table from an attribute value that points at the table pointer
+#define GATT_CCC_TBL( pValue ) ( (gattCharCfg_t *)(*((uintptr_t *)(pValue))) )
+
+typedef bStatus_t (*pfnGATTReadAttrCB_t)(uint16 connHandle, gattAttribute_t *pAttr,
+                                         uint8 *pValue, uint16 *pLen, uint16 offset,
+                                         uint16 maxLen, uint8 method);
+
+typedef bStatus_t (*pfnGATTWriteAttrCB_t)(uint16 connHandle, gattAttribute_t *pAttr,
+                                          uint8 *pValue, uint16 len, uint16 offset,
+                                          uint8 method);
+
+typedef bStatus_t (*pfnGATTAuthorizeAttrCB_t)(uint16 connHandle, gattAttribute_t *pAttr,
+                                              uint8 opcode);
+
+typedef struct {
+	osal_event_hdr_t hdr;
+	uint8 method;
+} gattEventHdr_t;
+
+typedef struct {
+	osal_event_hdr_t hdr;
+	uint8 method;
+	uint16 connHandle;
+	uint16 attrHandle;
+	uint16 value;
+} gattClientCharCfgUpdatedEvent_t;
+
+typedef struct {
+	pfnGATTReadAttrCB_t pfnReadAttrCB;
+	pfnGATTWriteAttrCB_t pfnWriteAttrCB;
+	pfnGATTAuthorizeAttrCB_t pfnAuthorizeAttrCB;
+} gattServiceCBs_t;
+
+extern bStatus_t GATTServApp_RegisterService(gattAttribute_t *pAttrs, uint16 numAttrs,
+                                             uint8 encKeySize, CONST gattServiceCBs_t *pServiceCBs);
+extern bStatus_t GATTServApp_AddService(uint32 services);
+
+extern void GATTServApp_InitCharCfg(uint16 connHandle, gattCharCfg_t *charCfgTbl);
+extern bStatus_t GATTServApp_ProcessCharCfg(gattCharCfg_t *charCfgTbl, uint8 *pValue,
+                                            uint8 authenticated, gattAttribute_t *attrTbl,
+                                            uint16 numAttrs, uint8 taskId,
+                                            pfnGATTReadAttrCB_t pfnReadAttrCB);
+extern gattAttribute_t *GATTServApp_FindAttr(gattAttribute_t *pAttrTbl, uint16 numAttrs, uint8 *pValue);
+extern bStatus_t GATTServApp_ProcessCCCWriteReq(uint16 connHandle, gattAttribute_t *pAttr,
+                                                uint8 *pValue, uint16 len, uint16 offset,
+                                                uint16 validCfg);
+extern uint16 GATTServApp_ReadCharCfg(uint16 connHandle, gattCharCfg_t *charCfgTbl);
+extern uint8 GATTServApp_WriteCharCfg(uint16 connHandle, gattCharCfg_t *charCfgTbl, uint16 value);
+extern void GATTServApp_RegisterForMsg(uint8 taskID);
+extern bStatus_t GATTServApp_ReadAttr(uint16 connHandle, gattAttribute_t *pAttr, uint16 service,
+                                      uint8 *pValue, uint16 *pLen, uint16 offset, uint16 maxLen,
+                                      uint8 method);
+extern bStatus_t GATTServApp_UpdateCharCfg(uint16 connHandle, uint16 attrHandle, uint16 value);
+
+#endif /* HOST_GATTSERVAPP_H */
@@ -0,0 +1,16 @@
+/*
+ * hal_board_cfg.h
+ *
+ * Host replacement for the board configuration, for the stack sources built on the host. The
+ * host is single threaded, so interrupts are never masked.
+ */
+
+#ifndef HOST_HAL_BOARD_CFG_H
+#define HOST_HAL_BOARD_CFG_H
+
+#include "OnBoard.h"
+
+#define HAL_ENABLE_INTERRUPTS()  ((void)0)
+#define HAL_DISABLE_INTERRUPTS() ((void)0)
+
+#endif /* HOST_HAL_BOARD_CFG_H */
@@ -0,0 +1,12 @@
+/*
+ * hal_drivers.h
+ *
+ * Host replacement for the HAL driver interface used by OSAL.c.
+ */
+
+#ifndef HOST_HAL_DRIVERS_H
+#define HOST_HAL_DRIVERS_H
+
+extern void Hal_ProcessPoll(void);
+
+#endif /* HOST_HAL_DRIVERS_H */
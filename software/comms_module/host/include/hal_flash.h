@@ -0,0 +1,15 @@
+/*
+ * hal_flash.h
+ *
+ * Host replacement for the CC26xx flash HAL constants.
+ */
+
+#ifndef HOST_HAL_FLASH_H
+#define HOST_HAL_FLASH_H
+
+#include "bcomdef.h"
+
+#define HAL_FLASH_PAGE_SIZE              4096
+#define HAL_FLASH_WORD_SIZE              4
+
+#endif /* HOST_HAL_FLASH_H */
@@ -0,0 +1,10 @@
+/*
+ * hal_timer.h
+ *
+ * Host replacement for the HAL timer interface. Nothing from it is used on the host.
+ */
+
+#ifndef HOST_HAL_TIMER_H
+#define HOST_HAL_TIMER_H
+
+#endif /* HOST_HAL_TIMER_H */
@@ -0,0 +1,12 @@
+/*
+ * hal_types.h
+ *
+ * Host replacement for the HAL base types, for the stack sources built on the host.
+ */
+
+#ifndef HOST_HAL_TYPES_H
+#define HOST_HAL_TYPES_H
+
+#include "bcomdef.h"
+
+#endif /* HOST_HAL_TYPES_H */
@@ -0,0 +1,21 @@
+/*
+ * hci.h
+ *
+ * Host replacement for the HCI interface used by the bond manager.
+ */
+
+#ifndef HOST_HCI_H
+#define HOST_HCI_H
+
+#include "bcomdef.h"
+
+#define HCI_PUBLIC_DEVICE_ADDRESS    0x00
+
+#define HCI_DISCONNECT_AUTH_FAILURE  0x05
+
+#define LL_ENC_KEY_REQ_REJECTED      0x06
+
+extern bStatus_t HCI_LE_ClearWhiteListCmd(void);
+extern bStatus_t HCI_LE_AddWhiteListCmd(uint8 addrType, uint8 *devAddr);
+
+#endif /* HOST_HCI_H */
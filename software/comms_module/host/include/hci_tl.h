@@ -0,0 +1,18 @@
+/*
+ * hci_tl.h
+ *
+ * Host replacement for the HCI transport layer interface.
+ */
+
+#ifndef HOST_HCI_TL_H
+#define HOST_HCI_TL_H
+
+#include "bcomdef.h"
+
+#define HCI_GAP_EVENT_EVENT              0x91
+#define HCI_COMMAND_COMPLETE_EVENT_CODE  0x0E
+
+extern bStatus_t HCI_EXT_ConnEventNoticeCmd(uint16 connHandle, uint8 taskID, uint16 taskEvent);
+extern bStatus_t HCI_EXT_SetBDADDRCmd(uint8 *bdAddr);
+
+#endif /* HOST_HCI_TL_H */
@@ -0,0 +1,41 @@
+/*
+ * heapmgr.h
+ *
+ * Host replacement for the stack's heap manager template, which ICall.c instantiates after
+ * defining the HEAPMGR_* names. The C heap stands in for it, as in emulator/emuStack.c.
+ */
+
+#ifndef HOST_HEAPMGR_H
+#define HOST_HEAPMGR_H
+
+#include <stdlib.h>
+
+void HEAPMGR_INIT(void) {
+	HEAPMGR_IMPL_INIT();
+}
+
+void *HEAPMGR_MALLOC(uint16_t size) {
+	void *blk;
+
+	HEAPMGR_LOCK();
+	blk = malloc(size);
+	HEAPMGR_UNLOCK();
+
+	return blk;
+}
+
+void *HEAPMGR_REALLOC(void *blk, uint16_t size) {
+	HEAPMGR_LOCK();
+	blk = realloc(blk, size);
+	HEAPMGR_UNLOCK();
+
+	return blk;
+}
+
+void HEAPMGR_FREE(void *blk) {
+	HEAPMGR_LOCK();
+	free(blk);
+	HEAPMGR_UNLOCK();
+}
+
+#endif /* HOST_HEAPMGR_H */
@@ -0,0 +1,38 @@
+/*
+ * linkdb.h
+ *
+ * Host replacement for the link database. The number of connections is chosen by the
+ * harness before the profiles are initialized.
+ */
+
+#ifndef HOST_LINKDB_H
+#define HOST_LINKDB_H
+
+#include "bcomdef.h"
+
+#define INVALID_CONNHANDLE 0xFFFF
+
+#define LINK_NOT_CONNECTED 0x00
+#define LINK_CONNECTED     0x01
+
+typedef struct {
+	uint8 taskID;
+	uint16 connectionHandle;
+	uint8 stateFlags;
+	uint8 addrType;
+	uint8 addr[B_ADDR_LEN];
+	uint16 connInterval;
+	uint16 MTU;
+} linkDBItem_t;
+
+typedef void (*pfnPerformFuncCB_t)(linkDBItem_t *pLinkItem);
+
+extern uint8 linkDBNumConns;
+
+extern uint8 linkDB_State(uint16 connectionHandle, uint8 state);
+extern linkDBItem_t *linkDB_Find(uint16 connectionHandle);
+extern void linkDB_PerformFunc(pfnPerformFuncCB_t cb);
+
+#define linkDB_Up( connectionHandle )  linkDB_State( (connectionHandle), LINK_CONNECTED )
+
+#endif /* HOST_LINKDB_H */
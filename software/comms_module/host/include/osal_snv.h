@@ -0,0 +1,21 @@
+/*
+ * osal_snv.h
+ *
+ * Host replacement for the simple NV interface.
+ */
+
+#ifndef HOST_OSAL_SNV_H
+#define HOST_OSAL_SNV_H
+
+#include "bcomdef.h"
+
+typedef uint8 osalSnvId_t;
+typedef uint16 osalSnvLen_t;
+
+extern uint8 osal_snv_read(osalSnvId_t id, osalSnvLen_t len, void *pBuf);
+extern uint8 osal_snv_write(osalSnvId_t id, osalSnvLen_t len, void *pBuf);
+extern uint8 osal_snv_compact(uint8 threshold);
+extern void osal_snv_defer(uint8 defer);
+extern uint8 osal_snv_flush(uint8 max);
+
+#endif /* HOST_OSAL_SNV_H */
@@ -0,0 +1,51 @@
+/*
+ * peripheral.h
+ *
+ * Host replacement for the GAP peripheral role. The emulator keeps the registered callbacks
+ * so that the harness can drive connection state changes.
+ */
+
+#ifndef HOST_PERIPHERAL_H
+#define HOST_PERIPHERAL_H
+
+#include "gap.h"
+
+#define GAPROLE_PROFILEROLE          0x300
+#define GAPROLE_BD_ADDR              0x302
+#define GAPROLE_ADVERT_ENABLED       0x305
+#define GAPROLE_ADVERT_OFF_TIME      0x306
+#define GAPROLE_ADVERT_DATA          0x307
+#define GAPROLE_SCAN_RSP_DATA        0x308
+#define GAPROLE_PARAM_UPDATE_ENABLE  0x30E
+#define GAPROLE_MIN_CONN_INTERVAL    0x311
+#define GAPROLE_MAX_CONN_INTERVAL    0x312
+#define GAPROLE_SLAVE_LATENCY        0x313
+#define GAPROLE_TIMEOUT_MULTIPLIER   0x314
+#define GAPROLE_CONN_BD_ADDR         0x315
+#define GAPROLE_CONNHANDLE           0x31A
+#define GAPROLE_BD_ADDR_TYPE         0x31C
+
+typedef enum {
+	GAPROLE_INIT = 0,
+	GAPROLE_STARTED,
+	GAPROLE_ADVERTISING,
+	GAPROLE_ADVERTISING_NONCONN,
+	GAPROLE_WAITING,
+	GAPROLE_WAITING_AFTER_TIMEOUT,
+	GAPROLE_CONNECTED,
+	GAPROLE_CONNECTED_ADV,
+	GAPROLE_ERROR
+} gaprole_States_t;
+
+typedef void (*gapRolesStateNotify_t)(gaprole_States_t newState);
+
+typedef struct {
+	gapRolesStateNotify_t pfnStateChange;
+} gapRolesCBs_t;
+
+extern bStatus_t GAPRole_SetParameter(uint16 param, uint8 len, void *pValue);
+extern bStatus_t GAPRole_GetParameter(uint16 param, void *pValue);
+extern bStatus_t GAPRole_StartDevice(gapRolesCBs_t *pAppCallbacks);
+extern bStatus_t GAPRole_TerminateConnection(void);
+
+#endif /* HOST_PERIPHERAL_H */
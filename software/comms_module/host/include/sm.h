@@ -0,0 +1,54 @@
+/*
+ * sm.h
+ *
+ * Host replacement for the security manager definitions used by the bond manager.
+ */
+
+#ifndef HOST_SM_H
+#define HOST_SM_H
+
+#include "bcomdef.h"
+
+#define SM_AUTH_STATE_AUTHENTICATED  0x04
+#define SM_AUTH_STATE_BONDING        0x01
+
+typedef struct {
+	unsigned int sEncKey:1;
+	unsigned int sIdKey:1;
+	unsigned int sSign:1;
+	unsigned int sLinkKey:1;
+	unsigned int sReserved:4;
+	unsigned int mEncKey:1;
+	unsigned int mIdKey:1;
+	unsigned int mSign:1;
+	unsigned int mLinkKey:1;
+	unsigned int mReserved:4;
+} keyDist_t;
+
+typedef struct {
+	uint8 ioCaps;
+	uint8 oobAvailable;
+	uint8 oob[KEYLEN];
+	uint8 authReq;
+	keyDist_t keyDist;
+	uint8 maxEncKeySize;
+} smLinkSecurityReq_t;
+
+typedef struct {
+	uint8 keySize;
+	uint8 ltk[KEYLEN];
+	uint16 div;
+	uint8 rand[B_RANDOM_NUM_SIZE];
+} smSecurityInfo_t;
+
+typedef struct {
+	uint8 irk[KEYLEN];
+	uint8 bd_addr[B_ADDR_LEN];
+} smIdentityInfo_t;
+
+typedef struct {
+	uint8 srk[KEYLEN];
+	uint32 signCounter;
+} smSigningInfo_t;
+
+#endif /* HOST_SM_H */
@@ -0,0 +1,16 @@
+/*
+ * ti/drivers/PIN.h
+ *
+ * Host replacement for the PIN driver types referenced by Board.h.
+ */
+
+#ifndef HOST_PIN_H
+#define HOST_PIN_H
+
+#include <stdint.h>
+
+typedef uint32_t PIN_Config;
+typedef uint8_t PIN_Id;
+typedef struct PIN_State_s *PIN_Handle;
+
+#endif /* HOST_PIN_H */
@@ -0,0 +1,12 @@
+/*
+ * ti/drivers/pin/PINCC26XX.h
+ *
+ * Host replacement for the CC26xx PIN driver.
+ */
+
+#ifndef HOST_PINCC26XX_H
+#define HOST_PINCC26XX_H
+
+#include <ti/drivers/PIN.h>
+
+#endif /* HOST_PINCC26XX_H */
@@ -0,0 +1,24 @@
+/*
+ * ti/sysbios/BIOS.h
+ *
+ * Host replacement for the SYS/BIOS module.
+ */
+
+#ifndef HOST_BIOS_H
+#define HOST_BIOS_H
+
+#include <xdc/std.h>
+
+#define BIOS_WAIT_FOREVER (~(0U))
+#define BIOS_NO_WAIT      0
+
+typedef enum {
+	BIOS_ThreadType_Hwi,
+	BIOS_ThreadType_Swi,
+	BIOS_ThreadType_Task,
+	BIOS_ThreadType_Main
+} BIOS_ThreadType;
+
+extern BIOS_ThreadType BIOS_getThreadType(void);
+
+#endif /* HOST_BIOS_H */
@@ -0,0 +1,12 @@
+/*
+ * ti/sysbios/gates/GateHwi.h
+ *
+ * Host replacement for the SYS/BIOS GateHwi module, which ICall.c includes but does not use.
+ */
+
+#ifndef HOST_GATEHWI_H
+#define HOST_GATEHWI_H
+
+#include <xdc/std.h>
+
+#endif /* HOST_GATEHWI_H */
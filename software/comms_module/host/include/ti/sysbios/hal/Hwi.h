@@ -0,0 +1,40 @@
+/*
+ * ti/sysbios/hal/Hwi.h
+ *
+ * Host replacement for the SYS/BIOS Hwi module. The host build is single threaded, so there
+ * are no interrupts to hold off.
+ */
+
+#ifndef HOST_HWI_H
+#define HOST_HWI_H
+
+#include <xdc/std.h>
+
+static inline UInt Hwi_disable(void) {
+	return 0;
+}
+
+static inline void Hwi_restore(UInt key) {
+}
+
+static inline UInt Hwi_enable(void) {
+	return 0;
+}
+
+static inline void Hwi_enableInterrupt(UInt intNum) {
+}
+
+static inline void Hwi_disableInterrupt(UInt intNum) {
+}
+
+typedef struct {
+	Int priority;
+} Hwi_Params;
+
+typedef void *Hwi_Handle;
+typedef void (*Hwi_FuncPtr)(UArg arg);
+
+extern void Hwi_Params_init(Hwi_Params *params);
+extern Hwi_Handle Hwi_create(Int intNum, Hwi_FuncPtr fxn, const Hwi_Params *params, void *eb);
+
+#endif /* HOST_HWI_H */
@@ -0,0 +1,48 @@
+/*
+ * ti/sysbios/knl/Clock.h
+ *
+ * Host replacement for the SYS/BIOS Clock module. Ticks are virtual and only advance when
+ * the harness calls SB_emuAdvanceTicks(); expired clock functions run from that call.
+ */
+
+#ifndef HOST_CLOCK_H
+#define HOST_CLOCK_H
+
+#include <xdc/std.h>
+
+// Matches the 10us system tick of the target
+#define Clock_tickPeriod 10
+
+typedef void (*Clock_FuncPtr)(UArg arg);
+
+typedef struct {
+	UInt32 period;
+	Bool startFlag;
+	UArg arg;
+} Clock_Params;
+
+typedef struct Clock_Struct {
+	Clock_FuncPtr fxn;
+	UArg arg;
+	UInt32 timeout;
+	UInt32 period;
+	UInt32 deadline;
+	Bool active;
+	struct Clock_Struct *next;
+} Clock_Struct;
+
+typedef Clock_Struct *Clock_Handle;
+
+#define Clock_handle(pClock) ((Clock_Handle)(pClock))
+
+extern UInt32 Clock_getTicks(void);
+extern void Clock_Params_init(Clock_Params *params);
+extern void Clock_construct(Clock_Struct *obj, Clock_FuncPtr fxn, UInt timeout, const Clock_Params *params);
+extern Clock_Handle Clock_create(Clock_FuncPtr fxn, UInt timeout, const Clock_Params *params, void *eb);
+extern void Clock_start(Clock_Handle handle);
+extern void Clock_stop(Clock_Handle handle);
+extern Bool Clock_isActive(Clock_Handle handle);
+extern void Clock_setTimeout(Clock_Handle handle, UInt32 timeout);
+extern void Clock_setPeriod(Clock_Handle handle, UInt32 period);
+
+#endif /* HOST_CLOCK_H */
@@ -0,0 +1,30 @@
+/*
+ * ti/sysbios/knl/Queue.h
+ *
+ * Host replacement for the SYS/BIOS Queue module (a circular doubly linked list).
+ */
+
+#ifndef HOST_QUEUE_H
+#define HOST_QUEUE_H
+
+#include <xdc/std.h>
+
+typedef struct Queue_Elem {
+	struct Queue_Elem *volatile next;
+	struct Queue_Elem *volatile prev;
+} Queue_Elem;
+
+typedef struct {
+	Queue_Elem elem;
+} Queue_Struct;
+
+typedef Queue_Struct *Queue_Handle;
+
+#define Queue_handle(pQueue) ((Queue_Handle)(pQueue))
+
+extern void Queue_construct(Queue_Struct *obj, void *params);
+extern Bool Queue_empty(Queue_Handle handle);
+extern void Queue_enqueue(Queue_Handle handle, Queue_Elem *elem);
+extern void *Queue_dequeue(Queue_Handle handle);
+
+#endif /* HOST_QUEUE_H */
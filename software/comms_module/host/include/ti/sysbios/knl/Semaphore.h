@@ -0,0 +1,36 @@
+/*
+ * ti/sysbios/knl/Semaphore.h
+ *
+ * Host replacement for the SYS/BIOS Semaphore module. Pends never block; they report
+ * whether the semaphore had been posted.
+ */
+
+#ifndef HOST_SEMAPHORE_H
+#define HOST_SEMAPHORE_H
+
+#include <xdc/std.h>
+
+typedef struct {
+	volatile UInt count;
+} Semaphore_Struct;
+
+typedef Semaphore_Struct *Semaphore_Handle;
+
+#define Semaphore_handle(pSem) ((Semaphore_Handle)(pSem))
+
+typedef enum {
+	Semaphore_Mode_COUNTING,
+	Semaphore_Mode_BINARY
+} Semaphore_Mode;
+
+typedef struct {
+	Semaphore_Mode mode;
+} Semaphore_Params;
+
+extern void Semaphore_construct(Semaphore_Struct *obj, Int count, void *params);
+extern void Semaphore_Params_init(Semaphore_Params *params);
+extern Semaphore_Handle Semaphore_create(Int count, const Semaphore_Params *params, void *eb);
+extern void Semaphore_post(Semaphore_Handle handle);
+extern Bool Semaphore_pend(Semaphore_Handle handle, UInt32 timeout);
+
+#endif /* HOST_SEMAPHORE_H */
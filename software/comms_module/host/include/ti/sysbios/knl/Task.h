@@ -0,0 +1,38 @@
+/*
+ * ti/sysbios/knl/Task.h
+ *
+ * Host replacement for the SYS/BIOS Task module. Sleeping advances virtual time. There is only
+ * one task, so the scheduler lock does nothing.
+ */
+
+#ifndef HOST_TASK_H
+#define HOST_TASK_H
+
+#include <xdc/std.h>
+
+typedef void *Task_Handle;
+typedef void (*Task_FuncPtr)(UArg arg0, UArg arg1);
+
+typedef struct {
+	UArg arg0;
+	UArg arg1;
+	Int priority;
+	SizeT stackSize;
+} Task_Params;
+
+extern void Task_sleep(UInt32 nticks);
+extern Task_Handle Task_self(void);
+extern void Task_Params_init(Task_Params *params);
+extern Task_Handle Task_create(Task_FuncPtr fxn, const Task_Params *params, void *eb);
+
+static inline UInt Task_disable(void) {
+	return 0;
+}
+
+static inline void Task_restore(UInt key) {
+}
+
+static inline void Task_enable(void) {
+}
+
+#endif /* HOST_TASK_H */
@@ -0,0 +1,17 @@
+/*
+ * xdc/runtime/System.h
+ *
+ * Host replacement for the XDC System module. Output is only printed when the harness
+ * enables verbose mode.
+ */
+
+#ifndef HOST_XDC_SYSTEM_H
+#define HOST_XDC_SYSTEM_H
+
+#include <xdc/std.h>
+
+extern Int System_printf(const char *fmt, ...);
+extern void System_flush(void);
+extern void System_abort(const char *str);
+
+#endif /* HOST_XDC_SYSTEM_H */
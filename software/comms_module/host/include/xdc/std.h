@@ -0,0 +1,25 @@
+/*
+ * xdc/std.h
+ *
+ * Host replacement for the XDC standard types.
+ */
+
+#ifndef HOST_XDC_STD_H
+#define HOST_XDC_STD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef uintptr_t UArg;
+typedef unsigned int UInt;
+typedef int Int;
+typedef uint32_t UInt32;
+typedef uint16_t UInt16;
+typedef uint8_t UInt8;
+typedef bool Bool;
+typedef void Void;
+typedef char Char;
+typedef size_t SizeT;
+
+#endif /* HOST_XDC_STD_H */
@@ -0,0 +1,622 @@
+/*
+ * matchBenchmark.c
+ *
+ * Replays bursts of GATT notifications through the application's ICall message queue, with the
+ * ICall_waitMatch() that SmartBandage/ICall/ICall.c used to have and with the ICall.c linked in
+ * here. The old wait is modelled, on the same messages; the benchmark supplies the TI-RTOS
+ * objects ICall.c needs, with a thread's semaphore a counter, and calls it through the
+ * dispatcher as the SDK's ICall.h does.
+ *
+ * Each notification is a call into the stack, which answers with a command status the call
+ * waits for with its match function. While the application is busy notifying, the stack keeps
+ * queueing it other messages, such as connection events and the peer's writes, which it only
+ * takes once the burst is over. Every wait must return its own command status, and the other
+ * messages must then be fetched in the order they were sent; the old wait took every message
+ * out of the queue and put the unmatched ones back, the new one leaves them where they are. It
+ * checks each of them once per wait, and those queued while it waits only once.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/hal/Hwi.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/knl/Semaphore.h>
+#include <ti/sysbios/knl/Task.h>
+
+#include "ICall.h"
+#include "ICallPlatform.h"
+
+#define BENCH_DEFAULT_BURSTS      200
+#define BENCH_DEFAULT_NOTIFS      50
+#define BENCH_MAX_PER_NOTIF       8
+#define BENCH_SIGNAL_PERCENT      5
+#define BENCH_MAX_SEMAPHORES      4
+
+// Message events
+#define BENCH_CMD_STATUS_EVENT    0xA0
+#define BENCH_HCI_GAP_EVENT       0x90
+#define BENCH_GATT_MSG_EVENT      0xB0
+
+typedef struct {
+	uint8 event;
+	uint8 status;
+	uint32 seq;
+} BenchMsg;
+
+#define MSG_NEXT(msg)             (((ICall_MsgHdr *)(msg) - 1)->next)
+#define MSG_HDR(msg)              ((ICall_MsgHdr *)(msg) - 1)
+
+typedef struct {
+	ICall_Errno (*send)(void *msg);
+	void *(*fetch)(void);
+	void *(*waitMatch)(ICall_MsgMatchFn matchFn);
+	void (*signal)(void);
+	void (*reset)(void);
+} BenchICall;
+
+// The application and the stack thread, and their entities
+static struct {
+	uint8 app;
+	uint8 stack;
+	Task_Handle self;
+} tasks;
+
+static ICall_EntityID appEntity, stackEntity;
+static ICall_Semaphore appSem;
+static Semaphore_Struct semaphores[BENCH_MAX_SEMAPHORES];
+static uint32 numSemaphores, matchCalls, rngState;
+
+/*********************************************************************
+ * What ICall.c needs from TI-RTOS and the rest of the SDK
+ */
+BIOS_ThreadType BIOS_getThreadType(void) {
+	return BIOS_ThreadType_Task;
+}
+
+Task_Handle Task_self(void) {
+	return tasks.self;
+}
+
+void Task_Params_init(Task_Params *params) {
+	memset(params, 0, sizeof(*params));
+}
+
+// The stack's image is not started
+Task_Handle Task_create(Task_FuncPtr fxn, const Task_Params *params, void *eb) {
+	return NULL;
+}
+
+void Semaphore_Params_init(Semaphore_Params *params) {
+	memset(params, 0, sizeof(*params));
+}
+
+Semaphore_Handle Semaphore_create(Int count, const Semaphore_Params *params, void *eb) {
+	if (BENCH_MAX_SEMAPHORES == numSemaphores) {
+		return NULL;
+	}
+
+	semaphores[numSemaphores].count = count;
+	return &semaphores[numSemaphores++];
+}
+
+void Semaphore_post(Semaphore_Handle handle) {
+	++handle->count;
+}
+
+// The command status is always queued by the time the application waits
+Bool Semaphore_pend(Semaphore_Handle handle, UInt32 timeout) {
+	if (0 == handle->count) {
+		return false;
+	}
+
+	--handle->count;
+	return true;
+}
+
+UInt32 Clock_getTicks(void) {
+	return 0;
+}
+
+void Clock_Params_init(Clock_Params *params) {
+	memset(params, 0, sizeof(*params));
+}
+
+Clock_Handle Clock_create(Clock_FuncPtr fxn, UInt timeout, const Clock_Params *params, void *eb) {
+	return NULL;
+}
+
+void Clock_start(Clock_Handle handle) {
+}
+
+void Clock_stop(Clock_Handle handle) {
+}
+
+void Clock_setTimeout(Clock_Handle handle, UInt32 timeout) {
+}
+
+void Hwi_Params_init(Hwi_Params *params) {
+	memset(params, 0, sizeof(*params));
+}
+
+Hwi_Handle Hwi_create(Int intNum, Hwi_FuncPtr fxn, const Hwi_Params *params, void *eb) {
+	return NULL;
+}
+
+static ICall_Errno pwrUnsupported(ICall_FuncArgsHdr *args) {
+	return ICALL_ERRNO_INVALID_FUNCTION;
+}
+
+ICall_Errno ICallPlatform_pwrUpdActivityCounter(ICall_FuncArgsHdr *args) {
+	return pwrUnsupported(args);
+}
+
+ICall_Errno ICallPlatform_pwrRegisterNotify(ICall_FuncArgsHdr *args) {
+	return pwrUnsupported(args);
+}
+
+ICall_Errno ICallPlatform_pwrConfigACAction(ICall_FuncArgsHdr *args) {
+	return pwrUnsupported(args);
+}
+
+ICall_Errno ICallPlatform_pwrRequire(ICall_FuncArgsHdr *args) {
+	return pwrUnsupported(args);
+}
+
+ICall_Errno ICallPlatform_pwrDispense(ICall_FuncArgsHdr *args) {
+	return pwrUnsupported(args);
+}
+
+ICall_Errno ICallPlatform_pwrIsStableXOSCHF(ICall_FuncArgsHdr *args) {
+	return pwrUnsupported(args);
+}
+
+ICall_Errno ICallPlatform_pwrGetTransitionState(ICall_FuncArgsHdr *args) {
+	return pwrUnsupported(args);
+}
+
+ICall_Errno ICallPlatform_pwrSwitchXOSCHF(ICall_FuncArgsHdr *args) {
+	return pwrUnsupported(args);
+}
+
+ICall_Errno ICallPlatform_pwrGetXOSCStartupTime(ICall_FuncArgsHdr *args) {
+	return pwrUnsupported(args);
+}
+
+// No images besides this one
+const ICall_RemoteTaskEntry ICall_imgEntries[1];
+const Int ICall_imgTaskPriorities[1];
+const SizeT ICall_imgTaskStackSizes[1];
+const void *ICall_imgInitParams[1];
+const uint_least8_t ICall_numImages = 0;
+
+/*********************************************************************
+ * The SDK's ICall.h calls: each is a call to the primitive service through the dispatcher
+ */
+void ICall_abort(void) {
+	abort();
+}
+
+void *ICall_allocMsg(size_t size) {
+	ICall_AllocArgs args;
+
+	args.hdr.service = ICALL_SERVICE_CLASS_PRIMITIVE;
+	args.hdr.func = ICALL_PRIMITIVE_FUNC_MSG_ALLOC;
+	args.size = size;
+
+	return ICALL_ERRNO_SUCCESS == ICall_dispatcher(&args.hdr) ? args.ptr : NULL;
+}
+
+void ICall_freeMsg(void *msg) {
+	ICall_FreeArgs args;
+
+	args.hdr.service = ICALL_SERVICE_CLASS_PRIMITIVE;
+	args.hdr.func = ICALL_PRIMITIVE_FUNC_MSG_FREE;
+	args.ptr = msg;
+
+	ICall_dispatcher(&args.hdr);
+}
+
+ICall_Errno ICall_fetchServiceMsg(ICall_ServiceEnum *src, ICall_EntityID *dest, void **msg) {
+	ICall_FetchMsgArgs args;
+	ICall_Errno errno;
+
+	args.hdr.service = ICALL_SERVICE_CLASS_PRIMITIVE;
+	args.hdr.func = ICALL_PRIMITIVE_FUNC_FETCH_SERV_MSG;
+
+	errno = ICall_dispatcher(&args.hdr);
+	*src = args.src.servId;
+	*dest = args.dest;
+	*msg = args.msg;
+
+	return errno;
+}
+
+static ICall_Errno icallEnrollService(ICall_ServiceEnum service, ICall_EntityID *entity) {
+	ICall_EnrollServiceArgs args;
+	ICall_Errno errno;
+
+	args.hdr.service = ICALL_SERVICE_CLASS_PRIMITIVE;
+	args.hdr.func = ICALL_PRIMITIVE_FUNC_ENROLL;
+	args.service = service;
+	args.fn = NULL;
+
+	errno = ICall_dispatcher(&args.hdr);
+	*entity = args.entity;
+
+	return errno;
+}
+
+static ICall_Errno icallRegisterApp(ICall_EntityID *entity, ICall_Semaphore *msgsem) {
+	ICall_RegisterAppArgs args;
+	ICall_Errno errno;
+
+	args.hdr.service = ICALL_SERVICE_CLASS_PRIMITIVE;
+	args.hdr.func = ICALL_PRIMITIVE_FUNC_REGISTER_APP;
+
+	errno = ICall_dispatcher(&args.hdr);
+	*entity = args.entity;
+	*msgsem = args.msgsem;
+
+	return errno;
+}
+
+static ICall_Errno icallSend(ICall_EntityID src, ICall_EntityID dest, void *msg) {
+	ICall_SendArgs args;
+
+	args.hdr.service = ICALL_SERVICE_CLASS_PRIMITIVE;
+	args.hdr.func = ICALL_PRIMITIVE_FUNC_SEND_MSG;
+	args.src = src;
+	args.dest.entityId = dest;
+	args.format = 0;
+	args.msg = msg;
+
+	return ICall_dispatcher(&args.hdr);
+}
+
+static ICall_Errno icallWaitMatch(uint_fast32_t milliseconds, ICall_MsgMatchFn matchFn, void **msg) {
+	ICall_WaitMatchArgs args;
+	ICall_Errno errno;
+
+	args.hdr.service = ICALL_SERVICE_CLASS_PRIMITIVE;
+	args.hdr.func = ICALL_PRIMITIVE_FUNC_WAIT_MATCH;
+	args.milliseconds = milliseconds;
+	args.matchFn = matchFn;
+
+	errno = ICall_dispatcher(&args.hdr);
+	*msg = ICALL_ERRNO_SUCCESS == errno ? args.msg : NULL;
+
+	return errno;
+}
+
+static void icallSignal(ICall_Semaphore msgsem) {
+	ICall_SignalArgs args;
+
+	args.hdr.service = ICALL_SERVICE_CLASS_PRIMITIVE;
+	args.hdr.func = ICALL_PRIMITIVE_FUNC_SIGNAL;
+	args.sem = msgsem;
+
+	ICall_dispatcher(&args.hdr);
+}
+
+// As the BLE API's: a command status from the stack
+static bool matchCmdStatus(ICall_ServiceEnum servId, ICall_EntityID dest, const void *msg) {
+	++matchCalls;
+	return ICALL_SERVICE_CLASS_BLE == servId && BENCH_CMD_STATUS_EVENT == ((const BenchMsg *)msg)->event;
+}
+
+/*********************************************************************
+ * The queue and wait ICall.c used to have
+ */
+static struct {
+	void *queue;
+	uint32 sem;
+} list;
+
+static void listEnqueue(void **q, void *msg) {
+	void *last;
+
+	MSG_NEXT(msg) = NULL;
+
+	if (NULL == *q) {
+		*q = msg;
+	} else {
+		for (last = *q; NULL != MSG_NEXT(last); last = MSG_NEXT(last));
+		MSG_NEXT(last) = msg;
+	}
+}
+
+static void *listDequeue(void **q) {
+	void *msg = *q;
+
+	if (NULL != msg) {
+		*q = MSG_NEXT(msg);
+		MSG_NEXT(msg) = NULL;
+		MSG_HDR(msg)->dest_id = ICALL_UNDEF_DEST_ID;
+	}
+
+	return msg;
+}
+
+static void listPrepend(void **q, void *head) {
+	void *msg;
+
+	if (NULL != head) {
+		for (msg = head; NULL != MSG_NEXT(msg); msg = MSG_NEXT(msg));
+		MSG_NEXT(msg) = *q;
+		*q = head;
+	}
+}
+
+static ICall_Errno listSend(void *msg) {
+	MSG_HDR(msg)->srcentity = stackEntity;
+	MSG_HDR(msg)->dstentity = appEntity;
+	listEnqueue(&list.queue, msg);
+	++list.sem;
+
+	return ICALL_ERRNO_SUCCESS;
+}
+
+static void *listFetch(void) {
+	return listDequeue(&list.queue);
+}
+
+static void *listWaitMatch(ICall_MsgMatchFn matchFn) {
+	void *prependQueue = NULL, *msg, *found = NULL;
+	uint32 consumedCount = 0;
+
+	while (list.sem > 0) {
+		--list.sem;
+
+		if (NULL != (msg = listFetch())) {
+			// Only the stack sends to the application here
+			if (stackEntity == MSG_HDR(msg)->srcentity
+					&& matchFn(ICALL_SERVICE_CLASS_BLE, MSG_HDR(msg)->dstentity, msg)) {
+				found = msg;
+				break;
+			}
+
+			listEnqueue(&prependQueue, msg);
+		}
+
+		++consumedCount;
+	}
+
+	listPrepend(&list.queue, prependQueue);
+	list.sem += consumedCount;
+
+	return found;
+}
+
+static void listSignal(void) {
+	++list.sem;
+}
+
+static void listReset(void) {
+	list.sem = 0;
+}
+
+/*********************************************************************
+ * ICall.c as it is now
+ */
+static ICall_Errno icallStackSend(void *msg) {
+	return icallSend(stackEntity, appEntity, msg);
+}
+
+static void *icallFetch(void) {
+	ICall_ServiceEnum src;
+	ICall_EntityID dest;
+	void *msg;
+
+	return ICALL_ERRNO_SUCCESS == ICall_fetchServiceMsg(&src, &dest, &msg) ? msg : NULL;
+}
+
+static void *icallAppWaitMatch(ICall_MsgMatchFn matchFn) {
+	void *msg;
+
+	icallWaitMatch(ICALL_TIMEOUT_FOREVER, matchFn, &msg);
+	return msg;
+}
+
+static void icallAppSignal(void) {
+	icallSignal(appSem);
+}
+
+static void icallReset(void) {
+	appSem->count = 0;
+}
+
+/*********************************************************************
+ * The run
+ */
+static uint32 rand32() {
+	rngState = rngState * 1103515245 + 12345;
+	return rngState >> 8;
+}
+
+static double nowNs() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static uint8 send(const BenchICall *icall, uint8 event, uint32 seq, uint32 *pending) {
+	BenchMsg *msg = ICall_allocMsg(sizeof(BenchMsg));
+
+	if (NULL == msg) {
+		return FAILURE;
+	}
+
+	msg->event = event;
+	msg->seq = seq;
+
+	if (ICALL_ERRNO_SUCCESS != icall->send(msg)) {
+		ICall_freeMsg(msg);
+		return FAILURE;
+	}
+
+	++*pending;
+	return SUCCESS;
+}
+
+static void release(void *msg, uint32 *pending) {
+	ICall_freeMsg(msg);
+	--*pending;
+}
+
+/*
+ * Runs bursts of notifs notifications, the stack queueing up to perNotif other messages for
+ * each. Returns the time spent waiting in ns, or a negative number if the messages ran out.
+ * Counts the waits and fetches that returned the wrong message.
+ */
+static double run(const BenchICall *icall, uint32 bursts, uint32 notifs, uint32 perNotif, uint32 *mismatches,
+		uint32 *peak) {
+	static const uint8 events[] = { BENCH_HCI_GAP_EVENT, BENCH_GATT_MSG_EVENT };
+	uint32 burst, notif, k, n, seq, next, pending = 0;
+	double start, ns = 0;
+	BenchMsg *msg;
+
+	rngState = 0x5B4D0001;
+	matchCalls = *mismatches = *peak = 0;
+
+	for (burst = 0; burst < bursts; ++burst) {
+		seq = next = 0;
+
+		for (notif = 0; notif < notifs; ++notif) {
+			// The stack queues what happened since the last call, then answers this one
+			n = rand32() % (perNotif + 1);
+			for (k = 0; k < n; ++k) {
+				if (SUCCESS != send(icall, events[rand32() % sizeof(events)], ++seq, &pending)) {
+					return -1;
+				}
+			}
+
+			if (SUCCESS != send(icall, BENCH_CMD_STATUS_EVENT, notif, &pending)) {
+				return -1;
+			}
+
+			// ICall_signal(), with no message
+			if (rand32() % 100 < BENCH_SIGNAL_PERCENT) {
+				icall->signal();
+			}
+
+			*peak = pending > *peak ? pending : *peak;
+
+			start = nowNs();
+			msg = icall->waitMatch(matchCmdStatus);
+			ns += nowNs() - start;
+
+			if (NULL == msg || BENCH_CMD_STATUS_EVENT != msg->event || notif != msg->seq) {
+				++*mismatches;
+			}
+			if (msg) {
+				release(msg, &pending);
+			}
+		}
+
+		// The burst is over: the application takes everything else, in order
+		while (NULL != (msg = icall->fetch())) {
+			*mismatches += ++next != msg->seq;
+			release(msg, &pending);
+		}
+		*mismatches += next != seq;
+		icall->reset();
+	}
+
+	return ns;
+}
+
+static void usage(const char *name) {
+	fprintf(stderr, "Usage: %s [-b bursts] [-n notifications per burst (at most %u)] "
+			"[-m most other messages per notification (at most %u)]\n", name, BENCH_DEFAULT_NOTIFS * 2,
+			BENCH_MAX_PER_NOTIF);
+}
+
+int main(int argc, char **argv) {
+	static const uint8 defaultPerNotif[] = { 0, 2, BENCH_MAX_PER_NOTIF };
+	static const struct {
+		const char *name;
+		BenchICall icall;
+	} impls[] = {
+		{ "requeue", { listSend, listFetch, listWaitMatch, listSignal, listReset } },
+		{ "inplace", { icallStackSend, icallFetch, icallAppWaitMatch, icallAppSignal, icallReset } },
+	};
+	uint32 bursts = BENCH_DEFAULT_BURSTS, notifs = BENCH_DEFAULT_NOTIFS, perNotif = 0, m, mismatches, peak;
+	double ns, baseNs = 0;
+	int opt, k, r, runs, failures = 0, perNotifSet = 0;
+
+	while (-1 != (opt = getopt(argc, argv, "b:n:m:h"))) {
+		switch (opt) {
+		case 'b':
+			bursts = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'n':
+			notifs = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'm':
+			perNotif = strtoul(optarg, NULL, 0);
+			perNotifSet = 1;
+			break;
+
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	if (0 == bursts || 0 == notifs || notifs > BENCH_DEFAULT_NOTIFS * 2 || perNotif > BENCH_MAX_PER_NOTIF) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	// The stack's thread enrolls its service, then the application registers
+	ICall_init();
+	tasks.self = &tasks.stack;
+	if (ICALL_ERRNO_SUCCESS != icallEnrollService(ICALL_SERVICE_CLASS_BLE, &stackEntity)) {
+		printf("enrolling the stack failed  FAILED\n");
+		return 1;
+	}
+	tasks.self = &tasks.app;
+	if (ICALL_ERRNO_SUCCESS != icallRegisterApp(&appEntity, &appSem)) {
+		printf("registering the application failed  FAILED\n");
+		return 1;
+	}
+
+	runs = perNotifSet ? 1 : sizeof(defaultPerNotif);
+
+	printf("%-8s %6s %6s %8s %6s %11s %9s %8s\n", "wait", "bursts", "notifs", "per_ntf", "peak", "match/wait",
+			"ns/wait", "speedup");
+
+	for (r = 0; r < runs; ++r) {
+		m = perNotifSet ? perNotif : defaultPerNotif[r];
+
+		for (k = 0; k < 2; ++k) {
+			ns = run(&impls[k].icall, bursts, notifs, m, &mismatches, &peak);
+
+			if (ns < 0) {
+				printf("%-8s %6u %6u %8u  ran out of messages  FAILED\n", impls[k].name, bursts, notifs, m);
+				++failures;
+				break;
+			}
+
+			if (0 == k) {
+				baseNs = ns;
+			}
+
+			printf("%-8s %6u %6u %8u %6u %11.2f %9.1f %7.1fx%s\n", impls[k].name, bursts, notifs, m, peak,
+					(double)matchCalls / bursts / notifs, ns / bursts / notifs, baseNs / ns,
+					mismatches ? "  FAILED" : "");
+
+			failures += mismatches > 0;
+		}
+	}
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,462 @@
+/*
+ * msgBenchmark.c
+ *
+ * Stresses the OSAL message queues with bursty GATT traffic, with the single queue of every
+ * task's messages OSAL.c used to keep and with the queue per task of the OSAL.c linked in here.
+ * The benchmark supplies the task table and the rest of the stack OSAL.c needs.
+ *
+ * Each round is a connection event: the controller may deliver a burst of ATT PDUs, each one a
+ * GATT message to the GATT server task, while HCI events go to the GAP task and the other tasks
+ * get the odd message. The GATT server counts its pending GATT messages and looks for a pending
+ * HCI event, as the stack does before flow control, then takes a few messages; every other task
+ * takes a couple. A slow task only takes its messages once it has backlog pending, so many messages
+ * for other tasks sit in the queue. Every message received, found and counted, and every
+ * message event set or cleared, is folded into a digest both queues must agree on.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "OSAL.h"
+#include "OSAL_Tasks.h"
+
+#define BENCH_DEFAULT_ROUNDS      20000
+#define BENCH_DEFAULT_BURST       12
+#define BENCH_MAX_BURST           16      // More than the GATT server keeps up with
+#define BENCH_TASKS               10
+#define BENCH_GATT_TASK           5
+#define BENCH_GAP_TASK            3
+#define BENCH_SLOW_TASK           8
+#define BENCH_GATT_TAKES          3
+#define BENCH_OTHER_TAKES         2
+#define BENCH_MAX_BACKLOG         200
+#define BENCH_MAX_MSGS            (BENCH_MAX_BACKLOG + 64 * BENCH_TASKS)
+
+#define BENCH_ALL_EVENTS          0xFF    // OSAL_MSG_ALL_EVENTS
+
+// Message events, as the stack numbers them
+#define BENCH_L2CAP_DATA_EVENT    0x70
+#define BENCH_L2CAP_SIGNAL_EVENT  0x71
+#define BENCH_HCI_GAP_EVENT       0x90
+#define BENCH_HCI_SMP_EVENT       0x92
+#define BENCH_GATT_MSG_EVENT      0xB0
+#define BENCH_GAP_MSG_EVENT       0xD0
+
+typedef struct {
+	osal_msg_hdr_t hdr;
+	osal_event_hdr_t ev;
+	uint32 seq;
+} BenchMsg;
+
+#define MSG_NEXT(msg)             OSAL_MSG_NEXT(msg)
+#define MSG_ID(msg)               OSAL_MSG_ID(msg)
+#define MSG_EVENT(msg)            ((osal_event_hdr_t *)(msg))->event
+#define MSG_SEQ(msg)              ((BenchMsg *)((osal_msg_hdr_t *)(msg) - 1))->seq
+
+typedef struct {
+	void (*init)(void);
+	void (*send)(uint8 task, void *msg, uint8 push);
+	void *(*receive)(uint8 task);
+	void *(*find)(uint8 task, uint8 event);
+	uint8 (*count)(uint8 task, uint8 event);
+} BenchQueue;
+
+static struct {
+	BenchMsg msgs[BENCH_MAX_MSGS];
+	BenchMsg *free[BENCH_MAX_MSGS];
+	uint32 numFree;
+} pool;
+
+static uint16 taskEvents[BENCH_TASKS];
+static uint32 digest, rngState;
+static uint8 allocFails;
+
+/*********************************************************************
+ * What OSAL.c needs from the rest of the stack
+ */
+const pTaskEventHandlerFn tasksArr[BENCH_TASKS];
+const uint8 tasksCnt = BENCH_TASKS;
+uint16 *tasksEvents;
+
+void osalInitTasks(void) {
+	tasksEvents = taskEvents;
+	memset(taskEvents, 0, sizeof(taskEvents));
+}
+
+void *osal_mem_alloc(uint16 size) {
+	return allocFails ? NULL : malloc(size);
+}
+
+void osal_mem_free(void *ptr) {
+	free(ptr);
+}
+
+void osal_mem_init(void) {
+}
+
+void osal_mem_kick(void) {
+}
+
+void osalTimerInit(void) {
+}
+
+void osalTimeUpdate(void) {
+}
+
+void osal_pwrmgr_init(void) {
+}
+
+void Hal_ProcessPoll(void) {
+}
+
+uint16 Onboard_rand(void) {
+	return 0;
+}
+
+/*********************************************************************
+ * The queue OSAL.c used to keep: every task's messages in one list
+ */
+static void *qHead;
+
+static void globalInit(void) {
+	qHead = NULL;
+}
+
+static void globalSend(uint8 task, void *msg, uint8 push) {
+	void *list;
+
+	MSG_ID(msg) = task;
+
+	if (push) {
+		MSG_NEXT(msg) = qHead;
+		qHead = msg;
+	} else if (NULL == qHead) {
+		qHead = msg;
+	} else {
+		for (list = qHead; NULL != MSG_NEXT(list); list = MSG_NEXT(list));
+		MSG_NEXT(list) = msg;
+	}
+
+	taskEvents[task] |= SYS_EVENT_MSG;
+}
+
+static void *globalReceive(uint8 task) {
+	void *list = qHead, *prev = NULL, *found = NULL;
+
+	while (NULL != list) {
+		if (MSG_ID(list) == task) {
+			if (NULL == found) {
+				found = list;
+			} else {
+				break;
+			}
+		}
+		if (NULL == found) {
+			prev = list;
+		}
+		list = MSG_NEXT(list);
+	}
+
+	if (NULL != list) {
+		taskEvents[task] |= SYS_EVENT_MSG;
+	} else {
+		taskEvents[task] &= ~SYS_EVENT_MSG;
+	}
+
+	if (NULL != found) {
+		if (found == qHead) {
+			qHead = MSG_NEXT(found);
+		} else {
+			MSG_NEXT(prev) = MSG_NEXT(found);
+		}
+		MSG_NEXT(found) = NULL;
+		MSG_ID(found) = TASK_NO_TASK;
+	}
+
+	return found;
+}
+
+static void *globalFind(uint8 task, uint8 event) {
+	void *msg;
+
+	for (msg = qHead; NULL != msg; msg = MSG_NEXT(msg)) {
+		if (MSG_ID(msg) == task && MSG_EVENT(msg) == event) {
+			break;
+		}
+	}
+
+	return msg;
+}
+
+static uint8 globalCount(uint8 task, uint8 event) {
+	uint8 count = 0;
+	void *msg;
+
+	for (msg = qHead; NULL != msg; msg = MSG_NEXT(msg)) {
+		if (MSG_ID(msg) == task && (BENCH_ALL_EVENTS == event || MSG_EVENT(msg) == event)) {
+			++count;
+		}
+	}
+
+	return count;
+}
+
+/*********************************************************************
+ * The queues OSAL.c keeps now: one per task, with the number of its messages per event
+ */
+static void taskInit(void) {
+	// osal_init_system() set them up, and every run leaves them empty
+}
+
+static void taskSend(uint8 task, void *msg, uint8 push) {
+	if (push) {
+		osal_msg_push_front(task, msg);
+	} else {
+		osal_msg_send(task, msg);
+	}
+}
+
+static void *taskReceive(uint8 task) {
+	return osal_msg_receive(task);
+}
+
+static void *taskFind(uint8 task, uint8 event) {
+	return osal_msg_find(task, event);
+}
+
+static uint8 taskCount(uint8 task, uint8 event) {
+	return osal_msg_count(task, event);
+}
+
+/*********************************************************************
+ * The run
+ */
+static uint32 rand32() {
+	rngState = rngState * 1103515245 + 12345;
+	return rngState >> 8;
+}
+
+static double nowNs() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void fold(uint32 value) {
+	digest = (digest ^ value) * 0x01000193;
+}
+
+static uint8 send(const BenchQueue *queue, uint8 task, uint8 event, uint8 push, uint32 *seq) {
+	BenchMsg *msg;
+
+	if (0 == pool.numFree) {
+		return FAILURE;
+	}
+
+	msg = pool.free[--pool.numFree];
+	msg->hdr.next = NULL;
+	msg->hdr.dest_id = TASK_NO_TASK;
+	msg->ev.event = event;
+	msg->seq = ++*seq;
+
+	queue->send(task, &msg->ev, push);
+	return SUCCESS;
+}
+
+static void receive(const BenchQueue *queue, uint8 task, uint32 *ops) {
+	void *msg = queue->receive(task);
+
+	++*ops;
+	fold(task << 24 ^ (msg ? MSG_SEQ(msg) : 0) ^ taskEvents[task] << 16);
+
+	if (msg) {
+		pool.free[pool.numFree++] = (BenchMsg *)((osal_msg_hdr_t *)msg - 1);
+	}
+}
+
+/*
+ * Runs rounds connection events, with bursts of up to burst GATT messages and backlog messages
+ * left for the slow task. Returns the time taken in ns, or a negative number if the messages
+ * ran out. The queues are left empty either way.
+ */
+static double run(const BenchQueue *queue, uint32 rounds, uint32 burst, uint32 backlog, uint32 *ops,
+		uint32 *pending) {
+	// More events than a task queue has slots for
+	static const uint8 events[] = { BENCH_L2CAP_DATA_EVENT, BENCH_L2CAP_SIGNAL_EVENT, BENCH_HCI_GAP_EVENT,
+			BENCH_HCI_SMP_EVENT, BENCH_GAP_MSG_EVENT };
+	uint32 round, seq = 0, k, n;
+	double start;
+	void *msg;
+	uint8 task, ranOut = FALSE;
+
+	rngState = 0x5B4D0001;
+	digest = 0x811C9DC5;
+	*ops = *pending = 0;
+
+	pool.numFree = 0;
+	for (k = 0; k < BENCH_MAX_MSGS; ++k) {
+		pool.free[pool.numFree++] = &pool.msgs[k];
+	}
+	memset(taskEvents, 0, sizeof(taskEvents));
+	queue->init();
+
+	start = nowNs();
+
+	for (round = 0; round < rounds && !ranOut; ++round) {
+		// A burst of ATT PDUs every few connection events
+		n = 0 == rand32() % 4 ? 1 + rand32() % burst : rand32() % 2;
+		for (k = 0; k < n && !ranOut; ++k) {
+			ranOut = SUCCESS != send(queue, BENCH_GATT_TASK, BENCH_GATT_MSG_EVENT, FALSE, &seq);
+		}
+
+		// The connection event's HCI event, and the odd message for the other tasks
+		ranOut = ranOut || SUCCESS != send(queue, BENCH_GAP_TASK, BENCH_HCI_GAP_EVENT, 0 == rand32() % 8, &seq);
+
+		for (k = 0; k < 2 && !ranOut; ++k) {
+			task = rand32() % BENCH_TASKS;
+			ranOut = SUCCESS != send(queue, task, events[rand32() % sizeof(events)], FALSE, &seq);
+		}
+
+		if (ranOut) {
+			break;
+		}
+
+		// The GATT server checks what it has pending, then takes a few messages
+		fold(queue->count(BENCH_GATT_TASK, BENCH_GATT_MSG_EVENT));
+		fold(queue->count(BENCH_GATT_TASK, BENCH_ALL_EVENTS));
+		msg = queue->find(BENCH_GATT_TASK, BENCH_HCI_GAP_EVENT);
+		fold(msg ? MSG_SEQ(msg) : 0);
+		*ops += 3;
+
+		for (k = 0; k < BENCH_GATT_TAKES; ++k) {
+			receive(queue, BENCH_GATT_TASK, ops);
+		}
+
+		// Every other task takes a couple of messages, the slow one only once it has a backlog
+		for (task = 0; task < BENCH_TASKS; ++task) {
+			if (BENCH_GATT_TASK == task) {
+				continue;
+			}
+
+			if (BENCH_SLOW_TASK == task) {
+				fold(n = queue->count(task, BENCH_ALL_EVENTS));
+				++*ops;
+				if (n <= backlog) {
+					continue;
+				}
+			}
+
+			for (k = 0; k < BENCH_OTHER_TAKES; ++k) {
+				receive(queue, task, ops);
+			}
+		}
+	}
+
+	start = nowNs() - start;
+
+	*pending = BENCH_MAX_MSGS - pool.numFree;
+
+	// Leave no messages behind
+	for (task = 0; task < BENCH_TASKS; ++task) {
+		while (NULL != (msg = queue->receive(task))) {
+			fold(MSG_SEQ(msg));
+			pool.free[pool.numFree++] = (BenchMsg *)((osal_msg_hdr_t *)msg - 1);
+		}
+	}
+
+	return ranOut ? -1 : start;
+}
+
+static void usage(const char *name) {
+	fprintf(stderr, "Usage: %s [-r rounds] [-u largest burst (at most %u)] [-b slow task backlog (at most %u)]\n",
+			name, BENCH_MAX_BURST, BENCH_MAX_BACKLOG);
+}
+
+int main(int argc, char **argv) {
+	static const uint8 defaultBacklogs[] = { 0, 16, 64, BENCH_MAX_BACKLOG };
+	static const struct {
+		const char *name;
+		BenchQueue queue;
+	} impls[] = {
+		{ "global", { globalInit, globalSend, globalReceive, globalFind, globalCount } },
+		{ "task", { taskInit, taskSend, taskReceive, taskFind, taskCount } },
+	};
+	uint32 rounds = BENCH_DEFAULT_ROUNDS, burst = BENCH_DEFAULT_BURST, backlog = 0, b, ops, pending;
+	uint32 digests[2];
+	double ns, baseNs = 0;
+	int opt, k, runs, r, failures = 0, backlogSet = 0;
+
+	while (-1 != (opt = getopt(argc, argv, "r:u:b:h"))) {
+		switch (opt) {
+		case 'r':
+			rounds = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'u':
+			burst = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'b':
+			backlog = strtoul(optarg, NULL, 0);
+			backlogSet = 1;
+			break;
+
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	if (0 == rounds || 0 == burst || burst > BENCH_MAX_BURST || backlog > BENCH_MAX_BACKLOG) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	// Without its task queues OSAL must fail to start, rather than run on no queues
+	allocFails = TRUE;
+	if (MSG_BUFFER_NOT_AVAIL != osal_init_system()) {
+		printf("osal_init_system() with no memory did not fail  FAILED\n");
+		++failures;
+	}
+	allocFails = FALSE;
+
+	if (SUCCESS != osal_init_system()) {
+		printf("osal_init_system() failed  FAILED\n");
+		return 1;
+	}
+
+	runs = backlogSet ? 1 : sizeof(defaultBacklogs);
+
+	printf("%-6s %7s %5s %7s %7s %9s %8s\n", "queue", "rounds", "burst", "backlog", "pending", "ns/op",
+			"speedup");
+
+	for (r = 0; r < runs; ++r) {
+		b = backlogSet ? backlog : defaultBacklogs[r];
+
+		for (k = 0; k < 2; ++k) {
+			ns = run(&impls[k].queue, rounds, burst, b, &ops, &pending);
+			digests[k] = digest;
+
+			if (ns < 0) {
+				printf("%-6s %7u %5u %7u  ran out of messages  FAILED\n", impls[k].name, rounds, burst, b);
+				++failures;
+				break;
+			}
+
+			if (0 == k) {
+				baseNs = ns;
+			}
+
+			printf("%-6s %7u %5u %7u %7u %9.1f %7.1fx%s\n", impls[k].name, rounds, burst, b, pending,
+					ns / ops, baseNs / ns, k > 0 && digests[1] != digests[0] ? "  FAILED" : "");
+
+			failures += k > 0 && digests[1] != digests[0];
+		}
+	}
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,471 @@
+/*
+ * oadBenchmark.c
+ *
+ * Drives the OAD profile (PROFILES/oad.c) with a scripted OAD manager on top of the emulated
+ * stack and external flash, and reports how long an image transfer takes.
+ *
+ *   legacy   - the target requests every 16 byte block with a notification and the manager
+ *              answers each request with one block.
+ *   windowed - the manager asks for windowed transfer, then streams each credited window
+ *              with write-without-response and resends the blocks the target NAKs. When
+ *              nothing comes back for a while it repeats its last write, which is how a
+ *              lost window end or lost resend is recovered.
+ *
+ * The image carries a real CRC, so a transfer only passes if the target verified it and asked
+ * for the reset into the boot loader, and if the image area matches byte for byte.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "bcomdef.h"
+#include "hal_flash.h"
+
+#include "oad.h"
+#include "oad_target.h"
+
+#include "emulator.h"
+
+#define BENCH_DEFAULT_IMAGE_KB    64
+#define BENCH_DEFAULT_PDUS        4
+#define BENCH_MAX_IMAGE_KB        112
+
+// Largest ATT MTU the stack build supports: MAX_PDU_SIZE (78) less the 4 byte L2CAP header
+#define BENCH_MAX_MTU             74
+
+// Managers ask for a short interval for the length of the update
+#define BENCH_DEFAULT_INTERVAL_MS 30
+
+// Connection events the windowed manager waits for a credit or NAK before writing again
+#define BENCH_RETRY_EVENTS        8
+#define BENCH_MAX_RETRIES         5
+
+#define BENCH_CONN                0
+
+typedef enum {
+	OAD_LEGACY,
+	OAD_WINDOWED,
+	OAD_NUM_MODES
+} OadMode;
+
+static const char *oadModeNames[OAD_NUM_MODES] = { "legacy", "windowed" };
+
+typedef struct {
+	OadMode mode;
+	uint16 mtu;
+	uint8 window;
+	uint16 intervalMs;
+	uint32 imageBytes;
+	uint8 pdusPerEvent;
+	uint32 dropEvery;		// Drop every nth block write, resends included (windowed only), 0 for none
+} BenchConfig;
+
+typedef struct {
+	uint32 blockWrites;
+	uint32 dropped;
+	uint32 naks;
+	uint32 retries;
+	uint32 errors;
+	uint64_t timeMs;
+	SB_EmuStats stats;
+	SB_EmuOadStats oad;
+} BenchResult;
+
+static uint8 image[BENCH_MAX_IMAGE_KB * 1024];
+
+/*
+ * Same CRC16 as the boot image manager, including the two trailing zero bytes
+ */
+static uint16 imageCrc(const uint8 *data, uint32 len) {
+	uint16 crc = 0;
+	uint32 i;
+	uint8 bit, val;
+
+	for (i = 0; i < len + 2; ++i) {
+		val = i < len ? data[i] : 0;
+
+		for (bit = 0; bit < 8; ++bit, val <<= 1) {
+			bool msb = crc & 0x8000;
+
+			crc = (crc << 1) | ((val & 0x80) ? 1 : 0);
+
+			if (msb) {
+				crc ^= 0x1021;
+			}
+		}
+	}
+
+	return crc;
+}
+
+static void buildImage(uint32 len) {
+	uint32 i, seed = 0x5B4D0001;
+	uint16 crc;
+
+	for (i = 0; i < len; ++i) {
+		seed = seed * 1103515245 + 12345;
+		image[i] = (uint8)(seed >> 16);
+	}
+
+	// CRC, CRC shadow, then the image header: version, length in words, user id, reserved
+	image[4] = 0;
+	image[5] = 0;
+	image[6] = LO_UINT16(len / HAL_FLASH_WORD_SIZE);
+	image[7] = HI_UINT16(len / HAL_FLASH_WORD_SIZE);
+	memcpy(image + 8, "SBND", 4);
+
+	// The CRC covers everything after the CRC and its shadow
+	crc = imageCrc(image + HAL_FLASH_WORD_SIZE, len - HAL_FLASH_WORD_SIZE);
+	image[0] = LO_UINT16(crc);
+	image[1] = HI_UINT16(crc);
+	image[2] = 0xFF;
+	image[3] = 0xFF;
+}
+
+/*
+ * The application would queue these and process them in its task; the benchmark calls
+ * straight into the profile instead.
+ */
+static void oadWriteCB(uint8_t event, uint16_t connHandle, uint8_t *pData, uint16_t len) {
+	switch (event) {
+	case OAD_WRITE_IDENTIFY_REQ:
+		OAD_imgIdentifyWrite(connHandle, pData);
+		break;
+
+	case OAD_WRITE_BLOCK_REQ:
+		OAD_imgBlockWrite(connHandle, pData, len);
+		break;
+
+	case OAD_WRITE_CONTROL_REQ:
+		OAD_imgControlWrite(connHandle, pData);
+		break;
+
+	default:
+		break;
+	}
+}
+
+static oadTargetCBs_t oadCBs = { oadWriteCB };
+
+static bool subscribe(uint16 uuid) {
+	uint8 enable[2] = { LO_UINT16(GATT_CLIENT_CFG_NOTIFY), HI_UINT16(GATT_CLIENT_CFG_NOTIFY) };
+
+	return SUCCESS == SB_emuWrite(BENCH_CONN, SB_emuFindCCCHandle(SB_emuFindHandle(uuid, 0)), enable, sizeof(enable), true);
+}
+
+/*
+ * Writes `count` blocks starting at blkNum in one Image Block write, losing every
+ * dropEvery'th write on the way
+ */
+static void writeBlocks(uint16 blkNum, uint8 count, uint32 dropEvery, BenchResult *result) {
+	uint8 value[OAD_PACKET_MAX_SIZE];
+	uint16 blockHandle = SB_emuFindHandle(OAD_IMG_BLOCK_UUID, 0);
+
+	value[0] = LO_UINT16(blkNum);
+	value[1] = HI_UINT16(blkNum);
+	memcpy(value + 2, image + blkNum * OAD_BLOCK_SIZE, count * OAD_BLOCK_SIZE);
+
+	++result->blockWrites;
+
+	if (dropEvery && 0 == result->blockWrites % dropEvery) {
+		++result->dropped;
+		return;
+	}
+
+	if (SUCCESS != SB_emuWrite(BENCH_CONN, blockHandle, value, 2 + count * OAD_BLOCK_SIZE, false)) {
+		++result->errors;
+	}
+}
+
+static void transferLegacy(const BenchConfig *config, BenchResult *result) {
+	uint16 blockHandle = SB_emuFindHandle(OAD_IMG_BLOCK_UUID, 0);
+	SB_EmuPDU pdu;
+	uint16 blkNum;
+
+	while (SB_emuReceive(BENCH_CONN, &pdu)) {
+		if (ATT_HANDLE_VALUE_NOTI != pdu.method || blockHandle != pdu.handle) {
+			continue;
+		}
+
+		blkNum = BUILD_UINT16(pdu.value[0], pdu.value[1]);
+
+		if (blkNum * OAD_BLOCK_SIZE >= config->imageBytes) {
+			++result->errors;
+			return;
+		}
+
+		SB_emuNextEvent(BENCH_CONN);
+		writeBlocks(blkNum, 1, 0, result);
+	}
+}
+
+static void transferWindowed(const BenchConfig *config, BenchResult *result) {
+	uint16 controlHandle = SB_emuFindHandle(OAD_IMG_CONTROL_UUID, 0);
+	uint16 blkNum, missing, i, lastBlk = 0;
+	uint8 count, perWrite = 1, n, lastCount = 0, retries = 0;
+	SB_EmuPDU pdu;
+
+	for (;;) {
+		if (!SB_emuReceive(BENCH_CONN, &pdu)) {
+			if (SB_emuOadStats.resetRequested || 0 == lastCount) {
+				return;
+			}
+
+			// The last write or the answer to it was lost; wait a while, then write it again
+			if (++retries > BENCH_MAX_RETRIES) {
+				++result->errors;
+				return;
+			}
+
+			for (i = 0; i < BENCH_RETRY_EVENTS; ++i) {
+				SB_emuNextEvent(BENCH_CONN);
+			}
+
+			++result->retries;
+			writeBlocks(lastBlk, lastCount, config->dropEvery, result);
+			continue;
+		}
+
+		if (ATT_HANDLE_VALUE_NOTI != pdu.method || controlHandle != pdu.handle || pdu.len != 5) {
+			continue;
+		}
+
+		blkNum = BUILD_UINT16(pdu.value[1], pdu.value[2]);
+		retries = 0;
+		SB_emuNextEvent(BENCH_CONN);
+
+		switch (pdu.value[0]) {
+		case OAD_CTRL_CREDIT:
+			count = pdu.value[3];
+			perWrite = pdu.value[4];
+
+			if (0 == count || 0 == perWrite || blkNum * OAD_BLOCK_SIZE >= config->imageBytes) {
+				++result->errors;
+				return;
+			}
+
+			for (i = 0; i < count; i += n) {
+				n = count - i < perWrite ? count - i : perWrite;
+				lastBlk = blkNum + i;
+				lastCount = n;
+				writeBlocks(lastBlk, lastCount, config->dropEvery, result);
+			}
+			break;
+
+		case OAD_CTRL_NAK:
+			missing = BUILD_UINT16(pdu.value[3], pdu.value[4]);
+			++result->naks;
+
+			for (i = 0; i < 16; i += perWrite) {
+				if (missing & (((1 << perWrite) - 1) << i)) {
+					n = (blkNum + i + perWrite) * OAD_BLOCK_SIZE > config->imageBytes
+						? config->imageBytes / OAD_BLOCK_SIZE - blkNum - i : perWrite;
+					lastBlk = blkNum + i;
+					lastCount = n;
+					writeBlocks(lastBlk, lastCount, config->dropEvery, result);
+				}
+			}
+			break;
+
+		default:
+			++result->errors;
+			return;
+		}
+	}
+}
+
+static bool runBenchmark(const BenchConfig *config, BenchResult *result) {
+	uint8 control[2] = { OAD_CTRL_WINDOWED, config->window };
+	uint8 imageCount = 1;
+	uint64_t startMs;
+
+	memset(result, 0, sizeof(*result));
+
+	SB_emuInit(1, config->intervalMs, config->pdusPerEvent);
+	SB_emuOadInit();
+
+	if (SUCCESS != OAD_addService()) {
+		fprintf(stderr, "OAD service setup failed\n");
+		return false;
+	}
+
+	OAD_register(&oadCBs);
+	buildImage(config->imageBytes);
+
+	SB_emuConnect(BENCH_CONN, config->mtu);
+	startMs = SB_emuTimeMs();
+
+	if (!subscribe(OAD_IMG_BLOCK_UUID) || !subscribe(OAD_IMG_CONTROL_UUID)) {
+		++result->errors;
+	}
+
+	// One image to expect, since the target is not reset between runs
+	if (SUCCESS != SB_emuWrite(BENCH_CONN, SB_emuFindHandle(OAD_IMG_COUNT_UUID, 0), &imageCount, 1, true)) {
+		++result->errors;
+	}
+
+	if (OAD_WINDOWED == config->mode
+			&& SUCCESS != SB_emuWrite(BENCH_CONN, SB_emuFindHandle(OAD_IMG_CONTROL_UUID, 0), control, sizeof(control), true)) {
+		++result->errors;
+	}
+
+	// Identify the image with its CRC and header
+	if (SUCCESS != SB_emuWrite(BENCH_CONN, SB_emuFindHandle(OAD_IMG_IDENTIFY_UUID, 0), image, 16, true)) {
+		++result->errors;
+	}
+
+	if (OAD_WINDOWED == config->mode) {
+		transferWindowed(config, result);
+	} else {
+		transferLegacy(config, result);
+	}
+
+	// Include the time the target spent verifying the image
+	if (SB_emuAppFreeAt() > SB_emuTicks()) {
+		SB_emuAdvanceTicks(SB_emuAppFreeAt() - SB_emuTicks());
+	}
+
+	result->timeMs = SB_emuTimeMs() - startMs;
+	result->stats = SB_emuStats;
+	result->oad = SB_emuOadStats;
+
+	SB_emuDisconnect(BENCH_CONN);
+	OAD_linkTerminated(BENCH_CONN);
+
+	return 0 == result->errors && SB_emuOadStats.resetRequested && 0 == SB_emuOadStats.overwrites
+		&& 0 == memcmp(SB_emuOadImage() + HAL_FLASH_WORD_SIZE, image + HAL_FLASH_WORD_SIZE,
+				config->imageBytes - HAL_FLASH_WORD_SIZE);
+}
+
+static void printHeader() {
+	printf("%-8s %4s %6s %5s %6s %9s %8s %7s %5s %7s %7s %11s\n",
+		"mode", "mtu", "window", "ci_ms", "kb", "time_s", "kB/s", "writes", "naks", "retries", "erases", "conn_events");
+}
+
+static void printResult(const BenchConfig *config, const BenchResult *result, bool passed) {
+	double seconds = result->timeMs / 1000.0;
+	double kb = config->imageBytes / 1024.0;
+
+	printf("%-8s %4u %6u %5u %6.0f %9.2f %8.2f %7u %5u %7u %7u %11u%s\n",
+		oadModeNames[config->mode], config->mtu, OAD_WINDOWED == config->mode ? config->window : 1,
+		config->intervalMs, kb, seconds, seconds > 0 ? kb / seconds : 0.0,
+		result->blockWrites, result->naks, result->retries, result->oad.erases, result->stats.connEvents,
+		passed ? "" : "  FAILED");
+}
+
+static void usage(const char *name) {
+	fprintf(stderr,
+		"Usage: %s [-s legacy|windowed] [-m mtu] [-w window_blocks] [-i interval_ms] [-k image_kb] [-p pdus_per_event] [-d drop_every] [-v]\n"
+		"Without -s, -m or -w legacy and every window size up to %u are run at the default (%u) and maximum (%u) ATT MTU.\n",
+		name, OAD_WINDOW_BLOCKS, ATT_MTU_SIZE, BENCH_MAX_MTU);
+}
+
+int main(int argc, char **argv) {
+	static const uint16 defaultMtus[] = { ATT_MTU_SIZE, BENCH_MAX_MTU };
+	static const uint8 defaultWindows[] = { 1, 2, 4, 8, OAD_WINDOW_BLOCKS };
+	BenchConfig config = {
+		.intervalMs = BENCH_DEFAULT_INTERVAL_MS,
+		.imageBytes = BENCH_DEFAULT_IMAGE_KB * 1024,
+		.pdusPerEvent = BENCH_DEFAULT_PDUS,
+	};
+	BenchResult result;
+	int modeFirst = 0, modeLast = OAD_NUM_MODES - 1;
+	int mtuFirst = 0, mtuLast = sizeof(defaultMtus)/sizeof(defaultMtus[0]) - 1;
+	int winFirst = 0, winLast = sizeof(defaultWindows)/sizeof(defaultWindows[0]) - 1;
+	uint16 mtuOverride = 0;
+	uint8 windowOverride = 0;
+	int opt, m, u, w, failures = 0;
+
+	while (-1 != (opt = getopt(argc, argv, "s:m:w:i:k:p:d:vh"))) {
+		switch (opt) {
+		case 's':
+			for (m = 0; m < OAD_NUM_MODES && strcmp(optarg, oadModeNames[m]); ++m);
+			if (m == OAD_NUM_MODES) {
+				usage(argv[0]);
+				return 2;
+			}
+
+			modeFirst = modeLast = m;
+			break;
+
+		case 'm':
+			mtuOverride = strtoul(optarg, NULL, 0);
+			if (mtuOverride < ATT_MTU_SIZE || mtuOverride > SB_EMU_MAX_ATT_VALUE) {
+				usage(argv[0]);
+				return 2;
+			}
+
+			mtuFirst = mtuLast = 0;
+			break;
+
+		case 'w':
+			windowOverride = strtoul(optarg, NULL, 0);
+			if (0 == windowOverride || windowOverride > OAD_WINDOW_BLOCKS) {
+				usage(argv[0]);
+				return 2;
+			}
+
+			winFirst = winLast = 0;
+			break;
+
+		case 'i':
+			config.intervalMs = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'k':
+			config.imageBytes = strtoul(optarg, NULL, 0) * 1024;
+			if (config.imageBytes < HAL_FLASH_PAGE_SIZE || config.imageBytes > sizeof(image)) {
+				usage(argv[0]);
+				return 2;
+			}
+			break;
+
+		case 'p':
+			config.pdusPerEvent = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'd':
+			config.dropEvery = strtoul(optarg, NULL, 0);
+			if (1 == config.dropEvery) {
+				usage(argv[0]);
+				return 2;
+			}
+			break;
+
+		case 'v':
+			SB_emuVerbose = true;
+			break;
+
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	printHeader();
+
+	for (m = modeFirst; m <= modeLast; ++m) {
+		for (u = mtuFirst; u <= mtuLast; ++u) {
+			for (w = winFirst; w <= winLast; ++w) {
+				bool passed;
+
+				// The window only applies to windowed transfers
+				if (OAD_LEGACY == m && w != winFirst) {
+					break;
+				}
+
+				config.mode = (OadMode)m;
+				config.mtu = mtuOverride ? mtuOverride : defaultMtus[u];
+				config.window = windowOverride ? windowOverride : defaultWindows[w];
+
+				passed = runBenchmark(&config, &result);
+				printResult(&config, &result, passed);
+
+				failures += !passed;
+			}
+		}
+	}
+
+	return failures ? 1 : 0;
+}
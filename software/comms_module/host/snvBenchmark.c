@@ -0,0 +1,235 @@
+/*
+ * snvBenchmark.c
+ *
+ * Replays the bond manager's NV traffic over many connections through the stack's NV wrapper,
+ * SmartBandageBLEStack/OSAL/osal_snv_wrapper.c, on the RAM-backed NV of emulator/osal_snv.c.
+ * gapbondmgr.c needs far more of the stack than the host has, so its NV calls are made here:
+ *
+ *  - on link establishment the bond record, sign counter and CCC table are read
+ *  - each CCC write by the peer reads the bond record and CCC table, and writes the table back
+ *  - every so often the peer bonds, writing a new bond record and its keys
+ *  - on link termination NV is compacted if it is 80% full
+ *
+ * "through" is how the bond manager ran before: every write a flash program, and compaction
+ * right on termination. "deferred" keeps CCC writes in RAM while connected, and writes them one
+ * per event after termination, with the compaction last. Bond records and keys are written
+ * through in both, so a new bond costs its programs while connected. Every read is checked against what
+ * was last written, and everything against NV when the connections are over.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bcomdef.h"
+#include "osal_snv.h"
+#include "emuSnv.h"
+
+// NV IDs, as gapbondmgr.c lays them out
+#define BENCH_BOND_REC_IDS          6
+#define BENCH_BOND_ID(idx, offset)  (BLE_NVID_GAP_BOND_START + (idx) * BENCH_BOND_REC_IDS + (offset))
+#define BENCH_CCC_ID(idx)           (BLE_NVID_GATT_CFG_START + (idx))
+
+#define BENCH_BONDINGS_MAX          10
+#define BENCH_CHAR_CFG_MAX          4
+#define BENCH_NV_COMPACT_THRESHOLD  80
+#define BENCH_MAX_ITEM_LEN          28
+
+#define BENCH_DEFAULT_CONNS         500
+#define BENCH_DEFAULT_CCC_WRITES    8
+#define BENCH_DEFAULT_BOND_EVERY    25
+
+// Items of a bond: record, local LTK, device LTK, IRK, CSRK, sign counter
+static const uint8 bondItemLen[BENCH_BOND_REC_IDS] = { 14, 28, 28, 16, 16, 4 };
+
+typedef struct {
+	uint32 programs;
+	uint32 compactions;
+} BenchPhase;
+
+typedef struct {
+	BenchPhase connected;
+	BenchPhase idle;
+	uint32 cccWrites;
+	uint32 errors;
+} BenchResult;
+
+// What NV should hold
+static struct {
+	uint8 len[0x100];
+	uint8 data[0x100][BENCH_MAX_ITEM_LEN];
+} expected;
+
+static uint32 rngState;
+
+/*********************************************************************
+ * What the NV wrapper needs from OSAL
+ */
+void *osal_memcpy(void *dst, const void *src, unsigned int len) {
+	return memcpy(dst, src, len);
+}
+
+void *osal_memset(void *dest, uint8 value, int len) {
+	return memset(dest, value, len);
+}
+
+/*********************************************************************
+ * The run
+ */
+static uint32 rand32() {
+	rngState = rngState * 1103515245 + 12345;
+	return rngState >> 8;
+}
+
+static void writeItem(BenchResult *result, uint8 id, uint8 len, const uint8 *buf) {
+	memcpy(expected.data[id], buf, len);
+	expected.len[id] = len;
+
+	if (SUCCESS != osal_snv_write(id, len, (void *)buf)) {
+		++result->errors;
+	}
+}
+
+static void readItem(BenchResult *result, uint8 id, uint8 *buf) {
+	if (SUCCESS != osal_snv_read(id, expected.len[id], buf) || 0 != memcmp(buf, expected.data[id], expected.len[id])) {
+		++result->errors;
+	}
+}
+
+static void bond(BenchResult *result, uint8 idx) {
+	uint8 buf[BENCH_MAX_ITEM_LEN];
+	uint8 offset, i;
+
+	for (offset = 0; offset < BENCH_BOND_REC_IDS; ++offset) {
+		for (i = 0; i < bondItemLen[offset]; ++i) {
+			buf[i] = rand32();
+		}
+		writeItem(result, BENCH_BOND_ID(idx, offset), bondItemLen[offset], buf);
+	}
+
+	memset(buf, 0xFF, 4 * BENCH_CHAR_CFG_MAX);
+	writeItem(result, BENCH_CCC_ID(idx), 4 * BENCH_CHAR_CFG_MAX, buf);
+}
+
+static void phase(BenchPhase *phase, const SB_EmuSnvStats *before) {
+	phase->programs += SB_emuSnvStats.programs - before->programs;
+	phase->compactions += SB_emuSnvStats.compactions - before->compactions;
+}
+
+static void run(uint8 defer, uint32 conns, uint32 cccWrites, uint32 bondEvery, BenchResult *result) {
+	uint8 buf[BENCH_MAX_ITEM_LEN];
+	SB_EmuSnvStats before;
+	uint32 conn, k;
+	uint16 id;
+	uint8 idx, bonds = 0;
+
+	rngState = 0x5B4D0001;
+	memset(&expected, 0, sizeof(expected));
+	memset(result, 0, sizeof(BenchResult));
+	osal_snv_init();
+
+	for (conn = 0; conn < conns; ++conn) {
+		before = SB_emuSnvStats;
+
+		// GAPBondMgr_LinkEst()
+		if (defer) {
+			osal_snv_defer(TRUE);
+		}
+
+		if (0 == bonds || 0 == conn % bondEvery) {
+			idx = bonds < BENCH_BONDINGS_MAX ? bonds++ : rand32() % BENCH_BONDINGS_MAX;
+			bond(result, idx);
+		} else {
+			idx = rand32() % bonds;
+			readItem(result, BENCH_BOND_ID(idx, 0), buf);
+			readItem(result, BENCH_BOND_ID(idx, 5), buf);
+			readItem(result, BENCH_CCC_ID(idx), buf);
+		}
+
+		// gapBondMgrUpdateCharCfg(), for CCC writes that change the value
+		for (k = 0; k < cccWrites; ++k) {
+			uint8 entry = rand32() % BENCH_CHAR_CFG_MAX;
+
+			readItem(result, BENCH_BOND_ID(idx, 0), buf);
+			readItem(result, BENCH_CCC_ID(idx), buf);
+
+			buf[4 * entry] = entry;
+			buf[4 * entry + 1] = 0;
+			buf[4 * entry + 2] ^= 1;
+			writeItem(result, BENCH_CCC_ID(idx), 4 * BENCH_CHAR_CFG_MAX, buf);
+		}
+
+		result->cccWrites += cccWrites;
+		phase(&result->connected, &before);
+
+		// GAPBondMgr_LinkTerm(), and the GAP_BOND_NV_IDLE_EVT events that follow
+		before = SB_emuSnvStats;
+
+		if (defer) {
+			osal_snv_defer(FALSE);
+			while (osal_snv_flush(1) > 0);
+		}
+		osal_snv_compact(BENCH_NV_COMPACT_THRESHOLD);
+
+		phase(&result->idle, &before);
+	}
+
+	for (id = 0; id < 0x100; ++id) {
+		if (expected.len[id]) {
+			readItem(result, id, buf);
+		}
+	}
+}
+
+static void usage(const char *name) {
+	fprintf(stderr, "Usage: %s [-c connections] [-w CCC writes per connection] [-b connections per new bond]\n",
+			name);
+}
+
+int main(int argc, char **argv) {
+	static const char *modes[] = { "through", "deferred" };
+	uint32 conns = BENCH_DEFAULT_CONNS, cccWrites = BENCH_DEFAULT_CCC_WRITES, bondEvery = BENCH_DEFAULT_BOND_EVERY;
+	BenchResult result;
+	int opt, k, failures = 0;
+
+	while (-1 != (opt = getopt(argc, argv, "c:w:b:h"))) {
+		switch (opt) {
+		case 'c':
+			conns = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'w':
+			cccWrites = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'b':
+			bondEvery = strtoul(optarg, NULL, 0);
+			break;
+
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	if (0 == conns || 0 == bondEvery) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	printf("%-9s %6s %10s %13s %13s %10s %10s\n", "mode", "conns", "ccc_writes", "conn_programs",
+			"conn_compacts", "idle_progs", "idle_cmpct");
+
+	for (k = 0; k < 2; ++k) {
+		run(k, conns, cccWrites, bondEvery, &result);
+
+		printf("%-9s %6u %10u %13u %13u %10u %10u%s\n", modes[k], conns, result.cccWrites,
+				result.connected.programs, result.connected.compactions,
+				result.idle.programs, result.idle.compactions, result.errors ? "  FAILED" : "");
+
+		failures += result.errors > 0;
+	}
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,675 @@
+/*
+ * syncBenchmark.c
+ *
+ * Drives the real readings path (ble.c, readingsManager.c, smartBandageProfile.c) with a
+ * scripted central on top of the emulated stack and reports how fast a backlog of stored
+ * readings can be drained.
+ *
+ *   indicate - the central subscribes to Readings and confirms each indication, reading the
+ *              rest of the value with Read Blob when it does not fit in one PDU.
+ *   poll     - the central long-reads Readings and acknowledges each batch by writing
+ *              ReadingCount (write without response).
+ *   rejoin   - the gateway (indicate) leaves a third of the way through the backlog, a phone
+ *              (poll) drains it all, then the gateway comes back with a new private address
+ *              and must get the rest.
+ *   handover - the gateway (poll) acknowledges a batch and leaves, and the phone connects on
+ *              the same connection handle, all before the app task runs. The acknowledgement
+ *              must not be taken as the phone's. The phone drains the backlog, then the gateway
+ *              comes back the same way and must get the rest.
+ *
+ * The peripheral takes one link, so the centrals take turns on it.
+ *
+ * Every reading carries its sequence number so that lost, duplicated or reordered readings
+ * make the run fail.
+ *
+ * Then the S_TRANSMIT loop of peripheralManager.c is replayed with a polling central that
+ * connects after a short wait, drains the backlog and leaves, once running to the end of the
+ * window and once leaving as soon as the backlog is drained. Readings are held back for a
+ * gateway that left before the window, which must not keep the window open. Each run reports the time spent
+ * in the state (PMGR.lastTransmitTicks) and the time the radio was on.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <ti/sysbios/knl/Clock.h>
+
+#include "bcomdef.h"
+#include "ICallPool.h"
+
+#include "ble.h"
+#include "clock.h"
+#include "energy.h"
+#include "flash.h"
+#include "readingsManager.h"
+#include "smartBandageProfile.h"
+
+#include "emulator.h"
+
+#define BENCH_DEFAULT_READINGS    300
+#define BENCH_DEFAULT_PDUS        4
+#define BENCH_START_TIME          1458000000
+
+// Largest ATT MTU the stack build supports: MAX_PDU_SIZE (78) less the 4 byte L2CAP header
+#define BENCH_MAX_MTU             74
+
+// The central accepts the peripheral's preferred minimum interval (units of 1.25ms)
+#define BENCH_DEFAULT_INTERVAL_MS (DEFAULT_DESIRED_MIN_CONN_INTERVAL * 5 / 4)
+
+// The one link, and the centrals that take turns on it
+#define BENCH_CONN                0
+#define BENCH_GATEWAY             0
+#define BENCH_PHONE               1
+
+// S_TRANSMIT until the central connects
+#define BENCH_ADVERTISE_MS        500
+
+typedef enum {
+	SYNC_INDICATE,
+	SYNC_POLL,
+	SYNC_REJOIN,
+	SYNC_HANDOVER,
+	SYNC_NUM_MODES
+} SyncMode;
+
+static const char *syncModeNames[SYNC_NUM_MODES] = { "indicate", "poll", "rejoin", "handover" };
+
+typedef struct {
+	SyncMode mode;
+	uint16 mtu;
+	uint16 intervalMs;
+	uint32 numReadings;
+	uint8 pdusPerEvent;
+} BenchConfig;
+
+typedef struct {
+	uint32 received;
+	uint32 nextSequence;
+	uint32 errors;
+} BenchCentral;
+
+typedef struct {
+	uint32 received;
+	uint32 errors;
+	uint64_t timeMs;
+	SB_EmuStats stats;
+} BenchResult;
+
+typedef struct {
+	uint32 received;
+	uint32 errors;
+	uint32 transmitMs;
+	uint32 radioMs;
+} TransmitResult;
+
+static void fillReading(uint32 sequence, SB_PeripheralReadings *reading) {
+	uint8 i;
+
+	memset(reading, 0, sizeof(*reading));
+
+	reading->temperatures[0] = (uint16)sequence;
+	for (i = 1; i < SB_NUM_TEMPERATURE; ++i) {
+		reading->temperatures[i] = 3000 + i;
+	}
+
+	reading->humidities[0] = (uint16)(sequence >> 16);
+	for (i = 0; i < SB_NUM_MOISTURE; ++i) {
+		reading->moistures[i] = (uint16)(sequence + i);
+	}
+
+	reading->timeDiff = 60000;
+}
+
+/*
+ * Consumes one Readings value and returns the number of readings it carried
+ */
+static uint8 consumeReadings(const uint8 *value, uint16 len, BenchCentral *result) {
+	const SB_PeripheralReadings *readings = (const SB_PeripheralReadings *)(value + SB_BLE_READINGREFTIMESTAMP_LEN);
+	uint8 i, count = 0;
+
+	if (len < SB_BLE_READINGS_LEN) {
+		++result->errors;
+		return 0;
+	}
+
+	for (i = 0; i < READINGS_MANAGER_THRESHOLD; ++i) {
+		// Unused slots are zeroed, and a valid reading never has a zero time difference
+		if (0 == readings[i].timeDiff) {
+			continue;
+		}
+
+		if (readings[i].temperatures[0] != (uint16)result->nextSequence
+				|| readings[i].moistures[0] != (uint16)result->nextSequence) {
+			++result->errors;
+		}
+
+		++result->nextSequence;
+		++count;
+	}
+
+	result->received += count;
+
+	return count;
+}
+
+static bool setupDevice(const BenchConfig *config) {
+	SB_PeripheralReadings reading;
+	uint32 i;
+
+	SB_emuInit(1, config->intervalMs, config->pdusPerEvent);
+
+	SB_clockInit();
+	SB_clockSetTime(BENCH_START_TIME);
+
+	if (NoError != SB_flashInit(sizeof(SB_PeripheralReadings), true)) {
+		return false;
+	}
+
+	SimpleBLEPeripheral_init();
+
+	if (NoError != SB_readingsManagerInit()) {
+		return false;
+	}
+
+	for (i = 0; i < config->numReadings; ++i) {
+		fillReading(i, &reading);
+
+		if (NoError != SB_flashWriteReadings(&reading)) {
+			return false;
+		}
+	}
+
+	// Same sequence as the start of S_TRANSMIT
+	SB_setClearReadingsMode(true);
+	SB_readingsWindowOpened();
+	SB_newReadingsAvailable();
+	SB_enableBLE();
+	SB_emuRunApp();
+
+	return true;
+}
+
+static bool subscribeIndicate(uint16 conn, BenchCentral *central) {
+	uint8 enable[2] = { LO_UINT16(GATT_CLIENT_CFG_INDICATE), HI_UINT16(GATT_CLIENT_CFG_INDICATE) };
+	uint16 readingsHandle = SB_emuFindHandle(SB_BLE_READINGS_UUID, 0);
+
+	if (SUCCESS != SB_emuWrite(conn, SB_emuFindCCCHandle(readingsHandle), enable, sizeof(enable), true)) {
+		++central->errors;
+		return false;
+	}
+
+	SB_emuRunApp();
+
+	return true;
+}
+
+/*
+ * Handles the next indication queued for the central. Returns false once none is left.
+ */
+static bool indicateStep(uint16 conn, BenchCentral *central) {
+	uint8 value[SB_EMU_MAX_ATT_VALUE];
+	uint16 readingsHandle = SB_emuFindHandle(SB_BLE_READINGS_UUID, 0);
+	uint16 len, partLen;
+	SB_EmuPDU pdu;
+
+	do {
+		if (!SB_emuReceive(conn, &pdu)) {
+			return false;
+		}
+	} while (ATT_HANDLE_VALUE_IND != pdu.method || readingsHandle != pdu.handle);
+
+	// Fetch whatever did not fit in the indication before confirming it, since the
+	// confirmation makes the peripheral load the next batch into the same value
+	memcpy(value, pdu.value, pdu.len);
+	for (len = pdu.len; len < SB_BLE_READINGS_LEN; len += partLen) {
+		if (SUCCESS != SB_emuRead(conn, readingsHandle, len, value + len, &partLen) || 0 == partLen) {
+			break;
+		}
+	}
+
+	consumeReadings(value, len, central);
+
+	SB_emuConfirm(conn);
+	SB_emuRunApp();
+
+	return true;
+}
+
+/*
+ * Reads and acknowledges the central's current batch. Returns false once it is empty.
+ */
+static bool pollStep(uint16 conn, BenchCentral *central) {
+	uint8 value[SB_EMU_MAX_ATT_VALUE];
+	uint8 count[SB_BLE_READINGCOUNT_LEN] = { 0 };
+	uint16 readingsHandle = SB_emuFindHandle(SB_BLE_READINGS_UUID, 0);
+	uint16 countHandle = SB_emuFindHandle(SB_BLE_READINGCOUNT_UUID, 0);
+	uint16 len;
+
+	if (SUCCESS != SB_emuReadLong(conn, readingsHandle, value, sizeof(value), &len)) {
+		++central->errors;
+		return false;
+	}
+
+	if (0 == consumeReadings(value, len, central)) {
+		return false;
+	}
+
+	SB_emuWrite(conn, countHandle, count, sizeof(count), false);
+	SB_emuRunApp();
+
+	return true;
+}
+
+static void syncIndicate(const BenchConfig *config, BenchCentral *central) {
+	if (subscribeIndicate(BENCH_CONN, central)) {
+		while (indicateStep(BENCH_CONN, central));
+	}
+}
+
+static void syncPoll(const BenchConfig *config, BenchCentral *central) {
+	uint8 count[SB_BLE_READINGCOUNT_LEN];
+	uint16 countHandle = SB_emuFindHandle(SB_BLE_READINGCOUNT_UUID, 0);
+	uint16 len;
+	uint32 batches = 0;
+
+	if (SUCCESS != SB_emuRead(BENCH_CONN, countHandle, 0, count, &len)) {
+		++central->errors;
+		return;
+	}
+
+	while (batches++ <= config->numReadings && pollStep(BENCH_CONN, central));
+}
+
+/*
+ * The readings the gateway has not acknowledged must be held for it while it is away, however
+ * far the phone gets
+ */
+static void syncRejoin(const BenchConfig *config, BenchCentral *gateway, BenchCentral *phone) {
+	uint32 steps = 0;
+
+	if (subscribeIndicate(BENCH_CONN, gateway)) {
+		while (gateway->received < config->numReadings / 3 && indicateStep(BENCH_CONN, gateway));
+	}
+
+	SB_emuDisconnect(BENCH_CONN);
+	SB_emuRunApp();
+
+	// A new central starts at the oldest reading still stored: the first the gateway has not had
+	phone->nextSequence = gateway->received;
+
+	SB_emuConnectPeer(BENCH_CONN, config->mtu, BENCH_PHONE);
+	SB_emuRunApp();
+
+	while (steps++ <= config->numReadings && pollStep(BENCH_CONN, phone));
+
+	SB_emuDisconnect(BENCH_CONN);
+	SB_emuRunApp();
+
+	if (phone->received != config->numReadings - gateway->received
+			|| SB_flashReadingCount() != config->numReadings - gateway->received) {
+		++phone->errors;
+	}
+
+	// The gateway is the same bonded central, whatever address it comes back with
+	SB_emuConnectPeer(BENCH_CONN, config->mtu, BENCH_GATEWAY);
+	SB_emuRunApp();
+
+	if (subscribeIndicate(BENCH_CONN, gateway)) {
+		while (indicateStep(BENCH_CONN, gateway));
+	}
+}
+
+/*
+ * Events from the gateway's last link must be handled against the gateway, even when the phone
+ * already has the link's handle by the time the app task gets to them
+ */
+static void syncHandover(const BenchConfig *config, BenchCentral *gateway, BenchCentral *phone) {
+	uint8 value[SB_EMU_MAX_ATT_VALUE];
+	uint8 count[SB_BLE_READINGCOUNT_LEN] = { 0 };
+	uint16 readingsHandle = SB_emuFindHandle(SB_BLE_READINGS_UUID, 0);
+	uint16 countHandle = SB_emuFindHandle(SB_BLE_READINGCOUNT_UUID, 0);
+	uint32 steps = 0;
+	uint16 len;
+
+	while (gateway->received < config->numReadings / 3 && pollStep(BENCH_CONN, gateway));
+
+	// The last batch is acknowledged right before the link drops
+	if (SUCCESS != SB_emuReadLong(BENCH_CONN, readingsHandle, value, sizeof(value), &len)) {
+		++gateway->errors;
+	}
+
+	consumeReadings(value, len, gateway);
+	SB_emuWrite(BENCH_CONN, countHandle, count, sizeof(count), false);
+	SB_emuDisconnect(BENCH_CONN);
+	SB_emuConnectPeer(BENCH_CONN, config->mtu, BENCH_PHONE);
+	SB_emuRunApp();
+
+	// The phone starts at the first reading the gateway has not acknowledged
+	phone->nextSequence = gateway->received;
+
+	while (steps++ <= config->numReadings && pollStep(BENCH_CONN, phone));
+
+	// What the gateway has not had is still held for it
+	if (phone->received != config->numReadings - gateway->received
+			|| SB_flashReadingCount() != config->numReadings - gateway->received) {
+		++phone->errors;
+	}
+
+	// Then the gateway takes the handle back and gets the rest
+	SB_emuDisconnect(BENCH_CONN);
+	SB_emuConnectPeer(BENCH_CONN, config->mtu, BENCH_GATEWAY);
+	SB_emuRunApp();
+
+	steps = 0;
+	while (steps++ <= config->numReadings && pollStep(BENCH_CONN, gateway));
+}
+
+static bool runBenchmark(const BenchConfig *config, BenchResult *result) {
+	BenchCentral gateway, phone;
+	uint64_t startMs;
+
+	memset(result, 0, sizeof(*result));
+	memset(&gateway, 0, sizeof(gateway));
+	memset(&phone, 0, sizeof(phone));
+
+	if (!setupDevice(config)) {
+		fprintf(stderr, "Device setup failed\n");
+		return false;
+	}
+
+	SB_emuResetStats();
+	startMs = SB_emuTimeMs();
+
+	SB_emuConnect(BENCH_CONN, config->mtu);
+	SB_emuRunApp();
+
+	switch (config->mode) {
+	case SYNC_INDICATE:
+		syncIndicate(config, &gateway);
+		break;
+
+	case SYNC_POLL:
+		syncPoll(config, &gateway);
+		break;
+
+	case SYNC_REJOIN:
+		syncRejoin(config, &gateway, &phone);
+		break;
+
+	case SYNC_HANDOVER:
+		syncHandover(config, &gateway, &phone);
+		break;
+
+	default:
+		break;
+	}
+
+	result->timeMs = SB_emuTimeMs() - startMs;
+	result->stats = SB_emuStats;
+	result->received = gateway.received;
+	result->errors = gateway.errors + phone.errors;
+
+	SB_emuDisconnect(BENCH_CONN);
+	SB_emuRunApp();
+
+	return 0 == result->errors && result->received == config->numReadings
+		&& SB_readingsBacklogDrained();
+}
+
+/*
+ * The central's next move in S_TRANSMIT, standing in for the BLE messages the state waits for.
+ * Returns false if it has nothing to do before connectAt, or at all once it has left.
+ */
+static bool transmitCentralStep(uint16 mtu, uint64_t connectAt, bool *joined, BenchCentral *central) {
+	if (!*joined) {
+		if (SB_emuTicks() < connectAt) {
+			return false;
+		}
+
+		SB_emuConnectPeer(BENCH_CONN, mtu, BENCH_PHONE);
+		SB_emuRunApp();
+		*joined = true;
+
+		return true;
+	}
+
+	if (!SB_emuConnected(BENCH_CONN)) {
+		return false;
+	}
+
+	if (!pollStep(BENCH_CONN, central)) {
+		SB_emuDisconnect(BENCH_CONN);
+		SB_emuRunApp();
+	}
+
+	return true;
+}
+
+/*
+ * The S_TRANSMIT loop of peripheralManager.c. Without earlyExit it runs to the deadline even
+ * once the central has drained the backlog and left, as it did before the early exit.
+ */
+static bool runTransmit(const BenchConfig *config, bool earlyExit, TransmitResult *result) {
+	BenchConfig pollConfig = *config;
+	BenchCentral central;
+	SB_EnergyHour hour;
+	uint64_t connectAt;
+	uint32_t startTime, deadline;
+	bool joined = false, wasConnected = false;
+
+	memset(result, 0, sizeof(*result));
+	memset(&central, 0, sizeof(central));
+
+	pollConfig.mode = SYNC_POLL;
+	if (!setupDevice(&pollConfig)) {
+		fprintf(stderr, "Device setup failed\n");
+		return false;
+	}
+
+	// A gateway came by in an earlier window and left without taking anything, so every
+	// reading is held for it
+	SB_emuConnectPeer(BENCH_CONN, config->mtu, BENCH_GATEWAY);
+	SB_emuRunApp();
+	SB_emuDisconnect(BENCH_CONN);
+	SB_emuRunApp();
+	SB_readingsWindowOpened();
+
+	// The radio has been on since setupDevice() started advertising, as from SB_enableBLE()
+	SB_energyInit();
+
+	startTime = Clock_getTicks();
+	connectAt = SB_emuTicks() + BENCH_ADVERTISE_MS * (NTICKS_PER_MILLSECOND);
+	deadline = startTime + NTICKS_PER_SECOND * SB_GlobalDeviceConfiguration.MaxTransmitStateTimeS;
+	forever {
+		uint32_t now = Clock_getTicks();
+		uint32_t wait = deadline - now;
+
+		if ((int32_t)(deadline - now) <= 0) {
+			break;
+		}
+
+		if (earlyExit && wasConnected && !SB_bleConnected() && SB_readingsBacklogDrained()) {
+			break;
+		}
+
+		if (!transmitCentralStep(config->mtu, connectAt, &joined, &central)) {
+			// Nothing happens until the central connects or the deadline passes
+			if (!joined && connectAt - SB_emuTicks() < wait) {
+				wait = connectAt - SB_emuTicks();
+			}
+
+			ICall_wait(wait / (NTICKS_PER_MILLSECOND) + 1);
+		} else if (SB_bleConnected()) {
+			wasConnected = true;
+
+			now = Clock_getTicks();
+			if ((int32_t)(now + SB_TRANSMIT_CONN_EXTEND_PERIOD - deadline) > 0) {
+				deadline = now + SB_TRANSMIT_CONN_EXTEND_PERIOD;
+			}
+		}
+	}
+
+	SB_setClearReadingsMode(false);
+	SB_disableBLE();
+	SB_emuRunApp();
+
+	result->transmitMs = (Clock_getTicks() - startTime) / (NTICKS_PER_MILLSECOND);
+	SB_energyGetHours(&hour, 1);
+	result->radioMs = hour.loadMs[SB_LOAD_RADIO];
+	result->received = central.received;
+	result->errors = central.errors;
+
+	return 0 == result->errors && result->received == config->numReadings && SB_readingsBacklogDrained()
+		&& SB_flashReadingCount() == config->numReadings;
+}
+
+static void printHeader() {
+	printf("%-8s %4s %8s %8s %8s %9s %10s %7s %11s %11s\n",
+		"mode", "mtu", "ci_ms", "readings", "received", "time_s", "readings/s", "att_ops", "ops/reading", "conn_events");
+}
+
+static void printResult(const BenchConfig *config, const BenchResult *result, bool passed) {
+	const SB_EmuStats *s = &result->stats;
+	uint32 ops = s->reads + s->readBlobs + s->writes + s->writeCmds
+		+ s->notifications + s->indications + s->mtuExchanges;
+	double seconds = result->timeMs / 1000.0;
+
+	printf("%-8s %4u %8u %8u %8u %9.2f %10.2f %7u %11.2f %11u%s\n",
+		syncModeNames[config->mode], config->mtu, config->intervalMs, config->numReadings,
+		result->received, seconds,
+		seconds > 0 ? result->received / seconds : 0.0,
+		ops, result->received ? (double)ops / result->received : 0.0,
+		s->connEvents, passed ? "" : "  FAILED");
+}
+
+// Time in S_TRANSMIT and radio on time with a fixed window against leaving once drained
+static int runTransmitComparison(const BenchConfig *config) {
+	static const char *exitNames[] = { "window", "drained" };
+	TransmitResult results[2];
+	int failures = 0, i;
+
+	printf("\n%-8s %8s %8s %11s %8s\n", "transmit", "readings", "received", "transmit_ms", "radio_ms");
+	for (i = 0; i < 2; ++i) {
+		bool passed = runTransmit(config, 1 == i, &results[i]);
+
+		// Leaving early must cut the window short, and may never keep the radio on for longer
+		passed = passed && (0 == i || (results[i].transmitMs < results[0].transmitMs
+			&& results[i].radioMs <= results[0].radioMs));
+
+		printf("%-8s %8u %8u %11u %8u%s\n", exitNames[i], config->numReadings, results[i].received,
+			results[i].transmitMs, results[i].radioMs, passed ? "" : "  FAILED");
+
+		failures += !passed;
+	}
+
+	return failures;
+}
+
+// Peak use of the ICall message pools over every run, as read from the Memory Stats characteristic
+static void printPoolUsage() {
+	ICall_PoolUsage usage;
+	int i;
+
+	ICall_poolGetUsage(&usage);
+
+	printf("\n%-8s %6s %10s %8s\n", "pool", "blocks", "high_water", "failures");
+	for (i = 0; i < ICALL_POOL_NUM; ++i) {
+		printf("%-8u %6u %10u %8u\n", usage.pools[i].blockSize, usage.pools[i].blocks,
+			usage.pools[i].highWater, usage.pools[i].failures);
+	}
+	printf("heap allocations %u, failures %u\n", usage.heapAllocs, usage.heapFailures);
+}
+
+static void usage(const char *name) {
+	fprintf(stderr,
+		"Usage: %s [-s indicate|poll|rejoin|handover] [-m mtu] [-i interval_ms] [-n readings] [-p pdus_per_event] [-v]\n"
+		"Without -s or -m every mode is run at the default (%u) and maximum (%u) ATT MTU.\n",
+		name, ATT_MTU_SIZE, BENCH_MAX_MTU);
+}
+
+int main(int argc, char **argv) {
+	static const uint16 defaultMtus[] = { ATT_MTU_SIZE, BENCH_MAX_MTU };
+	BenchConfig config = {
+		.intervalMs = BENCH_DEFAULT_INTERVAL_MS,
+		.numReadings = BENCH_DEFAULT_READINGS,
+		.pdusPerEvent = BENCH_DEFAULT_PDUS,
+	};
+	BenchResult result;
+	int modeFirst = 0, modeLast = SYNC_NUM_MODES - 1;
+	int mtuFirst = 0, mtuLast = sizeof(defaultMtus)/sizeof(defaultMtus[0]) - 1;
+	uint16 mtuOverride = 0;
+	int opt, m, u, failures = 0;
+
+	while (-1 != (opt = getopt(argc, argv, "s:m:i:n:p:vh"))) {
+		switch (opt) {
+		case 's':
+			for (m = 0; m < SYNC_NUM_MODES && strcmp(optarg, syncModeNames[m]); ++m);
+			if (m == SYNC_NUM_MODES) {
+				usage(argv[0]);
+				return 2;
+			}
+
+			modeFirst = modeLast = m;
+			break;
+
+		case 'm':
+			mtuOverride = strtoul(optarg, NULL, 0);
+			if (mtuOverride < ATT_MTU_SIZE || mtuOverride > SB_EMU_MAX_ATT_VALUE) {
+				usage(argv[0]);
+				return 2;
+			}
+
+			mtuFirst = mtuLast = 0;
+			break;
+
+		case 'i':
+			config.intervalMs = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'n':
+			config.numReadings = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'p':
+			config.pdusPerEvent = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'v':
+			SB_emuVerbose = true;
+			break;
+
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	printHeader();
+
+	for (m = modeFirst; m <= modeLast; ++m) {
+		for (u = mtuFirst; u <= mtuLast; ++u) {
+			bool passed;
+
+			config.mode = (SyncMode)m;
+			config.mtu = mtuOverride ? mtuOverride : defaultMtus[u];
+
+			passed = runBenchmark(&config, &result);
+			printResult(&config, &result, passed);
+
+			failures += !passed;
+		}
+	}
+
+	// At the default MTU, the phone case, unless -m is given
+	config.mtu = mtuOverride ? mtuOverride : ATT_MTU_SIZE;
+	failures += runTransmitComparison(&config);
+
+	printPoolUsage();
+
+	// Every event that reached a full ring is lost, whatever the trace configuration
+	printf("app events dropped %u%s\n", SB_bleEventsDropped(), SB_bleEventsDropped() ? "  FAILED" : "");
+	failures += 0 != SB_bleEventsDropped();
+
+	return failures ? 1 : 0;
+}
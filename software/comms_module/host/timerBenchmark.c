@@ -0,0 +1,380 @@
+/*
+ * timerBenchmark.c
+ *
+ * Runs the OSAL timer service with thousands of timers against the linked list it used to
+ * keep them in. Both are driven tick by tick with the same starts, restarts and stops, and
+ * must set the same events on the same ticks and report the same next timeout.
+ *
+ * A quarter of the timers reload; the others are started again, with a new timeout, when
+ * they fire. Every tick a few timers are restarted or stopped and started again, and
+ * osal_next_timeout() is asked for the next wakeup, as osal_run_system() does.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "comdef.h"
+#include "OSAL.h"
+#include "OSAL_Timers.h"
+
+#define BENCH_DEFAULT_TIMERS      2000
+#define BENCH_DEFAULT_TICKS       10000
+#define BENCH_MAX_TIMEOUT_MS      1000
+#define BENCH_OPS_PER_TICK        4
+#define BENCH_EVENTS_PER_TASK     16
+#define BENCH_MAX_TIMERS          (0xFF * BENCH_EVENTS_PER_TASK)
+
+#define BENCH_TASK(i)             ((uint8)((i) / BENCH_EVENTS_PER_TASK))
+#define BENCH_EVENT(i)            ((uint16)(1 << ((i) % BENCH_EVENTS_PER_TASK)))
+#define BENCH_RELOADS(i)          (0 == (i) % 4)
+
+typedef struct {
+	uint8 (*start)(uint8 task_id, uint16 event_id, uint32 timeout);
+	uint8 (*startReload)(uint8 task_id, uint16 event_id, uint32 timeout);
+	uint8 (*stop)(uint8 task_id, uint16 event_id);
+	void (*update)(uint32 updateTime);
+	uint32 (*nextTimeout)(void);
+} BenchTimers;
+
+// Events set during the current tick
+static struct {
+	uint16 fired[BENCH_MAX_TIMERS];
+	uint16 count;
+} events;
+
+static uint32 rngState;
+
+/*********************************************************************
+ * What the OSAL sources need from the rest of the stack
+ */
+uint8 osal_set_event(uint8 task_id, uint16 event_flag) {
+	uint16 bit = 0;
+
+	// The list sets no event for a stopped timer it frees
+	if (0 == event_flag) {
+		return SUCCESS;
+	}
+
+	while (!(event_flag & 1 << bit)) {
+		++bit;
+	}
+
+	events.fired[events.count++] = task_id * BENCH_EVENTS_PER_TASK + bit;
+	return SUCCESS;
+}
+
+void *osal_mem_alloc(uint16 size) {
+	return malloc(size);
+}
+
+void osal_mem_free(void *ptr) {
+	free(ptr);
+}
+
+// A macro in the host OSAL.h, a function in the stack's
+#undef osal_memcpy
+void *osal_memcpy(void *dst, const void *src, unsigned int len) {
+	return memcpy(dst, src, len);
+}
+
+/*********************************************************************
+ * The timer list OSAL_Timers.c used to keep, without its 8 bit shortcut
+ */
+typedef struct ListTimer {
+	struct ListTimer *next;
+	uint32 timeout;
+	uint16 event_flag;
+	uint8 task_id;
+	uint32 reloadTimeout;
+} ListTimer;
+
+static ListTimer *listHead;
+
+static ListTimer *listFind(uint8 task_id, uint16 event_flag) {
+	ListTimer *timer;
+
+	for (timer = listHead; timer; timer = timer->next) {
+		if (timer->event_flag == event_flag && timer->task_id == task_id) {
+			break;
+		}
+	}
+
+	return timer;
+}
+
+static ListTimer *listAdd(uint8 task_id, uint16 event_flag, uint32 timeout) {
+	ListTimer *timer = listFind(task_id, event_flag), **end;
+
+	if (timer) {
+		timer->timeout = timeout;
+		return timer;
+	}
+
+	if (NULL == (timer = osal_mem_alloc(sizeof(ListTimer)))) {
+		return NULL;
+	}
+
+	timer->task_id = task_id;
+	timer->event_flag = event_flag;
+	timer->timeout = timeout;
+	timer->reloadTimeout = 0;
+	timer->next = NULL;
+
+	for (end = &listHead; *end; end = &(*end)->next);
+	*end = timer;
+
+	return timer;
+}
+
+static uint8 listStart(uint8 task_id, uint16 event_id, uint32 timeout) {
+	return listAdd(task_id, event_id, timeout) ? SUCCESS : NO_TIMER_AVAIL;
+}
+
+static uint8 listStartReload(uint8 task_id, uint16 event_id, uint32 timeout) {
+	ListTimer *timer = listAdd(task_id, event_id, timeout);
+
+	if (timer) {
+		timer->reloadTimeout = timeout;
+	}
+
+	return timer ? SUCCESS : NO_TIMER_AVAIL;
+}
+
+static uint8 listStop(uint8 task_id, uint16 event_id) {
+	ListTimer *timer = listFind(task_id, event_id);
+
+	// Deleted by the next update
+	if (timer) {
+		timer->event_flag = 0;
+	}
+
+	return timer ? SUCCESS : INVALID_EVENT_ID;
+}
+
+static void listUpdate(uint32 updateTime) {
+	ListTimer *timer = listHead, *prev = NULL, *freeTimer;
+
+	while (timer) {
+		freeTimer = NULL;
+
+		timer->timeout = timer->timeout > updateTime ? timer->timeout - updateTime : 0;
+
+		if (0 == timer->timeout && timer->reloadTimeout && timer->event_flag) {
+			osal_set_event(timer->task_id, timer->event_flag);
+			timer->timeout = timer->reloadTimeout;
+		}
+
+		if (0 == timer->timeout || 0 == timer->event_flag) {
+			if (NULL == prev) {
+				listHead = timer->next;
+			} else {
+				prev->next = timer->next;
+			}
+
+			freeTimer = timer;
+		} else {
+			prev = timer;
+		}
+
+		timer = timer->next;
+
+		if (freeTimer) {
+			if (0 == freeTimer->timeout) {
+				osal_set_event(freeTimer->task_id, freeTimer->event_flag);
+			}
+
+			osal_mem_free(freeTimer);
+		}
+	}
+}
+
+/*
+ * The list also took timers stopped since the last update into account, waking early for
+ * nothing. Only running timers are compared.
+ */
+static uint32 listNextTimeout(void) {
+	ListTimer *timer;
+	uint32 next = 0;
+
+	for (timer = listHead; timer; timer = timer->next) {
+		if (timer->event_flag && (0 == next || timer->timeout < next)) {
+			next = timer->timeout;
+		}
+	}
+
+	return next;
+}
+
+/*********************************************************************
+ * The run
+ */
+static uint32 rand32() {
+	rngState = rngState * 1103515245 + 12345;
+	return rngState >> 8;
+}
+
+/*
+ * Timer i's timeout when started on tick. The events of a tick are set in a different order
+ * by each implementation, so the timeouts cannot be drawn in that order.
+ */
+static uint32 timeoutFor(uint16 i, uint32 tick) {
+	uint32 x = (i + 1) * 2654435761U ^ (tick + 1) * 40503U;
+
+	x ^= x >> 15;
+	x *= 0x2C1B3C6D;
+	x ^= x >> 12;
+
+	return 1 + x % BENCH_MAX_TIMEOUT_MS;
+}
+
+static double nowNs() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static uint8 startTimer(const BenchTimers *timers, uint16 i, uint32 tick) {
+	if (BENCH_RELOADS(i)) {
+		return timers->startReload(BENCH_TASK(i), BENCH_EVENT(i), timeoutFor(i, tick));
+	}
+
+	return timers->start(BENCH_TASK(i), BENCH_EVENT(i), timeoutFor(i, tick));
+}
+
+/*
+ * Runs the timers for ticks ms. Each tick's events and next timeout are folded into
+ * digest[tick], in an order independent way.
+ *
+ * Returns the time taken in ns, or a negative number if a timer could not be started.
+ */
+static double run(const BenchTimers *timers, uint16 n, uint32 ticks, uint32 *digest, uint32 *fired) {
+	double start;
+	uint32 tick, sum;
+	uint16 i, k;
+
+	rngState = 0x5B4D0001;
+	*fired = 0;
+
+	start = nowNs();
+
+	for (i = 0; i < n; ++i) {
+		if (SUCCESS != startTimer(timers, i, 0)) {
+			return -1;
+		}
+	}
+
+	for (tick = 0; tick < ticks; ++tick) {
+		events.count = 0;
+		timers->update(1);
+
+		sum = 0;
+		for (k = 0; k < events.count; ++k) {
+			i = events.fired[k];
+			sum += (i + 1) * 2654435761U;
+
+			// One shot timers are started again
+			if (!BENCH_RELOADS(i) && SUCCESS != startTimer(timers, i, tick)) {
+				return -1;
+			}
+		}
+
+		*fired += events.count;
+
+		// Restart some timers early, stop and start some others
+		for (k = 0; k < BENCH_OPS_PER_TICK; ++k) {
+			i = rand32() % n;
+
+			if (rand32() & 1) {
+				timers->stop(BENCH_TASK(i), BENCH_EVENT(i));
+			}
+
+			if (SUCCESS != startTimer(timers, i, tick)) {
+				return -1;
+			}
+		}
+
+		digest[tick] = sum ^ events.count << 24 ^ timers->nextTimeout();
+	}
+
+	// Leave no timers behind
+	for (i = 0; i < n; ++i) {
+		timers->stop(BENCH_TASK(i), BENCH_EVENT(i));
+	}
+	timers->update(1);
+
+	return nowNs() - start;
+}
+
+static void usage(const char *name) {
+	fprintf(stderr, "Usage: %s [-n timers (at most %u)] [-d ticks]\n", name, BENCH_MAX_TIMERS);
+}
+
+int main(int argc, char **argv) {
+	static const struct {
+		const char *name;
+		BenchTimers timers;
+	} impls[] = {
+		{ "list", { listStart, listStartReload, listStop, listUpdate, listNextTimeout } },
+		{ "heap", { osal_start_timerEx, osal_start_reload_timer, osal_stop_timerEx, osalTimerUpdate, osal_next_timeout } },
+	};
+	uint32 n = BENCH_DEFAULT_TIMERS, ticks = BENCH_DEFAULT_TICKS, fired, tick;
+	uint32 *digest[2];
+	double ns, baseNs = 0;
+	int opt, k, failures = 0;
+
+	while (-1 != (opt = getopt(argc, argv, "n:d:h"))) {
+		switch (opt) {
+		case 'n':
+			n = strtoul(optarg, NULL, 0);
+			if (0 == n || n > BENCH_MAX_TIMERS) {
+				usage(argv[0]);
+				return 2;
+			}
+			break;
+
+		case 'd':
+			ticks = strtoul(optarg, NULL, 0);
+			if (0 == ticks) {
+				usage(argv[0]);
+				return 2;
+			}
+			break;
+
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	osalTimerInit();
+
+	printf("%-6s %7s %7s %9s %10s %8s\n", "timers", "n", "ticks", "fired", "ns/tick", "speedup");
+
+	for (k = 0; k < 2; ++k) {
+		digest[k] = calloc(ticks, sizeof(uint32));
+		ns = run(&impls[k].timers, n, ticks, digest[k], &fired);
+
+		if (ns < 0) {
+			printf("%-6s %7u  could not start a timer  FAILED\n", impls[k].name, n);
+			++failures;
+			continue;
+		}
+
+		if (0 == k) {
+			baseNs = ns;
+		}
+
+		for (tick = 0; k > 0 && tick < ticks && digest[k][tick] == digest[0][tick]; ++tick);
+
+		printf("%-6s %7u %7u %9u %10.1f %7.1fx%s\n",
+			impls[k].name, n, ticks, fired, ns / ticks, baseNs / ns,
+			k > 0 && tick < ticks ? "  FAILED" : "");
+
+		failures += k > 0 && tick < ticks;
+	}
+
+	return failures ? 1 : 0;
+}
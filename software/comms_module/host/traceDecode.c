@@ -0,0 +1,402 @@
+/*
+ * traceDecode.c
+ *
+ * Turns trace records back into text with the messages in traceEvents.h. Times are shown from
+ * the first record, in ms; the clock ticks in a record wrap every 12 hours or so, which is fine as
+ * long as no two records are further apart than that.
+ *
+ * With -f, the records are read from a file of hex bytes as copied from a BLE client off the Trace
+ * characteristic. With -b, they are read from a binary capture of the UART, which may start or
+ * break off in the middle of a record; the decoder skips ahead to the next sync marker.
+ *
+ * Otherwise checks the firmware side: events are written through the SB_TRACEn macros, the ring is
+ * overrun and the clock wraps, everything is read back and acknowledged over the emulated link
+ * and must decode to what was written. Also times a record against formatting the same message with snprintf. -o
+ * saves what was read in the format -f takes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bcomdef.h"
+
+#include <ti/sysbios/knl/Clock.h>
+
+#include "ble.h"
+#include "flash.h"
+#include "fsm.h"
+#include "readingsManager.h"
+#include "smartBandageProfile.h"
+#include "trace.h"
+
+#include "emulator.h"
+#include "hexFile.h"
+
+#define BENCH_MAX_BYTES           16384
+#define BENCH_MAX_RECORDS         (BENCH_MAX_BYTES / 8)
+#define BENCH_TIMING_BATCHES      20000
+#define BENCH_CONN                0
+
+typedef struct {
+	uint8 event;
+	uint8 nargs;
+	uint32 ticks;
+	uint32 args[SB_TRACE_MAX_ARGS];
+} Record;
+
+#define SB_TRACE_EVENT(id, format) { #id, format },
+static const struct {
+	const char *name;
+	const char *format;
+} events[SB_NUM_TRACE_EVENTS] = {
+#include "traceEvents.h"
+};
+#undef SB_TRACE_EVENT
+
+static Record expected[BENCH_MAX_RECORDS];
+static uint32 numExpected;
+
+static uint32 getWord(const uint8 *data) {
+	return data[0] | data[1] << 8 | data[2] << 16 | (uint32)data[3] << 24;
+}
+
+/*
+ * Finds the records in data. Bytes that don't start a whole, valid record are skipped.
+ */
+static uint32 decode(const uint8 *data, uint32 len, Record *records, uint32 maxRecords, uint32 *skipped) {
+	uint32 pos = 0, n = 0, word, words, i;
+
+	*skipped = 0;
+
+	while (pos + 4 * SB_TRACE_RECORD_WORDS(0) <= len && n < maxRecords) {
+		word = getWord(&data[pos]);
+		words = SB_TRACE_RECORD_WORDS((word >> 8) & 0xFF);
+
+		if (SB_TRACE_SYNC != word >> 16 || ((word >> 8) & 0xFF) > SB_TRACE_MAX_ARGS
+				|| (word & 0xFF) >= SB_NUM_TRACE_EVENTS || pos + 4 * words > len) {
+			++pos;
+			++*skipped;
+			continue;
+		}
+
+		records[n].event = word & 0xFF;
+		records[n].nargs = (word >> 8) & 0xFF;
+		records[n].ticks = getWord(&data[pos + 4]);
+		for (i = 0; i < records[n].nargs; ++i) {
+			records[n].args[i] = getWord(&data[pos + 8 + 4 * i]);
+		}
+
+		pos += 4 * words;
+		++n;
+	}
+
+	*skipped += len - pos;
+
+	return n;
+}
+
+static void format(const Record *record, char *buf, size_t size) {
+	snprintf(buf, size, events[record->event].format, record->args[0], record->args[1], record->args[2]);
+}
+
+static void printRecords(const Record *records, uint32 n) {
+	uint64_t elapsed = 0;
+	char text[160];
+	uint32 i;
+
+	for (i = 0; i < n; ++i) {
+		if (i) {
+			elapsed += (uint32)(records[i].ticks - records[i - 1].ticks);
+		}
+
+		format(&records[i], text, sizeof(text));
+		printf("%12.2f  %s\n", elapsed / (double)(NTICKS_PER_MILLSECOND), text);
+	}
+}
+
+static bool readBinaryFile(const char *path, uint8 *data, uint32 maxLen, uint32 *len) {
+	FILE *file = strcmp(path, "-") ? fopen(path, "rb") : stdin;
+
+	if (NULL == file) {
+		perror(path);
+		return false;
+	}
+
+	*len = fread(data, 1, maxLen, file);
+
+	if (stdin != file) {
+		fclose(file);
+	}
+
+	return true;
+}
+
+/*
+ * Self check
+ */
+static void expect(SB_TraceEvent event, uint8 nargs, uint32 a0, uint32 a1, uint32 a2) {
+	Record *record = &expected[numExpected++];
+
+	record->event = event;
+	record->nargs = nargs;
+	record->ticks = Clock_getTicks();
+	record->args[0] = a0;
+	record->args[1] = a1;
+	record->args[2] = a2;
+}
+
+#define TRACE0(event)				do { SB_TRACE0(event); expect(event, 0, 0, 0, 0); } while (0)
+#define TRACE1(event, a0)			do { SB_TRACE1(event, a0); expect(event, 1, a0, 0, 0); } while (0)
+#define TRACE2(event, a0, a1)		do { SB_TRACE2(event, a0, a1); expect(event, 2, a0, a1, 0); } while (0)
+#define TRACE3(event, a0, a1, a2)	do { SB_TRACE3(event, a0, a1, a2); expect(event, 3, a0, a1, a2); } while (0)
+
+/*
+ * Reads the characteristic, acknowledging each read, until it comes back empty. Each read is
+ * made twice: records must stay in the ring until they are acknowledged, and an acknowledgement
+ * that splits a record must be refused.
+ */
+static bool readOverBLE(uint8 *data, uint32 maxLen, uint32 *len, uint32 *reads) {
+	uint16 handle = SB_emuFindHandle(SB_BLE_TRACE_UUID, 0), partLen, againLen;
+	uint8 part[SB_EMU_MAX_ATT_VALUE], again[SB_EMU_MAX_ATT_VALUE], ack[2];
+
+	do {
+		if (SUCCESS != SB_emuReadLong(BENCH_CONN, handle, part, sizeof(part), &partLen) || *len + partLen > maxLen
+				|| SUCCESS != SB_emuReadLong(BENCH_CONN, handle, again, sizeof(again), &againLen)
+				|| againLen != partLen || memcmp(part, again, partLen)) {
+			return false;
+		}
+
+		if (partLen > 0) {
+			ack[0] = LO_UINT16(partLen - 4);
+			ack[1] = HI_UINT16(partLen - 4);
+			if (SUCCESS == SB_emuWrite(BENCH_CONN, handle, ack, sizeof(ack), true)) {
+				return false;
+			}
+
+			ack[0] = LO_UINT16(partLen);
+			ack[1] = HI_UINT16(partLen);
+			if (SUCCESS != SB_emuWrite(BENCH_CONN, handle, ack, sizeof(ack), true)) {
+				return false;
+			}
+		}
+
+		memcpy(&data[*len], part, partLen);
+		*len += partLen;
+		++*reads;
+	} while (partLen > 0);
+
+	return true;
+}
+
+static bool writeTraces(uint8 *data, uint32 maxLen, uint32 *len, uint32 *reads) {
+	uint32 fit = SB_TRACE_BUFFER_WORDS / SB_TRACE_RECORD_WORDS(3), i;
+
+	SB_emuInit(1, DEFAULT_DESIRED_MIN_CONN_INTERVAL, 4);
+
+	if (NoError != SB_flashInit(sizeof(SB_PeripheralReadings), true)) {
+		return false;
+	}
+
+	SimpleBLEPeripheral_init();
+
+	if (NoError != SB_readingsManagerInit()) {
+		return false;
+	}
+
+	SB_emuRunApp();
+	SB_emuConnect(BENCH_CONN, ATT_MTU_SIZE);
+	SB_emuRunApp();
+
+	// Only what is written from here on is expected
+	SB_traceInit();
+
+	// A sensing cycle
+	TRACE1(SB_TRACE_PMGR_LOOP, S_CHECK);
+	SB_emuAdvanceTicks(NTICKS_PER_MILLSECOND * 20);
+	TRACE2(SB_TRACE_PMGR_TEMPERATURE, 0, 31);
+	TRACE2(SB_TRACE_PMGR_TEMPERATURE_FAILED, 1, 2);
+	SB_emuAdvanceTicks(NTICKS_PER_MILLSECOND * 15);
+	TRACE2(SB_TRACE_PMGR_HUMIDITY, 45, 30);
+	TRACE1(SB_TRACE_PMGR_BATTERY, 3912);
+	TRACE1(SB_TRACE_PMGR_SAVE_FAILED, SanityCheckFailed);
+	TRACE2(SB_TRACE_PMGR_IOEXP_FAILED, 7, (uint32)-1);
+	TRACE0(SB_TRACE_BLE_ADVERTISING);
+
+	// The clock wraps between two records
+	for (i = 0; i < 4; ++i) {
+		SB_emuAdvanceTicks(0x50000000);
+	}
+	TRACE3(SB_TRACE_PMGR_WAKE_STATS, 1234, 3600, 417);
+	SB_emuAdvanceTicks(NTICKS_PER_MILLSECOND * 500);
+	TRACE2(SB_TRACE_RM_READINGS_READ, BENCH_CONN, 12);
+
+	if (!readOverBLE(data, maxLen, len, reads)) {
+		return false;
+	}
+
+	// Twice as many as fit: half are dropped, and counted with the next record once there is room
+	for (i = 0; i < 2 * fit; ++i) {
+		SB_TRACE3(SB_TRACE_PMGR_WAKE_STATS, i, i + 1, i + 2);
+		if (i < fit) {
+			expect(SB_TRACE_PMGR_WAKE_STATS, 3, i, i + 1, i + 2);
+		}
+		SB_emuAdvanceTicks(7);
+	}
+
+	if (!readOverBLE(data, maxLen, len, reads)) {
+		return false;
+	}
+
+	expect(SB_TRACE_DROPPED, 1, fit, 0, 0);
+	TRACE1(SB_TRACE_PMGR_LOOP, S_SLEEP);
+
+	return readOverBLE(data, maxLen, len, reads);
+}
+
+static double nsSince(const struct timespec *start) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1e9 + (now.tv_nsec - start->tv_nsec);
+}
+
+/*
+ * The cost of a record against formatting the same message, ns each. The ring is emptied between
+ * batches, outside the time taken.
+ */
+static void timeTrace(double *traceNs, double *printfNs) {
+	static uint8 scratch[SB_TRACE_BUFFER_WORDS * 4];
+	static char text[160];
+	uint32 fit = SB_TRACE_BUFFER_WORDS / SB_TRACE_RECORD_WORDS(3), b, i;
+	struct timespec start;
+	volatile uint32 sink = 0;
+
+	*traceNs = *printfNs = 0;
+
+	for (b = 0; b < BENCH_TIMING_BATCHES; ++b) {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (i = 0; i < fit; ++i) {
+			SB_TRACE3(SB_TRACE_PMGR_WAKE_STATS, b, i, b + i);
+		}
+		*traceNs += nsSince(&start);
+
+		sink += SB_traceRead(scratch, sizeof(scratch));
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (i = 0; i < fit; ++i) {
+			sink += snprintf(text, sizeof(text), events[SB_TRACE_PMGR_WAKE_STATS].format, b, i, b + i);
+		}
+		*printfNs += nsSince(&start);
+	}
+
+	*traceNs /= (double)BENCH_TIMING_BATCHES * fit;
+	*printfNs /= (double)BENCH_TIMING_BATCHES * fit;
+}
+
+static void usage(const char *name) {
+	fprintf(stderr, "Usage: %s [-v] [-o dump_file]\n"
+	                "       %s -f dump_file\n"
+	                "       %s -b uart_capture\n", name, name, name);
+}
+
+int main(int argc, char **argv) {
+	static uint8 data[BENCH_MAX_BYTES];
+	static Record records[BENCH_MAX_RECORDS];
+	const char *hexPath = NULL, *binaryPath = NULL, *outPath = NULL;
+	char got[160], want[160];
+	uint32 len = 0, reads = 0, skipped, n, i;
+	uint16 hexLen;
+	double traceNs, printfNs;
+	int opt, failures = 0;
+
+	while (-1 != (opt = getopt(argc, argv, "f:b:o:vh"))) {
+		switch (opt) {
+		case 'f':
+			hexPath = optarg;
+			break;
+
+		case 'b':
+			binaryPath = optarg;
+			break;
+
+		case 'o':
+			outPath = optarg;
+			break;
+
+		case 'v':
+			SB_emuVerbose = true;
+			break;
+
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	if (NULL != hexPath) {
+		if (!SB_readHexFile(hexPath, data, 0xFFFF, &hexLen)) {
+			return 2;
+		}
+		len = hexLen;
+	} else if (NULL != binaryPath) {
+		if (!readBinaryFile(binaryPath, data, sizeof(data), &len)) {
+			return 2;
+		}
+	} else if (!writeTraces(data, sizeof(data), &len, &reads)) {
+		printf("FAILED: traces could not be read over BLE\n");
+		return 1;
+	}
+
+	n = decode(data, len, records, BENCH_MAX_RECORDS, &skipped);
+
+	if (NULL != hexPath || NULL != binaryPath) {
+		printRecords(records, n);
+		if (skipped) {
+			fprintf(stderr, "%u bytes skipped\n", skipped);
+		}
+		return 0;
+	}
+
+	if (NULL != outPath && (len > 0xFFFF || !SB_writeHexFile(outPath, data, len))) {
+		return 2;
+	}
+
+	if (SB_emuVerbose) {
+		printRecords(records, n);
+	}
+
+	// What was read must be what was written, in order, with the drops counted
+	if (0 != skipped || n != numExpected) {
+		printf("FAILED: %u records decoded, %u bytes skipped, %u written\n", n, skipped, numExpected);
+		++failures;
+	}
+
+	for (i = 0; i < n && i < numExpected; ++i) {
+		format(&records[i], got, sizeof(got));
+		format(&expected[i], want, sizeof(want));
+
+		if (records[i].ticks != expected[i].ticks || strcmp(got, want)) {
+			printf("FAILED: record %u is \"%s\" at %u, should be \"%s\" at %u\n", i, got, records[i].ticks, want, expected[i].ticks);
+			++failures;
+			break;
+		}
+	}
+
+	timeTrace(&traceNs, &printfNs);
+
+	printf("%-10s %8s %8s %8s\n", "records", "bytes", "reads", "ring_B");
+	printf("%-10u %8u %8u %8u\n", n, len, reads, SB_TRACE_BUFFER_WORDS * 4);
+	printf("%-10s %8s\n", "log", "ns/rec");
+	printf("%-10s %8.1f\n", "trace", traceNs);
+	printf("%-10s %8.1f\n", "snprintf", printfNs);
+
+	if (traceNs >= printfNs) {
+		printf("FAILED: a trace record costs as much as formatting the message\n");
+		++failures;
+	}
+
+	return failures ? 1 : 0;
+}
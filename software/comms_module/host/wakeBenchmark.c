@@ -0,0 +1,231 @@
+/*
+ * wakeBenchmark.c
+ *
+ * Counts how often the sensing loop wakes the device over some hours of virtual time, with the
+ * sleeps peripheralManager.c used to make and with the wake scheduler it now goes through.
+ *
+ * The old loop slept CheckSleepIntervalMS on every pass through the state machine, so a reading
+ * took two sleeps. It is run at half the interval so that both loops take about as many readings;
+ * it also fell behind by the time each cycle took. Sensor and radio work is modelled as busy
+ * time, the same for both.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/knl/Task.h>
+
+#include "Board.h"
+#include "scheduler.h"
+#include "emulator.h"
+
+#define MS(ms)                    (NTICKS_PER_MILLSECOND * (ms))
+
+#define BENCH_DEFAULT_HOURS       1
+#define BENCH_INIT_MS             20      // initPeripherals()
+#define BENCH_READ_MS             30      // readSensorData() up to the humidity sensor
+#define BENCH_HUMIDITY_MS         5       // readSensorData() from the humidity sensor
+#define BENCH_TRANSMIT_MS         2000    // An S_TRANSMIT cycle
+#define BENCH_SENSOR_READY_MS     15      // HDC1050 conversion, from the end of initialization
+
+// What is left of the humidity conversion when readSensorData() gets to it
+#define BENCH_SENSOR_WAIT_MS(delayMs) \
+	((delayMs) + BENCH_READ_MS < BENCH_SENSOR_READY_MS ? BENCH_SENSOR_READY_MS - (delayMs) - BENCH_READ_MS : 0)
+
+typedef struct {
+	uint32 readings;
+	uint32 wakeups;
+	uint32 lastWake;
+	bool woken;
+} BenchCount;
+
+static BenchCount count;
+static Clock_Struct sysdisblClock;
+
+static void countWake() {
+	uint32 now = Clock_getTicks();
+
+	// Everything that ends on the same tick shares the wake
+	if (!count.woken || now != count.lastWake) {
+		++count.wakeups;
+		count.lastWake = now;
+		count.woken = true;
+	}
+}
+
+static void sysdisblClockHandler(UArg arg) {
+	countWake();
+}
+
+static void busy(uint32 ms) {
+	SB_emuAdvanceTicks(MS(ms));
+}
+
+/*
+ * The loop as it was: every sleep a wake of its own
+ */
+static void legacySleep(uint32 ticks) {
+	if (ticks > 0) {
+		Task_sleep(ticks);
+		countWake();
+	}
+}
+
+static void runLegacy(uint64_t endTicks, uint32 intervalMs, uint32 delayMs, uint8 bleInterval) {
+	uint8 nChecks = 0;
+
+	// The sys disable refresh hold at start up
+	Clock_setTimeout(Clock_handle(&sysdisblClock), MS(SYSDSBL_REFRESH_CLOCK_PERIOD));
+	Clock_start(Clock_handle(&sysdisblClock));
+
+	while (SB_emuTicks() < endTicks) {
+		// S_SLEEP
+		legacySleep(MS(intervalMs / 2));
+
+		if (++nChecks < bleInterval) {
+			// S_CHECK
+			legacySleep(MS(intervalMs / 2));
+			busy(BENCH_INIT_MS);
+			legacySleep(MS(delayMs));
+			busy(BENCH_READ_MS);
+			legacySleep(MS(BENCH_SENSOR_WAIT_MS(delayMs)));
+			busy(BENCH_HUMIDITY_MS);
+			++count.readings;
+		} else {
+			// S_TRANSMIT
+			legacySleep(MS(intervalMs / 2));
+			busy(BENCH_TRANSMIT_MS);
+			nChecks = 0;
+		}
+	}
+}
+
+/*
+ * The loop as it is now
+ */
+static void scheduledSleep(SB_WakeSource source, uint32 minTicks, uint32 maxTicks) {
+	uint32 start = Clock_getTicks();
+
+	if (minTicks > 0) {
+		SB_schedulerSleep(source, minTicks, maxTicks);
+	}
+
+	if (Clock_getTicks() != start) {
+		countWake();
+	}
+}
+
+static void scheduledWaitCycle(uint32 periodTicks) {
+	uint32 start = Clock_getTicks();
+
+	SB_schedulerWaitCycle(periodTicks);
+
+	if (Clock_getTicks() != start) {
+		countWake();
+	}
+}
+
+static void runScheduled(uint64_t endTicks, uint32 intervalMs, uint32 delayMs, uint8 bleInterval) {
+	uint8 nChecks = 0;
+
+	SB_schedulerInit(MS(intervalMs));
+
+	Clock_setTimeout(Clock_handle(&sysdisblClock), SB_schedulerAlign(SB_WAKE_SYSDSBL,
+		MS(SYSDSBL_REFRESH_CLOCK_PERIOD), MS(SYSDSBL_REFRESH_CLOCK_PERIOD + intervalMs)));
+	Clock_start(Clock_handle(&sysdisblClock));
+
+	while (SB_emuTicks() < endTicks) {
+		// S_SLEEP
+		scheduledWaitCycle(MS(intervalMs));
+
+		if (++nChecks < bleInterval) {
+			// S_CHECK
+			busy(BENCH_INIT_MS);
+			scheduledSleep(SB_WAKE_READ_DELAY, MS(delayMs), 2 * MS(delayMs));
+			busy(BENCH_READ_MS);
+			scheduledSleep(SB_WAKE_SENSOR_READY, MS(BENCH_SENSOR_WAIT_MS(delayMs)), MS(BENCH_SENSOR_WAIT_MS(delayMs)));
+			busy(BENCH_HUMIDITY_MS);
+			++count.readings;
+		} else {
+			// S_TRANSMIT
+			busy(BENCH_TRANSMIT_MS);
+			nChecks = 0;
+		}
+	}
+}
+
+static void usage(const char *name) {
+	fprintf(stderr, "Usage: %s [-H hours] [-i interval_ms] [-d read_delay_ms] [-b ble_interval]\n", name);
+}
+
+int main(int argc, char **argv) {
+	uint32 hours = BENCH_DEFAULT_HOURS, intervalMs = 1000, delayMs = 0, bleInterval = 10;
+	uint32 legacyReadings, legacyWakeups;
+	uint64_t start;
+	SB_WakeStats stats;
+	Clock_Params clockParams;
+	int opt, failures = 0;
+
+	while (-1 != (opt = getopt(argc, argv, "H:i:d:b:h"))) {
+		switch (opt) {
+		case 'H':
+			hours = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'i':
+			intervalMs = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'd':
+			delayMs = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'b':
+			bleInterval = strtoul(optarg, NULL, 0);
+			break;
+
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	if (0 == hours || intervalMs < 2 || intervalMs > 0xFFFF || 0 == bleInterval || bleInterval > 0xFF) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	Clock_Params_init(&clockParams);
+	Clock_construct(&sysdisblClock, sysdisblClockHandler, 0, &clockParams);
+
+	start = SB_emuTicks();
+	runLegacy(start + (uint64_t)hours * 3600 * NTICKS_PER_SECOND, intervalMs, delayMs, bleInterval);
+	legacyReadings = count.readings;
+	legacyWakeups = count.wakeups;
+
+	count = (BenchCount){ 0 };
+	start = SB_emuTicks();
+	runScheduled(start + (uint64_t)hours * 3600 * NTICKS_PER_SECOND, intervalMs, delayMs, bleInterval);
+	SB_schedulerGetStats(&stats);
+
+	printf("%-10s %10s %10s %10s %10s\n", "loop", "readings/h", "wakeups/h", "per read", "merged");
+	printf("%-10s %10u %10u %10.2f %10s\n", "legacy", legacyReadings / hours, legacyWakeups / hours,
+		(double)legacyWakeups / legacyReadings, "-");
+	printf("%-10s %10u %10u %10.2f %10u\n", "scheduled", count.readings / hours, stats.wakeupsPerHour,
+		(double)stats.wakeups / count.readings, stats.merged);
+
+	// The counters the device reports must match the wakes seen from outside
+	if (stats.wakeups != count.wakeups) {
+		printf("FAILED: scheduler counted %u wakeups, %u seen\n", stats.wakeups, count.wakeups);
+		++failures;
+	}
+
+	if ((uint64_t)stats.wakeups * legacyReadings >= (uint64_t)legacyWakeups * count.readings) {
+		printf("FAILED: no fewer wakeups per reading than the old loop\n");
+		++failures;
+	}
+
+	return failures ? 1 : 0;
+}
@@ -1,37 +1,260 @@
 // Test program to test the states of the Finite State Machine
+//
+// Built and run by the host harness (software/comms_module/host, `make check`). Drives every
+// state and event through SB_handleEvent and checks the next state, the callbacks run and the
+// transition trace, then times dispatch against the linked list walk fsm.c used to do.
 
 #include <stdbool.h>
 #include <stdio.h>
-#include "fsm.c"
+#include <stdlib.h>
+#include <time.h>
 
+#include "fsm.h"
+#include "emulator.h"
 
-//where things will actually be happening
-void main(void) {
-//start out in the initialize state
-    currentState = S_INIT;
+#define BENCH_TRANSITIONS	2000000
+#define BENCH_CALLBACKS		5
 
-    // iterate through the states
-    for(int i = 0; i < STATES; i++) {
+static const char *stateNames[SB_NUM_STATES] = { "sleep", "check", "transmit", "error_temp", "error_perm", "init" };
 
-        //iterate through each event 
-        for(int j = 0; j <EVENTS; j++) {
-            if (((j >= 0) && (j < EVENTS)) && ((i >= 0) && (i < STATES))) {
-                state_table[i][j] ();
-            
-                printf("\n%d %d", i, j);
-                printf("\ncurrent state: ");
-                printf("%d", currentState);
-                
-            }
-            else {
-            // value outside range of LUT. call error - not necessarily same as error from bandage
-            errorEvent();
-            }
-        }
-    }   
+// Next state for every state and event, written out independently of fsm.c
+static const SB_State expected[SB_NUM_STATES][SB_NUM_EVENTS] = {
+	//              check timer    ble timer    data change  no bandage    error         cycle complete
+	[S_SLEEP]      = { S_CHECK,      S_TRANSMIT,  S_TRANSMIT,  S_ERROR_TEMP, S_ERROR_TEMP, S_SLEEP },
+	[S_CHECK]      = { S_CHECK,      S_TRANSMIT,  S_TRANSMIT,  S_ERROR_TEMP, S_ERROR_TEMP, S_SLEEP },
+	[S_TRANSMIT]   = { S_CHECK,      S_TRANSMIT,  S_TRANSMIT,  S_ERROR_TEMP, S_ERROR_TEMP, S_SLEEP },
+	[S_ERROR_TEMP] = { S_CHECK,      S_TRANSMIT,  S_TRANSMIT,  S_ERROR_TEMP, S_ERROR_TEMP, S_SLEEP },
+	[S_ERROR_PERM] = { S_ERROR_PERM, S_ERROR_PERM, S_ERROR_PERM, S_ERROR_PERM, S_ERROR_PERM, S_ERROR_PERM },
+	[S_INIT]       = { S_CHECK,      S_TRANSMIT,  S_TRANSMIT,  S_ERROR_TEMP, S_ERROR_TEMP, S_SLEEP },
+};
+
+// Callbacks seen since the last reset, in order
+static struct {
+	SB_State_Transition transition;
+	SB_State state;
+} seen[8];
+static int nSeen;
+static volatile uint32_t benchCalls;
+
+static void recordCallback(SB_State_Transition transition, SB_State state) {
+	if (nSeen < sizeof(seen)/sizeof(seen[0])) {
+		seen[nSeen].transition = transition;
+		seen[nSeen].state = state;
+	}
+	++nSeen;
+}
+
+static void countCallback(SB_State_Transition transition, SB_State state) {
+	++benchCalls;
+}
+
+static bool expectCallback(int i, SB_State_Transition transition, SB_State state) {
+	return i < nSeen && seen[i].transition == transition && seen[i].state == state;
+}
+
+// Puts the machine in the given state, directly since S_ERROR_PERM cannot be left through events
+static void enterState(SB_State state) {
+	SB_switchState(state);
+	nSeen = 0;
+}
+
+static int testTransitions() {
+	SB_FsmTraceEntry entry;
+	uint32_t count;
+	int s, e, t, failures = 0;
+
+	for (t = 0; t < SB_NUM_TRANSITIONS; ++t) {
+		for (s = 0; s < SB_NUM_STATES; ++s) {
+			if (NoError != SB_registerStateTransitionCallback(recordCallback, t, s)) {
+				printf("registering a callback failed\n");
+				return 1;
+			}
+		}
+	}
+
+	for (s = 0; s < SB_NUM_STATES; ++s) {
+		for (e = 0; e < SB_NUM_EVENTS; ++e) {
+			SB_State next;
+
+			enterState(s);
+			SB_emuAdvanceTicks(100 * (s + 1));
+			count = SB_fsmTransitionCount();
+
+			next = SB_handleEvent(e);
+
+			if (next != expected[s][e] || SB_currentState() != next) {
+				printf("%s + event %d: went to %s, expected %s\n", stateNames[s], e, stateNames[next], stateNames[expected[s][e]]);
+				++failures;
+				continue;
+			}
+
+			if (4 != nSeen || !expectCallback(0, T_STATE_PRE_EXIT, s) || !expectCallback(1, T_STATE_PRE_ENTER, next)
+					|| !expectCallback(2, T_STATE_EXIT, s) || !expectCallback(3, T_STATE_ENTER, next)) {
+				printf("%s + event %d: wrong callbacks (%d)\n", stateNames[s], e, nSeen);
+				++failures;
+			}
+
+			if (SB_fsmTransitionCount() != count + 1 || 0 == SB_fsmGetTrace(&entry, 1)) {
+				printf("%s + event %d: transition not traced\n", stateNames[s], e);
+				++failures;
+			}
+		}
+	}
+
+	// A permanent error escalates E_ERROR
+	enterState(S_SLEEP);
+	SB_setError(OutOfMemory);
+	if (S_ERROR_PERM != SB_handleEvent(E_ERROR)) {
+		printf("error: out of memory is not permanent\n");
+		++failures;
+	}
+
+	enterState(S_SLEEP);
+	SB_setError(OperationTimeout);
+	if (S_ERROR_TEMP != SB_handleEvent(E_ERROR)) {
+		printf("error: timeout is not temporary\n");
+		++failures;
+	}
+
+	// Events outside the table are a permanent error
+	enterState(S_CHECK);
+	if (S_ERROR_PERM != SB_handleEvent(SB_NUM_EVENTS)) {
+		printf("invalid event not rejected\n");
+		++failures;
+	}
+
+	return failures;
 }
 
+static int testTrace() {
+	SB_FsmTraceEntry entries[SB_FSM_TRACE_SIZE + 4];
+	uint32_t start;
+	uint8_t n, i;
+	int failures = 0;
 
+	// Fill the trace with a known sleep -> check -> sleep cycle, 1000 ticks in each state
+	enterState(S_SLEEP);
+	for (i = 0; i < SB_FSM_TRACE_SIZE; ++i) {
+		SB_emuAdvanceTicks(1000);
+		SB_handleEvent(i & 1 ? E_CYCLE_COMPLETE : E_CHECK_TIMER_EXPIRED);
+	}
 
+	n = SB_fsmGetTrace(entries, sizeof(entries)/sizeof(entries[0]));
+	if (SB_FSM_TRACE_SIZE != n) {
+		printf("trace: %u entries, expected %u\n", n, SB_FSM_TRACE_SIZE);
+		return 1;
+	}
 
-    
+	start = entries[0].ticks;
+	for (i = 0; i < n; ++i) {
+		SB_State to = i & 1 ? S_SLEEP : S_CHECK;
+
+		if (entries[i].to != to || entries[i].ticks - start != 1000u * i
+				|| entries[i].event != (i & 1 ? E_CYCLE_COMPLETE : E_CHECK_TIMER_EXPIRED)) {
+			printf("trace: entry %u is %u -> %u at +%u\n", i, entries[i].from, entries[i].to, entries[i].ticks - start);
+			++failures;
+		}
+	}
+
+	return failures;
+}
+
+/*
+ * The callback list fsm.c used to keep: every transition walked the whole list once per stage.
+ */
+typedef struct ListCallback {
+	struct ListCallback *next;
+	SB_StateTransitionCallbackFunc function;
+	SB_State_Transition transition;
+	SB_State state;
+} ListCallback;
+
+static ListCallback *listCallbacks;
+
+static void listCall(SB_State_Transition transition, SB_State state) {
+	ListCallback *current;
+
+	for (current = listCallbacks; NULL != current; current = current->next) {
+		if (transition == current->transition && state == current->state && NULL != current->function) {
+			current->function(transition, state);
+		}
+	}
+}
+
+static double elapsedNs(const struct timespec *start) {
+	struct timespec end;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	return (end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec);
+}
+
+static void benchmark() {
+	// The callbacks peripheralManager.c registers
+	static const struct { SB_State_Transition transition; SB_State state; } registrations[BENCH_CALLBACKS] = {
+		{ T_STATE_PRE_ENTER, S_SLEEP }, { T_STATE_PRE_ENTER, S_TRANSMIT }, { T_STATE_PRE_ENTER, S_CHECK },
+		{ T_STATE_EXIT, S_SLEEP }, { T_STATE_PRE_EXIT, S_TRANSMIT },
+	};
+	static const SB_Event cycle[] = { E_CHECK_TIMER_EXPIRED, E_CYCLE_COMPLETE, E_BLE_TIMER_EXPIRED, E_CYCLE_COMPLETE };
+	static const SB_State cycleStates[] = { S_CHECK, S_SLEEP, S_TRANSMIT, S_SLEEP };
+	struct timespec start;
+	double tableNs, listNs;
+	uint32_t tableCalls, i;
+	int r;
+
+	for (r = 0; r < BENCH_CALLBACKS; ++r) {
+		ListCallback *node = calloc(1, sizeof(ListCallback));
+
+		node->function = countCallback;
+		node->transition = registrations[r].transition;
+		node->state = registrations[r].state;
+		node->next = listCallbacks;
+		listCallbacks = node;
+	}
+
+	for (r = 0; r < BENCH_CALLBACKS; ++r) {
+		SB_registerStateTransitionCallback(countCallback, registrations[r].transition, registrations[r].state);
+	}
+
+	SB_switchState(S_SLEEP);
+	benchCalls = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < BENCH_TRANSITIONS; ++i) {
+		SB_handleEvent(cycle[i & 3]);
+	}
+	tableNs = elapsedNs(&start) / BENCH_TRANSITIONS;
+	tableCalls = benchCalls;
+
+	// Same cycle with the list dispatch
+	benchCalls = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < BENCH_TRANSITIONS; ++i) {
+		static SB_State current = S_SLEEP;
+		SB_State next = cycleStates[i & 3];
+
+		listCall(T_STATE_PRE_EXIT, current);
+		listCall(T_STATE_PRE_ENTER, next);
+		listCall(T_STATE_EXIT, current);
+		listCall(T_STATE_ENTER, next);
+		current = next;
+	}
+	listNs = elapsedNs(&start) / BENCH_TRANSITIONS;
+
+	printf("%-10s %12s %14s %10s\n", "dispatch", "transitions", "ns/transition", "callbacks");
+	printf("%-10s %12u %14.1f %10u\n", "list", BENCH_TRANSITIONS, listNs, benchCalls);
+	printf("%-10s %12u %14.1f %10u%s\n", "table", BENCH_TRANSITIONS, tableNs, tableCalls,
+		tableCalls == benchCalls ? "" : "  FAILED");
+}
+
+int main(int argc, char **argv) {
+	int failures = 0;
+
+	// Timed first, with only the benchmark callbacks registered
+	benchmark();
+
+	failures += testTransitions();
+	failures += testTrace();
+
+	printf("fsm: %d states x %d events, %d failures\n", SB_NUM_STATES, SB_NUM_EVENTS, failures);
+
+	return failures ? 1 : 0;
+}